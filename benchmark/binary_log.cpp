@@ -0,0 +1,64 @@
+// Compares cost per record and size on disk of FileLog and BinaryLog
+//
+// usage: binary_log [records]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+#include "../library/log_binary.hpp"
+
+long long FileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long long)st.st_size : 0;
+}
+
+int main(int argc, char** argv) {
+    
+    long records = argc > 1 ? atol(argv[1]) : 1000000;
+    
+    logger::BindLogDirectory("./");
+    
+    std::string user = "user-42";
+    
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    for(long i = 0; i < records; ++i) {
+        FileLog(logger::T_INFO, user, i, 3.25);
+    }
+    logger::Flush();
+    
+    double file_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count() / records;
+    
+    
+    start = std::chrono::steady_clock::now();
+    
+    for(long i = 0; i < records; ++i) {
+        BinaryLog(logger::T_INFO, user, i, 3.25);
+    }
+    logger::FlushBinaryLog();
+    
+    double binary_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count() / records;
+    
+    
+    logger::log_path path;
+    time_t now = logger::Now().seconds;
+    
+    path.Reset("./");
+    long long file_bytes = FileSize(path.Resolve(now));
+    
+    path.Reset("./", ".bin");
+    long long binary_bytes = FileSize(path.Resolve(now));
+    
+    printf("records      %ld\n", records);
+    printf("FileLog      %8.1f ns/record  %12lld bytes\n", file_ns, file_bytes);
+    printf("BinaryLog    %8.1f ns/record  %12lld bytes\n", binary_ns, binary_bytes);
+    printf("speedup      %8.1fx           %11.1fx smaller\n", file_ns / binary_ns,
+           binary_bytes ? (double)file_bytes / binary_bytes : 0.0);
+    
+    return 0;
+}
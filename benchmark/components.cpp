@@ -0,0 +1,199 @@
+// Measures cost per operation and heap allocations per operation of
+// the formatting and sink components
+//
+// usage: components [filter]   - run only benchmarks whose name contains filter
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <streambuf>
+#include <string>
+#include "../library/log_console.hpp"
+#include "../library/log_file.hpp"
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"   // operator new below is malloc
+#endif
+
+std::atomic<long long> allocations(0);
+
+void* operator new(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// keeps results of benchmarked calls alive
+volatile size_t sink = 0;
+
+void Keep(size_t x) { sink = sink + x; }
+
+class null_buffer : public std::streambuf {
+protected:
+    int_type        overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+class Point {
+    int x_, y_;
+public:
+    Point(int x, int y) : x_(x), y_(y) {}
+    friend std::ostream& operator<<(std::ostream& os, const Point& p) {
+        return os << '(' << p.x_ << ", " << p.y_ << ')';
+    }
+};
+
+const char* filter = nullptr;
+
+// runs @op until it takes at least 200 ms and prints ns/op and allocations/op
+template <class Op>
+void Run(const char* name, Op op) {
+
+    if(filter && !strstr(name, filter)) return;
+
+    for(int i = 0; i < 1000; ++i) op();     // warm up caches and thread local buffers
+
+    long long iterations = 1000;
+
+    for(;;) {
+        long long allocated = allocations.load();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for(long long i = 0; i < iterations; ++i) op();
+
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count();
+
+        if(ns >= 200000000 || iterations >= (1LL << 32)) {
+            printf("%-44s %10.1f ns/op %8.2f allocs/op\n", name, (double)ns / iterations,
+                   (double)(allocations.load() - allocated) / iterations);
+            return;
+        }
+
+        iterations *= ns > 0 && 400000000 / ns < 10 ? 400000000 / ns + 1 : 10;
+    }
+}
+
+int main(int argc, char** argv) {
+
+    filter = argc > 1 ? argv[1] : nullptr;
+
+    null_buffer     null;
+    std::streambuf* console = std::cout.rdbuf(&null);  // ConsoleLog output is discarded
+
+    logger::SetConsoleColors(logger::CC_ALWAYS);      // output is not a terminal
+    logger::BindConsoleStyle("Foo", logger::BG_WHITE, logger::FG_RED, logger::BOLD);
+    logger::BindConsoleStyle("Bar", logger::UNDERLINE);
+    logger::BindLogDirectory("./");
+
+    std::string text  = "user-42";
+    Point       point(3, 4);
+
+
+    // format string parsing
+    const char* shapes[][2] = {
+        { "compile: plain text",        "connection to the server established" },
+        { "compile: one %v",            "value %v" },
+        { "compile: four %v",           "%v + %v = %v (%v)" },
+        { "compile: date and time",     "[%dd.%mm.%yyyy %h:%m:%s.%ms] %v" },
+        { "compile: macros",            "%FILE:%FUNC:%LINE %v" },
+        { "compile: styled",            "%.Foo([%h:%m:%s]%) -> %v" },
+    };
+
+    for(size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i) {
+        const char* s = shapes[i][1];
+        size_t      n = strlen(s);
+
+        Run(shapes[i][0], [&]{
+            logger::format_program program;
+            logger::CompileFormat(s, n, program);
+            Keep(program.ops.size());
+        });
+    }
+
+    Run("cached format lookup", [&]{ Keep(logger::CachedFormat("%v + %v = %v (%v)")->ops.size()); });
+
+
+    // conversion of arguments
+    Run("ProcessVars: int",                 [&]{ logger::var_buffer b; logger::ProcessVars(&b, 42); Keep(b.Count()); });
+    Run("ProcessVars: double",              [&]{ logger::var_buffer b; logger::ProcessVars(&b, 3.25); Keep(b.Count()); });
+    Run("ProcessVars: const char*",         [&]{ logger::var_buffer b; logger::ProcessVars(&b, "literal"); Keep(b.Count()); });
+    Run("ProcessVars: std::string",         [&]{ logger::var_buffer b; logger::ProcessVars(&b, text); Keep(b.Count()); });
+    Run("ProcessVars: operator<<",          [&]{ logger::var_buffer b; logger::ProcessVars(&b, point); Keep(b.Count()); });
+    Run("ProcessVars: 4 mixed",             [&]{ logger::var_buffer b; logger::ProcessVars(&b, 42, 3.25, text, point); Keep(b.Count()); });
+    Run("ProcessVars: 8 ints",              [&]{ logger::var_buffer b; logger::ProcessVars(&b, 1, 2, 3, 4, 5, 6, 7, 8); Keep(b.Count()); });
+
+    logger::var_buffer reused;
+
+    Run("ProcessVars: 4 mixed, reused buffer", [&]{ reused.Clear(); logger::ProcessVars(&reused, 42, 3.25, text, point); Keep(reused.Count()); });
+    Run("ProcessJsonVars: 4 kv, reused buffer", [&]{ reused.Clear(); logger::ProcessJsonVars(&reused, "served", logger::kv("user", 42), logger::kv("ms", 3.25), logger::kv("name", text), logger::kv("at", point)); Keep(reused.Count()); });
+
+
+    // JSON string escaping
+    std::string json;
+    std::string clean   = "connection to the server established in 3.25 ms by user-42";
+    std::string escaped = "path \"C:\\logs\"\tline one\nline two";
+
+    Run("AppendJsonString: 58 clean bytes", [&]{ json.clear(); logger::AppendJsonString(json, clean.data(), clean.length()); Keep(json.length()); });
+    Run("AppendJsonString: with escapes",   [&]{ json.clear(); logger::AppendJsonString(json, escaped.data(), escaped.length()); Keep(json.length()); });
+
+
+    // helpers
+    Run("StrToLen: pad to 6",               [&]{ Keep(logger::StrToLen(std::to_string(42), 6, '0').length()); });
+    Run("StrToLen: already long",           [&]{ Keep(logger::StrToLen(std::string("1234567"), 6, '0').length()); });
+
+
+    // styles
+    std::string styled;
+
+    Run("style: find by name",              [&]{ Keep(logger::FindStyle("Foo", 3)->id); });
+    Run("style: apply 3 modifiers",         [&]{ styled.clear(); logger::AppendSgr(styled, 0, logger::ApplyStyle(0, *logger::FindStyle("Foo", 3))); Keep(styled.length()); });
+
+
+    // whole ConsoleLog calls, output is discarded
+    Run("ConsoleLog: plain text",           [&]{ Keep(ConsoleLog("connection to the server established")); });
+    Run("ConsoleLog: int",                  [&]{ Keep(ConsoleLog("value %v", 42)); });
+    Run("ConsoleLog: 4 mixed",              [&]{ Keep(ConsoleLog("%v + %v = %v (%v)", 42, 3.25, text, point)); });
+    Run("ConsoleLog: date and time",        [&]{ Keep(ConsoleLog("[%dd.%mm.%yyyy %h:%m:%s.%ms] %v", 42)); });
+    Run("ConsoleLog: styled",               [&]{ Keep(ConsoleLog("%.Foo([%h:%m:%s]%) -> %v", 42)); });
+    Run("ConsoleLog: nested styles",        [&]{ Keep(ConsoleLog("%.Foo(a %.Bar(b%) c%)%.Bar(d%) %v", 42)); });
+
+    logger::SetConsoleColors(logger::CC_NEVER);
+
+    Run("ConsoleLog: styled, plain output", [&]{ Keep(ConsoleLog("%.Foo([%h:%m:%s]%) -> %v", 42)); });
+
+    logger::SetConsoleColors(logger::CC_ALWAYS);
+    Run("ConsoleLog: runtime string",       [&]{ std::string s = "value %v"; Keep(ConsoleLog(s, 42)); });
+
+
+    // file path resolution and whole FileLog calls
+    logger::log_path path;
+    time_t           now = logger::Now().seconds;
+
+    path.Reset("./");
+
+    Run("log_path: Resolve",                [&]{ Keep(path.Resolve(now).length()); });
+    Run("log_path: Expired",                [&]{ Keep(path.Expired(now)); });
+
+    Run("FileLog: int",                     [&]{ Keep(FileLog(logger::T_INFO, 42)); });
+    Run("FileLog: 4 mixed",                 [&]{ Keep(FileLog(logger::T_INFO, 42, 3.25, text, point)); });
+
+    logger::EnableJsonFileLog();
+
+    Run("FileLog: json, 4 kv",              [&]{ Keep(FileLog(logger::T_INFO, "served", logger::kv("user", 42), logger::kv("ms", 3.25), logger::kv("name", text), logger::kv("at", point))); });
+
+    logger::SetLogLevel(logger::T_ERROR);
+
+    Run("FileLog: filtered out",            [&]{ Keep(FileLog(logger::T_INFO, 42, 3.25, text, point)); });
+
+    std::cout.rdbuf(console);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+// Drives FileLog and ConsoleLog from several threads at a target rate and reports
+// caller side latency percentiles and sustained throughput
+//
+// usage: load [threads=4] [rate=100000] [seconds=5] [burst=1] [mode=sync|async] [sink=file|console|both]
+//             [console=cout|line|bytes|periodic] [retention=0] [compress=0] [segment=0]
+//
+//      rate    - messages per second of all threads together, 0 - as fast as possible
+//      burst   - messages sent back to back every burst / rate * threads seconds
+//      mode    - sync: every thread writes its records itself, calls of several threads are
+//                serialized by the sink, so latency includes waiting for the other threads
+//                async: records are handed to the central flusher
+//      console - std::cout or flush policy of the direct console sink
+//      retention - EnableLogRetention(retention bytes) right before the first record, 0 - off
+//      compress  - EnableLogCompression(compress), 0 - off, needs LOGGER_ZLIB
+//      segment   - EnableSegmentFileLog(segment bytes), 0 - off
+//      console output is redirected to /dev/null
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../library/log_console.hpp"
+#include "../library/log_file.hpp"
+
+typedef std::chrono::steady_clock clock_type;
+
+// log-linear histogram of nanoseconds: 16 linear buckets per power of two,
+// values are reported with at most 1/16 relative error
+class histogram {
+public:
+
+    histogram() : counts_(64 * 16, 0), max_(0) {}
+
+    void Add(long long ns) {
+        unsigned long long v = ns > 0 ? (unsigned long long)ns : 0;
+        counts_[Index(v)]++;
+        max_ = std::max(max_, v);
+    }
+
+    void Merge(const histogram& other) {
+        for(size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+        max_ = std::max(max_, other.max_);
+    }
+
+    unsigned long long Count() const {
+        unsigned long long total = 0;
+        for(size_t i = 0; i < counts_.size(); ++i) total += counts_[i];
+        return total;
+    }
+
+    unsigned long long Percentile(double p) const {
+        unsigned long long rank  = (unsigned long long)(p / 100 * Count());
+        unsigned long long total = 0;
+
+        for(size_t i = 0; i < counts_.size(); ++i) {
+            total += counts_[i];
+            if(total > rank) return std::min(Upper(i), max_);
+        }
+
+        return max_;
+    }
+
+    unsigned long long Max() const { return max_; }
+
+private:
+
+    static size_t Index(unsigned long long v) {
+        if(v < 16) return (size_t)v;
+        int msb = 63 - __builtin_clzll(v);
+        return (size_t)(msb - 3) * 16 + (size_t)((v >> (msb - 4)) & 15);
+    }
+
+    static unsigned long long Upper(size_t i) {
+        if(i < 16) return i;
+        size_t msb = i / 16 + 3;
+        return ((16ULL + i % 16 + 1) << (msb - 4)) - 1;
+    }
+
+    std::vector<unsigned long long> counts_;
+    unsigned long long              max_;
+};
+
+struct options {
+    int         threads;
+    double      rate;
+    double      seconds;
+    int         burst;
+    std::string mode;
+    std::string sink;
+    std::string console;
+    double      retention;
+    double      compress;
+    double      segment;
+};
+
+options Parse(int argc, char** argv) {
+
+    options o = { 4, 100000, 5, 1, "sync", "file", "cout", 0, 0, 0 };
+
+    for(int i = 1; i < argc; ++i) {
+        const char* eq = strchr(argv[i], '=');
+
+        if(!eq) {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            exit(1);
+        }
+
+        std::string key(argv[i], eq - argv[i]);
+        const char* value = eq + 1;
+
+        if(key == "threads")      o.threads = std::max(1, atoi(value));
+        else if(key == "rate")    o.rate    = atof(value);
+        else if(key == "seconds") o.seconds = atof(value);
+        else if(key == "burst")   o.burst   = std::max(1, atoi(value));
+        else if(key == "mode")    o.mode    = value;
+        else if(key == "sink")    o.sink    = value;
+        else if(key == "console") o.console = value;
+        else if(key == "retention") o.retention = atof(value);
+        else if(key == "compress")  o.compress  = atof(value);
+        else if(key == "segment")   o.segment   = atof(value);
+        else {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    return o;
+}
+
+int main(int argc, char** argv) {
+
+    options o = Parse(argc, argv);
+
+    bool to_file    = o.sink == "file" || o.sink == "both";
+    bool to_console = o.sink == "console" || o.sink == "both";
+
+    logger::BindLogDirectory("./");
+
+    if(o.mode == "async") {
+        logger::EnableAsyncFileLog();
+        logger::EnableAsyncConsoleLog();
+    }
+
+
+    // console output goes to /dev/null, the report to the saved stdout
+    fflush(stdout);
+
+    int saved_stdout = dup(1);
+    int null         = open("/dev/null", O_WRONLY);
+
+    dup2(null, 1);
+    close(null);
+
+    if(o.console == "line")     logger::EnableDirectConsoleLog(1, logger::CF_LINE);
+    if(o.console == "bytes")    logger::EnableDirectConsoleLog(1, logger::CF_BYTES);
+    if(o.console == "periodic") logger::EnableDirectConsoleLog(1, logger::CF_PERIODIC);
+
+    if(o.segment > 0)   logger::EnableSegmentFileLog((size_t)o.segment);
+    if(o.compress > 0)  logger::EnableLogCompression(o.compress);
+    if(o.retention > 0) logger::EnableLogRetention((unsigned long long)o.retention, 0);
+
+
+    std::vector<histogram>   histograms(o.threads);
+    std::vector<std::thread> threads;
+    std::atomic<int>         ready(0);
+    std::atomic<bool>        go(false);
+
+    // time between bursts of one thread
+    double period = o.rate > 0 ? o.burst * o.threads / o.rate : 0;
+
+    clock_type::time_point start;
+
+    for(int t = 0; t < o.threads; ++t) {
+        threads.push_back(std::thread([&, t]{
+
+            histogram& h = histograms[t];
+
+            ready.fetch_add(1);
+            while(!go.load()) std::this_thread::yield();
+
+            clock_type::time_point end = start + std::chrono::duration_cast<clock_type::duration>(
+                                            std::chrono::duration<double>(o.seconds));
+
+            for(long long i = 0; ; ++i) {
+
+                // open loop schedule: burst i is due at start + i * period
+                if(period > 0) {
+                    clock_type::time_point due = start + std::chrono::duration_cast<clock_type::duration>(
+                                                    std::chrono::duration<double>(period * i));
+                    if(due >= end) break;
+                    std::this_thread::sleep_until(due);
+                }
+                else if(clock_type::now() >= end) break;
+
+                for(int b = 0; b < o.burst; ++b) {
+
+                    clock_type::time_point before = clock_type::now();
+
+                    if(to_file)    FileLog(logger::T_INFO, "request served", t, i, 3.25);
+                    if(to_console) ConsoleLog("request served %v %v %v", t, i, 3.25);
+
+                    h.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - before).count());
+                }
+            }
+        }));
+    }
+
+    while(ready.load() < o.threads) std::this_thread::yield();
+
+    start = clock_type::now();
+    go.store(true);
+
+    for(size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    double produced = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    logger::Flush();
+
+    double written = std::chrono::duration<double>(clock_type::now() - start).count();
+
+
+    std::cout.flush();
+    fflush(stdout);
+    dup2(saved_stdout, 1);
+    close(saved_stdout);
+
+
+    histogram total;
+
+    for(size_t i = 0; i < histograms.size(); ++i) total.Merge(histograms[i]);
+
+    unsigned long long calls = total.Count();
+
+    printf("threads %d  rate %.0f/s  burst %d  mode %s  sink %s  console %s\n", o.threads, o.rate, o.burst, o.mode.c_str(), o.sink.c_str(), o.console.c_str());
+    printf("calls        %llu\n", calls);
+    printf("throughput   %.0f calls/s produced, %.0f calls/s written\n", calls / produced, calls / written);
+    printf("latency p50  %llu ns\n", total.Percentile(50));
+    printf("latency p99  %llu ns\n", total.Percentile(99));
+    printf("latency p999 %llu ns\n", total.Percentile(99.9));
+    printf("latency max  %llu ns\n", total.Max());
+
+    return 0;
+}
@@ -0,0 +1,552 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_ASYNC_HPP
+#define LOG_ASYNC_HPP
+
+#include <cstddef>                  // size_t
+#include <vector>                   // std::vector
+#include <memory>                   // std::shared_ptr, std::make_shared
+#include <atomic>                   // std::atomic
+#include <thread>                   // std::thread, std::this_thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <condition_variable>       // std::condition_variable
+#include <chrono>                   // std::chrono::milliseconds, std::chrono::steady_clock
+
+namespace logger {
+
+    // template<T>
+    // @class spsc_ring
+    //
+    //
+    // @constructor spsc_ring(capacity) : capacity is rounded up to the power of two
+    //
+    //
+    // @method Full()
+    //      @return bool
+    //
+    //      return true if there is no free cell, producer only
+    //
+    // @method Push(value, sequence)
+    //      @return void
+    //
+    //      copy @value and its @sequence number into the ring, the ring must not be full
+    //      producer only
+    //
+    // @method Front(sequence)
+    //      @return T*
+    //
+    //      return the oldest value and put its sequence number to @sequence,
+    //      nullptr if the ring is empty, consumer only
+    //
+    // @method Pop()
+    //      @return void
+    //
+    //      release the value returned by Front, consumer only
+    //
+    //
+    // bounded lock-free single-producer single-consumer ring
+    // each side keeps a cached copy of the other side's position so the shared
+    // positions are read only when the cached one says the ring is full or empty
+    // values are copy-assigned so cells keep the memory they own
+    // and the ring does not allocate once it is warmed up
+
+    template <class T>
+    class spsc_ring {
+    public:
+
+        explicit spsc_ring(size_t);
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        bool    Full();
+        void    Push(const T&, size_t);
+        T*      Front(size_t&);
+        void    Pop();
+
+    private:
+
+        struct cell {
+            size_t  sequence;
+            T       data;
+        };
+
+        std::vector<cell>   cells_;
+        size_t              mask_;
+
+        char                pad0_[64];
+        std::atomic<size_t> tail_;          // written by the producer
+        size_t              head_cache_;    // producer's copy of @head_
+        char                pad1_[64];
+        std::atomic<size_t> head_;          // written by the consumer
+        size_t              tail_cache_;    // consumer's copy of @tail_
+        char                pad2_[64];
+
+    };
+
+
+
+
+    // template<T>
+    // @class async_worker
+    //
+    //
+    // @constructor async_worker(capacity, handler, flusher)
+    //      @param capacity - size_t        : maximum number of records waiting to be written per thread
+    //      @param handler  - bool(*)(T&)   : writes one record, may throw logger::error
+    //      @param flusher  - bool(*)()     : flushes everything written so far, also called every second while idle
+    //
+    //
+    // @method Push(record)
+    //      @return void
+    //
+    //      enqueue copy of @record, waits while the ring of the calling thread is full
+    //
+    // @method Flush()
+    //      @return bool
+    //
+    //      block until every record pushed before the call is handled and flushed
+    //      return false if some record failed since the previous Flush
+    //
+    //
+    // every producer thread gets its own ring on the first Push, so producers never
+    // touch each other's memory; records are numbered by one global counter and
+    // the background thread merges the rings and handles records in that order
+    // destructor drains the rings, flushes and joins the thread
+
+    template <class T>
+    class async_worker {
+    public:
+
+        typedef bool (*handler)(T&);
+        typedef bool (*flusher)();
+
+        async_worker(size_t, handler, flusher);
+        ~async_worker();
+
+        async_worker(const async_worker&) = delete;
+        async_worker& operator=(const async_worker&) = delete;
+
+        void Push(const T&);
+        bool Flush();
+
+    private:
+
+        // ring of one producer thread, kept until the thread exits and the ring is drained
+        struct stage {
+            explicit stage(size_t capacity) : ring(capacity), closed(false) {}
+
+            spsc_ring<T>        ring;
+            std::atomic<bool>   closed;
+        };
+
+        // ring of the calling thread, closes it when the thread exits
+        struct producer {
+            producer() : owner(0) {}
+            ~producer() { if(target) target->closed.store(true, std::memory_order_release); }
+
+            size_t                  owner;      // id of the worker @target belongs to
+            std::shared_ptr<stage>  target;
+        };
+
+        static producer&    Producer();
+        static size_t       NextId();
+
+        void                Run();
+        void                Collect(std::vector<std::shared_ptr<stage> >&);
+
+        size_t                  id_;
+        size_t                  capacity_;
+        handler                 handler_;
+        flusher                 flusher_;
+
+        std::vector<std::shared_ptr<stage> > stages_;   // guarded by @mutex_
+        std::atomic<bool>       stages_changed_;
+
+        char                    pad0_[64];
+        std::atomic<size_t>     sequence_;      // sequence number of the next record
+        char                    pad1_[64];
+        std::atomic<size_t>     processed_;     // records handled by the worker
+        std::atomic<size_t>     flush_ticket_;  // records that have to be flushed
+        std::atomic<size_t>     flushed_;       // records that are flushed
+        std::atomic<bool>       failed_;
+        std::atomic<bool>       stop_;
+
+        std::mutex              mutex_;
+        std::condition_variable wake_;          // wakes the worker
+        std::condition_variable done_;          // wakes Flush callers
+
+        std::thread             thread_;
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::spsc_ring
+
+template <class T>
+logger::spsc_ring<T>::spsc_ring(size_t capacity) : tail_(0), head_cache_(0), head_(0), tail_cache_(0) {
+
+    size_t size = 2;
+    while(size < capacity) size <<= 1;
+
+    cells_ = std::vector<cell>(size);
+    mask_  = size - 1;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Full
+
+template <class T>
+bool logger::spsc_ring<T>::Full() {
+
+    size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if(tail - head_cache_ <= mask_) return false;
+
+    head_cache_ = head_.load(std::memory_order_acquire);
+
+    return tail - head_cache_ > mask_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Push
+
+template <class T>
+void logger::spsc_ring<T>::Push(const T& value, size_t sequence) {
+
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    cell&  target = cells_[tail & mask_];
+
+    target.data     = value;
+    target.sequence = sequence;
+
+    tail_.store(tail + 1, std::memory_order_release);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Front
+
+template <class T>
+T* logger::spsc_ring<T>::Front(size_t& sequence) {
+
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    if(head == tail_cache_) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if(head == tail_cache_) return nullptr;
+    }
+
+    cell& target = cells_[head & mask_];
+
+    sequence = target.sequence;
+
+    return &target.data;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Pop
+
+template <class T>
+void logger::spsc_ring<T>::Pop() {
+
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::async_worker
+
+template <class T>
+logger::async_worker<T>::async_worker(size_t capacity, handler h, flusher f) :
+    id_(NextId()), capacity_(capacity), handler_(h), flusher_(f), stages_changed_(false),
+    sequence_(0), processed_(0), flush_ticket_(0), flushed_(0), failed_(false), stop_(false) {
+
+    thread_ = std::thread(&async_worker<T>::Run, this);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::~async_worker
+
+template <class T>
+logger::async_worker<T>::~async_worker() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    wake_.notify_one();
+
+    thread_.join();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Producer
+
+template <class T>
+typename logger::async_worker<T>::producer& logger::async_worker<T>::Producer() {
+
+    static thread_local producer p;
+
+    return p;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::NextId
+
+template <class T>
+size_t logger::async_worker<T>::NextId() {
+
+    static std::atomic<size_t> id(0);
+
+    return ++id;    // 0 is never used, so a fresh producer belongs to no worker
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Push
+
+template <class T>
+void logger::async_worker<T>::Push(const T& record) {
+
+    producer& p = Producer();
+
+    if(p.owner != id_) {
+        // first record of this thread
+        if(p.target) p.target->closed.store(true, std::memory_order_release);
+
+        p.target = std::make_shared<stage>(capacity_);
+        p.owner  = id_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stages_.push_back(p.target);
+        stages_changed_.store(true, std::memory_order_release);
+    }
+
+    spsc_ring<T>& ring = p.target->ring;
+
+    while(ring.Full()) {
+        // ring is full, let the worker catch up
+        wake_.notify_one();
+        std::this_thread::yield();
+    }
+
+    // numbered only when the record can be published at once,
+    // so the worker never waits for a record stuck behind a full ring
+    ring.Push(record, sequence_.fetch_add(1, std::memory_order_relaxed));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Flush
+
+template <class T>
+bool logger::async_worker<T>::Flush() {
+
+    size_t ticket = sequence_.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if(flush_ticket_.load() < ticket) flush_ticket_.store(ticket);
+
+    wake_.notify_one();
+    done_.wait(lock, [this, ticket]{ return flushed_.load() >= ticket; });
+
+    return !failed_.exchange(false);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Collect
+
+template <class T>
+void logger::async_worker<T>::Collect(std::vector<std::shared_ptr<stage> >& stages) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t sequence;
+    size_t kept = 0;
+
+    for(size_t i = 0; i < stages_.size(); ++i) {
+        // rings of finished threads are dropped once they are drained
+        if(stages_[i]->closed.load(std::memory_order_acquire) && !stages_[i]->ring.Front(sequence)) continue;
+
+        stages_[kept++] = stages_[i];
+    }
+
+    stages_.resize(kept);
+    stages_changed_.store(false, std::memory_order_relaxed);
+
+    stages = stages_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Run
+
+template <class T>
+void logger::async_worker<T>::Run() {
+
+    std::vector<std::shared_ptr<stage> > stages;   // snapshot of @stages_
+    size_t next = 0;                                // sequence number of the next record to handle
+
+    std::chrono::steady_clock::time_point flushed_at = std::chrono::steady_clock::now();
+
+    for(;;) {
+
+        bool stop    = stop_.load();   // read before draining so nothing pushed earlier is lost
+        bool written = false;
+        bool missing = false;          // next record is numbered but not published yet
+
+        if(stages_changed_.load(std::memory_order_acquire)) Collect(stages);
+
+        for(;;) {
+
+            // the ring whose oldest record has the smallest number
+            spsc_ring<T>* best          = nullptr;
+            size_t        best_sequence = 0;
+
+            for(size_t i = 0; i < stages.size(); ++i) {
+                size_t sequence;
+                if(stages[i]->ring.Front(sequence) && (!best || sequence < best_sequence)) {
+                    best          = &stages[i]->ring;
+                    best_sequence = sequence;
+                }
+            }
+
+            if(!best) break;
+
+            if(best_sequence != next) {
+                missing = true;
+                break;
+            }
+
+            // consecutive records of one thread are handled without scanning again
+            size_t sequence;
+            T*     record;
+
+            while((record = best->Front(sequence)) && sequence == next) {
+                try {
+                    if(!handler_(*record)) failed_.store(true);
+                } catch(...) {
+                    failed_.store(true);
+                }
+                best->Pop();
+                ++next;
+                written = true;
+            }
+
+            processed_.store(next, std::memory_order_release);
+        }
+
+        if(missing || (stop && next < sequence_.load())) {
+            // some producer numbered a record but did not publish it yet,
+            // or it is in a ring that is not in the snapshot
+            if(stages_changed_.load(std::memory_order_acquire)) Collect(stages);
+            std::this_thread::yield();
+            continue;
+        }
+
+        size_t processed       = next;
+        bool   flush_requested = flush_ticket_.load() > flushed_.load();
+
+        if(flush_requested && processed < flush_ticket_.load() && !stop) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if(written || flush_requested || stop || now - flushed_at >= std::chrono::seconds(1)) {
+            // rings are empty - flush the whole batch at once,
+            // when idle the sink still gets to write what it held back
+            if(!flusher_()) failed_.store(true);
+            flushed_at = now;
+        }
+
+        if(flush_requested || stop) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushed_.store(processed);
+            done_.notify_all();
+        }
+
+        if(stop) return;
+
+        if(!written) Collect(stages);   // idle, forget rings of finished threads
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(1), [this]{
+            return stop_.load() || flush_ticket_.load() > flushed_.load();
+        });
+    }
+
+}
+
+#endif /* LOG_ASYNC_HPP */
@@ -0,0 +1,690 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_BINARY_HPP
+#define LOG_BINARY_HPP
+
+#include <string.h>                 // memcpy, strlen
+#include <stdio.h>                  // snprintf
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <istream>                  // std::istream
+#include <ostream>                  // std::ostream
+#include <fstream>                  // std::ofstream
+#include <mutex>                    // std::mutex, std::lock_guard
+
+#include "log_message_types.hpp"    // logger::log_message_type, logger::MessageTypeName
+#include "log_error.hpp"            // logger::error
+#include "log_utility.hpp"          // logger::AppendVar, logger::thread_frame
+#include "log_clock.hpp"            // logger::Now, logger::UtcOffset, logger::CivilDateTime
+#include "log_path.hpp"             // logger::log_path
+#include "log_file.hpp"             // logger::log_directory_
+#include "log_level.hpp"            // logger::Enabled
+#include "log_stats.hpp"            // logger::stats_timer, logger::CountRecord
+
+// Binary log file
+//
+// "CPPLOGB1" followed by entries, numbers are stored in the byte order of the machine
+//
+// 'S' call site   : u32 id, u32 line, u16 length, file name, u16 length, function name
+// 'R' record      : u32 site id, u8 log_message_type, i64 local time, u8 number of variables, variables
+//
+// variable        : 'i' i64 | 'u' u64 | 'd' f64 | 'c' char | 'b' u8 | 's' u32 length, text
+
+#define LOGGER_BINARY_MAGIC "CPPLOGB1"
+
+namespace logger {
+
+    // @class binary_sink
+    //
+    //
+    // @method Register(filename, line, func)
+    //      @return unsigned
+    //
+    //      remember a call site and return its id
+    //
+    // @method Write(data, n, time)
+    //      @return bool
+    //      @throw  logger::error
+    //
+    //      append encoded record to the binary log file of the day of @time
+    //
+    // @method Flush()
+    //      @return bool
+    //
+    //      flush written records to the file
+    //
+    //
+    // binary log files logs/{year}/{month}/ddmmyyyy.bin
+    // every file starts with the definitions of all known call sites so it can be decoded alone
+
+    class binary_sink {
+    public:
+
+        binary_sink() : generation_(0) {}
+        ~binary_sink() { Flush(); }
+
+        unsigned    Register(const char*, int, const char*);
+        bool        Write(const char*, size_t, time_t);
+        bool        Flush();
+
+    private:
+
+        void        Open(time_t);
+        void        WriteSite(unsigned);
+
+        struct site {
+            std::string filename;
+            int         line;
+            std::string func;
+        };
+
+        std::mutex          mutex_;
+        std::vector<site>   sites_;
+        std::ofstream       stream_;
+        log_path            path_;
+        size_t              generation_;
+        std::vector<char>   buffer_;        // buffer of @stream_
+
+    };
+
+
+
+
+    // @member binary_sink_
+    //
+    // binary log file shared by every BinaryLog call
+
+    binary_sink binary_sink_;
+
+
+
+
+    // @function EncodeVar(s, var)
+    //
+    //
+    // @param s   - std::string& : encoded record
+    // @param var - T            : variable to encode
+    //
+    // @return void
+    //
+    //
+    // append tagged raw bytes of @var to @s, numbers, characters and strings are stored as is
+    // other types are converted to string now because they may not outlive the call
+
+    void EncodeVar(std::string&, bool);
+    void EncodeVar(std::string&, char);
+    void EncodeVar(std::string&, signed char);
+    void EncodeVar(std::string&, unsigned char);
+    void EncodeVar(std::string&, short);
+    void EncodeVar(std::string&, unsigned short);
+    void EncodeVar(std::string&, int);
+    void EncodeVar(std::string&, unsigned int);
+    void EncodeVar(std::string&, long);
+    void EncodeVar(std::string&, unsigned long);
+    void EncodeVar(std::string&, long long);
+    void EncodeVar(std::string&, unsigned long long);
+    void EncodeVar(std::string&, float);
+    void EncodeVar(std::string&, double);
+    void EncodeVar(std::string&, const char*);
+    void EncodeVar(std::string&, const std::string&);
+
+    template <class T>
+    void EncodeVar(std::string&, const T&);
+
+
+
+
+    // @function EncodeVars(s, args)
+    //
+    //
+    // @param s    - std::string& : encoded record
+    // @param args - pack         : variables to encode
+    //
+    // @return void
+    //
+    //
+    // encode every variable of @args
+
+    void EncodeVars(std::string&);
+
+    template <class T, class ...Args>
+    void EncodeVars(std::string&, const T&, const Args&...);
+
+
+
+
+    // @function BinaryLog(site, TYPE, args)
+    //
+    //
+    // @param site - unsigned                   : call site id returned by binary_sink::Register
+    // @param TYPE - logger::log_message_type   : type of message
+    // @param args - pack                       : variables that will be logged
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // store call site id, time and raw variables in the binary log file,
+    // all text formatting is done by DecodeBinaryLog later
+    // return true if everything ok and false if there were errors with file output
+
+    template <class ...Args>
+    bool BinaryLog(unsigned, log_message_type, const Args&...);
+
+
+
+
+    // @function FlushBinaryLog()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush the binary log file
+
+    bool FlushBinaryLog();
+
+
+
+
+    // @function DecodeBinaryLog(in, out)
+    //
+    //
+    // @param in  - std::istream& : binary log file
+    // @param out - std::ostream& : text output
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // convert binary log to the same text FileLog writes
+
+    void DecodeBinaryLog(std::istream&, std::ostream&);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Register
+
+unsigned logger::binary_sink::Register(const char* filename, int line, const char* func) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    site s;
+
+    s.filename = filename;
+    s.line     = line;
+    s.func     = func;
+
+    sites_.push_back(s);
+
+    unsigned id = (unsigned)(sites_.size() - 1);
+
+    if(stream_.is_open()) WriteSite(id);
+
+    return id;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::WriteSite
+
+void logger::binary_sink::WriteSite(unsigned id) {
+
+    const site& s = sites_[id];
+
+    unsigned        line      = (unsigned)s.line;
+    unsigned short  file_len  = (unsigned short)s.filename.length();
+    unsigned short  func_len  = (unsigned short)s.func.length();
+
+    stream_.put('S');
+    stream_.write((const char*)&id, sizeof(id));
+    stream_.write((const char*)&line, sizeof(line));
+    stream_.write((const char*)&file_len, sizeof(file_len));
+    stream_.write(s.filename.data(), file_len);
+    stream_.write((const char*)&func_len, sizeof(func_len));
+    stream_.write(s.func.data(), func_len);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Open
+
+void logger::binary_sink::Open(time_t time) {
+
+    if(generation_ != logger::log_directory_generation_.load()) {
+
+        std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+
+        path_.Reset(logger::log_directory_, ".bin");
+        generation_ = logger::log_directory_generation_.load();
+    }
+
+    if(stream_.is_open()) {
+        stream_.close();
+    }
+
+    if(buffer_.empty()) {
+        buffer_.resize(1 << 16);
+    }
+
+    stream_.clear();
+    stream_.rdbuf()->pubsetbuf(buffer_.data(), (std::streamsize)buffer_.size());
+    stream_.open(path_.Resolve(time), std::ios::app | std::ios::binary);
+
+    if(!stream_.is_open()) {
+        generation_ = 0;   // check directories again next time
+        throw logger::error("cannot open file");
+    }
+
+    if(stream_.tellp() == 0) {
+        stream_.write(LOGGER_BINARY_MAGIC, 8);
+    }
+
+    for(unsigned id = 0; id < sites_.size(); ++id) {
+        WriteSite(id);  // file may be decoded without the previous ones
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Write
+
+bool logger::binary_sink::Write(const char* data, size_t n, time_t time) {
+
+    logger::stats_timer timer(logger::sink_meters_[logger::S_BINARY].write);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(path_.Expired(time) || !stream_.good() || !stream_.is_open() ||
+       generation_ != logger::log_directory_generation_.load(std::memory_order_relaxed)) {
+        Open(time);
+    }
+
+    stream_.write(data, (std::streamsize)n);
+
+    bool written = stream_.good();
+
+    logger::CountRecord(logger::S_BINARY, written, n);
+
+    return written;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Flush
+
+bool logger::binary_sink::Flush() {
+
+    logger::CountFlush(logger::S_BINARY);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(!stream_.is_open()) return true;
+
+    return stream_.flush().good();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, long long var) {
+
+    s += 'i';
+    s.append((const char*)&var, sizeof(var));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, unsigned long long var) {
+
+    s += 'u';
+    s.append((const char*)&var, sizeof(var));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, double var) {
+
+    s += 'd';
+    s.append((const char*)&var, sizeof(var));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, bool var)                { s += 'b'; s += (char)var; }
+void logger::EncodeVar(std::string& s, char var)                { s += 'c'; s += var; }
+void logger::EncodeVar(std::string& s, signed char var)         { s += 'c'; s += (char)var; }
+void logger::EncodeVar(std::string& s, unsigned char var)       { s += 'c'; s += (char)var; }
+void logger::EncodeVar(std::string& s, short var)               { logger::EncodeVar(s, (long long)var); }
+void logger::EncodeVar(std::string& s, unsigned short var)      { logger::EncodeVar(s, (unsigned long long)var); }
+void logger::EncodeVar(std::string& s, int var)                 { logger::EncodeVar(s, (long long)var); }
+void logger::EncodeVar(std::string& s, unsigned int var)        { logger::EncodeVar(s, (unsigned long long)var); }
+void logger::EncodeVar(std::string& s, long var)                { logger::EncodeVar(s, (long long)var); }
+void logger::EncodeVar(std::string& s, unsigned long var)       { logger::EncodeVar(s, (unsigned long long)var); }
+void logger::EncodeVar(std::string& s, float var)               { logger::EncodeVar(s, (double)var); }
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, const char* var) {
+
+    unsigned length = var ? (unsigned)strlen(var) : 0;
+
+    s += 's';
+    s.append((const char*)&length, sizeof(length));
+    s.append(var ? var : "", length);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, const std::string& var) {
+
+    unsigned length = (unsigned)var.length();
+
+    s += 's';
+    s.append((const char*)&length, sizeof(length));
+    s.append(var);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+template <class T>
+void logger::EncodeVar(std::string& s, const T& var) {
+
+    unsigned length = 0;
+
+    s += 's';
+
+    size_t position = s.length();
+
+    s.append((const char*)&length, sizeof(length));
+
+    logger::AppendVar(s, var);  // format in place, then patch the length
+
+    length = (unsigned)(s.length() - position - sizeof(length));
+
+    memcpy(&s[position], &length, sizeof(length));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVars
+
+void logger::EncodeVars(std::string& s) {
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVars
+
+template <class T, class ...Args>
+void logger::EncodeVars(std::string& s, const T& var, const Args&... args) {
+
+    logger::EncodeVar(s, var);
+
+    EncodeVars(s, args...);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::BinaryLog
+
+template <class ...Args>
+bool logger::BinaryLog(unsigned site, logger::log_message_type TYPE, const Args&... args) {
+
+    static_assert(sizeof...(Args) < 256, "BinaryLog : too many variables");
+
+    logger::stats_timer timer(logger::sink_meters_[logger::S_BINARY].enqueue);
+
+    logger::thread_frame<std::string> record;   // reused by every call of this thread
+
+    time_t          time  = logger::Now().seconds;
+    long long       local = (long long)time + logger::UtcOffset(time);
+    unsigned char   type  = (unsigned char)TYPE;
+    unsigned char   count = (unsigned char)sizeof...(Args);
+
+    record->clear();
+    *record += 'R';
+    record->append((const char*)&site, sizeof(site));
+    *record += (char)type;
+    record->append((const char*)&local, sizeof(local));
+    *record += (char)count;
+
+    EncodeVars(*record, args...);
+
+    return logger::binary_sink_.Write(record->data(), record->length(), time);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushBinaryLog
+
+bool logger::FlushBinaryLog() {
+
+    return logger::binary_sink_.Flush();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::DecodeBinaryLog
+
+void logger::DecodeBinaryLog(std::istream& in, std::ostream& out) {
+
+    struct site {
+        std::string filename;
+        unsigned    line;
+        std::string func;
+    };
+
+    std::vector<site>   sites;
+    std::string         value;
+    char                magic[8];
+
+    if(!in.read(magic, 8) || memcmp(magic, LOGGER_BINARY_MAGIC, 8) != 0) {
+        throw logger::error("not a binary log file");
+    }
+
+    char kind;
+
+    while(in.get(kind)) {
+
+        if(kind == 'S') {
+
+            unsigned        id, line;
+            unsigned short  length;
+            site            s;
+
+            in.read((char*)&id, sizeof(id));
+            in.read((char*)&line, sizeof(line));
+
+            in.read((char*)&length, sizeof(length));
+            s.filename.resize(length);
+            if(length) in.read(&s.filename[0], length);
+
+            in.read((char*)&length, sizeof(length));
+            s.func.resize(length);
+            if(length) in.read(&s.func[0], length);
+
+            s.line = line;
+
+            if(!in) break;
+
+            if(sites.size() <= id) sites.resize(id + 1);
+            sites[id] = s;
+
+            continue;
+        }
+
+        if(kind != 'R') {
+            throw logger::error("broken binary log file");
+        }
+
+
+        unsigned        id;
+        unsigned char   type, count;
+        long long       local;
+        char            date_time[20];
+
+        in.read((char*)&id, sizeof(id));
+        type = (unsigned char)in.get();
+        in.read((char*)&local, sizeof(local));
+        count = (unsigned char)in.get();
+
+        if(!in || id >= sites.size()) {
+            throw logger::error("broken binary log file");
+        }
+
+        logger::CivilDateTime(local, date_time);
+
+        const site& s        = sites[id];
+        const char* log_type = logger::MessageTypeName((logger::log_message_type)type);
+
+        for(unsigned i = 0; i < count; ++i) {
+
+            char tag = (char)in.get();
+
+            value.clear();
+
+            if(tag == 'i') {
+                long long var;
+                in.read((char*)&var, sizeof(var));
+                logger::AppendVar(value, var);
+            } else if(tag == 'u') {
+                unsigned long long var;
+                in.read((char*)&var, sizeof(var));
+                logger::AppendVar(value, var);
+            } else if(tag == 'd') {
+                double var;
+                in.read((char*)&var, sizeof(var));
+                logger::AppendVar(value, var);
+            } else if(tag == 'c') {
+                value += (char)in.get();
+            } else if(tag == 'b') {
+                logger::AppendVar(value, in.get() != 0);
+            } else if(tag == 's') {
+                unsigned length;
+                in.read((char*)&length, sizeof(length));
+                value.resize(length);
+                if(length) in.read(&value[0], length);
+            } else {
+                throw logger::error("broken binary log file");
+            }
+
+            if(!in) {
+                throw logger::error("broken binary log file");
+            }
+
+            out.write(date_time, 19) << ' '; // date and time
+
+            out << '[' << log_type << "] "; // message type
+
+            out << s.filename << ':' << s.line << ' ' << s.func << " -> "; // info
+
+            out << value << '\n';
+        }
+    }
+
+}
+
+// Macro that registers the call site once and passes its id to the logger::BinaryLog
+// TYPE is evaluated once, calls below LOGGER_MIN_LEVEL or the runtime level do nothing
+// and do not evaluate the other arguments
+#define BinaryLog(TYPE, ...) logger::Gate(logger::S_BINARY, TYPE, __func__, \
+    [&](decltype((TYPE)) logger_first_, const char* logger_func_) -> bool { \
+        static const unsigned site = logger::binary_sink_.Register(__FILENAME__, __LINE__, logger_func_); \
+        return logger::BinaryLog(site, logger_first_, __VA_ARGS__); })
+
+// DEBUG ONLY mode
+#ifdef DEBUG_ONLY
+    #if defined(DEBUG) | defined(_DEBUG)
+        #define BinaryLog(...) NULL
+    #endif
+#endif
+
+#endif /* LOG_BINARY_HPP */
@@ -0,0 +1,391 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_CLOCK_HPP
+#define LOG_CLOCK_HPP
+
+#include <string.h>                 // memcpy
+#include <time.h>                   // time_t, clock_gettime, localtime_r
+#include <cstddef>                  // size_t
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::system_clock
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#define OS_UNIX
+#endif
+
+// LOGGER_COARSE_CLOCK makes logger::Now read the coarse clock of the kernel:
+// it is cheaper but has a resolution of a few milliseconds
+#if defined(__linux__) && defined(LOGGER_COARSE_CLOCK)
+#define LOGGER_CLOCK_ID CLOCK_REALTIME_COARSE
+#elif defined(OS_UNIX)
+#define LOGGER_CLOCK_ID CLOCK_REALTIME
+#endif
+
+namespace logger {
+
+    // @struct log_time
+    //
+    //
+    // @member seconds     - time_t : seconds since the epoch
+    // @member nanoseconds - long   : fractional part of the second
+    //
+    //
+    // point of time of a log record
+
+    struct log_time {
+        time_t  seconds;
+        long    nanoseconds;
+    };
+
+
+
+
+    // @function Now()
+    //
+    //
+    // @return logger::log_time
+    //
+    //
+    // current wall clock time, read without a system call where the platform allows it
+
+    log_time Now();
+
+
+
+
+    // @function LocalTime(time, result)
+    //
+    //
+    // @param time   - time_t     : time to convert
+    // @param result - struct tm* : converted local time
+    //
+    // @return void
+    //
+    //
+    // thread safe version of localtime
+
+    void LocalTime(time_t, struct tm*);
+
+
+
+
+    // @function UtcOffset(time)
+    //
+    //
+    // @param time - time_t : point of time
+    //
+    // @return long
+    //
+    //
+    // difference in seconds between local time and UTC at @time
+    // the offset is computed once per quarter of an hour and shared by every thread
+
+    long UtcOffset(time_t);
+
+
+
+
+    // @function DateTime(time, text)
+    //
+    //
+    // @param time - time_t : point of time
+    // @param text - char*  : buffer for at least 20 characters
+    //
+    // @return void
+    //
+    //
+    // write local time @time in format "YYYY-MM-DD HH:MM:SS" with terminating null to @text
+    // the string of the current second is rendered once and reused by every thread
+
+    void DateTime(time_t, char*);
+
+
+
+
+    // @function CivilDateTime(local, text)
+    //
+    //
+    // @param local - long long : seconds since the epoch shifted by the UTC offset
+    // @param text  - char*     : buffer for at least 20 characters
+    //
+    // @return void
+    //
+    //
+    // write @local in format "YYYY-MM-DD HH:MM:SS" with terminating null to @text
+
+    void CivilDateTime(long long, char*);
+
+
+
+
+    // @function FractionDigits(nanoseconds, digits, text)
+    //
+    //
+    // @param nanoseconds - long   : fractional part of the second
+    // @param digits      - int    : number of digits to write, 3 for milliseconds, 6 for microseconds
+    // @param text        - char*  : buffer for @digits characters
+    //
+    // @return void
+    //
+    //
+    // write first @digits digits of the fractional part of the second
+
+    void FractionDigits(long, int, char*);
+
+
+
+
+    // @struct date_time_slot
+    //
+    //
+    // @member sequence - std::atomic<unsigned>            : odd while the slot is being written
+    // @member second   - std::atomic<long long>           : second that @text belongs to
+    // @member text     - std::atomic<unsigned long long>  : rendered "YYYY-MM-DD HH:MM:SS"
+    //
+    //
+    // rendered date and time of the latest second protected by a sequence lock,
+    // readers never wait and writers never block each other
+
+    struct date_time_slot {
+        std::atomic<unsigned>           sequence;
+        std::atomic<long long>          second;
+        std::atomic<unsigned long long> text[3];
+    };
+
+
+
+
+    // @member date_time_slot_
+    //
+    // date and time shared by every thread
+
+    date_time_slot date_time_slot_;
+
+
+
+
+    // @member utc_offset_
+    //
+    // cached UTC offset packed with the quarter of an hour it was computed for
+
+    std::atomic<long long> utc_offset_(-1);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::Now
+
+logger::log_time logger::Now() {
+
+    logger::log_time result;
+
+#ifdef LOGGER_CLOCK_ID
+    struct timespec ts;
+
+    clock_gettime(LOGGER_CLOCK_ID, &ts);
+
+    result.seconds     = ts.tv_sec;
+    result.nanoseconds = ts.tv_nsec;
+#else
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    result.seconds     = (time_t)(ns / 1000000000);
+    result.nanoseconds = (long)(ns % 1000000000);
+#endif
+
+    return result;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::LocalTime
+
+void logger::LocalTime(time_t time, struct tm* result) {
+
+#ifdef OS_UNIX
+    localtime_r(&time, result);
+#endif // OS_UNIX
+
+#ifdef OS_WIN
+    localtime_s(result, &time);
+#endif // OS_WIN
+
+}
+
+
+
+
+// @Implementation of
+//  logger::UtcOffset
+
+long logger::UtcOffset(time_t time) {
+
+    long long quarter = (long long)time / 900;  // DST changes on a quarter of an hour boundary
+    long long cached  = logger::utc_offset_.load(std::memory_order_relaxed);
+
+    if(cached >= 0 && (cached >> 20) == quarter) {
+        return (long)(cached & 0xFFFFF) - 65536;
+    }
+
+    struct tm local;
+
+    logger::LocalTime(time, &local);
+
+
+    // days from 1970-01-01 to the local date
+    long long y   = local.tm_year + 1900 - (local.tm_mon < 2);
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yoe = y - era * 400;
+    long long m   = local.tm_mon + 1;
+    long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + local.tm_mday - 1;
+    long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long day = era * 146097 + doe - 719468;
+
+    long offset = (long)(day * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec - (long long)time);
+
+    if(quarter >= 0) {
+        logger::utc_offset_.store((quarter << 20) | (offset + 65536), std::memory_order_relaxed);
+    }
+
+    return offset;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CivilDateTime
+
+void logger::CivilDateTime(long long local, char* text) {
+
+    long long z     = (local >= 0 ? local : local - 86399) / 86400;
+    long long secs  = local - z * 86400;
+
+    z += 719468;
+
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    long long doe = z - era * 146097;
+    long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long long mp  = (5 * doy + 2) / 153;
+    long long day = doy - (153 * mp + 2) / 5 + 1;
+    long long mon = mp < 10 ? mp + 3 : mp - 9;
+    long long yr  = yoe + era * 400 + (mon <= 2);
+
+    int hour = (int)(secs / 3600), min = (int)(secs / 60 % 60), sec = (int)(secs % 60);
+
+    char buffer[20] = {
+        (char)('0' + yr / 1000 % 10), (char)('0' + yr / 100 % 10), (char)('0' + yr / 10 % 10), (char)('0' + yr % 10), '-',
+        (char)('0' + mon / 10),       (char)('0' + mon % 10),       '-',
+        (char)('0' + day / 10),       (char)('0' + day % 10),       ' ',
+        (char)('0' + hour / 10),      (char)('0' + hour % 10),      ':',
+        (char)('0' + min / 10),       (char)('0' + min % 10),       ':',
+        (char)('0' + sec / 10),       (char)('0' + sec % 10),       '\0'
+    };
+
+    memcpy(text, buffer, 20);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::DateTime
+
+void logger::DateTime(time_t time, char* text) {
+
+    logger::date_time_slot& slot = logger::date_time_slot_;
+
+    unsigned long long words[3];
+
+    unsigned sequence = slot.sequence.load(std::memory_order_acquire);
+
+    if(!(sequence & 1) && slot.second.load(std::memory_order_relaxed) == (long long)time) {
+
+        words[0] = slot.text[0].load(std::memory_order_relaxed);
+        words[1] = slot.text[1].load(std::memory_order_relaxed);
+        words[2] = slot.text[2].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(slot.sequence.load(std::memory_order_relaxed) == sequence && words[0] != 0) {
+            memcpy(text, words, 20);
+            return;
+        }
+    }
+
+
+    // render date and time of a new second
+    char buffer[24] = {0};
+
+    logger::CivilDateTime((long long)time + logger::UtcOffset(time), buffer);
+
+    memcpy(text, buffer, 20);
+
+
+    // publish it for other threads unless somebody else is writing right now
+    if(!(sequence & 1) && slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy(words, buffer, sizeof(words));
+
+        slot.second.store((long long)time, std::memory_order_relaxed);
+        slot.text[0].store(words[0], std::memory_order_relaxed);
+        slot.text[1].store(words[1], std::memory_order_relaxed);
+        slot.text[2].store(words[2], std::memory_order_relaxed);
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FractionDigits
+
+void logger::FractionDigits(long nanoseconds, int digits, char* text) {
+
+    for(int i = 9; i > digits; --i) nanoseconds /= 10;
+
+    for(int i = digits - 1; i >= 0; --i) {
+        text[i] = (char)('0' + nanoseconds % 10);
+        nanoseconds /= 10;
+    }
+
+}
+
+#endif /* LOG_CLOCK_HPP */
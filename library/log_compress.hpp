@@ -0,0 +1,433 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_COMPRESS_HPP
+#define LOG_COMPRESS_HPP
+
+#include <stdio.h>                  // FILE, fopen, fread, fwrite, rename, remove
+#include <string.h>                 // memcpy, memmove, memset
+#include <time.h>                   // clock_gettime
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <deque>                    // std::deque
+#include <atomic>                   // std::atomic
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <chrono>                   // std::chrono::nanoseconds
+#include <condition_variable>       // std::condition_variable
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <unistd.h>                 // fsync, unlink, link, access
+#define OS_UNIX
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>           // setpriority
+#include <sys/syscall.h>            // SYS_gettid
+#endif
+
+#ifdef LOGGER_ZLIB
+#include <zlib.h>                   // deflate, crc32
+#endif
+
+#include "log_retention.hpp"        // logger::ListLogFiles, logger::DayOf
+
+namespace logger {
+
+    // @function CompressLogFile(path, level, budget, stop)
+    //
+    //
+    // @param path   - const std::string&       : closed log file
+    // @param level  - int                      : zlib compression level
+    // @param budget - double                   : share of one CPU the compression may use, 1 - no limit
+    // @param stop   - const std::atomic<bool>* : checked between blocks, compression is abandoned if it is set
+    //
+    // @return bool
+    //
+    //
+    // replace @path with @path.gz in BGZF format: a sequence of independent gzip members
+    // of at most 64 KB each followed by an empty member, so every block can be found by
+    // walking the headers and decompressed on its own, and the whole file by gzip -d or zcat
+    // blocks end at a line boundary when a line fits into one block
+    // an existing @path.gz is never replaced, @path is left as it is then
+    // return false if the file is not compressed, always without LOGGER_ZLIB
+
+    bool CompressLogFile(const std::string&, int, double, const std::atomic<bool>*);
+
+
+
+
+    // @class log_compressor
+    //
+    //
+    // @method Start(directory, level, budget)
+    //      @return void
+    //
+    //      start the background thread and compress log files left in @directory
+    //      except the latest segment of today
+    //      has no effect without LOGGER_ZLIB or on Windows
+    //
+    // @method Request(path)
+    //      @return void
+    //
+    //      compress closed log file @path, never waits for the compression
+    //
+    //
+    // compresses closed log files on a background thread with the lowest priority
+    // that sleeps as long as needed to keep its CPU usage within the budget
+
+    class log_compressor {
+    public:
+
+        log_compressor() : level_(6), budget_(1), stop_(false) {}
+        ~log_compressor();
+
+        log_compressor(const log_compressor&) = delete;
+        log_compressor& operator=(const log_compressor&) = delete;
+
+        void    Start(const std::string&, int, double);
+        void    Request(const std::string&);
+
+    private:
+
+        void    Run();
+
+        std::thread             thread_;
+        std::mutex              mutex_;
+        std::condition_variable wake_;
+        std::deque<std::string> paths_;     // files waiting for compression
+        std::string             directory_; // logs directory to look for left files in, empty - none
+        int                     level_;
+        double                  budget_;
+        std::atomic<bool>       stop_;
+
+    };
+
+
+
+
+    // @member log_compressor_
+    //
+    // compression of files closed by FileLog
+
+    log_compressor log_compressor_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CompressLogFile
+
+bool logger::CompressLogFile(const std::string& path, int level, double budget, const std::atomic<bool>* stop) {
+
+#if defined(LOGGER_ZLIB) && defined(OS_UNIX)
+    static const unsigned char eof_block[28] = {
+        0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+
+    const size_t block_size = 0xff00;   // input of one block, its output always fits into 64 KB
+
+    std::string target = path + ".gz";
+    std::string temp   = target + ".tmp";
+
+    if(access(target.c_str(), F_OK) == 0) return false;    // written by an earlier run for another file of the same name
+
+    FILE* in = fopen(path.c_str(), "rb");
+
+    if(!in) return false;
+
+    FILE* out = fopen(temp.c_str(), "wb");
+
+    if(!out) {
+        fclose(in);
+        return false;
+    }
+
+
+    z_stream stream;
+
+    memset(&stream, 0, sizeof(stream));
+
+    if(deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fclose(in);
+        fclose(out);
+        remove(temp.c_str());
+        return false;
+    }
+
+    std::vector<unsigned char> input(block_size);
+    std::vector<unsigned char> output(18 + deflateBound(&stream, block_size) + 8);
+
+    size_t filled = 0;
+    bool   eof    = false;
+    bool   ok     = true;
+
+    while(ok && !*stop) {
+
+        struct timespec started;
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &started);
+
+
+        if(!eof) {
+            filled += fread(input.data() + filled, 1, block_size - filled, in);
+            eof     = filled < block_size;
+        }
+
+        if(!filled) break;
+
+
+        // cut the block after the last complete line
+        size_t length = filled;
+
+        if(!eof) {
+            size_t line_end = filled;
+
+            while(line_end > 0 && input[line_end - 1] != '\n') --line_end;
+
+            if(line_end) length = line_end;
+        }
+
+
+        deflateReset(&stream);
+
+        stream.next_in   = input.data();
+        stream.avail_in  = (uInt)length;
+        stream.next_out  = output.data() + 18;
+        stream.avail_out = (uInt)(output.size() - 26);
+
+        if(deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+            ok = false;
+            break;
+        }
+
+        size_t          total = 18 + stream.total_out + 8;
+        unsigned        crc   = (unsigned)crc32(0, input.data(), (uInt)length);
+        unsigned char*  h     = output.data();
+
+        const unsigned char header[16] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0 };
+
+        memcpy(h, header, 16);
+        h[16] = (unsigned char)((total - 1) & 0xff);
+        h[17] = (unsigned char)((total - 1) >> 8);
+
+        unsigned char* t = h + 18 + stream.total_out;
+
+        for(int i = 0; i < 4; ++i) {
+            t[i]     = (unsigned char)(crc >> (8 * i));
+            t[4 + i] = (unsigned char)(length >> (8 * i));
+        }
+
+        ok = fwrite(h, 1, total, out) == total;
+
+
+        memmove(input.data(), input.data() + length, filled - length);
+        filled -= length;
+
+
+        // sleep for the time the budget leaves to other threads
+        struct timespec finished;
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &finished);
+
+        if(budget > 0 && budget < 1) {
+
+            long long spent = (long long)(finished.tv_sec - started.tv_sec) * 1000000000 + (finished.tv_nsec - started.tv_nsec);
+
+            std::this_thread::sleep_for(std::chrono::nanoseconds((long long)(spent * (1 / budget - 1))));
+        }
+    }
+
+    deflateEnd(&stream);
+    fclose(in);
+
+    ok = ok && !*stop && filled == 0 && fwrite(eof_block, 1, sizeof(eof_block), out) == sizeof(eof_block);
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    ok = fclose(out) == 0 && ok;
+
+    // link fails if the target appeared meanwhile, rename would replace it
+    if(!ok || link(temp.c_str(), target.c_str()) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+
+    unlink(temp.c_str());
+    unlink(path.c_str());
+
+    return true;
+#else
+    (void)path;
+    (void)level;
+    (void)budget;
+    (void)stop;
+
+    return false;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::~log_compressor
+
+logger::log_compressor::~log_compressor() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_one();
+
+    if(thread_.joinable()) thread_.join();   // a file being compressed is left for the next start
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::Start
+
+void logger::log_compressor::Start(const std::string& directory, int level, double budget) {
+
+#if defined(LOGGER_ZLIB) && defined(OS_UNIX)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        level_     = level;
+        budget_    = budget;
+        directory_ = directory;
+
+        if(!thread_.joinable()) {
+            thread_ = std::thread(&log_compressor::Run, this);
+        }
+    }
+
+    wake_.notify_one();
+#else
+    (void)directory;
+    (void)level;
+    (void)budget;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::Request
+
+void logger::log_compressor::Request(const std::string& path) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(!thread_.joinable()) return;
+
+        paths_.push_back(path);
+    }
+
+    wake_.notify_one();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::Run
+
+void logger::log_compressor::Run() {
+
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);   // the lowest priority for this thread only
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for(;;) {
+
+        wake_.wait(lock, [this]{ return stop_ || !paths_.empty() || !directory_.empty(); });
+
+        if(stop_) return;
+
+
+        // files closed before the start
+        if(!directory_.empty()) {
+
+            std::string directory;
+
+            directory.swap(directory_);
+
+            lock.unlock();
+
+            std::vector<logger::log_entry>  entries;
+            std::vector<std::string>        directories;
+
+            logger::ListLogFiles(directory, &entries, &directories);
+
+            long   today  = logger::DayOf(time(nullptr));
+            size_t latest = 0;
+
+            for(size_t i = 0; i < entries.size(); ++i) {
+                if(entries[i].day == today && entries[i].kind == ".log") latest = entries[i].segment;
+            }
+
+            lock.lock();
+
+            for(size_t i = 0; i < entries.size(); ++i) {
+
+                if(entries[i].kind != ".log") continue;
+                if(entries[i].day >= today && entries[i].segment >= latest) continue;
+
+                paths_.push_back(entries[i].path);
+            }
+
+            continue;
+        }
+
+
+        std::string path   = paths_.front();
+        int         level  = level_;
+        double      budget = budget_;
+
+        paths_.pop_front();
+
+        lock.unlock();
+
+        logger::CompressLogFile(path, level, budget, &stop_);
+
+        lock.lock();
+    }
+
+}
+
+#endif /* LOG_COMPRESS_HPP */
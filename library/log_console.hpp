@@ -23,48 +23,179 @@
 #ifndef LOG_CONSOLE_HPP
 #define LOG_CONSOLE_HPP
 
-#include <string.h>			            // strrchr
-#include <time.h>                       // time, localtime
+#include <string.h>			            // strrchr, strlen
 #include <cstddef>                      // size_t
 #include <utility>                      // std::move
+#include <memory>                       // std::shared_ptr, std::make_shared
 #include <string>                       // std::string, std::to_string
 #include <vector>                       // std::vector
-#include <stack>                        // std::stack
-#include <queue>                        // std::queue
 #include <iostream>                     // std::cout
 #include <sstream>                      // std::stringstream
 #include <unordered_map>                // std::unordered_map
+#include <type_traits>                  // std::enable_if, std::type_identity_t
+#include <mutex>                        // std::mutex, std::lock_guard, std::unique_lock
+#include <thread>                       // std::thread
+#include <chrono>                       // std::chrono::milliseconds
+#include <condition_variable>           // std::condition_variable
+#include <atomic>                       // std::atomic
 
 #if defined(_WIN32) | defined(_WIN64)
 #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
 #define OS_WIN
+#include <io.h>                         // _write, _isatty
 #else
 #define OS_UNIX
+#include <errno.h>                      // errno, EINTR
+#include <unistd.h>                     // write, isatty
+#include <sys/uio.h>                    // writev
 #endif
 
 #include "log_console_modifiers.hpp"    // logger::kModifier
+#include "log_style.hpp"                // logger::style, logger::bound_style, logger::FindStyle
 #include "log_error.hpp"                // logger::error
-#include "log_utility.hpp"              // logger::ProcessVars, logger::StrToLen
+#include "log_utility.hpp"              // logger::ProcessVars, logger::var_buffer, logger::thread_frame
+#include "log_format.hpp"               // logger::format_op, logger::ParseFormatOp
+#include "log_clock.hpp"                // logger::Now, logger::DateTime
+#include "log_flusher.hpp"              // logger::log_record, logger::StartLogWorker, logger::AddSinkFlusher
+#include "log_level.hpp"                // logger::Enabled, logger::TypeOf
+#include "log_limit.hpp"                // logger::rate_limiter, logger::sample_limiter
+#include "log_stats.hpp"                // logger::stats_timer, logger::CountRecord
 
 #define __FILENAME__ (strrchr("/" __FILE__, '/') + 1)
 
+// maximum number of compiled target strings kept by every thread
+#ifndef LOGGER_FORMAT_CACHE_SIZE
+#define LOGGER_FORMAT_CACHE_SIZE 256
+#endif
+
 namespace logger {
     
-    // @typedef style
+    // @member async_console_log_
+    //
+    // ConsoleLog only passes rendered lines to the central flusher
+    
+    bool async_console_log_ = false;
+    
+    
+    
+    
+    // @enum console_colors
+    //
+    //
+    // whether ConsoleLog writes escape sequences of styles
+    
+    typedef enum : unsigned char {
+        CC_AUTO,            // only if the console sink writes to a terminal
+        CC_ALWAYS,          // always
+        CC_NEVER            // never, styles are skipped
+    } console_colors;
+    
+    
+    
+    
+    // @function IsTerminal(fd)
+    //
+    //
+    // @param fd - int : file descriptor
+    //
+    // @return bool
+    //
+    //
+    // return true if @fd is a terminal and not a file or a pipe
+    
+    bool IsTerminal(int);
+    
+    
+    
+    
+    // @member console_colors_
+    //
+    // mode set by logger::SetConsoleColors
+    
+    console_colors console_colors_ = CC_AUTO;
+    
+    
+    
+    
+    // @member console_plain_
+    //
+    // ConsoleLog writes no escape sequences, stdout is checked once at startup
+    
+    std::atomic<bool> console_plain_(!IsTerminal(1));
+    
+    
+    
+    
+    // @function SetConsoleColors(colors)
+    //
+    //
+    // @param colors - logger::console_colors : new mode
+    //
+    // @return void
+    //
+    //
+    // override detection of the terminal, CC_AUTO checks the file descriptor of the console sink again
+    
+    void SetConsoleColors(console_colors);
+    
+    
+    
+    
+    // @enum console_flush
     //
     //
-    // structure for holding modifiers that applied to elements with this style
+    // when lines buffered by the direct console sink are written to the file descriptor
     
-    typedef std::vector<kModifier> style;
+    typedef enum : unsigned char {
+        CF_LINE,            // every line right away
+        CF_BYTES,           // when the buffer holds at least the given number of bytes
+        CF_PERIODIC         // every given number of milliseconds or when the buffer is full
+    } console_flush;
     
     
     
     
-    // @member binded_styles_
+    // @struct console_sink
     //
-    // hash table that contains correspondence between styles and it names
+    //
+    // @member fd       - int                     : file descriptor lines are written to, -1 - std::cout is used
+    // @member policy   - logger::console_flush   : when the buffer is written
+    // @member bytes    - size_t                  : size the buffer is written at
+    // @member interval - unsigned                : milliseconds between writes in CF_PERIODIC mode
+    // @member buffer   - std::string             : lines that are not written yet
+    // @member mutex    - std::mutex              : guards the buffer
+    // @member thread   - std::thread             : writes the buffer in CF_PERIODIC mode
+    // @member wake     - std::condition_variable : stops the thread
+    // @member stop     - bool                    : thread should exit
+    //
+    //
+    // console output that bypasses iostream: lines are appended to one buffer and written
+    // with write(2), the pending buffer and the new line together with writev(2)
+    // T_ERROR and T_CRITICAL lines are always written right away
+    
+    struct console_sink {
+        int                     fd;
+        console_flush           policy;
+        size_t                  bytes;
+        unsigned                interval;
+        std::string             buffer;
+        std::mutex              mutex;
+        std::thread             thread;
+        std::condition_variable wake;
+        bool                    stop;
+        
+        console_sink() : fd(-1), policy(CF_LINE), bytes(0), interval(0), stop(false) {}
+        ~console_sink();
+    };
+    
+    
+    
+    
+    // @member console_sink_
+    //
+    // console sink shared by every ConsoleLog call
     
-    std::unordered_map<std::string, style> binded_styles;
+    console_sink console_sink_;
     
     
     
@@ -126,6 +257,214 @@ namespace logger {
     
     
     
+    // @function EnableAsyncConsoleLog(capacity)
+    //
+    //
+    // @param capacity - size_t : maximum number of lines waiting to be written per thread
+    //
+    // @return void
+    //
+    //
+    // switch ConsoleLog to asynchronous mode: calls render the line and pass it through
+    // the ring of the calling thread to the central flusher, so lines of different threads
+    // never interleave and keep the order they were logged in with FileLog records
+    // errors of the background thread are reported by logger::Flush
+    
+    void EnableAsyncConsoleLog(size_t capacity = 1024);
+    
+    
+    
+    
+    // @function EnableDirectConsoleLog(fd, policy, bytes, interval)
+    //
+    //
+    // @param fd       - int                   : file descriptor to write to, 1 - stdout, 2 - stderr
+    // @param policy   - logger::console_flush : when buffered lines are written
+    // @param bytes    - size_t                : size of the buffer that is written in CF_BYTES and CF_PERIODIC modes
+    // @param interval - unsigned              : milliseconds between writes in CF_PERIODIC mode
+    //
+    // @return void
+    //
+    //
+    // make ConsoleLog write to @fd directly instead of std::cout, see logger::console_sink
+    // output does not depend on std::ios::sync_with_stdio, std::cout is flushed before the switch
+    
+    void EnableDirectConsoleLog(int fd = 1, console_flush policy = CF_LINE, size_t bytes = 64 * 1024, unsigned interval = 100);
+    
+    
+    
+    
+    // @function WriteConsole(text, type)
+    //
+    //
+    // @param text - const std::string&        : rendered output
+    // @param type - logger::log_message_type  : type of the output
+    //
+    // @return bool
+    //
+    //
+    // pass @text to the console sink or to the central flusher in asynchronous mode
+    // return true if everything ok and false if there were errors with console output
+    
+    bool WriteConsole(const std::string&, log_message_type);
+    
+    
+    
+    
+    // @function WriteConsoleText(data, n, type)
+    //
+    //
+    // @param data - const char*              : rendered output
+    // @param n    - size_t                   : length of @data
+    // @param type - logger::log_message_type : type of the output
+    //
+    // @return bool
+    //
+    //
+    // write @data to std::cout or to the buffer of the direct console sink
+    
+    bool WriteConsoleText(const char*, size_t, log_message_type);
+    
+    
+    
+    
+    // @function WriteConsoleFd(fd, first, first_n, second, second_n)
+    //
+    //
+    // @param fd       - int         : file descriptor
+    // @param first    - const char* : data written first
+    // @param first_n  - size_t      : length of @first
+    // @param second   - const char* : data written after @first
+    // @param second_n - size_t      : length of @second
+    //
+    // @return bool
+    //
+    //
+    // write both pieces with one system call when possible, retry partial and interrupted writes
+    
+    bool WriteConsoleFd(int, const char*, size_t, const char*, size_t);
+    
+    
+    
+    
+    // @function WriteConsoleRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record with rendered line
+    //
+    // @return bool
+    //
+    //
+    // write line rendered by ConsoleLog to the console sink
+    
+    bool WriteConsoleRecord(log_record&);
+    
+    
+    
+    
+    // @function FlushConsoleSink()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush std::cout or write the buffer of the direct console sink
+    
+    bool FlushConsoleSink();
+    
+    
+    
+    
+    // @struct format_program
+    //
+    //
+    // @member format - std::string                      : copy of target string
+    // @member ops    - std::vector<logger::format_op>   : parsed target string
+    // @member styles - std::vector<const logger::bound_style*>: style of every F_STYLE instruction,
+    //                                                           nullptr for other instructions
+    // @member plain  - bool                             : compiled for output without escape sequences,
+    //                                                     style instructions are left out
+    //
+    //
+    // target string compiled once and executed by every ConsoleLog call with the same string
+    
+    struct format_program {
+        std::string                     format;
+        std::vector<format_op>          ops;
+        std::vector<const bound_style*> styles;
+        bool                            plain;
+    };
+    
+    
+    
+    
+    // @function CompileFormat(s, n, program)
+    //
+    //
+    // @param s       - const char*              : target string
+    // @param n       - size_t                   : length of target string
+    // @param program - logger::format_program&  : compiled target string
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // parse target string and resolve its styles, leave style instructions out if logger::console_plain_ is set
+    
+    void CompileFormat(const char*, size_t, format_program&);
+    
+    
+    
+    
+    // @function CachedFormat(s)
+    //
+    //
+    // @param s - const std::string&/const char* : target string
+    //
+    // @return std::shared_ptr<const logger::format_program>
+    //
+    // @throw logger::error
+    //
+    //
+    // return compiled target string from the cache of current thread,
+    // compile it if this thread meets it for the first time
+    // cache is cleared when it holds LOGGER_FORMAT_CACHE_SIZE strings,
+    // the caller keeps the program alive while ConsoleLog called by operator<< of its arguments changes the cache
+    
+    std::shared_ptr<const format_program> CachedFormat(const char*, size_t);
+    std::shared_ptr<const format_program> CachedFormat(const std::string&);
+    std::shared_ptr<const format_program> CachedFormat(const char*);
+    
+    
+    
+    
+    // @function RenderFormat(default args, type, s, ops, styles, count, args)
+    //
+    //
+    // @param default args                                  : set of arguments that define macro information
+    // @param type          - logger::log_message_type      : type of message
+    // @param s             - const char*                   : target string
+    // @param ops           - const logger::format_op*      : parsed target string
+    // @param styles        - const logger::bound_style* const* : resolved styles of @ops, or nullptr
+    //                                                            to find styles by name
+    // @param count         - size_t                        : number of parsed instructions
+    // @param args          - pack                          : variables that will be put instead of "%v"
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // execute parsed target string and pass result to logger::WriteConsole.
+    // return true if everything ok and false if there were errors with console output
+    
+    template <class ...Args>
+    bool RenderFormat(const char*, const char*, int, const char*, log_message_type, const char*, const format_op*, const bound_style* const*, size_t, const Args&...);
+    
+    
+    
+    
     // @function ConsoleLog(default args, s, args)
     //
     //
@@ -142,8 +481,102 @@ namespace logger {
     // if some error occurs, throws logger::error with information about error
     // return true if everything ok and false if there were errors with console output
     
+    template <class S, class ...Args>
+    typename std::enable_if<is_runtime_format<S>::value, bool>::type
+    ConsoleLog(const char*, const char*, int, const char*, const S&, const Args&...);
+    
+    
+    
+    
+#ifdef LOGGER_HAS_CONSTEVAL
+    // @function ConsoleLog(default args, s, args)
+    //
+    //
+    // @param default args                                      : set of arguments that define macro information
+    // @param s             - logger::format_string<Args...>    : string literal parsed at compile time
+    // @param args          - pack                              : variables that will be put instead of "%v" in target string
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // same as ConsoleLog for runtime strings but string literal is parsed at compile time,
+    // wrong commands and wrong number of arguments are compile errors
+    
+    template <class ...Args>
+    bool ConsoleLog(const char*, const char*, int, const char*, format_string<std::type_identity_t<Args>...>, const Args&...);
+#endif
+    
+    
+    
+    
+    // @function ConsoleLog(default args, type, s, args)
+    //
+    //
+    // @param default args                            : set of arguments that define macro information
+    // @param type          - logger::log_message_type: type of message, calls below LOGGER_MIN_LEVEL are removed
+    // @param s             - std::string/const char* : target string - string that will be parsed
+    // @param args          - pack                    : variables that will be put instead of "%v" in target string
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // same as ConsoleLog without a type, T_ERROR and T_CRITICAL lines are written right away
+    // by the direct console sink, lines without a type are T_INFO
+    
+    template <class S, class ...Args>
+    typename std::enable_if<is_runtime_format<S>::value, bool>::type
+    ConsoleLog(const char*, const char*, int, const char*, log_message_type, const S&, const Args&...);
+    
+#ifdef LOGGER_HAS_CONSTEVAL
     template <class ...Args>
-    bool ConsoleLog(const char*, const char*, int, const char*, const std::string&, const Args&...);
+    bool ConsoleLog(const char*, const char*, int, const char*, log_message_type, format_string<std::type_identity_t<Args>...>, const Args&...);
+#endif
+    
+    
+    
+    
+    // @function ConsoleLogPass(limiter, default args, first)
+    //
+    //
+    // @param limiter       - logger::rate_limiter& : limiter of the call site
+    // @param default args                          : set of arguments that define macro information
+    // @param first                                 : first argument of the log call
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // return false if the record is suppressed, when the record passes after suppressed ones
+    // put a line with the number of suppressed records first
+    // a call site that suppressed records is watched, so logger::Flush and the exit report the rest
+    
+    template <class T>
+    bool ConsoleLogPass(rate_limiter&, const char*, const char*, int, const char*, const T&);
+    
+    
+    
+    
+    // @function ConsoleLogSuppressed(site, suppressed, now)
+    //
+    //
+    // @param site       - const logger::limiter_site& : call site
+    // @param suppressed - size_t                      : number of suppressed records
+    // @param now        - bool                        : write the line on this thread without thread local
+    //                                                   buffers and format cache, so it works when the program exits
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // put a line with the number of suppressed records of @site to the console
+    
+    bool ConsoleLogSuppressed(const limiter_site&, size_t, bool);
     
     
     
@@ -175,7 +608,7 @@ namespace logger {
 template <class ...Args>
 bool logger::BindConsoleStyle(std::string s, Args... args) {
     
-    return binded_styles.emplace(std::make_pair(std::move(s), style({args...}))).second;
+    return logger::BindStyle(s, logger::style({args...}));
     
 }
 
@@ -210,186 +643,593 @@ logger::error logger::Trace(logger::error&& error, const char* path, const char*
 
 
 // @Implementation of
-//  logger::ConsoleLog
+//  logger::CompileFormat
 
-template <class ...Args>
-bool logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const std::string& s, const Args&... args) {
-    
-#ifdef OS_WIN
-    static bool escape_sequence_enabled = false;
-    if(!escape_sequence_enabled) {
-        logger::EnableWindowsAnsiEscapeSequence();
-        escape_sequence_enabled = true;
-    }
-#endif
-    
-    
-    static time_t               the_time  = time(NULL);             // static time object
-    struct tm                   *cur_time = localtime(&the_time);   // current time object
-    size_t                      n         = s.length();             // length of string
-    size_t                      prev_it   = 0;                      // start pos of last substring without commands
+void logger::CompileFormat(const char* s, size_t n, logger::format_program& program) {
     
+    program.format.assign(s, n);
+    program.ops.clear();
+    program.styles.clear();
+    program.plain = logger::console_plain_.load(std::memory_order_relaxed);
     
-    std::queue<std::string>     queue;                              // queue with variable converted to string
-    std::stack<logger::style*>  modifier_stack;                     // stack with active modifiers
-    static logger::style        default_style({logger::RESET});     // default style is no-style
-    
+    for(size_t i = 0, vars = 0; i < n; ) {
+        
+        logger::format_op           op    = {logger::F_TEXT, 0, 0};
+        const logger::bound_style*  style = nullptr;
+        
+        i = logger::ParseFormatOp(s, n, i, op, vars);
+        
+        if(op.command == logger::F_VAR) ++vars;
+        
+        if(op.command == logger::F_STYLE) {
+            style = logger::FindStyle(s + op.begin, op.length);
+            
+            if(!style) throw logger::error("parse error : unknown style");
+        }
+        
+        if(program.plain && (op.command == logger::F_STYLE || op.command == logger::F_STYLE_END)) continue;
+        
+        program.ops.push_back(op);
+        program.styles.push_back(style);
+    }
     
-    modifier_stack.push(&default_style);
+}
+
+
+
+
+// @Implementation of
+//  logger::CachedFormat
+
+std::shared_ptr<const logger::format_program> logger::CachedFormat(const char* s, size_t n) {
+    
+    static thread_local std::unordered_map<size_t, std::shared_ptr<const logger::format_program> > cache;   // hash of target string -> program
+    
+    size_t hash = 14695981039346656037ULL & (size_t)-1;    // FNV-1a
+    
+    for(size_t i = 0; i < n; ++i) {
+        hash = (hash ^ (unsigned char)s[i]) * (size_t)1099511628211ULL;
+    }
+    
+    std::unordered_map<size_t, std::shared_ptr<const logger::format_program> >::iterator it = cache.find(hash);
+    
+    if(it != cache.end() && it->second->format.compare(0, std::string::npos, s, n) == 0 &&
+       it->second->plain == logger::console_plain_.load(std::memory_order_relaxed)) {
+        return it->second;
+    }
+    
+    std::shared_ptr<logger::format_program> program = std::make_shared<logger::format_program>();
+    
+    logger::CompileFormat(s, n, *program);  // throws before the cache is changed
+    
+    if(cache.size() >= LOGGER_FORMAT_CACHE_SIZE) {
+        cache.clear();      // programs being rendered are freed by their callers
+    }
+    
+    cache[hash] = program;
     
-    ProcessVars(&queue, args...);    // convert vars to string and push them to the queue
+    return program;
     
+}
+
+
+
+
+// @Implementation of
+//  logger::CachedFormat
 
+std::shared_ptr<const logger::format_program> logger::CachedFormat(const std::string& s) {
     
-    std::stringstream result_ss;    // stringstream containing output
+    return logger::CachedFormat(s.c_str(), s.length());
     
+}
+
+
+
+
+// @Implementation of
+//  logger::CachedFormat
+
+std::shared_ptr<const logger::format_program> logger::CachedFormat(const char* s) {
     
-    for(size_t i = 0; i < n; ++i) {
-        if(s[i] == '%') { // command
-            
-            if(i + 1 == n) {
-                throw logger::error("parse error : empty command");
-            }
-            
-            if(i != prev_it) {
-                
-                result_ss.write((char*)(s.c_str() + prev_it),sizeof(char) * (i - prev_it));
-                //result_ss << s.substr(prev_it,i - prev_it);
-            }
+    return logger::CachedFormat(s, strlen(s));
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableAsyncConsoleLog
+
+void logger::EnableAsyncConsoleLog(size_t capacity) {
+    
+    logger::StartLogWorker(capacity);
+    
+    logger::async_console_log_ = true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::IsTerminal
+
+bool logger::IsTerminal(int fd) {
+    
+#ifdef OS_WIN
+    return _isatty(fd) != 0;
+#else
+    return isatty(fd) != 0;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::SetConsoleColors
+
+void logger::SetConsoleColors(logger::console_colors colors) {
+    
+    logger::console_colors_ = colors;
+    
+    if(colors == logger::CC_AUTO) {
+        logger::console_plain_.store(!logger::IsTerminal(logger::console_sink_.fd < 0 ? 1 : logger::console_sink_.fd));
+        return;
+    }
+    
+    logger::console_plain_.store(colors == logger::CC_NEVER);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableDirectConsoleLog
+
+void logger::EnableDirectConsoleLog(int fd, logger::console_flush policy, size_t bytes, unsigned interval) {
+    
+    logger::AddSinkFlusher(&logger::FlushConsoleSink);  // logger::Flush writes the buffer
+    
+    std::cout.flush();
+    
+    {
+        std::lock_guard<std::mutex> lock(logger::console_sink_.mutex);
+        
+        logger::console_sink_.fd       = fd;
+        logger::console_sink_.policy   = policy;
+        logger::console_sink_.bytes    = bytes;
+        logger::console_sink_.interval = interval ? interval : 1;
+        
+        logger::console_sink_.buffer.reserve(bytes);
+        
+        if(logger::console_colors_ == logger::CC_AUTO) {
+            logger::console_plain_.store(!logger::IsTerminal(fd));
+        }
+        
+        if(policy == logger::CF_PERIODIC && !logger::console_sink_.thread.joinable()) {
             
-            if(s[i + 1] == 'y') {         // %yyyy / %yy
-                if(i + 2 != n && s[i + 2] == 'y') {
-                    if(i + 4 != n && s[i + 3] == s[i + 4] && s[i + 3] == 'y') {
-                        // %yyyy
-                        result_ss << std::to_string(cur_time->tm_year + 1900);
-                        i += 4;
-                    } else {
-                        // %yy
-                        result_ss << StrToLen(std::to_string(cur_time->tm_year % 100),2,'0');
-                        i += 2;
-                    }
-                } else {
-                    throw logger::error("no such command : \"%y\"");
-                }
-                
-            } else if(s[i + 1] == 'm') {  // %mm / %m
-                if(i + 2 != n && s[i + 2] == 'm') {
-                    // %mm
-                    result_ss << StrToLen(std::to_string(cur_time->tm_mon + 1),2,'0');
-                    i += 2;
-                } else {
-                    // %m
-                    result_ss << StrToLen(std::to_string(cur_time->tm_min),2,'0');
-                    i += 1;
-                }
-            } else if(s[i + 1] == 's') {  // %s
-                result_ss << StrToLen(std::to_string(cur_time->tm_sec),2,'0');
-                i += 1;
-            } else if(s[i + 1] == 'h') {  // %h
-                result_ss << StrToLen(std::to_string(cur_time->tm_hour),2,'0');
-                i += 1;
-            } else if(s[i + 1] == 'd') {  // %dd
-                if(i + 2 != n && s[i + 2] == 'd') {
-                    result_ss << StrToLen(std::to_string(cur_time->tm_mday),2,'0');
-                    i += 2;
-                } else {
-                    throw logger::error("no such command : \"%d\"");
-                }
-            } else if(s[i + 1] == 'v') {  // %v
-                result_ss << queue.front();
-                queue.pop();
-                i += 1;
-            } else if(s[i + 1] == 'F') {  // %FILE
-                if(i + 4 != n && s[i + 2] == 'I' && s[i + 3] == 'L' && s[i + 4] == 'E') {
-                    result_ss << FILENAME;
-                    i += 4;
-                } else if(i + 4 != n && s[i + 2] == 'U' && s[i + 3] == 'N' && s[i + 4] == 'C') {
-                    result_ss << FUNC;
-                    i += 4;
-                } else {
-                    throw logger::error("parse error");
-                }
-            } else if(s[i + 1] == 'P') {  // %PATH
-                if(i + 4 != n && s[i + 2] == 'A' && s[i + 3] == 'T' && s[i + 4] == 'H') {
-                    result_ss << PATH;
-                    i += 4;
-                } else {
-                    throw logger::error("parse error");
-                }
-            } else if(s[i + 1] == 'L') {  // %LINE
-                if(i + 4 != n && s[i + 2] == 'I' && s[i + 3] == 'N' && s[i + 4] == 'E') {
-                    result_ss << LINE;
-                    i += 4;
-                } else {
-                    throw logger::error("parse error");
-                }
-            } else if(s[i + 1] == '.') {  // %.
-                
-                size_t class_name_begin = i+2,              // start pos of class name
-                       class_name_end = std::string::npos;  // end pos of class name
+            logger::console_sink_.thread = std::thread([]{
                 
-                for(size_t j = i + 2; j < n; ++j) {
-                    if(s[j] == '(') {
-                        class_name_end = j;
-                        break;
-                    }
-                }
+                logger::console_sink& sink = logger::console_sink_;
                 
-                if(class_name_end == std::string::npos) {
-                    throw logger::error("parse error");
-                }
+                std::unique_lock<std::mutex> lock(sink.mutex);
                 
-                try{
-                    // try to find style with such name
-                    logger::style &style = logger::binded_styles.at(s.substr(class_name_begin, class_name_end - class_name_begin));
-                    
-                    // update last active modifier
-                    modifier_stack.push(&style);
+                while(!sink.wake.wait_for(lock, std::chrono::milliseconds(sink.interval), [&sink]{ return sink.stop; })) {
                     
-                    // apply modifier
-                    result_ss << style;
+                    if(sink.buffer.empty()) continue;
                     
-                }catch(std::out_of_range e) {
-                    throw logger::error(e.what());
+                    logger::WriteConsoleFd(sink.fd, sink.buffer.data(), sink.buffer.length(), nullptr, 0);
+                    sink.buffer.clear();
+                }
+            });
+        }
+    }
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::console_sink::~console_sink
+
+logger::console_sink::~console_sink() {
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    
+    wake.notify_one();
+    
+    if(thread.joinable()) thread.join();
+    
+    if(fd >= 0 && !buffer.empty()) {
+        logger::WriteConsoleFd(fd, buffer.data(), buffer.length(), nullptr, 0);
+    }
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsole
+
+bool logger::WriteConsole(const std::string& text, logger::log_message_type type) {
+    
+    if(logger::async_console_log_ && logger::log_worker_) {     // written right away once the central flusher stopped at exit
+        
+        logger::thread_frame<logger::log_record> record;  // reused by every call of this thread
+        
+        record->write    = &logger::WriteConsoleRecord;
+        record->type     = type;
+        record->is_error = false;
+        
+        record->values.Clear();
+        
+        ProcessVars(&record->values, text);
+        
+        logger::log_worker_->Push(*record);
+        
+        return true;
+    }
+    
+    return logger::WriteConsoleText(text.data(), text.length(), type);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsoleRecord
+
+bool logger::WriteConsoleRecord(logger::log_record& record) {
+    
+    static const bool flushed = logger::AddSinkFlusher(&logger::FlushConsoleSink);   // logger::Flush flushes the console
+    
+    (void)flushed;
+    
+    return logger::WriteConsoleText(record.values.Var(0), record.values.Length(0), record.type);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsoleText
+
+bool logger::WriteConsoleText(const char* data, size_t n, logger::log_message_type type) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_CONSOLE].write);
+    
+    logger::console_sink& sink = logger::console_sink_;
+    
+    bool written = true;
+    
+    if(sink.fd < 0) {
+        
+        written = std::cout.write(data, (std::streamsize)n).good();
+    }
+    else {
+        
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        
+        bool urgent = type == logger::T_ERROR || type == logger::T_CRITICAL;
+        bool full   = sink.buffer.length() + n >= sink.bytes;
+        
+        if(sink.policy != logger::CF_LINE && !urgent && !full) {
+            sink.buffer.append(data, n);
+        }
+        else {
+            written = logger::WriteConsoleFd(sink.fd, sink.buffer.data(), sink.buffer.length(), data, n);    // no copy of the line
+            sink.buffer.clear();
+        }
+    }
+    
+    logger::CountRecord(logger::S_CONSOLE, written, n);
+    
+    return written;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsoleFd
+
+bool logger::WriteConsoleFd(int fd, const char* first, size_t first_n, const char* second, size_t second_n) {
+    
+#ifdef OS_UNIX
+    struct iovec parts[2] = { {(void*)first, first_n}, {(void*)second, second_n} };
+    struct iovec* part    = first_n ? parts : parts + 1;
+    int           count   = (int)(parts + 2 - part);
+    
+    while(count && part->iov_len + (count > 1 ? part[1].iov_len : 0)) {
+        
+        ssize_t n = count > 1 ? writev(fd, part, count) : write(fd, part->iov_base, part->iov_len);
+        
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        
+        // skip written data, a partial write continues where it stopped
+        while(count && (size_t)n >= part->iov_len) {
+            n -= (ssize_t)part->iov_len;
+            ++part;
+            --count;
+        }
+        
+        if(count) {
+            part->iov_base  = (char*)part->iov_base + n;
+            part->iov_len  -= (size_t)n;
+        }
+    }
+    
+    return true;
+#else
+    const char* parts[2]   = { first, second };
+    size_t      lengths[2] = { first_n, second_n };
+    
+    for(int i = 0; i < 2; ++i) {
+        
+        while(lengths[i]) {
+            
+            int n = _write(fd, parts[i], (unsigned)lengths[i]);
+            
+            if(n <= 0) return false;
+            
+            parts[i]   += n;
+            lengths[i] -= (size_t)n;
+        }
+    }
+    
+    return true;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushConsoleSink
+
+bool logger::FlushConsoleSink() {
+    
+    logger::CountFlush(logger::S_CONSOLE);
+    
+    logger::console_sink& sink = logger::console_sink_;
+    
+    if(sink.fd < 0) return std::cout.flush().good();
+    
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    
+    bool written = logger::WriteConsoleFd(sink.fd, sink.buffer.data(), sink.buffer.length(), nullptr, 0);
+    
+    sink.buffer.clear();
+    
+    return written;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::RenderFormat
+
+template <class ...Args>
+bool logger::RenderFormat(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, const char* s, const logger::format_op* ops, const logger::bound_style* const* styles, size_t count, const Args&... args) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_CONSOLE].enqueue);
+    
+    bool plain = logger::console_plain_.load(std::memory_order_relaxed);   // no escape sequences
+    
+#ifdef OS_WIN
+    static bool escape_sequence_enabled = false;
+    if(!escape_sequence_enabled && !plain) {
+        logger::EnableWindowsAnsiEscapeSequence();
+        escape_sequence_enabled = true;
+    }
+#endif
+    
+    
+    logger::log_time            now       = logger::Now();          // current time
+    char                        date_time[20];                      // "YYYY-MM-DD HH:MM:SS"
+    char                        fraction[6];                        // digits of fractional part of second
+    
+    logger::DateTime(now.seconds, date_time);
+    
+    
+    logger::thread_frame<logger::var_buffer>             vars;     // variables converted to string
+    logger::thread_frame<std::vector<logger::sgr_state>> states;   // state of every opened style
+    logger::sgr_state                                    emitted = 0;  // state of the terminal
+    
+    
+    states->assign(1, 0);   // line starts and ends in the default state
+    
+    vars->Clear();
+    
+    ProcessVars(&*vars, args...);    // convert vars to string and append them to the buffer
+    
+    
+    logger::thread_frame<std::string> line;     // output, keeps its capacity between calls
+    std::string&                      out = *line;
+    
+    out.clear();
+    
+    
+    for(size_t i = 0; i < count; ++i) {
+        
+        const logger::format_op& op = ops[i];
+        
+        // styles only change the wanted state, the difference is written before the next text
+        // so adjacent style commands produce one escape sequence
+        if(op.command != logger::F_STYLE && op.command != logger::F_STYLE_END && emitted != states->back()) {
+            logger::AppendSgr(out, emitted, states->back());
+            emitted = states->back();
+        }
+        
+        switch(op.command) {
+            case logger::F_TEXT:
+                out.append(s + op.begin, op.length);
+                break;
+            case logger::F_YEAR4:
+                out.append(date_time, 4);
+                break;
+            case logger::F_YEAR2:
+                out.append(date_time + 2, 2);
+                break;
+            case logger::F_MONTH:
+                out.append(date_time + 5, 2);
+                break;
+            case logger::F_DAY:
+                out.append(date_time + 8, 2);
+                break;
+            case logger::F_HOUR:
+                out.append(date_time + 11, 2);
+                break;
+            case logger::F_MINUTE:
+                out.append(date_time + 14, 2);
+                break;
+            case logger::F_SECOND:
+                out.append(date_time + 17, 2);
+                break;
+            case logger::F_MILLISECOND:
+                logger::FractionDigits(now.nanoseconds, 3, fraction);
+                out.append(fraction, 3);
+                break;
+            case logger::F_MICROSECOND:
+                logger::FractionDigits(now.nanoseconds, 6, fraction);
+                out.append(fraction, 6);
+                break;
+            case logger::F_VAR:
+                if(op.begin >= vars->Count()) {
+                    throw logger::error("parse error : not enough arguments for \"%v\"");
                 }
+                out.append(vars->Var(op.begin), vars->Length(op.begin));
+                break;
+            case logger::F_FILE:
+                out.append(FILENAME);
+                break;
+            case logger::F_FUNC:
+                out.append(FUNC);
+                break;
+            case logger::F_LINE:
+                logger::AppendVar(out, LINE);
+                break;
+            case logger::F_PATH:
+                out.append(PATH);
+                break;
+            case logger::F_STYLE:
+            {
+                if(plain) break;    // only in strings parsed at compile time
                 
-                i = class_name_end;
+                // style resolved by CompileFormat or found by name without copying it
+                const logger::bound_style* style = styles ? styles[i] : logger::FindStyle(s + op.begin, op.length);
                 
-            } else if(s[i + 1] == ')') {  // %)
+                if(!style) throw logger::error("parse error : unknown style");
                 
-                if(modifier_stack.size() < 2){
+                states->push_back(logger::ApplyStyle(states->back(), *style));
+                break;
+            }
+            case logger::F_STYLE_END:
+                if(plain) break;
+                
+                if(states->size() < 2){
                     throw logger::error("parse error: modifier stack is empty");
                 }
                 
-                modifier_stack.pop();
-                
-                result_ss << logger::RESET;
-                result_ss << *modifier_stack.top();
-                
-                i += 1;
-                
-            } else if(s[i + 1] == '%') {  // %%
-                result_ss << '%';
-                i += 1;
-            } else {                      // nothing
-                throw logger::error("parse error : empty command");
-            }
-            
-            prev_it = i + 1; // update non-command sequence
+                states->pop_back();
+                break;
         }
     }
     
-    if(n != prev_it) {
-        result_ss.write((char*)(s.c_str() + prev_it),sizeof(char) * (n - prev_it));
-    }
+    // disable modifiers that are still on and move to next line
+    logger::AppendSgr(out, emitted, 0);
+    out += '\n';
     
-    // output stringstream, disable all modifiers and move to next line
-    std::cout << std::move(result_ss.str()) << logger::RESET << '\n';
     
+    return logger::WriteConsole(out, TYPE);
     
-    return std::cout.good();
+}
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class S, class ...Args>
+typename std::enable_if<logger::is_runtime_format<S>::value, bool>::type
+logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const S& format, const Args&... args) {
+    
+    return logger::ConsoleLog(PATH, FILENAME, LINE, FUNC, logger::T_INFO, format, args...);
+    
+}
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class ...Args>
+bool logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::format_string<std::type_identity_t<Args>...> format, const Args&... args) {
+    
+    return logger::ConsoleLog<Args...>(PATH, FILENAME, LINE, FUNC, logger::T_INFO, format, args...);
+    
+}
+#endif
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class S, class ...Args>
+typename std::enable_if<logger::is_runtime_format<S>::value, bool>::type
+logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, const S& format, const Args&... args) {
+    
+    std::shared_ptr<const logger::format_program> program = logger::CachedFormat(format);   // parsed target string, alive until rendered
+    
+    return logger::RenderFormat(PATH, FILENAME, LINE, FUNC, TYPE, program->format.c_str(), program->ops.data(), program->styles.data(), program->ops.size(), args...);
+    
+}
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class ...Args>
+bool logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, logger::format_string<std::type_identity_t<Args>...> format, const Args&... args) {
+    
+    if(format.dynamic) { // too many commands to be stored in format_string
+        
+        std::shared_ptr<const logger::format_program> program = logger::CachedFormat(format.str, format.length);
+        
+        return logger::RenderFormat(PATH, FILENAME, LINE, FUNC, TYPE, program->format.c_str(), program->ops.data(), program->styles.data(), program->ops.size(), args...);
+    }
+    
+    return logger::RenderFormat(PATH, FILENAME, LINE, FUNC, TYPE, format.str, format.ops, (const logger::bound_style* const*)nullptr, format.count, args...);
     
 }
+#endif
 
 
 
@@ -399,6 +1239,22 @@ bool logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const
 
 bool logger::ConsoleLog(const char*, const char*, int, const char*, logger::error& error) {
     
+    logger::stats_timer timer(logger::sink_meters_[logger::S_CONSOLE].enqueue);
+    
+    if(logger::console_plain_.load(std::memory_order_relaxed)) {
+        
+        std::string text = "[ERROR] error message : \"";
+        
+        text.append(error.what()).append("\" error stack :\n");
+        
+        while(!error.error_stack_.empty()) {
+            text.append(1, '\t').append(error.error_stack_.top()) += '\n';
+            error.error_stack_.pop();
+        }
+        
+        return logger::WriteConsole(text, logger::T_ERROR);
+    }
+    
 #ifdef OS_WIN
     static bool escape_sequence_enabled = false;
     if(!escape_sequence_enabled) {
@@ -407,18 +1263,101 @@ bool logger::ConsoleLog(const char*, const char*, int, const char*, logger::erro
     }
 #endif
     
-    std::cout << logger::FG_WHITE << logger::BG_RED << "[ERROR]" << logger::RESET << " error message : \"" << logger::FG_RED << error.what() << logger::RESET <<  "\" error stack :\n" ;
+    std::stringstream result_ss;    // stringstream containing output
+    
+    result_ss << logger::FG_WHITE << logger::BG_RED << "[ERROR]" << logger::RESET << " error message : \"" << logger::FG_RED << error.what() << logger::RESET <<  "\" error stack :\n" ;
     while(!error.error_stack_.empty()) {
-        std::cout << '\t' << logger::UNDERLINE <<  error.error_stack_.top() << logger::UNDERLINE_OFF << "\n";
+        result_ss << '\t' << logger::UNDERLINE <<  error.error_stack_.top() << logger::UNDERLINE_OFF << "\n";
         error.error_stack_.pop();
     }
     
-    return std::cout.good();
+    return logger::WriteConsole(result_ss.str(), logger::T_ERROR);
     
 };
 
+// @Implementation of
+//  logger::ConsoleLogPass
+
+template <class T>
+bool logger::ConsoleLogPass(logger::rate_limiter& limiter, const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const T& first) {
+    
+    size_t passed = limiter.Pass();
+    
+    if(passed == 0) {
+        logger::CountDropped(logger::S_CONSOLE, 1);
+        limiter.Watch(logger::limiter_site{ &logger::ConsoleLogSuppressed, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) });
+        return false;
+    }
+    
+    if(passed > 1) {
+        logger::ConsoleLogSuppressed(logger::limiter_site{ nullptr, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) }, passed - 1, false);
+    }
+    
+    return true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLogSuppressed
+
+bool logger::ConsoleLogSuppressed(const logger::limiter_site& site, size_t suppressed, bool now) {
+    
+    if(now) {
+        
+        std::string text = "suppressed ";
+        
+        logger::AppendVar(text, suppressed);
+        text += " records\n";
+        
+        if(logger::log_worker_) logger::log_worker_->Flush();   // records queued before stay ahead of the line
+        
+        return logger::WriteConsoleText(text.data(), text.length(), site.type);
+    }
+    
+    const char* format = "suppressed %v records";   // parsed once and cached
+    
+    return logger::ConsoleLog(site.path, site.filename, site.line, site.func, site.type, format, suppressed);
+    
+}
+
+// LOGGER_GATE for ConsoleLog, with compile time parsing a first argument written as a string literal
+// is passed on as it is written, so it stays a constant expression (it has no side effects to repeat),
+// other character arrays are passed as const char* and parsed at runtime
+#ifdef LOGGER_HAS_CONSTEVAL
+#define LOGGER_STRINGIFY_(x) #x
+#define LOGGER_STRINGIFY(x) LOGGER_STRINGIFY_(x)
+#define LOGGER_CONSOLE_GATE(PASS, ...) logger::Gate(logger::S_CONSOLE, LOGGER_FIRST_ARG(__VA_ARGS__), __func__, \
+    [&](auto&& logger_first_, const char* logger_func_) -> bool { \
+        if constexpr(logger::IsStringLiteral(LOGGER_STRINGIFY(LOGGER_FIRST_ARG(__VA_ARGS__)))) { \
+            return PASS && (logger::ConsoleLog)(__FILE__,__FILENAME__,__LINE__,logger_func_, __VA_ARGS__); \
+        } \
+        else if constexpr(std::is_array<std::remove_reference_t<decltype(logger_first_)> >::value) { \
+            return PASS && (logger::ConsoleLog)(__FILE__,__FILENAME__,__LINE__,logger_func_, \
+                                                static_cast<const char*>(logger_first_) LOGGER_REST_ARGS(__VA_ARGS__)); \
+        } \
+        else { \
+            return PASS && (logger::ConsoleLog)(__FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_ LOGGER_REST_ARGS(__VA_ARGS__)); \
+        } })
+#else
+#define LOGGER_CONSOLE_GATE(PASS, ...) LOGGER_GATE(logger::S_CONSOLE, PASS, (logger::ConsoleLog), __VA_ARGS__)
+#endif
+
 // Macro that pass to the logger::ConsoleLog additional info about place where it has been called
-#define ConsoleLog(...) logger::ConsoleLog(__FILE__,__FILENAME__,__LINE__,__func__ ,__VA_ARGS__)
+// the first argument is evaluated once, calls below LOGGER_MIN_LEVEL or the runtime level
+// do nothing and do not evaluate the other arguments
+#define ConsoleLog(...) LOGGER_CONSOLE_GATE(true, __VA_ARGS__)
+
+// ConsoleLog that prints at most RATE lines per second from this call site,
+// arguments of suppressed calls except the first one are not evaluated
+#define ConsoleLogRate(RATE, ...) LOGGER_CONSOLE_GATE( \
+    logger::ConsoleLogPass(LOGGER_LIMITER(logger::rate_limiter, RATE), __FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_), \
+    __VA_ARGS__)
+
+// ConsoleLog that prints one of every K lines from this call site
+#define ConsoleLogSample(K, ...) LOGGER_CONSOLE_GATE(LOGGER_LIMITER(logger::sample_limiter, K).Pass(), __VA_ARGS__)
 
 // Macro that pass to the logger::Trace additional info about place where it has been called
 #define Trace(x) logger::Trace(x,__FILE__,__func__,__LINE__)
@@ -427,6 +1366,8 @@ bool logger::ConsoleLog(const char*, const char*, int, const char*, logger::erro
 #ifdef DEBUG_ONLY
     #if defined(DEBUG) | defined(_DEBUG)
         #define ConsoleLog(...) NULL
+        #define ConsoleLogRate(...) NULL
+        #define ConsoleLogSample(...) NULL
     #endif
 #endif
 
@@ -24,90 +24,814 @@
 #define LOG_FILE_HPP
 
 #include <string.h>                 // strrchr
+#include <stdlib.h>                 // atexit
 #include <cstddef>                  // size_t
-#include <time.h>                   // time, localtime
+#include <time.h>                   // time_t
 #include <string>                   // std::string, std::to_string
-#include <queue>                    // std::queue
+#include <mutex>                    // std::mutex, std::recursive_mutex, std::lock_guard
+#include <atomic>                   // std::atomic
 #include <fstream>                  // std::ofstream
 
 #if defined(_WIN32) | defined(_WIN64)
-#include <windows.h>                // WIN32_FIND_DATA, HANDLE, CreateDirectory
+#include <windows.h>                // WIN32_FIND_DATA, HANDLE
+#include <sys/stat.h>               // stat
 #define OS_WIN
 #else
 #include <sys/stat.h>               // stat
-#include <unistd.h>                 // mkdir
 #define OS_UNIX
 #endif
 
-#include "log_message_types.hpp"    // logger::log_message_type
+#include "log_message_types.hpp"    // logger::log_message_type, logger::MessageTypeName
 #include "log_error.hpp"            // logger::error
-#include "log_utility.hpp"          // logger::ProcessVars, logger::StrToLen
+#include "log_utility.hpp"          // logger::ProcessVars, logger::var_buffer, logger::thread_frame
+#include "log_flusher.hpp"          // logger::log_record, logger::StartLogWorker, logger::AddSinkFlusher
+#include "log_path.hpp"             // logger::log_path
+#include "log_mmap.hpp"             // logger::mapped_file
+#include "log_uring.hpp"            // logger::uring_file
+#include "log_retention.hpp"        // logger::log_retention_
+#include "log_compress.hpp"         // logger::log_compressor_
+#include "log_clock.hpp"            // logger::Now, logger::DateTime
+#include "log_level.hpp"            // logger::Enabled, logger::TypeOf
+#include "log_limit.hpp"            // logger::rate_limiter, logger::sample_limiter
+#include "log_stats.hpp"            // logger::stats_timer, logger::CountRecord
+#include "log_json.hpp"             // logger::kv, logger::ProcessJsonVars, logger::AppendJsonHead
 
 #define __FILENAME__ (strrchr("/" __FILE__, '/') + 1)
 
-namespace logger {
+namespace logger {
+    
+    // @member log_directory_
+    //
+    // string with path to logging directory
+    
+    std::string log_directory_;
+    
+    
+    
+    
+    // @member log_directory_mutex_
+    //
+    // guards log_directory_ when it is read by the background writer
+    
+    std::mutex log_directory_mutex_;
+    
+    
+    
+    
+    // @member log_directory_generation_
+    //
+    // incremented every time the logging directory is changed
+    
+    std::atomic<size_t> log_directory_generation_(1);
+    
+    
+    
+    
+    // @struct file_sink
+    //
+    //
+    // @member stream     - std::ofstream       : currently opened log file
+    // @member mapped     - logger::mapped_file : currently opened log file in mapped mode
+    // @member uring      - logger::uring_file  : currently opened log file in io_uring mode
+    // @member path       - logger::log_path    : resolved path and day boundaries of the opened file
+    // @member generation - size_t              : log_directory_generation_ the file was opened for
+    // @member text       - std::string         : rendered record, reused by every write
+    // @member extent     - size_t              : preallocation step of mapped mode, 0 - std::ofstream is used
+    // @member checkpoint - size_t              : bytes between msync calls in mapped mode, 0 - never
+    // @member buffers    - size_t              : number of buffers in io_uring mode, 0 - mode is disabled
+    // @member buffer_size- size_t              : size of one buffer in io_uring mode
+    // @member threads    - size_t              : pwrite threads used when io_uring is unavailable
+    // @member segment_size    - size_t         : size a segment of the day is limited to, 0 - no limit
+    // @member written         - size_t         : size of the opened segment
+    // @member opened          - std::string    : path to the opened log file
+    // @member repeat_interval - time_t         : longest time repeats are held back, 0 - repeats are written
+    // @member repeat_hash     - size_t         : hash of the last written record, 0 - none
+    // @member repeats         - size_t         : number of held back repeats of the last written record
+    // @member repeat_since    - time_t         : time of the first held back repeat
+    // @member repeated        - log_record     : time of the last held back repeat and place of the last record
+    // @member stats_due       - time_t         : time of the next stats record, 0 - not scheduled yet
+    // @member mutex           - std::recursive_mutex : serializes writes and flushes of synchronous FileLog calls
+    //                                                  of several threads, the central flusher and logger::Flush
+    //
+    //
+    // log file that stays opened between FileLog calls until the day changes
+    
+    struct file_sink {
+        std::ofstream   stream;
+        mapped_file     mapped;
+        uring_file      uring;
+        log_path        path;
+        size_t          generation;
+        std::string     text;
+        size_t          extent;
+        size_t          checkpoint;
+        size_t          buffers;
+        size_t          buffer_size;
+        size_t          threads;
+        size_t          segment_size;
+        size_t          written;
+        std::string     opened;
+        time_t          repeat_interval;
+        size_t          repeat_hash;
+        size_t          repeats;
+        time_t          repeat_since;
+        log_record      repeated;
+        time_t          stats_due;
+        std::recursive_mutex mutex;
+    };
+    
+    
+    
+    
+    // @member log_file_
+    //
+    // file sink shared by every FileLog call
+    
+    file_sink log_file_;
+    
+    
+    
+    
+    // @member async_file_log_
+    //
+    // FileLog only passes records to the central flusher
+    
+    bool async_file_log_ = false;
+    
+    
+    
+    
+    // @member json_file_log_
+    //
+    // FileLog writes JSON lines instead of text
+    
+    bool json_file_log_ = false;
+    
+    
+    
+    
+    // @function BindLogDirectory
+    //
+    //
+    // @param s - const char* : null terminated string, relative or full path to log directory
+    //
+    // @return void
+    //
+    //
+    // Set the logging directory to @s
+    
+    void BindLogDirectory(const char*);
+    
+    
+    
+    
+    // @function EnableAsyncFileLog(capacity)
+    //
+    //
+    // @param capacity - size_t : maximum number of records waiting to be written per thread
+    //
+    // @return void
+    //
+    //
+    // switch FileLog to asynchronous mode: calls only capture the record into
+    // the ring of the calling thread and the central flusher writes it to the log file
+    // errors of the background thread are reported by logger::Flush
+    // pending records are written when the program exits
+    
+    void EnableAsyncFileLog(size_t capacity = 1024);
+    
+    
+    
+    
+    // @function EnableMappedFileLog(extent, checkpoint)
+    //
+    //
+    // @param extent     - size_t : number of bytes the log file is preallocated by
+    // @param checkpoint - size_t : msync written data every @checkpoint bytes, 0 - never
+    //
+    // @return void
+    //
+    //
+    // write log files through a shared memory mapping instead of std::ofstream:
+    // appending a record is a memcpy until the preallocated extent is used up
+    // files are truncated to their real length at rollover and when the program exits
+    // has no effect on Windows, should be called before the first FileLog call
+    
+    void EnableMappedFileLog(size_t extent = 16 << 20, size_t checkpoint = 0);
+    
+    
+    
+    
+    // @function EnableUringFileLog(buffers, buffer_size, threads)
+    //
+    //
+    // @param buffers     - size_t : number of buffers records are collected in
+    // @param buffer_size - size_t : size of one buffer
+    // @param threads     - size_t : number of pwrite threads used when io_uring is unavailable
+    //
+    // @return void
+    //
+    //
+    // write log files through io_uring instead of std::ofstream: rendered records are
+    // copied to a buffer and a full buffer is submitted without waiting for the write,
+    // so records reach the file when their buffer is full or on logger::Flush
+    // falls back to a pool of @threads threads calling pwrite if io_uring cannot be set up
+    // has no effect on Windows, should be called before the first FileLog call
+    
+    void EnableUringFileLog(size_t buffers = 16, size_t buffer_size = 64 << 10, size_t threads = 2);
+    
+    
+    
+    
+    // @function EnableSegmentFileLog(segment_size)
+    //
+    //
+    // @param segment_size - size_t : size a log file is limited to
+    //
+    // @return void
+    //
+    //
+    // split log files of a day into segments ddmmyyyy.log, ddmmyyyy.1.log, ddmmyyyy.2.log, ...
+    // a record is never split between segments, the next segment is opened when
+    // the record does not fit into the current one
+    
+    void EnableSegmentFileLog(size_t segment_size);
+    
+    
+    
+    
+    // @function EnableLogRetention(max_bytes, max_days)
+    //
+    //
+    // @param max_bytes - unsigned long long : total size of log files to keep, 0 - no limit
+    // @param max_days  - unsigned           : number of days to keep log files for, 0 - no limit
+    //
+    // @return void
+    //
+    //
+    // delete the oldest files of the logging directory every time a log file is opened
+    // files are deleted by a background thread, FileLog never waits for it
+    // has no effect on Windows
+    
+    void EnableLogRetention(unsigned long long max_bytes, unsigned max_days = 0);
+    
+    
+    
+    
+    // @function EnableLogCompression(budget, level)
+    //
+    //
+    // @param budget - double : share of one CPU the compression may use, 1 - no limit
+    // @param level  - int    : zlib compression level from 1 to 9
+    //
+    // @return void
+    //
+    //
+    // compress every log file closed by FileLog and files left by previous runs to ddmmyyyy.log.gz
+    // on a background thread with the lowest priority, FileLog never waits for it
+    // compressed files are BGZF: blocks of 64 KB that can be decompressed independently
+    // needs LOGGER_ZLIB defined and zlib linked, has no effect otherwise and on Windows
+    
+    void EnableLogCompression(double budget = 0.25, int level = 6);
+    
+    
+    
+    
+    // @function EnableJsonFileLog()
+    //
+    //
+    // @return void
+    //
+    //
+    // make FileLog write one JSON object per line:
+    // {"time":..,"level":..,"file":..,"line":..,"func":..,"msg":..,"key":value,...}
+    // values without a key are joined by spaces into "msg", every logger::kv becomes a typed field,
+    // errors put their stack into "stack", should be called before the first FileLog call
+    
+    void EnableJsonFileLog();
+    
+    
+    
+    
+    // @function EnableRepeatFileLog(interval)
+    //
+    //
+    // @param interval - time_t : longest time in seconds repeats are held back
+    //
+    // @return void
+    //
+    //
+    // make FileLog hold back records that repeat the previous one: same place, type and values
+    // instead of them a single line "last message repeated N times" is written when
+    // a different record comes, the day changes, @interval seconds pass or the program exits,
+    // after a burst of repeats the line is written by FlushFileSink once it is due
+    
+    void EnableRepeatFileLog(time_t interval = 30);
+    
+    
+    
+    
+    // @function FlushRepeatFileLog()
+    //
+    //
+    // @return bool
+    //
+    //
+    // write the line about held back repeats now and flush the log file
+    
+    bool FlushRepeatFileLog();
+    
+    
+    
+    
+    // @function WriteRepeatRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : unused, makes the function a log_record writer
+    //
+    // @return bool
+    //
+    //
+    // append the line about held back repeats of the last written record to the log file
+    
+    bool WriteRepeatRecord(log_record&);
+    
+    
+    
+    
+    // @function WriteStatsRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record that made the stats due, gives the time
+    //
+    // @return bool
+    //
+    //
+    // append the line with logger::GetStats of every sink to the log file, see logger::EnableStats
+    
+    bool WriteStatsRecord(log_record&);
+    
+    
+    
+    
+    // @function RecordHash(record)
+    //
+    //
+    // @param record - const logger::log_record& : record
+    //
+    // @return size_t
+    //
+    //
+    // FNV-1a hash of place, type and values of @record, never 0
+    
+    size_t RecordHash(const log_record&);
+    
+    
+    
+    
+    // @function WriteFileRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record to write
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // create log directories and append @record to the log file
+    // return true if everything ok and false if there were errors with file output
+    
+    bool WriteFileRecord(log_record&);
+    
+    
+    
+    
+    // @function WriteFileRecordNow(record)
+    //
+    //
+    // @param record - logger::log_record& : record to write
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // write @record in synchronous mode: std::ofstream is flushed after every record,
+    // io_uring buffers are left to be submitted when they are full
+    
+    bool WriteFileRecordNow(log_record&);
+    
+    
+    
+    
+    // @function OpenLogFile(time)
+    //
+    //
+    // @param time - time_t : time of the record
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // create directories logs/{year}/{month} and open the log file of the day of @time
+    
+    void OpenLogFile(time_t);
+    
+    
+    
+    
+    // @function RotateLogFile()
+    //
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // close the opened log file and open the next segment of the same day
+    
+    void RotateLogFile();
+    
+    
+    
+    
+    // @function OpenLogPath(path)
+    //
+    //
+    // @param path - const std::string& : path to the log file
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // close the opened log file and open @path with the enabled backend
+    
+    void OpenLogPath(const std::string&);
+    
+    
+    
+    
+    // @function AppendLogFile(data, n)
+    //
+    //
+    // @param data - const char* : rendered records
+    // @param n    - size_t      : length of @data
+    //
+    // @return bool
+    //
+    //
+    // append @data to the opened log file
+    
+    bool AppendLogFile(const char*, size_t);
+    
+    
+    
+    
+    // @function FlushFileSink()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush data written by WriteFileRecord, first write the line about held back repeats
+    // if @interval of EnableRepeatFileLog passed or the day changed since they began
+    
+    bool FlushFileSink();
+    
+    
+    
+    
+    // @function FileLog(default args, s, args)
+    //
+    //
+    // @param default args                              : set of arguments that define macro information
+    // @param TYPE          - logger::log_message_type  : type of message
+    // @param args          - pack                      : variables that will be logged
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // Put every arg in new line of log file
+    // synchronous calls of several threads are serialized, lines of one call are never split
+    // if some error occurs, throws logger::error with information about error
+    // return true if everything ok and false if there were errors with console output
+    
+    template <class ...Args>
+    bool FileLog(const char*, const char*, int, const char*, log_message_type, const Args&...);
+    
+    
+    
+    
+    // @function FileLogPass(limiter, default args, first)
+    //
+    //
+    // @param limiter       - logger::rate_limiter& : limiter of the call site
+    // @param default args                          : set of arguments that define macro information
+    // @param first                                 : first argument of the log call
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // return false if the record is suppressed, when the record passes after suppressed ones
+    // put a line with the number of suppressed records first
+    // a call site that suppressed records is watched, so logger::Flush and the exit report the rest
+    
+    template <class T>
+    bool FileLogPass(rate_limiter&, const char*, const char*, int, const char*, const T&);
+    
+    
+    
+    
+    // @function FileLogSuppressed(site, suppressed, now)
+    //
+    //
+    // @param site       - const logger::limiter_site& : call site
+    // @param suppressed - size_t                      : number of suppressed records
+    // @param now        - bool                        : write the line on this thread even in asynchronous mode
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // put a line with the number of suppressed records of @site to the log file,
+    // thread local buffers are not used, so it works when the program exits
+    
+    bool FileLogSuppressed(const limiter_site&, size_t, bool);
+    
+    
+    
+    
+    // @function FileLog(error)
+    //
+    //
+    // @param error - const logger::error& : error
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // output error's stack to the log file
+    // if some error occurs, throws logger::error with information about error
+    // return true if everything ok and false if there were errors with file output
+    
+    bool FileLog(const char*, const char*, int, const char*, error&);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::BindLogFile
+
+void logger::BindLogDirectory(const char* s) {
+    
+#ifdef OS_UNIX
+    struct stat st = {0};   // structure for holding stat
+
+    if (stat(s, &st) == -1) {
+        throw logger::error("path is invalid");
+    }
+#endif // OS_UNIX
+
+#ifdef OS_WIN
+	WIN32_FIND_DATA data;
+	HANDLE hFile = FindFirstFile(s, &data);
+
+	if (hFile == INVALID_HANDLE_VALUE) // directory doesn't exist
+		throw logger::error("path is invalid");
+#endif // OS_WIN
+
+    std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+    
+    logger::log_directory_ = s;
+    
+    logger::log_directory_generation_.fetch_add(1); // reopen the log file on the next write
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableAsyncFileLog
+
+void logger::EnableAsyncFileLog(size_t capacity) {
+    
+    logger::StartLogWorker(capacity);
+    
+    logger::async_file_log_ = true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableMappedFileLog
+
+void logger::EnableMappedFileLog(size_t extent, size_t checkpoint) {
+    
+    logger::log_file_.extent     = extent;
+    logger::log_file_.checkpoint = checkpoint;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableUringFileLog
+
+void logger::EnableUringFileLog(size_t buffers, size_t buffer_size, size_t threads) {
+    
+    logger::log_file_.buffers     = buffers;
+    logger::log_file_.buffer_size = buffer_size;
+    logger::log_file_.threads     = threads;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableSegmentFileLog
+
+void logger::EnableSegmentFileLog(size_t segment_size) {
+    
+    logger::log_file_.segment_size = segment_size;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableLogRetention
+
+void logger::EnableLogRetention(unsigned long long max_bytes, unsigned max_days) {
+    
+    logger::log_retention_.Start(max_bytes, max_days);
+    
+    std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+    
+    logger::log_retention_.Request(logger::log_directory_ + "logs", std::string());
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableLogCompression
+
+void logger::EnableLogCompression(double budget, int level) {
+    
+    std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+    
+    logger::log_compressor_.Start(logger::log_directory_ + "logs", level, budget);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableJsonFileLog
+
+void logger::EnableJsonFileLog() {
+    
+    logger::json_file_log_ = true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableRepeatFileLog
+
+void logger::EnableRepeatFileLog(time_t interval) {
+    
+    static const int registered = atexit([]{ logger::FlushRepeatFileLog(); });   // runs before log_file_ is destroyed
+    
+    (void)registered;
+    
+    logger::log_file_.repeat_interval = interval;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushRepeatFileLog
+
+bool logger::FlushRepeatFileLog() {
+    
+    if(logger::async_file_log_ && logger::log_worker_) {
+        
+        logger::log_record record = logger::log_record();   // written by the background thread in order
+        
+        record.write = &logger::WriteRepeatRecord;
+        
+        logger::log_worker_->Push(record);
+        
+        return logger::log_worker_->Flush();
+    }
+    
+    return logger::WriteRepeatRecord(logger::log_file_.repeated) && logger::FlushFileSink();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::RecordHash
+
+size_t logger::RecordHash(const logger::log_record& record) {
     
-    // @member log_directory_
-    //
-    // string with path to logging directory
+    size_t hash = 14695981039346656037ULL & (size_t)-1;    // FNV-1a
+    size_t head[4] = { (size_t)record.filename, (size_t)record.line, (size_t)record.func, (size_t)record.type };
     
-    std::string log_directory_;
+    const unsigned char* bytes = (const unsigned char*)head;
     
+    for(size_t i = 0; i < sizeof(head); ++i) {
+        hash = (hash ^ bytes[i]) * (size_t)1099511628211ULL;
+    }
     
+    for(size_t i = 0; i < record.values.Count(); ++i) {
+        
+        const char* var = record.values.Var(i);
+        size_t      n   = record.values.Length(i);
+        
+        for(size_t j = 0; j < n; ++j) {
+            hash = (hash ^ (unsigned char)var[j]) * (size_t)1099511628211ULL;
+        }
+        
+        hash = (hash ^ 0xFF) * (size_t)1099511628211ULL;    // separates values
+    }
     
+    return hash ? hash : 1;
     
-    // @function BindLogDirectory
-    //
-    //
-    // @param s - const char* : null terminated string, relative or full path to log directory
-    //
-    // @return void
-    //
-    //
-    // Set the logging directory to @s
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteRepeatRecord
+
+bool logger::WriteRepeatRecord(logger::log_record&) {
     
-    void BindLogDirectory(const char*);
+    logger::file_sink& sink = logger::log_file_;
     
+    std::lock_guard<std::recursive_mutex> lock(sink.mutex);
     
+    if(!sink.repeats) return true;
     
+    char date_time[20];
     
-    // @function FileLog(default args, s, args)
-    //
-    //
-    // @param default args                              : set of arguments that define macro information
-    // @param TYPE          - logger::log_message_type  : type of message
-    // @param args          - pack                      : variables that will be logged
-    //
-    // @return bool
-    //
-    // @throw logger::error
-    //
-    //
-    // Put every arg in new line of log file
-    // if some error occurs, throws logger::error with information about error
-    // return true if everything ok and false if there were errors with console output
+    logger::DateTime(sink.repeated.time, date_time);
     
-    template <class ...Args>
-    bool FileLog(const char*, const char*, int, const char*, log_message_type, Args...);
     
+    std::string& text = sink.text;
     
+    text.clear();
     
+    if(logger::json_file_log_) {
+        
+        logger::AppendJsonHead(text, date_time, sink.repeated.type, sink.repeated.filename, sink.repeated.line, sink.repeated.func);
+        text.append("\"msg\":\"last message repeated ");
+        logger::AppendVar(text, sink.repeats);
+        text.append(" times\",\"repeats\":");
+        logger::AppendVar(text, sink.repeats);
+        text.append("}\n");
+    }
+    else {
+        
+        text.append(date_time, 19) += ' ';
+        text.append(1, '[').append(logger::MessageTypeName(sink.repeated.type)).append("] ");
+        text.append(sink.repeated.filename) += ':';
+        logger::AppendVar(text, sink.repeated.line);
+        text.append(1, ' ').append(sink.repeated.func).append(" -> last message repeated ");
+        logger::AppendVar(text, sink.repeats);
+        text.append(" times\n");
+    }
     
-    // @function FileLog(error)
-    //
-    //
-    // @param error - const logger::error& : error
-    //
-    // @return bool
-    //
-    // @throw logger::error
-    //
-    //
-    // output error's stack to the log file
-    // if some error occurs, throws logger::error with information about error
-    // return true if everything ok and false if there were errors with file output
+    sink.repeats = 0;
     
-    bool FileLog(const char*, const char*, int, const char*, error&);
+    return logger::AppendLogFile(text.data(), text.length());
     
 }
 
@@ -115,27 +839,67 @@ namespace logger {
 
 
 // @Implementation of
-//  logger::BindLogFile
+//  logger::AppendLogFile
 
-void logger::BindLogDirectory(const char* s) {
+bool logger::AppendLogFile(const char* data, size_t n) {
     
-#ifdef OS_UNIX
-    struct stat st = {0};   // structure for holding stat
-
-    if (stat(s, &st) == -1) {
-        throw logger::error("path is invalid");
+    logger::file_sink& sink = logger::log_file_;
+    
+    if(sink.segment_size && sink.written && sink.written + n > sink.segment_size) {
+        logger::RotateLogFile();
     }
-#endif // OS_UNIX
+    
+    sink.written += n;
+    
+    if(logger::log_file_.mapped.IsOpen()) {
+        return logger::log_file_.mapped.Append(data, n);
+    }
+    
+    if(logger::log_file_.uring.IsOpen()) {
+        return logger::log_file_.uring.Append(data, n);
+    }
+    
+    return logger::log_file_.stream.write(data, (std::streamsize)n).good();
+    
+}
 
-#ifdef OS_WIN
-	WIN32_FIND_DATA data;
-	HANDLE hFile = FindFirstFile(s, &data);
-
-	if (hFile == INVALID_HANDLE_VALUE) // directory doesn't exist
-		throw logger::error("path is invalid");
-#endif // OS_WIN
 
-    logger::log_directory_ = s;
+
+
+// @Implementation of
+//  logger::FlushFileSink
+
+bool logger::FlushFileSink() {
+    
+    logger::file_sink& sink = logger::log_file_;
+    
+    std::lock_guard<std::recursive_mutex> lock(sink.mutex);
+    
+    bool written = true;
+    
+    if(sink.repeats) {  // repeats followed by silence, no record comes to write the line
+        
+        time_t now = logger::Now().seconds;
+        
+        if(now - sink.repeat_since >= sink.repeat_interval || sink.path.Expired(now)) {
+            written = logger::WriteRepeatRecord(sink.repeated);
+        }
+    }
+    
+    logger::CountFlush(logger::S_FILE);
+    
+    if(sink.mapped.IsOpen()) {
+        // written data is in the page cache already, msync only if checkpoints are enabled
+        return (!sink.checkpoint || sink.mapped.Sync()) && written;
+    }
+    
+    if(sink.uring.IsOpen()) {
+        return sink.uring.Flush() && written;
+    }
+    
+    if(!sink.stream.is_open()) return written;
+    
+    return sink.stream.flush().good() && written;
     
 }
 
@@ -143,173 +907,200 @@ void logger::BindLogDirectory(const char* s) {
 
 
 // @Implementation of
-//  logger::FileLog
+//  logger::OpenLogFile
 
-template <class ...Args>
-bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, Args... args) {
-    
-    static const char* month[] = {
-        "january",
-        "february",
-        "march",
-        "april",
-        "may",
-        "june",
-        "july",
-        "august",
-        "september",
-        "october",
-        "november",
-        "december"
-    };
+void logger::OpenLogFile(time_t time) {
+    
+    static const bool flushed = logger::AddSinkFlusher(&logger::FlushFileSink);   // logger::Flush flushes the log file
     
-    static time_t               the_time  = time(NULL);             // static time object
-    struct tm                   *cur_time = localtime(&the_time);   // current time object
-    struct stat st                        = {0};                    // structure for holding stat
+    (void)flushed;
     
+    if(logger::log_file_.generation != logger::log_directory_generation_.load()) {
+        
+        std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+        
+        logger::log_file_.path.Reset(logger::log_directory_);
+        logger::log_file_.generation = logger::log_directory_generation_.load();
+    }
     
-    std::string directory       = logger::log_directory_ + "logs";
-    std::string year_directory  = directory + '/' + std::to_string(cur_time->tm_year + 1900);
-    std::string month_directory = year_directory + '/' + month[cur_time->tm_mon];
-    std::string filename        =  month_directory + '/' +
-                                   StrToLen(std::to_string(cur_time->tm_mday),2,'0') +
-                                   StrToLen(std::to_string(cur_time->tm_mon + 1),2,'0') +
-                                   std::to_string(cur_time->tm_year + 1900) + ".log";
     
+    logger::OpenLogPath(logger::log_file_.path.Resolve(time));
     
-    std::queue<std::string> queue;  // queue with variable converted to string
+}
+
+
+
+
+// @Implementation of
+//  logger::RotateLogFile
+
+void logger::RotateLogFile() {
     
+    logger::OpenLogPath(logger::log_file_.path.NextSegment());
     
+}
 
-#ifdef OS_UNIX
-    int res;
+
+
+
+// @Implementation of
+//  logger::OpenLogPath
+
+void logger::OpenLogPath(const std::string& path) {
     
-    if (stat(directory.c_str(), &st) == -1) {
-        res = mkdir(directory.c_str(), 0700);
-        if(res) {
-            throw logger::error("cannot create directory");
-        }
+    if(logger::log_file_.stream.is_open()) {
+        logger::log_file_.stream.close();
     }
     
-    if (stat(year_directory.c_str(), &st) == -1) {
-        res = mkdir(year_directory.c_str(), 0700);
-        if(res) {
-            throw logger::error("cannot create directory");
-        }
+    logger::log_file_.mapped.Close();   // truncated to the written length
+    logger::log_file_.uring.Close();    // waits for buffers in flight
+    
+    if(!logger::log_file_.opened.empty() && logger::log_file_.opened != path) {
+        logger::log_compressor_.Request(logger::log_file_.opened);
     }
     
-    if (stat(month_directory.c_str(), &st) == -1) {
-        res = mkdir(month_directory.c_str(), 0700);
-        if(res) {
-            throw logger::error("cannot create directory");
+    logger::log_file_.opened = path;
+    
+    
+    struct stat st;
+    
+    logger::log_file_.written = stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+    
+    if(logger::log_file_.extent && logger::log_file_.mapped.Open(path, logger::log_file_.extent, logger::log_file_.checkpoint)) {
+        logger::log_file_.written = logger::log_file_.mapped.Size();    // without the preallocated tail
+    }
+    else if(!logger::log_file_.buffers || !logger::log_file_.uring.Open(path, logger::log_file_.buffers, logger::log_file_.buffer_size, logger::log_file_.threads)) {
+        
+        logger::log_file_.stream.clear();
+        logger::log_file_.stream.open(path, std::ios::app);
+        
+        if(!logger::log_file_.stream.is_open()) {
+            logger::log_file_.generation = 0;   // check directories again next time
+            logger::log_file_.opened.clear();
+            throw logger::error("cannot open file");
         }
     }
-#endif // OS_UNIX
-
-#ifdef OS_WIN
-	if (CreateDirectory(directory.c_str(), NULL))
-	{
-		// Directory created
-	}
-	else if (ERROR_ALREADY_EXISTS == GetLastError())
-	{
-		// Directory already exists
-	}
-	else
-	{
-		throw logger::error("cannot create directory");
-	}
-
-
-	if (CreateDirectory(year_directory.c_str(), NULL))
-	{
-		// Directory created
-	}
-	else if (ERROR_ALREADY_EXISTS == GetLastError())
-	{
-		// Directory already exists
-	}
-	else
-	{
-		throw logger::error("cannot create directory");
-	}
-
-
-	if (CreateDirectory(month_directory.c_str(), NULL))
-	{
-		// Directory created
-	}
-	else if (ERROR_ALREADY_EXISTS == GetLastError())
-	{
-		// Directory already exists
-	}
-	else
-	{
-		throw logger::error("cannot create directory");
-	}
+    
+    // only once the file exists, its directory must not look empty to the retention thread
+    logger::log_retention_.Request(logger::log_file_.path.Directory(), path);
+    
+}
 
-#endif // OS_WIN
 
 
 
+// @Implementation of
+//  logger::WriteFileRecord
 
+bool logger::WriteFileRecord(logger::log_record& record) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_FILE].write);
     
+    logger::file_sink& sink = logger::log_file_;
     
-    std::ofstream file_out(filename, std::ios::app);
+    std::lock_guard<std::recursive_mutex> lock(sink.mutex);    // synchronous FileLog may be called by several threads
     
-    if(!file_out.is_open()) {
-        throw logger::error("cannot open file");
+    bool written = true;
+    
+    if(sink.repeat_interval) {
+        
+        size_t hash = record.is_error ? 0 : logger::RecordHash(record);
+        
+        if(hash && hash == sink.repeat_hash && !sink.path.Expired(record.time)) {
+            
+            if(!sink.repeats) sink.repeat_since = record.time;
+            
+            sink.repeated.time = record.time;
+            
+            ++sink.repeats;
+            
+            if(record.time - sink.repeat_since < sink.repeat_interval) {
+                logger::CountDropped(logger::S_FILE, 1);
+                return true;
+            }
+            
+            return logger::WriteRepeatRecord(record);
+        }
+        
+        written = logger::WriteRepeatRecord(record);   // the previous record is not repeated anymore
+        
+        sink.repeat_hash       = hash;
+        sink.repeated.type     = record.type;
+        sink.repeated.filename = record.filename;
+        sink.repeated.line     = record.line;
+        sink.repeated.func     = record.func;
     }
     
     
-    std::string log_type;
+    char                        date_time[20];                      // "YYYY-MM-DD HH:MM:SS"
     
-    switch (TYPE) {
-        case logger::T_INFO:
-            log_type = "INFO";
-            break;
-        case logger::T_DEBUG:
-            log_type = "DEBUG";
-            break;
-        case logger::T_ERROR:
-            log_type = "ERROR";
-            break;
-        case logger::T_WARNING:
-            log_type = "WARNING";
-            break;
-        case logger::T_CRITICAL:
-            log_type = "CRITICAL";
-            break;
-        default:
-            log_type = "INFO";
-            break;
+    logger::DateTime(record.time, date_time);
+    
+    
+    bool opened = logger::log_file_.mapped.IsOpen() || logger::log_file_.uring.IsOpen() ||
+                  (logger::log_file_.stream.is_open() && logger::log_file_.stream.good());
+    
+    if(logger::log_file_.path.Expired(record.time) || !opened ||
+       logger::log_file_.generation != logger::log_directory_generation_.load(std::memory_order_relaxed)) {
+        logger::OpenLogFile(record.time);
     }
     
     
-    ProcessVars(&queue, args...);    // convert vars to string and push them to the queue
+    const char*  log_type = logger::MessageTypeName(record.type);
+    std::string& text     = logger::log_file_.text;    // keeps its capacity between records
+    
+    text.clear();
     
     
-    while(!queue.empty()) {
+    if(record.is_json) {    // one variable with every field after the head
         
-        std::string cur = queue.front();
+        logger::AppendJsonHead(text, date_time, record.type, record.filename, record.line, record.func);
+        text.append(record.values.Var(0), record.values.Length(0)).append("}\n");
+    }
+    else for(size_t i = 0; i < record.values.Count(); ++i) {
         
-        file_out << std::to_string(cur_time->tm_year + 1900) << '-' << StrToLen(std::to_string(cur_time->tm_mon + 1),2,'0') << '-' << StrToLen(std::to_string(cur_time->tm_mday),2,'0') << ' '; // date
-        file_out << StrToLen(std::to_string(cur_time->tm_hour),2,'0') << ':' << StrToLen(std::to_string(cur_time->tm_min),2,'0') << ':' << StrToLen(std::to_string(cur_time->tm_sec),2,'0') << ' '; // time
+        if(record.is_error && i > 0) {  // error stack
+            
+            text += '\t';
+            text.append(record.values.Var(i), record.values.Length(i)) += '\n';
+            continue;
+        }
         
-        file_out << '[' << log_type << "] "; // message type
+        text.append(date_time, 19) += ' ';    // date and time
         
-        file_out << FILENAME << ':' << LINE << ' ' << FUNC << " -> "; // info
+        text.append(1, '[').append(log_type).append("] ");  // message type
         
+        text.append(record.filename) += ':';  // info
+        logger::AppendVar(text, record.line);
+        text.append(1, ' ').append(record.func).append(" -> ");
         
         
-        file_out << cur << '\n';
+        if(record.is_error) {   // error message
+            
+            text += '\"';
+            text.append(record.values.Var(0), record.values.Length(0)).append("\" error stack : \n");
+            continue;
+        }
         
-        queue.pop();
+        text.append(record.values.Var(i), record.values.Length(i)) += '\n';
     }
     
     
+    written = logger::AppendLogFile(text.data(), text.length()) && written;
+    
+    logger::CountRecord(logger::S_FILE, written, text.length());
+    
+    
+    long long period = logger::stats_period_.load(std::memory_order_relaxed);
+    
+    if(period && record.time >= sink.stats_due) {
+        
+        if(sink.stats_due) written = logger::WriteStatsRecord(record) && written;
+        
+        sink.stats_due = record.time + (time_t)period;
+    }
     
-    return file_out.good();
+    return written;
     
 }
 
@@ -317,146 +1108,255 @@ bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const cha
 
 
 // @Implementation of
-//  logger::FileLog
+//  logger::WriteStatsRecord
 
-bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::error& error) {
+bool logger::WriteStatsRecord(logger::log_record& record) {
     
-    static const char* month[] = {
-        "january",
-        "february",
-        "march",
-        "april",
-        "may",
-        "june",
-        "july",
-        "august",
-        "september",
-        "october",
-        "november",
-        "december"
-    };
+    std::lock_guard<std::recursive_mutex> lock(logger::log_file_.mutex);
     
-    static time_t               the_time  = time(NULL);             // static time object
-    struct tm                   *cur_time = localtime(&the_time);   // current time object
-    struct stat st                        = {0};                    // structure for holding stat
+    char date_time[20];
     
+    logger::DateTime(record.time, date_time);
     
-    std::string directory       = logger::log_directory_ + "logs";
-    std::string year_directory  = directory + '/' + std::to_string(cur_time->tm_year + 1900);
-    std::string month_directory = year_directory + '/' + month[cur_time->tm_mon];
-    std::string filename        =  month_directory + '/' +
-    StrToLen(std::to_string(cur_time->tm_mday),2,'0') +
-    StrToLen(std::to_string(cur_time->tm_mon + 1),2,'0') +
-    std::to_string(cur_time->tm_year + 1900) + ".log";
     
+    std::string& text = logger::log_file_.text;
     
-#ifdef OS_UNIX
-	int res;
-
-	if (stat(directory.c_str(), &st) == -1) {
-		res = mkdir(directory.c_str(), 0700);
-		if (res) {
-			throw logger::error("cannot create directory");
-		}
-	}
-
-	if (stat(year_directory.c_str(), &st) == -1) {
-		res = mkdir(year_directory.c_str(), 0700);
-		if (res) {
-			throw logger::error("cannot create directory");
-		}
-	}
-
-	if (stat(month_directory.c_str(), &st) == -1) {
-		res = mkdir(month_directory.c_str(), 0700);
-		if (res) {
-			throw logger::error("cannot create directory");
-		}
-	}
-#endif // OS_UNIX
+    text.clear();
+    
+    if(logger::json_file_log_) {
+        
+        std::string stats;      // not thread_frame, a stats line may be due when the program exits
+        
+        logger::AppendStats(stats, logger::GetStats());
+        
+        logger::AppendJsonHead(text, date_time, logger::T_INFO, "logger", 0, "stats");
+        text.append("\"msg\":");
+        logger::AppendJsonString(text, stats.data(), stats.length());
+        text.append("}\n");
+    }
+    else {
+        
+        text.append(date_time, 19).append(" [").append(logger::MessageTypeName(logger::T_INFO)).append("] logger:0 stats -> ");
+        logger::AppendStats(text, logger::GetStats());
+        text += '\n';
+    }
+    
+    return logger::AppendLogFile(text.data(), text.length());
+    
+}
 
-#ifdef OS_WIN
-	if (CreateDirectory(directory.c_str(), NULL))
-	{
-		// Directory created
-	}
-	else if (ERROR_ALREADY_EXISTS == GetLastError())
-	{
-		// Directory already exists
-	}
-	else
-	{
-		throw logger::error("cannot create directory");
-	}
-
-
-	if (CreateDirectory(year_directory.c_str(), NULL))
-	{
-		// Directory created
-	}
-	else if (ERROR_ALREADY_EXISTS == GetLastError())
-	{
-		// Directory already exists
-	}
-	else
-	{
-		throw logger::error("cannot create directory");
-	}
-
-
-	if (CreateDirectory(month_directory.c_str(), NULL))
-	{
-		// Directory created
-	}
-	else if (ERROR_ALREADY_EXISTS == GetLastError())
-	{
-		// Directory already exists
-	}
-	else
-	{
-		throw logger::error("cannot create directory");
-	}
 
-#endif // OS_WIN
+
+
+// @Implementation of
+//  logger::WriteFileRecordNow
+
+bool logger::WriteFileRecordNow(logger::log_record& record) {
+    
+    std::lock_guard<std::recursive_mutex> lock(logger::log_file_.mutex);    // the record and its flush are not interleaved with other threads
+    
+    if(!logger::WriteFileRecord(record)) return false;
+    
+    if(logger::log_file_.uring.IsOpen()) return true;   // flushing would wait for the write
+    
+    return logger::FlushFileSink();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FileLog
+
+template <class ...Args>
+bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, const Args&... args) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_FILE].enqueue);
+    
+    logger::thread_frame<logger::log_record> record;  // reused by every call of this thread
+    
+    record->write    = &logger::WriteFileRecord;
+    record->time     = logger::Now().seconds;
+    record->type     = TYPE;
+    record->filename = FILENAME;
+    record->line     = LINE;
+    record->func     = FUNC;
+    record->is_error = false;
+    record->is_json  = logger::json_file_log_;
     
+    record->values.Clear();
     
-    std::ofstream file_out(filename, std::ios::app);
+    if(record->is_json) {
+        logger::ProcessJsonVars(&record->values, args...);
+    }
+    else {
+        ProcessVars(&record->values, args...);    // convert vars to string and append them to the buffer
+    }
     
-    if(!file_out.is_open()) {
-        throw logger::error("cannot open file");
+    
+    if(logger::async_file_log_ && logger::log_worker_) {     // written right away once the central flusher stopped at exit
+        logger::log_worker_->Push(*record);
+        return true;
     }
     
+    return logger::WriteFileRecordNow(*record);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FileLog
+
+bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::error& error) {
     
-    std::string log_type = "ERROR";
+    logger::stats_timer timer(logger::sink_meters_[logger::S_FILE].enqueue);
     
-    file_out << std::to_string(cur_time->tm_year + 1900) << '-' << StrToLen(std::to_string(cur_time->tm_mon + 1),2,'0') << '-' << StrToLen(std::to_string(cur_time->tm_mday),2,'0') << ' '; // date
-    file_out << StrToLen(std::to_string(cur_time->tm_hour),2,'0') << ':' << StrToLen(std::to_string(cur_time->tm_min),2,'0') << ':' << StrToLen(std::to_string(cur_time->tm_sec),2,'0') << ' '; // time
+    logger::thread_frame<logger::log_record> record;  // reused by every call of this thread
     
-    file_out << '[' << log_type << "] "; // message type
+    record->write    = &logger::WriteFileRecord;
+    record->time     = logger::Now().seconds;
+    record->type     = logger::T_ERROR;
+    record->filename = FILENAME;
+    record->line     = LINE;
+    record->func     = FUNC;
+    record->is_error = true;
+    record->is_json  = logger::json_file_log_;
     
-    file_out << FILENAME << ':' << LINE << ' ' << FUNC << " -> "; // info
-    file_out << '\"' <<  error.what() << "\" error stack : \n";
+    record->values.Clear();
     
-    while(!error.error_stack_.empty()) {
+    if(record->is_json) {
+        
+        std::string& data = record->values.data;
+        
+        data.append("\"msg\":");
+        logger::AppendJson(data, error.what());
+        data.append(",\"stack\":[");
+        
+        for(bool first = true; !error.error_stack_.empty(); first = false) {
+            
+            if(!first) data += ',';
+            
+            logger::AppendJson(data, error.error_stack_.top());
+            
+            error.error_stack_.pop();
+        }
+        
+        data += ']';
+        
+        record->values.ends.push_back(data.length());
+    }
+    else {
         
-        file_out << '\t' << error.error_stack_.top() << '\n';
+        ProcessVars(&record->values, error.what());
         
-        error.error_stack_.pop();
+        while(!error.error_stack_.empty()) {
+            
+            ProcessVars(&record->values, error.error_stack_.top());
+            
+            error.error_stack_.pop();
+        }
+    }
+    
+    
+    if(logger::async_file_log_ && logger::log_worker_) {
+        logger::log_worker_->Push(*record);
+        return true;
     }
     
+    return logger::WriteFileRecordNow(*record);
     
+}
+
+// @Implementation of
+//  logger::FileLogPass
+
+template <class T>
+bool logger::FileLogPass(logger::rate_limiter& limiter, const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const T& first) {
+    
+    size_t passed = limiter.Pass();
+    
+    if(passed == 0) {
+        logger::CountDropped(logger::S_FILE, 1);
+        limiter.Watch(logger::limiter_site{ &logger::FileLogSuppressed, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) });
+        return false;
+    }
+    
+    if(passed > 1) {
+        logger::FileLogSuppressed(logger::limiter_site{ nullptr, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) }, passed - 1, false);
+    }
+    
+    return true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FileLogSuppressed
+
+bool logger::FileLogSuppressed(const logger::limiter_site& site, size_t suppressed, bool now) {
+    
+    std::string message = "suppressed ";
+    
+    logger::AppendVar(message, suppressed);
+    message += " records";
+    
+    
+    logger::log_record record = logger::log_record();
+    
+    record.write    = &logger::WriteFileRecord;
+    record.time     = logger::Now().seconds;
+    record.type     = site.type;
+    record.filename = site.filename;
+    record.line     = site.line;
+    record.func     = site.func;
+    record.is_json  = logger::json_file_log_;
+    
+    if(record.is_json) {
+        record.values.data.append("\"msg\":");
+        logger::AppendJsonString(record.values.data, message.data(), message.length());
+        record.values.ends.push_back(record.values.data.length());
+    }
+    else {
+        ProcessVars(&record.values, message);
+    }
+    
+    
+    if(!now && logger::async_file_log_ && logger::log_worker_) {
+        logger::log_worker_->Push(record);
+        return true;
+    }
+    
+    if(logger::log_worker_) logger::log_worker_->Flush();   // records queued before stay ahead of the line
     
-    return file_out.good();
+    return logger::WriteFileRecordNow(record);
     
 }
 
 // Macro that pass to the logger::FileLog additional info about place where it has been called
-#define FileLog(...) logger::FileLog(__FILE__,__FILENAME__,__LINE__,__func__ ,__VA_ARGS__)
+// the first argument is evaluated once, calls below LOGGER_MIN_LEVEL or the runtime level
+// do nothing and do not evaluate the other arguments
+#define FileLog(...) LOGGER_GATE(logger::S_FILE, true, (logger::FileLog), __VA_ARGS__)
+
+// FileLog that writes at most RATE records per second from this call site,
+// arguments of suppressed calls except the first one are not evaluated
+#define FileLogRate(RATE, ...) LOGGER_GATE(logger::S_FILE, \
+    logger::FileLogPass(LOGGER_LIMITER(logger::rate_limiter, RATE), __FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_), \
+    (logger::FileLog), __VA_ARGS__)
+
+// FileLog that writes one of every K records from this call site
+#define FileLogSample(K, ...) LOGGER_GATE(logger::S_FILE, LOGGER_LIMITER(logger::sample_limiter, K).Pass(), (logger::FileLog), __VA_ARGS__)
 
 // DEBUG ONLY mode
 #ifdef DEBUG_ONLY
     #if defined(DEBUG) | defined(_DEBUG)
         #define FileLog(...) NULL
+        #define FileLogRate(...) NULL
+        #define FileLogSample(...) NULL
     #endif
 #endif
 
@@ -0,0 +1,286 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_FLUSHER_HPP
+#define LOG_FLUSHER_HPP
+
+#include <stdlib.h>                 // atexit
+#include <cstddef>                  // size_t
+#include <time.h>                   // time_t
+#include <memory>                   // std::unique_ptr
+#include <atomic>                   // std::atomic
+
+#include "log_message_types.hpp"    // logger::log_message_type
+#include "log_utility.hpp"          // logger::var_buffer
+#include "log_async.hpp"            // logger::async_worker
+#include "log_limit.hpp"            // logger::ReportSuppressed
+
+// maximum number of sinks that are flushed by logger::Flush
+#define LOGGER_MAX_SINKS 8
+
+namespace logger {
+    
+    // @struct log_record
+    //
+    //
+    // @member write    - bool(*)(log_record&)      : sink that writes the record
+    // @member time     - time_t                    : time when the record was made
+    // @member type     - logger::log_message_type  : type of message
+    // @member filename - const char*               : file where the record was made
+    // @member line     - int                       : line where the record was made
+    // @member func     - const char*               : function where the record was made
+    // @member is_error - bool                      : record holds logger::error
+    // @member is_json  - bool                      : @values is one variable with the JSON fields of the record
+    // @member values   - logger::var_buffer        : variables converted to string
+    //                                                (message and error stack if @is_error,
+    //                                                rendered line for the console)
+    //
+    //
+    // everything that is needed to write one log call to its sink
+    
+    struct log_record {
+        bool                    (*write)(log_record&);
+        time_t                  time;
+        log_message_type        type;
+        const char*             filename;
+        int                     line;
+        const char*             func;
+        bool                    is_error;
+        bool                    is_json;
+        var_buffer              values;
+    };
+    
+    
+    
+    
+    // @member log_worker_
+    //
+    // central flusher that drains the rings of all producer threads in the order
+    // records were made, empty while every sink is synchronous
+    
+    std::unique_ptr<async_worker<log_record> > log_worker_;
+    
+    
+    
+    
+    // @member sink_flushers_
+    //
+    // flush functions of the sinks that were written at least once
+    
+    std::atomic<bool (*)()> sink_flushers_[LOGGER_MAX_SINKS];
+    
+    
+    
+    
+    // @function StartLogWorker(capacity)
+    //
+    //
+    // @param capacity - size_t : maximum number of records waiting to be written per thread
+    //
+    // @return void
+    //
+    //
+    // start the central flusher if it is not running yet
+    // pending records are written when the program exits
+    
+    void StartLogWorker(size_t);
+    
+    
+    
+    
+    // @function StopLogWorker()
+    //
+    //
+    // @return void
+    //
+    //
+    // write pending records and stop the central flusher
+    
+    void StopLogWorker();
+    
+    
+    
+    
+    // @function AddSinkFlusher(flusher)
+    //
+    //
+    // @param flusher - bool(*)() : function that flushes a sink
+    //
+    // @return bool
+    //
+    //
+    // make logger::Flush flush one more sink, adding the same function twice does nothing
+    
+    bool AddSinkFlusher(bool (*)());
+    
+    
+    
+    
+    // @function FlushSinks()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush every sink added with AddSinkFlusher
+    // return true if everything ok and false if some sink failed
+    
+    bool FlushSinks();
+    
+    
+    
+    
+    // @function WriteLogRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record to write
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // pass @record to its sink
+    
+    bool WriteLogRecord(log_record&);
+    
+    
+    
+    
+    // @function Flush()
+    //
+    //
+    // @return bool
+    //
+    //
+    // report records suppressed by rate limited call sites and
+    // wait until every record logged before the call is written to its sink
+    // return true if everything ok and false if some record was not written
+    
+    bool Flush();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::StartLogWorker
+
+void logger::StartLogWorker(size_t capacity) {
+    
+    if(logger::log_worker_) return;
+    
+    logger::log_worker_.reset(new logger::async_worker<logger::log_record>(capacity, &logger::WriteLogRecord, &logger::FlushSinks));
+    
+    // registered after every sink is constructed, so it runs before they are destroyed
+    atexit(&logger::StopLogWorker);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::StopLogWorker
+
+void logger::StopLogWorker() {
+    
+    logger::log_worker_.reset();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AddSinkFlusher
+
+bool logger::AddSinkFlusher(bool (*flusher)()) {
+    
+    for(size_t i = 0; i < LOGGER_MAX_SINKS; ++i) {
+        
+        bool (*expected)() = nullptr;
+        
+        if(logger::sink_flushers_[i].compare_exchange_strong(expected, flusher) || expected == flusher) {
+            return true;
+        }
+    }
+    
+    return false;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushSinks
+
+bool logger::FlushSinks() {
+    
+    bool result = true;
+    
+    for(size_t i = 0; i < LOGGER_MAX_SINKS; ++i) {
+        
+        bool (*flusher)() = logger::sink_flushers_[i].load();
+        
+        if(!flusher) break;
+        
+        if(!flusher()) result = false;
+    }
+    
+    return result;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteLogRecord
+
+bool logger::WriteLogRecord(logger::log_record& record) {
+    
+    return record.write(record);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Flush
+
+bool logger::Flush() {
+    
+    bool reported = logger::ReportSuppressed();
+    
+    if(logger::log_worker_) {
+        return logger::log_worker_->Flush() && reported;
+    }
+    
+    return logger::FlushSinks() && reported;
+    
+}
+
+#endif /* LOG_FLUSHER_HPP */
@@ -0,0 +1,371 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <type_traits>              // std::enable_if, std::is_array, std::is_convertible
+
+#include "log_error.hpp"            // logger::error
+
+// relaxed constexpr functions (loops, several statements) are available since C++14
+#if __cplusplus >= 201402L
+#define LOGGER_CONSTEXPR constexpr
+#else
+#define LOGGER_CONSTEXPR
+#endif
+
+// string literals are parsed at compile time when consteval is available (C++20)
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+#define LOGGER_HAS_CONSTEVAL
+#endif
+
+// maximum number of commands in format string that is parsed at compile time
+// longer format strings are parsed when ConsoleLog is called
+#ifndef LOGGER_MAX_FORMAT_OPS
+#define LOGGER_MAX_FORMAT_OPS 32
+#endif
+
+namespace logger {
+
+    typedef enum : unsigned char {
+        F_TEXT,             // text without commands or "%%"
+        F_YEAR4,            // %yyyy
+        F_YEAR2,            // %yy
+        F_MONTH,            // %mm
+        F_DAY,              // %dd
+        F_HOUR,             // %h
+        F_MINUTE,           // %m
+        F_SECOND,           // %s
+        F_MILLISECOND,      // %ms
+        F_MICROSECOND,      // %us
+        F_VAR,              // %v
+        F_FILE,             // %FILE
+        F_FUNC,             // %FUNC
+        F_LINE,             // %LINE
+        F_PATH,             // %PATH
+        F_STYLE,            // %.ClassName(
+        F_STYLE_END         // %)
+    } format_command;
+
+
+
+
+    // @struct format_op
+    //
+    //
+    // @member command - logger::format_command : what to put
+    // @member begin   - size_t                 : start of text or class name in format string,
+    //                                            index of variable for F_VAR
+    // @member length  - size_t                 : length of text or class name
+    //
+    //
+    // one instruction of parsed format string
+
+    struct format_op {
+        format_command  command;
+        size_t          begin;
+        size_t          length;
+    };
+
+
+
+
+    // @function ParseFormatOp(s, n, i, op, var)
+    //
+    //
+    // @param s   - const char*         : format string
+    // @param n   - size_t              : length of format string
+    // @param i   - size_t              : position of the instruction to parse, less than @n
+    // @param op  - logger::format_op&  : parsed instruction
+    // @param var - size_t              : number of "%v" parsed before @i
+    //
+    // @return size_t
+    //
+    // @throw logger::error
+    //
+    //
+    // parse one instruction that starts at @i in accoring to ConsoleLog rules
+    // and return position of the next one
+    // usable in constant expressions since C++14
+
+    LOGGER_CONSTEXPR size_t ParseFormatOp(const char*, size_t, size_t, format_op&, size_t);
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+    // template<Args>
+    // @struct format_string
+    //
+    //
+    // @constructor format_string(s) : parse string literal @s at compile time
+    //
+    // @member str       - const char*       : format string
+    // @member length    - size_t            : length of format string
+    // @member ops       - logger::format_op : parsed instructions
+    // @member count     - size_t            : number of instructions, 0 if @dynamic
+    // @member dynamic   - bool              : string has more than LOGGER_MAX_FORMAT_OPS
+    //                                         instructions and is parsed at runtime
+    //
+    //
+    // format string literal parsed at compile time
+    // wrong commands and mismatch between the number of "%v" and
+    // the number of arguments are compile errors
+
+    template <class ...Args>
+    struct format_string {
+
+        template <size_t N>
+        consteval format_string(const char (&s)[N]) : str(s), length(N - 1), ops(), count(0), dynamic(false) {
+
+            for(size_t i = 0; i < LOGGER_MAX_FORMAT_OPS; ++i) {
+                ops[i] = format_op{F_TEXT, 0, 0};
+            }
+
+            size_t vars = 0;
+
+            for(size_t i = 0; i < length; ) {
+
+                format_op op = {F_TEXT, 0, 0};
+
+                i = ParseFormatOp(str, length, i, op, vars);
+
+                if(op.command == F_VAR) ++vars;
+
+                if(count == LOGGER_MAX_FORMAT_OPS) dynamic = true;
+                else ops[count++] = op;
+            }
+
+            if(vars != sizeof...(Args)) {
+                throw "ConsoleLog : number of %v doesn't match number of arguments";
+            }
+
+            if(dynamic) count = 0;
+        }
+
+        const char* str;
+        size_t      length;
+        format_op   ops[LOGGER_MAX_FORMAT_OPS];
+        size_t      count;
+        bool        dynamic;
+
+    };
+#endif
+
+
+
+
+    // template<S>
+    // @struct is_runtime_format
+    //
+    //
+    // @member value - bool : @S is a format string that is parsed when ConsoleLog is called
+    //
+    //
+    // string literals are parsed at compile time when it is supported,
+    // ConsoleLog passes other character arrays as const char*
+
+    template <class S>
+    struct is_runtime_format {
+#ifdef LOGGER_HAS_CONSTEVAL
+        static const bool value = std::is_convertible<const S&, std::string>::value && !std::is_array<S>::value;
+#else
+        static const bool value = std::is_convertible<const S&, std::string>::value;
+#endif
+    };
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+    // @function IsStringLiteral(spelling)
+    //
+    //
+    // @param spelling - const char* : argument of a macro turned into a string by #
+    //
+    // @return bool
+    //
+    //
+    // return true if the argument is written as a string literal (or several of them),
+    // only such arguments are constant expressions that format_string can parse,
+    // arrays filled at runtime are parsed when ConsoleLog is called
+
+    constexpr bool IsStringLiteral(const char* spelling) {
+
+        size_t n = 0;
+
+        while(spelling[n]) ++n;
+
+        return n >= 2 && spelling[0] == '"' && spelling[n - 1] == '"';
+    }
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ParseFormatOp
+
+LOGGER_CONSTEXPR size_t logger::ParseFormatOp(const char* s, size_t n, size_t i, logger::format_op& op, size_t var) {
+
+    if(s[i] != '%') {  // text until the next command
+
+        size_t j = i;
+        while(j < n && s[j] != '%') ++j;
+
+        op.command = logger::F_TEXT;
+        op.begin   = i;
+        op.length  = j - i;
+
+        return j;
+    }
+
+    if(i + 1 == n) {
+        throw logger::error("parse error : empty command");
+    }
+
+    op.begin  = 0;
+    op.length = 0;
+
+    if(s[i + 1] == 'y') {         // %yyyy / %yy
+        if(i + 2 < n && s[i + 2] == 'y') {
+            if(i + 4 < n && s[i + 3] == 'y' && s[i + 4] == 'y') {
+                op.command = logger::F_YEAR4;
+                return i + 5;
+            }
+            op.command = logger::F_YEAR2;
+            return i + 3;
+        }
+        throw logger::error("no such command : \"%y\"");
+    }
+
+    if(s[i + 1] == 'm') {         // %mm / %ms / %m
+        if(i + 2 < n && s[i + 2] == 'm') {
+            op.command = logger::F_MONTH;
+            return i + 3;
+        }
+        if(i + 2 < n && s[i + 2] == 's') {
+            op.command = logger::F_MILLISECOND;
+            return i + 3;
+        }
+        op.command = logger::F_MINUTE;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 's') {         // %s
+        op.command = logger::F_SECOND;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 'u') {         // %us
+        if(i + 2 < n && s[i + 2] == 's') {
+            op.command = logger::F_MICROSECOND;
+            return i + 3;
+        }
+        throw logger::error("no such command : \"%u\"");
+    }
+
+    if(s[i + 1] == 'h') {         // %h
+        op.command = logger::F_HOUR;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 'd') {         // %dd
+        if(i + 2 < n && s[i + 2] == 'd') {
+            op.command = logger::F_DAY;
+            return i + 3;
+        }
+        throw logger::error("no such command : \"%d\"");
+    }
+
+    if(s[i + 1] == 'v') {         // %v
+        op.command = logger::F_VAR;
+        op.begin   = var;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 'F') {         // %FILE / %FUNC
+        if(i + 4 < n && s[i + 2] == 'I' && s[i + 3] == 'L' && s[i + 4] == 'E') {
+            op.command = logger::F_FILE;
+            return i + 5;
+        }
+        if(i + 4 < n && s[i + 2] == 'U' && s[i + 3] == 'N' && s[i + 4] == 'C') {
+            op.command = logger::F_FUNC;
+            return i + 5;
+        }
+        throw logger::error("parse error");
+    }
+
+    if(s[i + 1] == 'P') {         // %PATH
+        if(i + 4 < n && s[i + 2] == 'A' && s[i + 3] == 'T' && s[i + 4] == 'H') {
+            op.command = logger::F_PATH;
+            return i + 5;
+        }
+        throw logger::error("parse error");
+    }
+
+    if(s[i + 1] == 'L') {         // %LINE
+        if(i + 4 < n && s[i + 2] == 'I' && s[i + 3] == 'N' && s[i + 4] == 'E') {
+            op.command = logger::F_LINE;
+            return i + 5;
+        }
+        throw logger::error("parse error");
+    }
+
+    if(s[i + 1] == '.') {         // %.ClassName(
+
+        size_t j = i + 2;
+        while(j < n && s[j] != '(') ++j;
+
+        if(j == n) {
+            throw logger::error("parse error");
+        }
+
+        op.command = logger::F_STYLE;
+        op.begin   = i + 2;
+        op.length  = j - (i + 2);
+
+        return j + 1;
+    }
+
+    if(s[i + 1] == ')') {         // %)
+        op.command = logger::F_STYLE_END;
+        return i + 2;
+    }
+
+    if(s[i + 1] == '%') {         // %%
+        op.command = logger::F_TEXT;
+        op.begin   = i + 1;
+        op.length  = 1;
+        return i + 2;
+    }
+
+    throw logger::error("parse error : empty command");
+
+}
+
+#endif /* LOG_FORMAT_HPP */
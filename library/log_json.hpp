@@ -0,0 +1,465 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_JSON_HPP
+#define LOG_JSON_HPP
+
+#include <stdio.h>                  // snprintf
+#include <stdlib.h>                 // strtod
+#include <string.h>                 // strlen
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <ostream>                  // std::ostream
+
+// strings are scanned 16 bytes at a time where SSE2 is available
+#if !defined(LOGGER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>              // _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8
+#define LOGGER_SSE2
+#endif
+
+#include "log_message_types.hpp"    // logger::log_message_type, logger::MessageTypeName
+#include "log_utility.hpp"          // logger::AppendVar, logger::thread_frame, logger::var_buffer
+
+namespace logger {
+
+    // template<T>
+    // @struct key_value
+    //
+    //
+    // @member key   - const char* : name of the field
+    // @member value - const T&    : value of the field
+    //
+    //
+    // named field of a structured log call, see logger::kv
+
+    template <class T>
+    struct key_value {
+        const char*     key;
+        const T&        value;
+    };
+
+
+
+
+    // template<T>
+    // @function kv(key, value)
+    //
+    //
+    // @param key   - const char* : name of the field
+    // @param value - const T&    : value of the field
+    //
+    // @return logger::key_value<T>
+    //
+    //
+    // field that is written as "key":value by the JSON-lines file sink and as key=value elsewhere
+    // the value is referenced, not copied, so kv is used only as an argument of a log call
+
+    template <class T>
+    key_value<T> kv(const char* key, const T& value) { return key_value<T>{ key, value }; }
+
+
+
+
+    // template<T>
+    // @function operator<<(os, field)
+    //
+    //
+    // @param os    - std::ostream&                 : target stream
+    // @param field - const logger::key_value<T>&   : field
+    //
+    // @return std::ostream&
+    //
+    //
+    // put key=value, so fields are written by every sink
+
+    template <class T>
+    std::ostream& operator<<(std::ostream&, const key_value<T>&);
+
+
+
+
+    // @function AppendJsonString(s, data, n)
+    //
+    //
+    // @param s    - std::string& : target string
+    // @param data - const char*  : UTF-8 text
+    // @param n    - size_t       : length of @data
+    //
+    // @return void
+    //
+    //
+    // append @data as a quoted JSON string, runs without '"', '\' and control characters
+    // are found 16 bytes at a time with SSE2 and copied at once
+
+    void AppendJsonString(std::string&, const char*, size_t);
+
+
+
+
+    // @function AppendJson(s, var)
+    //
+    //
+    // @param s   - std::string& : target string
+    // @param var - T            : value
+    //
+    // @return void
+    //
+    //
+    // append @var as a JSON value: numbers and booleans as they are, NaN and infinities as null,
+    // everything else as a string converted like logger::AppendVar does it
+
+    void AppendJson(std::string&, bool);
+    void AppendJson(std::string&, short);
+    void AppendJson(std::string&, unsigned short);
+    void AppendJson(std::string&, int);
+    void AppendJson(std::string&, unsigned int);
+    void AppendJson(std::string&, long);
+    void AppendJson(std::string&, unsigned long);
+    void AppendJson(std::string&, long long);
+    void AppendJson(std::string&, unsigned long long);
+    void AppendJson(std::string&, float);
+    void AppendJson(std::string&, double);
+    void AppendJson(std::string&, long double);
+    void AppendJson(std::string&, const char*);
+    void AppendJson(std::string&, const std::string&);
+
+    template <class T>
+    void AppendJson(std::string&, const T&);
+
+
+
+
+    // @function ProcessJson(message, fields, args)
+    //
+    //
+    // @param message - std::string& : values without a key separated by spaces
+    // @param fields  - std::string& : ,"key":value for every logger::key_value
+    // @param args    - pack         : arguments of a log call
+    //
+    // @return void
+
+    void ProcessJson(std::string&, std::string&);
+
+    template <class T, class ...Args>
+    void ProcessJson(std::string&, std::string&, const T&, const Args&...);
+
+    template <class T, class ...Args>
+    void ProcessJson(std::string&, std::string&, const key_value<T>&, const Args&...);
+
+
+
+
+    // @function ProcessJsonVars(buffer, args)
+    //
+    //
+    // @param buffer - logger::var_buffer* : buffer the fields are appended to as one variable
+    // @param args   - pack                : arguments of a log call
+    //
+    // @return void
+    //
+    //
+    // append "msg":"..." followed by ,"key":value of every logger::key_value of @args
+
+    template <class ...Args>
+    void ProcessJsonVars(var_buffer*, const Args&...);
+
+
+
+
+    // @function AppendJsonHead(s, date_time, type, filename, line, func)
+    //
+    //
+    // @param s         - std::string&             : target string
+    // @param date_time - const char*              : "YYYY-MM-DD HH:MM:SS"
+    // @param type      - logger::log_message_type : type of message
+    // @param filename  - const char*              : file where the record was made
+    // @param line      - int                      : line where the record was made
+    // @param func      - const char*              : function where the record was made
+    //
+    // @return void
+    //
+    //
+    // open a JSON-lines record: {"time":..,"level":..,"file":..,"line":..,"func":..,
+    // fields of the record and "}\n" are appended by the caller
+
+    void AppendJsonHead(std::string&, const char*, log_message_type, const char*, int, const char*);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::operator<<
+
+template <class T>
+std::ostream& logger::operator<<(std::ostream& os, const logger::key_value<T>& field) {
+
+    return os << field.key << '=' << field.value;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJsonString
+
+void logger::AppendJsonString(std::string& s, const char* data, size_t n) {
+
+    static const char hex[] = "0123456789abcdef";
+
+    s += '"';
+
+    size_t start = 0;   // first byte that is not appended yet
+
+    for(size_t i = 0; i < n; ) {
+
+#ifdef LOGGER_SSE2
+        if(i + 16 <= n) {
+
+            __m128i bytes   = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));   // <= 0x1f
+            __m128i quote   = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+            __m128i slash   = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(control, _mm_or_si128(quote, slash)));
+
+            if(!mask) {
+                i += 16;
+                continue;
+            }
+
+#if defined(__GNUC__) || defined(__clang__)
+            i += (size_t)__builtin_ctz(mask);
+#else
+            while(!(mask & 1)) {
+                mask >>= 1;
+                ++i;
+            }
+#endif
+        }
+#endif
+
+        unsigned char c = (unsigned char)data[i];
+
+        if(c >= 0x20 && c != '"' && c != '\\') {
+            ++i;
+            continue;
+        }
+
+        s.append(data + start, i - start);
+
+        switch(c) {
+            case '"':   s.append("\\\"");   break;
+            case '\\':  s.append("\\\\");   break;
+            case '\n':  s.append("\\n");    break;
+            case '\r':  s.append("\\r");    break;
+            case '\t':  s.append("\\t");    break;
+            case '\b':  s.append("\\b");    break;
+            case '\f':  s.append("\\f");    break;
+            default:
+                s.append("\\u00");
+                s += hex[c >> 4];
+                s += hex[c & 15];
+                break;
+        }
+
+        start = ++i;
+    }
+
+    s.append(data + start, n - start);
+    s += '"';
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+void logger::AppendJson(std::string& s, bool var)                   { s.append(var ? "true" : "false"); }
+void logger::AppendJson(std::string& s, short var)                  { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned short var)         { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, int var)                    { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned int var)           { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, long var)                   { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned long var)          { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, long long var)              { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned long long var)     { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, float var)                  { logger::AppendJson(s, (double)var); }
+void logger::AppendJson(std::string& s, long double var)            { logger::AppendJson(s, (double)var); }
+void logger::AppendJson(std::string& s, const std::string& var)     { logger::AppendJsonString(s, var.data(), var.length()); }
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+void logger::AppendJson(std::string& s, double var) {
+
+    if(var != var || var - var != 0) {     // NaN or infinity
+        s.append("null");
+        return;
+    }
+
+    char buffer[32];
+
+    int n = snprintf(buffer, sizeof(buffer), "%.15g", var);
+
+    if(strtod(buffer, nullptr) != var) {
+        n = snprintf(buffer, sizeof(buffer), "%.17g", var);    // the shortest precision that round-trips
+    }
+
+    s.append(buffer, n > 0 ? (size_t)n : 0);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+void logger::AppendJson(std::string& s, const char* var) {
+
+    if(!var) {
+        s.append("null");
+        return;
+    }
+
+    logger::AppendJsonString(s, var, strlen(var));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+template <class T>
+void logger::AppendJson(std::string& s, const T& var) {
+
+    logger::thread_frame<std::string> text;     // converted value, escaped as a whole
+
+    text->clear();
+
+    logger::AppendVar(*text, var);
+    logger::AppendJsonString(s, text->data(), text->length());
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessJson
+
+void logger::ProcessJson(std::string&, std::string&) {}
+
+
+
+
+// @Implementation of
+//  logger::ProcessJson
+
+template <class T, class ...Args>
+void logger::ProcessJson(std::string& message, std::string& fields, const T& var, const Args&... args) {
+
+    if(!message.empty()) message += ' ';
+
+    logger::AppendVar(message, var);
+
+    logger::ProcessJson(message, fields, args...);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessJson
+
+template <class T, class ...Args>
+void logger::ProcessJson(std::string& message, std::string& fields, const logger::key_value<T>& field, const Args&... args) {
+
+    fields += ',';
+    logger::AppendJsonString(fields, field.key, strlen(field.key));
+    fields += ':';
+    logger::AppendJson(fields, field.value);
+
+    logger::ProcessJson(message, fields, args...);
+
+}
+
+
+
+
+
+// @Implementation of
+//  logger::ProcessJsonVars
+
+template <class ...Args>
+void logger::ProcessJsonVars(logger::var_buffer* buffer, const Args&... args) {
+
+    logger::thread_frame<std::string> message;  // values without a key
+    logger::thread_frame<std::string> fields;   // ,"key":value
+
+    message->clear();
+    fields->clear();
+
+    logger::ProcessJson(*message, *fields, args...);
+
+    buffer->data.append("\"msg\":");
+    logger::AppendJsonString(buffer->data, message->data(), message->length());
+    buffer->data.append(*fields);
+
+    buffer->ends.push_back(buffer->data.length());
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJsonHead
+
+void logger::AppendJsonHead(std::string& s, const char* date_time, logger::log_message_type type, const char* filename, int line, const char* func) {
+
+    s.append("{\"time\":");
+    logger::AppendJsonString(s, date_time, 19);
+    s.append(",\"level\":");
+    logger::AppendJson(s, logger::MessageTypeName(type));
+    s.append(",\"file\":");
+    logger::AppendJson(s, filename);
+    s.append(",\"line\":");
+    logger::AppendVar(s, line);
+    s.append(",\"func\":");
+    logger::AppendJson(s, func);
+    s += ',';
+
+}
+
+#endif /* LOG_JSON_HPP */
@@ -0,0 +1,461 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_LEVEL_HPP
+#define LOG_LEVEL_HPP
+
+#include <atomic>                   // std::atomic
+#include <mutex>                    // std::mutex, std::lock_guard
+#include <type_traits>              // std::decay
+#include <utility>                  // std::forward
+
+#include "log_message_types.hpp"    // logger::log_message_type
+#include "log_error.hpp"            // logger::error
+
+// least severe message type that is compiled in, e.g. -DLOGGER_MIN_LEVEL=T_INFO
+// log calls of less severe types are removed together with their arguments:
+// by their type alone for logger::error, by the constant folded check for a constant message type
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL T_DEBUG
+#endif
+
+// first argument of a log macro, works with a single argument too
+#define LOGGER_EXPAND(x) x
+#define LOGGER_FIRST_ARG_(first, ...) first
+#define LOGGER_FIRST_ARG(...) LOGGER_EXPAND(LOGGER_FIRST_ARG_(__VA_ARGS__, 0))
+
+// arguments of a log macro after the first one, each with a leading comma, nothing for a single argument
+// works with up to 64 arguments
+#define LOGGER_CONCAT_(a, b) a##b
+#define LOGGER_CONCAT(a, b) LOGGER_CONCAT_(a, b)
+#define LOGGER_ARG_65(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,_17,_18,_19,_20,_21,_22,_23,_24,_25,_26,_27,_28,_29,_30,_31,_32,_33,_34,_35,_36,_37,_38,_39,_40,_41,_42,_43,_44,_45,_46,_47,_48,_49,_50,_51,_52,_53,_54,_55,_56,_57,_58,_59,_60,_61,_62,_63,_64, N, ...) N
+#define LOGGER_HAS_REST(...) LOGGER_EXPAND(LOGGER_ARG_65(__VA_ARGS__, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 0, 0))
+#define LOGGER_REST_0(first)
+#define LOGGER_REST_1(first, ...) , __VA_ARGS__
+#define LOGGER_REST_ARGS(...) LOGGER_EXPAND(LOGGER_CONCAT(LOGGER_REST_, LOGGER_HAS_REST(__VA_ARGS__))(__VA_ARGS__))
+
+// log call of a macro: the first argument is evaluated once and checked by logger::Gate,
+// PASS and CALL are made only if it passes, with the first argument bound to logger_first_
+// and the function of the call site in logger_func_
+#define LOGGER_GATE(SINK, PASS, CALL, ...) logger::Gate(SINK, LOGGER_FIRST_ARG(__VA_ARGS__), __func__, \
+    [&](decltype((LOGGER_FIRST_ARG(__VA_ARGS__))) logger_first_, const char* logger_func_) -> bool { \
+        return PASS && CALL(__FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_ LOGGER_REST_ARGS(__VA_ARGS__)); })
+
+namespace logger {
+    
+    typedef enum : unsigned char {
+        S_FILE,             // FileLog
+        S_CONSOLE,          // ConsoleLog
+        S_BINARY,           // BinaryLog
+        S_COUNT
+    } log_sink;
+    
+    
+    
+    
+    // @function Severity(type)
+    //
+    //
+    // @param type - logger::log_message_type : type of message
+    //
+    // @return int
+    //
+    //
+    // rank of @type from the least severe T_DEBUG (0) to the most severe T_CRITICAL (4),
+    // order of log_message_type values is kept for compatibility and is not the severity
+    
+    constexpr int Severity(log_message_type);
+    
+    
+    
+    
+    // @member min_level_
+    //
+    // LOGGER_MIN_LEVEL, may be given with or without "logger::"
+    
+    constexpr log_message_type min_level_ = LOGGER_MIN_LEVEL;
+    
+    
+    
+    
+    // @function CompiledIn(x)
+    //
+    //
+    // @param x - first argument of a log macro
+    //
+    // @return bool
+    //
+    //
+    // false if a log call is below LOGGER_MIN_LEVEL: @x is its message type,
+    // logger::error is logged as T_ERROR, calls without a type as T_INFO
+    
+    constexpr bool CompiledIn(log_message_type);
+    constexpr bool CompiledIn(const error&);
+    
+    template <class T>
+    constexpr bool CompiledIn(const T&);
+    
+    
+    
+    
+    // template<T>
+    // @struct compiled_in
+    //
+    //
+    // @member value - bool : a log call whose first argument has type @T may be compiled in
+    //
+    //
+    // the part of CompiledIn that depends only on the type of the first argument,
+    // false removes the call at compile time without looking at the argument
+    
+    template <class T>
+    struct compiled_in;
+    
+    
+    
+    
+    // @function TypeOf(x)
+    //
+    //
+    // @param x - first argument of a log macro
+    //
+    // @return logger::log_message_type
+    //
+    //
+    // message type of a log call: @x itself, T_ERROR for logger::error, T_INFO otherwise
+    
+    log_message_type TypeOf(log_message_type);
+    log_message_type TypeOf(const error&);
+    
+    template <class T>
+    log_message_type TypeOf(const T&);
+    
+    
+    
+    
+    // @member log_levels_
+    //
+    // runtime levels: global level, then level of every sink, guarded by log_levels_mutex_
+    
+    log_message_type log_levels_[S_COUNT + 1] = {T_DEBUG, T_DEBUG, T_DEBUG, T_DEBUG};
+    
+    
+    
+    
+    // @member log_levels_mutex_
+    //
+    // serializes SetLogLevel and SetSinkLevel
+    
+    std::mutex log_levels_mutex_;
+    
+    
+    
+    
+    // @member enabled_levels_
+    //
+    // 8 bits per sink, bit Severity(type) is set if @type passes both the global
+    // and the sink level, so a log call checks both with one relaxed load
+    
+    std::atomic<unsigned> enabled_levels_(0x1F1F1F);
+    
+    
+    
+    
+    // @function SetLogLevel(type)
+    //
+    //
+    // @param type - logger::log_message_type : least severe type that is logged
+    //
+    // @return void
+    //
+    //
+    // change the global runtime level, it applies to every sink together with its own level
+    
+    void SetLogLevel(log_message_type);
+    
+    
+    
+    
+    // @function SetSinkLevel(sink, type)
+    //
+    //
+    // @param sink - logger::log_sink          : sink to configure
+    // @param type - logger::log_message_type  : least severe type that is logged to @sink
+    //
+    // @return void
+    //
+    //
+    // change the runtime level of one sink
+    
+    void SetSinkLevel(log_sink, log_message_type);
+    
+    
+    
+    
+    // @function Enabled(sink, x)
+    //
+    //
+    // @param sink - logger::log_sink : sink of the log call
+    // @param x    - first argument of a log macro
+    //
+    // @return bool
+    //
+    //
+    // false if a log call is below LOGGER_MIN_LEVEL or filtered out at runtime
+    // checked by the log macros before any argument is evaluated
+    
+    bool Enabled(log_sink, log_message_type);
+    bool Enabled(log_sink, const error&);
+    
+    template <class T>
+    bool Enabled(log_sink, const T&);
+    
+    
+    
+    
+    // @function Gate(sink, first, func, call)
+    //
+    //
+    // @param sink  - logger::log_sink : sink of the log call
+    // @param first - T&&              : first argument of a log macro, evaluated once by the macro
+    // @param func  - const char*      : function of the call site
+    // @param call  - F                : bool(first, func), evaluates the other arguments and logs
+    //
+    // @return bool
+    //
+    //
+    // false without calling @call if the log call is not compiled in or filtered out at runtime,
+    // the result of @call otherwise
+    
+    template <class T, class F>
+    bool Gate(log_sink, T&&, const char*, F);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Severity
+
+constexpr int logger::Severity(logger::log_message_type type) {
+    
+    return type == logger::T_DEBUG   ? 0 :
+           type == logger::T_INFO    ? 1 :
+           type == logger::T_WARNING ? 2 :
+           type == logger::T_ERROR   ? 3 : 4;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CompiledIn
+
+constexpr bool logger::CompiledIn(logger::log_message_type type) {
+    
+    return logger::Severity(type) >= logger::Severity(logger::min_level_);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CompiledIn
+
+constexpr bool logger::CompiledIn(const logger::error&) {
+    
+    return logger::CompiledIn(logger::T_ERROR);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CompiledIn
+
+template <class T>
+constexpr bool logger::CompiledIn(const T&) {
+    
+    return logger::CompiledIn(logger::T_INFO);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::compiled_in
+
+template <class T>
+struct logger::compiled_in {
+    static constexpr bool value = logger::CompiledIn(logger::T_INFO);
+};
+
+template <>
+struct logger::compiled_in<logger::log_message_type> {
+    static constexpr bool value = true;     // checked by value
+};
+
+template <>
+struct logger::compiled_in<logger::error> {
+    static constexpr bool value = logger::CompiledIn(logger::T_ERROR);
+};
+
+
+
+
+
+// @Implementation of
+//  logger::TypeOf
+
+logger::log_message_type logger::TypeOf(logger::log_message_type type) {
+    
+    return type;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::TypeOf
+
+logger::log_message_type logger::TypeOf(const logger::error&) {
+    
+    return logger::T_ERROR;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::TypeOf
+
+template <class T>
+logger::log_message_type logger::TypeOf(const T&) {
+    
+    return logger::T_INFO;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::SetLogLevel
+
+void logger::SetLogLevel(logger::log_message_type type) {
+    
+    logger::SetSinkLevel(logger::S_COUNT, type);    // slot S_COUNT holds the global level
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::SetSinkLevel
+
+void logger::SetSinkLevel(logger::log_sink sink, logger::log_message_type type) {
+    
+    std::lock_guard<std::mutex> lock(logger::log_levels_mutex_);
+    
+    logger::log_levels_[sink] = type;
+    
+    int      global  = logger::Severity(logger::log_levels_[logger::S_COUNT]);
+    unsigned enabled = 0;
+    
+    for(int i = 0; i < logger::S_COUNT; ++i) {
+        
+        int level = logger::Severity(logger::log_levels_[i]);
+        
+        if(level < global) level = global;
+        
+        enabled |= (0x1Fu >> level << level) << (i * 8);  // bits level..4
+    }
+    
+    logger::enabled_levels_.store(enabled, std::memory_order_relaxed);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Enabled
+
+bool logger::Enabled(logger::log_sink sink, logger::log_message_type type) {
+    
+    return logger::CompiledIn(type) &&
+           (logger::enabled_levels_.load(std::memory_order_relaxed) >> (sink * 8 + logger::Severity(type)) & 1);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Enabled
+
+bool logger::Enabled(logger::log_sink sink, const logger::error&) {
+    
+    return logger::Enabled(sink, logger::T_ERROR);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Enabled
+
+template <class T>
+bool logger::Enabled(logger::log_sink sink, const T&) {
+    
+    return logger::Enabled(sink, logger::T_INFO);   // the same type TypeOf gives the call
+    
+}
+
+
+
+
+
+// @Implementation of
+//  logger::Gate
+
+template <class T, class F>
+bool logger::Gate(logger::log_sink sink, T&& first, const char* func, F call) {
+    
+    if(!logger::compiled_in<typename std::decay<T>::type>::value) return false;     // by the type, a constant
+    
+    if(!logger::CompiledIn(first)) return false;    // folded when the message type is a constant
+    
+    return logger::Enabled(sink, first) && call(std::forward<T>(first), func);
+    
+}
+
+#endif /* LOG_LEVEL_HPP */
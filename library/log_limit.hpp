@@ -0,0 +1,278 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_LIMIT_HPP
+#define LOG_LIMIT_HPP
+
+#include <stdlib.h>                 // atexit
+#include <cstddef>                  // size_t
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::steady_clock
+
+#include "log_message_types.hpp"    // logger::log_message_type
+
+// state of one call site, created when the call site is reached for the first time
+#define LOGGER_LIMITER(TYPE, ARG) [&]() -> TYPE& { static TYPE limiter(ARG); return limiter; }()
+
+namespace logger {
+    
+    // @struct limiter_site
+    //
+    //
+    // @member report   - bool(*)(const limiter_site&, size_t, bool) : logs "suppressed N records" for the call site
+    // @member path     - const char*                           : file of the call site
+    // @member filename - const char*                           : name of the file of the call site
+    // @member line     - int                                   : line of the call site
+    // @member func     - const char*                           : function of the call site
+    // @member type     - logger::log_message_type              : type of the first suppressed record
+    //
+    //
+    // where and how suppressed records of a rate limited call site are reported
+    
+    struct limiter_site {
+        bool                (*report)(const limiter_site&, size_t, bool);
+        const char*         path;
+        const char*         filename;
+        int                 line;
+        const char*         func;
+        log_message_type    type;
+    };
+    
+    
+    
+    
+    // @class rate_limiter
+    //
+    //
+    // @constructor rate_limiter(per_second) : pass at most @per_second records per second
+    //
+    //
+    // @method Pass()
+    //      @return size_t
+    //
+    //      0 if the record has to be suppressed, otherwise 1 + number of records
+    //      suppressed since the previous passed one
+    //
+    // @method Watch(site)
+    //      @return void
+    //
+    //      remember @site and add the limiter to rate_limiters_ when it suppresses a record
+    //      for the first time, so logger::ReportSuppressed finds it
+    //
+    // @method Report(now)
+    //      @return bool
+    //
+    //      report records suppressed since the previous passed one, if there are any,
+    //      @now - written right away as logger::ReportSuppressed does it
+    //
+    //
+    // token bucket of one call site that holds a second worth of records
+    // the bucket is kept as the time it becomes empty (generic cell rate algorithm),
+    // so it is checked and updated with a single atomic
+    
+    class rate_limiter {
+    public:
+        
+        explicit rate_limiter(double);
+        
+        size_t Pass();
+        
+        void Watch(const limiter_site&);
+        
+        bool Report(bool);
+        
+        rate_limiter*               next;           // next watched limiter in rate_limiters_
+        
+    private:
+        
+        long long                   interval_;      // nanoseconds per record
+        long long                   tolerance_;     // nanoseconds the bucket may run ahead of the clock
+        std::atomic<long long>      empty_at_;      // time when the bucket is empty
+        std::atomic<size_t>         suppressed_;
+        std::atomic<bool>           watched_;
+        limiter_site                site_;          // set once before the limiter is added to rate_limiters_
+        
+    };
+    
+    
+    
+    
+    // @member rate_limiters_
+    //
+    // rate limiters that have suppressed records, newest first, never removed
+    
+    std::atomic<rate_limiter*> rate_limiters_(nullptr);
+    
+    
+    
+    
+    // @function ReportSuppressed(now)
+    //
+    //
+    // @param now - bool : write the lines right away without buffers of the calling thread,
+    //                     which are already destroyed when the program exits
+    //
+    // @return bool
+    //
+    //
+    // log "suppressed N records" for every call site with records suppressed since its last passed one,
+    // called by logger::Flush and when the program exits, so counts are not lost when a call site goes quiet
+    // return false if some line could not be written
+    
+    bool ReportSuppressed(bool now = false);
+    
+    
+    
+    
+    // @class sample_limiter
+    //
+    //
+    // @constructor sample_limiter(k) : pass one record of every @k
+    //
+    //
+    // @method Pass()
+    //      @return size_t
+    //
+    //      0 if the record has to be suppressed, 1 otherwise
+    //
+    //
+    // sampling state of one call site, the first record is always passed
+    // passed records stand for the @k - 1 suppressed ones, so no summary is reported
+    
+    class sample_limiter {
+    public:
+        
+        explicit sample_limiter(size_t k) : k_(k ? k : 1), count_(0) {}
+        
+        size_t Pass() { return count_.fetch_add(1, std::memory_order_relaxed) % k_ == 0 ? 1 : 0; }
+        
+    private:
+        
+        size_t                      k_;
+        std::atomic<size_t>         count_;
+        
+    };
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::rate_limiter
+
+logger::rate_limiter::rate_limiter(double per_second) : next(nullptr), empty_at_(0), suppressed_(0), watched_(false), site_() {
+    
+    if(per_second <= 0) per_second = 1e-9;
+    
+    interval_  = (long long)(1e9 / per_second);
+    tolerance_ = per_second > 1 ? 1000000000LL - interval_ : 0;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::Pass
+
+size_t logger::rate_limiter::Pass() {
+    
+    long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+    
+    long long empty_at = empty_at_.load(std::memory_order_relaxed);
+    
+    for(;;) {
+        
+        long long start = empty_at > now ? empty_at : now;
+        
+        if(start - now > tolerance_) {  // no token left
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        
+        if(empty_at_.compare_exchange_weak(empty_at, start + interval_, std::memory_order_relaxed)) break;
+    }
+    
+    return 1 + suppressed_.exchange(0, std::memory_order_relaxed);
+    
+}
+
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::Watch
+
+void logger::rate_limiter::Watch(const logger::limiter_site& site) {
+    
+    if(watched_.load(std::memory_order_relaxed) || watched_.exchange(true)) return;
+    
+    static const int registered = atexit([]{
+        try { logger::ReportSuppressed(true); } catch(...) {}   // nothing can be reported at exit
+    });
+    
+    (void)registered;
+    
+    site_ = site;
+    next  = logger::rate_limiters_.load(std::memory_order_relaxed);
+    
+    while(!logger::rate_limiters_.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::Report
+
+bool logger::rate_limiter::Report(bool now) {
+    
+    size_t suppressed = suppressed_.exchange(0, std::memory_order_relaxed);   // the next passed record does not count them again
+    
+    return !suppressed || site_.report(site_, suppressed, now);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ReportSuppressed
+
+bool logger::ReportSuppressed(bool now) {
+    
+    bool result = true;
+    
+    for(logger::rate_limiter* limiter = logger::rate_limiters_.load(std::memory_order_acquire); limiter; limiter = limiter->next) {
+        
+        if(!limiter->Report(now)) result = false;
+    }
+    
+    return result;
+    
+}
+
+#endif /* LOG_LIMIT_HPP */
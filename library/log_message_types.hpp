@@ -33,6 +33,46 @@ namespace logger {
         T_CRITICAL
     } log_message_type;
     
+    
+    
+    
+    // @function MessageTypeName(type)
+    //
+    //
+    // @param type - logger::log_message_type : type of message
+    //
+    // @return const char*
+    //
+    //
+    // label of @type that is written to the log file
+    
+    const char* MessageTypeName(log_message_type);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::MessageTypeName
+
+const char* logger::MessageTypeName(logger::log_message_type type) {
+    
+    switch (type) {
+        case logger::T_INFO:
+            return "INFO";
+        case logger::T_DEBUG:
+            return "DEBUG";
+        case logger::T_ERROR:
+            return "ERROR";
+        case logger::T_WARNING:
+            return "WARNING";
+        case logger::T_CRITICAL:
+            return "CRITICAL";
+        default:
+            return "INFO";
+    }
+    
 }
 
 #endif /* LOG_MESSAGE_TYPES_HPP */
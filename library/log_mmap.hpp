@@ -0,0 +1,295 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_MMAP_HPP
+#define LOG_MMAP_HPP
+
+#include <string.h>                 // memcpy
+#include <errno.h>                  // errno, EINTR, EOPNOTSUPP, ENOSYS
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <atomic>                   // std::atomic
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <fcntl.h>                  // open, fallocate
+#include <unistd.h>                 // ftruncate, close, sysconf
+#include <sys/mman.h>               // mmap, munmap, msync
+#include <sys/stat.h>               // fstat
+#define OS_UNIX
+#endif
+
+namespace logger {
+    
+    // @class mapped_file
+    //
+    //
+    // @method Open(path, extent, checkpoint)
+    //      @return bool
+    //
+    //      open or create @path, preallocate it by @extent bytes and map it to memory
+    //      msync written data every @checkpoint bytes, never if @checkpoint is 0
+    //      return false if the file cannot be mapped (always on Windows)
+    //
+    // @method IsOpen()
+    //      @return bool
+    //
+    // @method Size()
+    //      @return size_t
+    //
+    //      written length of the file
+    //
+    // @method Append(data, n)
+    //      @return bool
+    //
+    //      copy @n bytes to the end of the file, grow the file by another extent if needed
+    //
+    // @method Sync()
+    //      @return bool
+    //
+    //      msync data written since the previous checkpoint and wait for it
+    //
+    // @method Close()
+    //      @return void
+    //
+    //      unmap the file and truncate it to the written length
+    //
+    //
+    // log file that is written with memcpy: the file is preallocated in large extents,
+    // so appending costs no system call until the extent is used up
+    // written length is kept in an atomic, so it can be read by other threads,
+    // but there must be a single writer at a time
+    // a file that was not closed (e.g. after a crash) ends with zeros that are
+    // cut off by the next Open
+    
+    class mapped_file {
+    public:
+        
+        mapped_file() : fd_(-1), data_(nullptr), capacity_(0), extent_(0), checkpoint_(0), synced_(0), tail_(0) {}
+        ~mapped_file() { Close(); }
+        
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        
+        bool    Open(const std::string&, size_t, size_t);
+        bool    IsOpen() const { return data_ != nullptr; }
+        size_t  Size() const { return tail_.load(std::memory_order_relaxed); }
+        bool    Append(const char*, size_t);
+        bool    Sync();
+        void    Close();
+        
+    private:
+        
+        bool    Map(size_t);
+        
+        int                 fd_;
+        char*               data_;          // mapped file
+        size_t              capacity_;      // mapped and preallocated length
+        size_t              extent_;        // preallocation step
+        size_t              checkpoint_;    // bytes between msync calls, 0 - never
+        size_t              synced_;        // bytes written before the last msync
+        std::atomic<size_t> tail_;          // written length
+        
+    };
+    
+}
+
+
+
+
+#ifdef OS_UNIX
+// @Implementation of
+//  logger::mapped_file::Map
+
+bool logger::mapped_file::Map(size_t capacity) {
+    
+#ifdef __linux__
+    int allocated;
+    
+    while((allocated = fallocate(fd_, 0, 0, (off_t)capacity)) != 0 && errno == EINTR) {}
+    
+    if(allocated != 0) {
+        // a sparse file only if the file system cannot preallocate, a page without
+        // a disk block behind it would raise SIGBUS on the first write (ENOSPC)
+        if(errno != EOPNOTSUPP && errno != ENOSYS) return false;
+        if(ftruncate(fd_, (off_t)capacity) != 0) return false;
+    }
+#else
+    if(ftruncate(fd_, (off_t)capacity) != 0) return false;
+#endif
+    
+    if(data_) {     // the old mapping stays usable until the file is extended
+        munmap(data_, capacity_);
+        data_ = nullptr;
+    }
+    
+    void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    
+    if(data == MAP_FAILED) return false;
+    
+    data_     = (char*)data;
+    capacity_ = capacity;
+    
+    return true;
+    
+}
+#endif // OS_UNIX
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Open
+
+bool logger::mapped_file::Open(const std::string& path, size_t extent, size_t checkpoint) {
+    
+    Close();
+    
+#ifdef OS_UNIX
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    
+    if(fd_ < 0) return false;
+    
+    struct stat st;
+    
+    if(fstat(fd_, &st) != 0) {
+        Close();
+        return false;
+    }
+    
+    size_t length = (size_t)st.st_size;
+    size_t page   = (size_t)sysconf(_SC_PAGESIZE);
+    
+    extent_     = (extent + page - 1) / page * page;
+    checkpoint_ = checkpoint;
+    
+    if(!Map((length / extent_ + 1) * extent_)) {
+        Close();
+        return false;
+    }
+    
+    // drop preallocated zeros left by a file that was not closed
+    while(length && data_[length - 1] == '\0') --length;
+    
+    tail_.store(length, std::memory_order_release);
+    synced_ = length;
+    
+    return true;
+#else
+    return false;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Append
+
+bool logger::mapped_file::Append(const char* data, size_t n) {
+    
+#ifdef OS_UNIX
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    
+    if(tail + n > capacity_ || !data_) {    // no mapping if mmap failed while growing
+        
+        size_t capacity = capacity_;
+        while(tail + n > capacity) capacity += extent_;
+        
+        if(!Map(capacity)) return false;
+    }
+    
+    memcpy(data_ + tail, data, n);
+    
+    tail_.store(tail + n, std::memory_order_release);
+    
+    if(checkpoint_ && tail + n - synced_ >= checkpoint_) {
+        return Sync();
+    }
+    
+    return true;
+#else
+    return false;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Sync
+
+bool logger::mapped_file::Sync() {
+    
+#ifdef OS_UNIX
+    if(!data_) return true;
+    
+    size_t tail  = tail_.load(std::memory_order_acquire);
+    size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = synced_ / page * page;   // msync needs page aligned address
+    
+    if(tail == synced_) return true;
+    
+    synced_ = tail;
+    
+    return msync(data_ + begin, tail - begin, MS_SYNC) == 0;
+#else
+    return true;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Close
+
+void logger::mapped_file::Close() {
+    
+#ifdef OS_UNIX
+    if(data_) {
+        if(checkpoint_) Sync();
+        
+        munmap(data_, capacity_);
+        data_ = nullptr;
+    }
+    
+    if(fd_ >= 0) {
+        // file was never mapped when capacity is 0, its length is unknown
+        if(capacity_ && ftruncate(fd_, (off_t)tail_.load(std::memory_order_acquire)) != 0) {
+            // file keeps trailing zeros, they are cut off by the next Open
+        }
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+    
+    capacity_ = 0;
+    tail_.store(0, std::memory_order_relaxed);
+    
+}
+
+#endif /* LOG_MMAP_HPP */
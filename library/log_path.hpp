@@ -0,0 +1,327 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_PATH_HPP
+#define LOG_PATH_HPP
+
+#include <time.h>                   // time_t, mktime
+#include <cstddef>                  // size_t
+#include <utility>                  // std::move
+#include <string>                   // std::string
+#include <unordered_set>            // std::unordered_set
+
+#if defined(_WIN32) | defined(_WIN64)
+#include <windows.h>                // CreateDirectory
+#include <sys/stat.h>               // stat
+#define OS_WIN
+#else
+#include <sys/stat.h>               // stat, mkdir
+#include <unistd.h>                 // mkdir
+#define OS_UNIX
+#endif
+
+#include "log_error.hpp"            // logger::error
+#include "log_clock.hpp"            // logger::LocalTime
+
+namespace logger {
+
+    // @function MakeDirectory(path)
+    //
+    //
+    // @param path - const std::string& : directory to create
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // create directory @path if it does not exist
+
+    void MakeDirectory(const std::string&);
+
+
+
+
+    // @class log_path
+    //
+    //
+    // @method Reset(directory, extension)
+    //      @return void
+    //
+    //      change the logging directory to @directory and extension of log files to @extension
+    //      and forget everything resolved before
+    //
+    // @method Expired(time)
+    //      @return bool
+    //
+    //      return true if a record made at @time does not belong to the resolved file
+    //
+    // @method Resolve(time)
+    //      @return const std::string&
+    //      @throw  logger::error
+    //
+    //      create directories logs/{year}/{month} for the day of @time
+    //      and return path to the latest existing segment of the log file of that day,
+    //      a segment compressed to {path}.gz counts as existing but is never continued
+    //
+    // @method NextSegment()
+    //      @return const std::string&
+    //
+    //      return path to the next segment of the resolved day: ddmmyyyy.N{extension}
+    //
+    //
+    // resolves log file path once per day: the local day boundaries are computed
+    // when the path is resolved so the hot path only compares the record time
+    // against them, directories that are known to exist are never checked again
+    // the first segment of a day is ddmmyyyy{extension}, the next are ddmmyyyy.1{extension}, ...
+
+    class log_path {
+    public:
+
+        log_path() : segment_(0), begin_(0), end_(0) {}
+
+        void                Reset(std::string, const char* = ".log");
+        bool                Expired(time_t t) const { return t >= end_ || t < begin_; }
+        const std::string&  Resolve(time_t);
+        const std::string&  NextSegment();
+        const std::string&  Path() const { return path_; }
+        const std::string&  Directory() const { return directory_; }
+
+    private:
+
+        void                EnsureDirectory(const std::string&);
+        void                BuildPath();
+
+        std::string                     directory_;     // logging directory with "logs" appended
+        std::string                     extension_;     // extension of log files
+        std::string                     path_;          // resolved log file
+        std::string                     day_;           // resolved log file without segment and extension
+        size_t                          segment_;       // segment of the resolved log file
+        time_t                          begin_;         // local midnight of the resolved day
+        time_t                          end_;           // next local midnight
+        std::unordered_set<std::string> created_;       // directories known to exist
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::MakeDirectory
+
+void logger::MakeDirectory(const std::string& path) {
+
+#ifdef OS_UNIX
+    struct stat st = {0};   // structure for holding stat
+
+    if (stat(path.c_str(), &st) == -1) {
+        if(mkdir(path.c_str(), 0700)) {
+            throw logger::error("cannot create directory");
+        }
+    }
+#endif // OS_UNIX
+
+#ifdef OS_WIN
+	if (CreateDirectory(path.c_str(), NULL))
+	{
+		// Directory created
+	}
+	else if (ERROR_ALREADY_EXISTS == GetLastError())
+	{
+		// Directory already exists
+	}
+	else
+	{
+		throw logger::error("cannot create directory");
+	}
+#endif // OS_WIN
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::Reset
+
+void logger::log_path::Reset(std::string directory, const char* extension) {
+
+    directory_ = std::move(directory) + "logs";
+    extension_ = extension;
+    path_.clear();
+    day_.clear();
+    segment_ = 0;
+    created_.clear();
+    begin_ = end_ = 0;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::EnsureDirectory
+
+void logger::log_path::EnsureDirectory(const std::string& path) {
+
+    if(created_.count(path)) return;
+
+    logger::MakeDirectory(path);
+
+    created_.insert(path);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::Resolve
+
+const std::string& logger::log_path::Resolve(time_t time) {
+
+    static const char* month[] = {
+        "january",
+        "february",
+        "march",
+        "april",
+        "may",
+        "june",
+        "july",
+        "august",
+        "september",
+        "october",
+        "november",
+        "december"
+    };
+
+    struct tm cur_time;
+
+    logger::LocalTime(time, &cur_time);
+
+
+    // day boundaries, mktime takes care of month/year overflow and DST
+    struct tm midnight = cur_time;
+
+    midnight.tm_hour  = 0;
+    midnight.tm_min   = 0;
+    midnight.tm_sec   = 0;
+    midnight.tm_isdst = -1;
+    begin_ = mktime(&midnight);
+
+    midnight = cur_time;
+    midnight.tm_mday += 1;
+    midnight.tm_hour  = 0;
+    midnight.tm_min   = 0;
+    midnight.tm_sec   = 0;
+    midnight.tm_isdst = -1;
+    end_ = mktime(&midnight);
+
+
+    int  year = cur_time.tm_year + 1900;
+    char digits[4];
+
+    digits[0] = (char)('0' + year / 1000 % 10);
+    digits[1] = (char)('0' + year / 100 % 10);
+    digits[2] = (char)('0' + year / 10 % 10);
+    digits[3] = (char)('0' + year % 10);
+
+    path_.assign(directory_);
+    EnsureDirectory(path_);
+
+    path_ += '/';
+    path_.append(digits, 4);
+    EnsureDirectory(path_);
+
+    path_ += '/';
+    path_ += month[cur_time.tm_mon];
+    EnsureDirectory(path_);
+
+
+    path_ += '/';
+    path_ += (char)('0' + cur_time.tm_mday / 10);
+    path_ += (char)('0' + cur_time.tm_mday % 10);
+    path_ += (char)('0' + (cur_time.tm_mon + 1) / 10);
+    path_ += (char)('0' + (cur_time.tm_mon + 1) % 10);
+    path_.append(digits, 4);
+
+    day_.swap(path_);
+
+
+    // continue the latest segment written before
+    struct stat st;
+
+    for(segment_ = 1; ; ++segment_) {
+
+        BuildPath();
+
+        if(stat(path_.c_str(), &st) != 0 && stat((path_ + ".gz").c_str(), &st) != 0) break;
+    }
+
+    --segment_;
+    BuildPath();
+
+    if(stat(path_.c_str(), &st) != 0 && stat((path_ + ".gz").c_str(), &st) == 0) {
+        NextSegment();  // compressed by an earlier run, its number is taken
+    }
+
+    return path_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::NextSegment
+
+const std::string& logger::log_path::NextSegment() {
+
+    ++segment_;
+    BuildPath();
+
+    return path_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::BuildPath
+
+void logger::log_path::BuildPath() {
+
+    path_.assign(day_);
+
+    if(segment_) {
+        path_ += '.';
+        path_ += std::to_string(segment_);
+    }
+
+    path_ += extension_;
+
+}
+
+#endif /* LOG_PATH_HPP */
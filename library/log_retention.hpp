@@ -0,0 +1,485 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_RETENTION_HPP
+#define LOG_RETENTION_HPP
+
+#include <time.h>                   // time_t, time
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <map>                      // std::map
+#include <set>                      // std::set
+#include <algorithm>                // std::sort
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <condition_variable>       // std::condition_variable
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <dirent.h>                 // opendir, readdir, closedir
+#include <sys/stat.h>               // stat
+#include <unistd.h>                 // unlink, rmdir
+#define OS_UNIX
+#endif
+
+#include "log_clock.hpp"            // logger::LocalTime
+
+namespace logger {
+
+    // @struct log_entry
+    //
+    //
+    // @member path    - std::string        : path to the file
+    // @member kind    - std::string        : extension of the file, e.g. ".log" or ".bin"
+    // @member day     - long               : day of the file as yyyymmdd
+    // @member segment - size_t             : number of the segment of the day
+    // @member size    - unsigned long long : size of the file
+    //
+    //
+    // log file found in logs/{year}/{month}
+
+    struct log_entry {
+        std::string         path;
+        std::string         kind;
+        long                day;
+        size_t              segment;
+        unsigned long long  size;
+
+        bool operator<(const log_entry& other) const {
+            return day != other.day ? day < other.day : segment < other.segment;
+        }
+    };
+
+
+
+
+    // @function ParseLogName(name, entry)
+    //
+    //
+    // @param name  - const char*        : file name "ddmmyyyy.ext" or "ddmmyyyy.N.ext"
+    // @param entry - logger::log_entry* : day, segment and kind of the file
+    //
+    // @return bool
+    //
+    //
+    // return false if @name is not a name of a log file
+
+    bool ParseLogName(const char*, log_entry*);
+
+
+
+
+    // @function ListLogFiles(directory, entries, directories)
+    //
+    //
+    // @param directory   - const std::string&          : logs directory
+    // @param entries     - std::vector<log_entry>*      : log files of logs/{year}/{month} sorted from the oldest
+    // @param directories - std::vector<std::string>*   : month directories followed by year directories
+    //
+    // @return void
+    //
+    //
+    // find every log file in @directory, does nothing on Windows
+
+    void ListLogFiles(const std::string&, std::vector<log_entry>*, std::vector<std::string>*);
+
+
+
+
+    // @function DayOf(time)
+    //
+    //
+    // @param time - time_t : point of time
+    //
+    // @return long
+    //
+    //
+    // local day of @time as yyyymmdd
+
+    long DayOf(time_t);
+
+
+
+
+    // @class log_retention
+    //
+    //
+    // @method Start(max_bytes, max_days)
+    //      @return void
+    //
+    //      start the background thread that keeps at most @max_bytes bytes
+    //      and at most @max_days days of log files, 0 - no limit
+    //      has no effect on Windows
+    //
+    // @method Request(directory, current)
+    //      @return void
+    //
+    //      ask the background thread to enforce limits in @directory,
+    //      @current is the file being written, it is never deleted
+    //      never waits for the files to be deleted
+    //
+    //
+    // deletes the oldest files of logs/{year}/{month} and directories left empty by that,
+    // the latest segment of every kind of today's files is kept as it may be opened by a sink,
+    // directories that were empty before are kept as a sink may be about to open a file there
+
+    class log_retention {
+    public:
+
+        log_retention() : max_bytes_(0), max_days_(0), requested_(false), stop_(false) {}
+        ~log_retention();
+
+        log_retention(const log_retention&) = delete;
+        log_retention& operator=(const log_retention&) = delete;
+
+        void    Start(unsigned long long, unsigned);
+        void    Request(const std::string&, const std::string&);
+
+    private:
+
+        void    Run();
+        void    Enforce(const std::string&, const std::string&, unsigned long long, unsigned);
+
+        std::thread             thread_;
+        std::mutex              mutex_;
+        std::condition_variable wake_;
+        unsigned long long      max_bytes_;
+        unsigned                max_days_;
+        std::string             directory_;     // logs directory of the latest request
+        std::string             current_;       // file being written
+        bool                    requested_;
+        bool                    stop_;
+
+    };
+
+
+
+
+    // @member log_retention_
+    //
+    // retention of files written by FileLog
+
+    log_retention log_retention_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ParseLogName
+
+bool logger::ParseLogName(const char* name, logger::log_entry* entry) {
+
+    long digits[8];
+
+    for(int i = 0; i < 8; ++i) {
+        if(name[i] < '0' || name[i] > '9') return false;
+        digits[i] = name[i] - '0';
+    }
+
+    if(name[8] != '.') return false;
+
+    entry->day = (digits[4] * 1000 + digits[5] * 100 + digits[6] * 10 + digits[7]) * 10000 +
+                 (digits[2] * 10 + digits[3]) * 100 + digits[0] * 10 + digits[1];
+
+    entry->segment = 0;
+
+    const char* rest = name + 8;
+    const char* p    = rest + 1;
+
+    while(*p >= '0' && *p <= '9') {
+        entry->segment = entry->segment * 10 + (size_t)(*p - '0');
+        ++p;
+    }
+
+    if(p != rest + 1 && *p == '.') {
+        rest = p;               // "ddmmyyyy.N.ext"
+    }
+    else {
+        entry->segment = 0;     // "ddmmyyyy.ext"
+    }
+
+    entry->kind = rest;
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ListLogFiles
+
+void logger::ListLogFiles(const std::string& directory, std::vector<logger::log_entry>* entries, std::vector<std::string>* directories) {
+
+#ifdef OS_UNIX
+    std::vector<std::string> years;
+
+    DIR* root = opendir(directory.c_str());
+
+    if(!root) return;
+
+    for(struct dirent* year = readdir(root); year; year = readdir(root)) {
+
+        if(year->d_name[0] == '.') continue;
+
+        std::string year_path = directory + '/' + year->d_name;
+        DIR*        months    = opendir(year_path.c_str());
+
+        if(!months) continue;
+
+        for(struct dirent* month = readdir(months); month; month = readdir(months)) {
+
+            if(month->d_name[0] == '.') continue;
+
+            std::string month_path = year_path + '/' + month->d_name;
+            DIR*        files      = opendir(month_path.c_str());
+
+            if(!files) continue;
+
+            for(struct dirent* file = readdir(files); file; file = readdir(files)) {
+
+                logger::log_entry entry;
+                struct stat       st;
+
+                if(!logger::ParseLogName(file->d_name, &entry)) continue;
+
+                entry.path = month_path + '/' + file->d_name;
+
+                if(stat(entry.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+                entry.size = (unsigned long long)st.st_size;
+                entries->push_back(entry);
+            }
+
+            closedir(files);
+            directories->push_back(month_path);
+        }
+
+        closedir(months);
+        years.push_back(year_path);
+    }
+
+    closedir(root);
+
+    directories->insert(directories->end(), years.begin(), years.end());
+
+    std::sort(entries->begin(), entries->end());
+#else
+    (void)directory;
+    (void)entries;
+    (void)directories;
+#endif // OS_UNIX
+
+}
+
+
+
+
+// @Implementation of
+//  logger::DayOf
+
+long logger::DayOf(time_t time) {
+
+    struct tm local;
+
+    logger::LocalTime(time, &local);
+
+    return (local.tm_year + 1900L) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::~log_retention
+
+logger::log_retention::~log_retention() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_one();
+
+    if(thread_.joinable()) thread_.join();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Start
+
+void logger::log_retention::Start(unsigned long long max_bytes, unsigned max_days) {
+
+#ifdef OS_UNIX
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    max_bytes_ = max_bytes;
+    max_days_  = max_days;
+
+    if(!thread_.joinable()) {
+        thread_ = std::thread(&log_retention::Run, this);
+    }
+#endif // OS_UNIX
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Request
+
+void logger::log_retention::Request(const std::string& directory, const std::string& current) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(!thread_.joinable()) return;
+
+        directory_ = directory;
+        current_   = current;
+        requested_ = true;
+    }
+
+    wake_.notify_one();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Run
+
+void logger::log_retention::Run() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for(;;) {
+
+        wake_.wait(lock, [this]{ return requested_ || stop_; });
+
+        if(stop_) return;
+
+        requested_ = false;
+
+        std::string directory = directory_;
+        std::string current   = current_;
+
+        unsigned long long max_bytes = max_bytes_;
+        unsigned           max_days  = max_days_;
+
+        lock.unlock();
+
+        Enforce(directory, current, max_bytes, max_days);
+
+        lock.lock();
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Enforce
+
+void logger::log_retention::Enforce(const std::string& directory, const std::string& current, unsigned long long max_bytes, unsigned max_days) {
+
+#ifdef OS_UNIX
+    std::vector<logger::log_entry>  entries;
+    std::vector<std::string>        directories;
+
+    logger::ListLogFiles(directory, &entries, &directories);
+
+
+    // files that can be opened by a sink right now
+    time_t now    = time(nullptr);
+    long   today  = logger::DayOf(now);
+    long   oldest = 0;
+
+    if(max_days) {
+        oldest = logger::DayOf(now - (time_t)max_days * 86400);
+    }
+
+    std::map<std::string, size_t> latest;   // kind -> latest segment of today
+    std::set<std::string>         emptied;  // directories files were deleted from
+    unsigned long long            total = 0;
+
+    for(size_t i = 0; i < entries.size(); ++i) {
+
+        total += entries[i].size;
+
+        if(entries[i].day == today) latest[entries[i].kind] = entries[i].segment;
+    }
+
+
+    for(size_t i = 0; i < entries.size(); ++i) {
+
+        const logger::log_entry& entry = entries[i];
+
+        bool expired  = max_days && entry.day <= oldest;
+        bool overflow = max_bytes && total > max_bytes;
+
+        if(!expired && !overflow) break;    // entries are sorted from the oldest
+
+        if(entry.path == current) continue;
+        if(entry.day >= today && latest[entry.kind] == entry.segment) continue;
+
+        if(unlink(entry.path.c_str()) == 0) {
+            total -= entry.size;
+            emptied.insert(entry.path.substr(0, entry.path.rfind('/')));
+        }
+    }
+
+
+    for(size_t i = 0; i < directories.size(); ++i) {     // months come before their years
+
+        const std::string& path = directories[i];
+
+        if(!emptied.count(path)) continue;
+        if(current.compare(0, path.length() + 1, path + '/') == 0) continue;  // holds the file being written
+
+        if(rmdir(path.c_str()) == 0) {      // fails unless the directory is empty
+            emptied.insert(path.substr(0, path.rfind('/')));
+        }
+    }
+#else
+    (void)directory;
+    (void)current;
+    (void)max_bytes;
+    (void)max_days;
+#endif // OS_UNIX
+
+}
+
+#endif /* LOG_RETENTION_HPP */
@@ -0,0 +1,532 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_STATS_HPP
+#define LOG_STATS_HPP
+
+#include <time.h>                   // time_t
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::steady_clock
+
+#include "log_level.hpp"            // logger::log_sink
+#include "log_utility.hpp"          // logger::AppendVar
+
+namespace logger {
+
+    // @class latency_histogram
+    //
+    //
+    // @method Add(ns)
+    //      @return void
+    //
+    //      count one call that took @ns nanoseconds
+    //
+    // @method Percentile(p)
+    //      @return unsigned long long
+    //
+    //      upper bound of the bucket that holds @p percent of counted calls, p is from 0 to 100
+    //
+    // @method Count()
+    //      @return unsigned long long
+    //
+    // @method Max()
+    //      @return unsigned long long
+    //
+    //
+    // HDR style histogram of nanoseconds: 8 linear buckets for every power of two,
+    // so values are kept with at most 1/8 relative error in 4 KB
+    // Add is a relaxed atomic increment, any thread may call it
+
+    class latency_histogram {
+    public:
+
+        void                Add(unsigned long long);
+        unsigned long long  Percentile(double) const;
+        unsigned long long  Count() const;
+        unsigned long long  Max() const { return max_.load(std::memory_order_relaxed); }
+
+    private:
+
+        static size_t               Index(unsigned long long);
+        static unsigned long long   Upper(size_t);
+
+        std::atomic<unsigned long long> counts_[64 * 8];
+        std::atomic<unsigned long long> max_;
+
+    };
+
+
+
+
+    // @struct sink_meter
+    //
+    //
+    // @member records - std::atomic<unsigned long long> : records written
+    // @member dropped - std::atomic<unsigned long long> : records suppressed or not written because of errors
+    // @member bytes   - std::atomic<unsigned long long> : bytes written
+    // @member flushes - std::atomic<unsigned long long> : number of flushes
+    // @member enqueue - logger::latency_histogram      : time spent in log calls by the caller
+    // @member write   - logger::latency_histogram      : time spent writing a record to the sink
+    //
+    //
+    // self instrumentation of one sink
+
+    struct sink_meter {
+        std::atomic<unsigned long long> records;
+        std::atomic<unsigned long long> dropped;
+        std::atomic<unsigned long long> bytes;
+        std::atomic<unsigned long long> flushes;
+        latency_histogram               enqueue;
+        latency_histogram               write;
+    };
+
+
+
+
+    // @struct latency_stats
+    //
+    //
+    // @member count - unsigned long long : number of measured calls
+    // @member p50   - unsigned long long : median in nanoseconds
+    // @member p99   - unsigned long long : 99th percentile in nanoseconds
+    // @member p999  - unsigned long long : 99.9th percentile in nanoseconds
+    // @member max   - unsigned long long : longest call in nanoseconds
+
+    struct latency_stats {
+        unsigned long long  count;
+        unsigned long long  p50;
+        unsigned long long  p99;
+        unsigned long long  p999;
+        unsigned long long  max;
+    };
+
+
+
+
+    // @struct sink_stats
+    //
+    //
+    // snapshot of logger::sink_meter
+
+    struct sink_stats {
+        unsigned long long  records;
+        unsigned long long  dropped;
+        unsigned long long  bytes;
+        unsigned long long  flushes;
+        latency_stats       enqueue;
+        latency_stats       write;
+    };
+
+
+
+
+    // @struct log_stats
+    //
+    //
+    // @member sinks - logger::sink_stats[] : statistics of every sink indexed by logger::log_sink
+
+    struct log_stats {
+        sink_stats          sinks[S_COUNT];
+    };
+
+
+
+
+    // @member stats_enabled_
+    //
+    // sinks measure themselves, otherwise every measurement costs a relaxed load
+
+    std::atomic<bool> stats_enabled_(false);
+
+
+
+
+    // @member stats_period_
+    //
+    // seconds between stats records in the log file, 0 - never
+
+    std::atomic<long long> stats_period_(0);
+
+
+
+
+    // @member sink_meters_
+    //
+    // counters and histograms of every sink
+
+    sink_meter sink_meters_[S_COUNT];
+
+
+
+
+    // @function EnableStats(period)
+    //
+    //
+    // @param period - time_t : seconds between stats records written to the log file, 0 - never
+    //
+    // @return void
+    //
+    //
+    // make sinks count records, bytes and flushes and measure latency of log calls and writes
+
+    void EnableStats(time_t period = 0);
+
+
+
+
+    // @function GetStats()
+    //
+    //
+    // @return logger::log_stats
+    //
+    //
+    // snapshot of counters and latency percentiles of every sink since EnableStats was called
+
+    log_stats GetStats();
+
+
+
+
+    // @function AppendStats(s, stats)
+    //
+    //
+    // @param s     - std::string&              : target string
+    // @param stats - const logger::log_stats&  : statistics
+    //
+    // @return void
+    //
+    //
+    // append one line description of @stats to @s
+
+    void AppendStats(std::string&, const log_stats&);
+
+
+
+
+    // @function CountRecord(sink, written, bytes)
+    //
+    //
+    // @param sink    - logger::log_sink : sink
+    // @param written - bool             : false if the record was not written
+    // @param bytes   - size_t           : number of written bytes
+    //
+    // @return void
+
+    void CountRecord(log_sink, bool, size_t);
+
+
+
+
+    // @function CountDropped(sink, n)
+    //
+    //
+    // @param sink - logger::log_sink : sink
+    // @param n    - size_t           : number of suppressed records
+    //
+    // @return void
+
+    void CountDropped(log_sink, size_t);
+
+
+
+
+    // @function CountFlush(sink)
+    //
+    //
+    // @param sink - logger::log_sink : sink
+    //
+    // @return void
+
+    void CountFlush(log_sink);
+
+
+
+
+    // @class stats_timer
+    //
+    //
+    // measures time between its construction and destruction into @histogram
+    // reads the clock only when stats are enabled
+
+    class stats_timer {
+    public:
+
+        explicit stats_timer(latency_histogram& histogram) : histogram_(histogram),
+            enabled_(logger::stats_enabled_.load(std::memory_order_relaxed)) {
+            if(enabled_) start_ = std::chrono::steady_clock::now();
+        }
+
+        ~stats_timer() {
+            if(enabled_) {
+                histogram_.Add((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start_).count());
+            }
+        }
+
+        stats_timer(const stats_timer&) = delete;
+        stats_timer& operator=(const stats_timer&) = delete;
+
+    private:
+
+        latency_histogram&                      histogram_;
+        bool                                    enabled_;
+        std::chrono::steady_clock::time_point   start_;
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Index
+
+size_t logger::latency_histogram::Index(unsigned long long ns) {
+
+    if(ns < 8) return (size_t)ns;
+
+    int msb = 63;
+
+    while(!(ns >> msb)) --msb;
+
+    return (size_t)(msb - 2) * 8 + (size_t)((ns >> (msb - 3)) & 7);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Upper
+
+unsigned long long logger::latency_histogram::Upper(size_t i) {
+
+    if(i < 8) return i;
+
+    size_t msb = i / 8 + 2;
+
+    return ((8ULL + i % 8 + 1) << (msb - 3)) - 1;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Add
+
+void logger::latency_histogram::Add(unsigned long long ns) {
+
+    counts_[Index(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    unsigned long long max = max_.load(std::memory_order_relaxed);
+
+    while(ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Count
+
+unsigned long long logger::latency_histogram::Count() const {
+
+    unsigned long long total = 0;
+
+    for(size_t i = 0; i < 64 * 8; ++i) total += counts_[i].load(std::memory_order_relaxed);
+
+    return total;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Percentile
+
+unsigned long long logger::latency_histogram::Percentile(double p) const {
+
+    unsigned long long rank  = (unsigned long long)(p / 100 * (double)Count());
+    unsigned long long total = 0;
+    unsigned long long max   = Max();
+
+    for(size_t i = 0; i < 64 * 8; ++i) {
+
+        total += counts_[i].load(std::memory_order_relaxed);
+
+        if(total > rank) return Upper(i) < max ? Upper(i) : max;
+    }
+
+    return max;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableStats
+
+void logger::EnableStats(time_t period) {
+
+    logger::stats_period_.store((long long)period, std::memory_order_relaxed);
+    logger::stats_enabled_.store(true, std::memory_order_relaxed);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::GetStats
+
+logger::log_stats logger::GetStats() {
+
+    logger::log_stats result;
+
+    for(size_t i = 0; i < logger::S_COUNT; ++i) {
+
+        logger::sink_meter& meter = logger::sink_meters_[i];
+        logger::sink_stats& stats = result.sinks[i];
+
+        stats.records = meter.records.load(std::memory_order_relaxed);
+        stats.dropped = meter.dropped.load(std::memory_order_relaxed);
+        stats.bytes   = meter.bytes.load(std::memory_order_relaxed);
+        stats.flushes = meter.flushes.load(std::memory_order_relaxed);
+
+        logger::latency_histogram* histograms[2] = { &meter.enqueue, &meter.write };
+        logger::latency_stats*     latencies[2]  = { &stats.enqueue, &stats.write };
+
+        for(size_t j = 0; j < 2; ++j) {
+            latencies[j]->count = histograms[j]->Count();
+            latencies[j]->p50   = histograms[j]->Percentile(50);
+            latencies[j]->p99   = histograms[j]->Percentile(99);
+            latencies[j]->p999  = histograms[j]->Percentile(99.9);
+            latencies[j]->max   = histograms[j]->Max();
+        }
+    }
+
+    return result;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendStats
+
+void logger::AppendStats(std::string& s, const logger::log_stats& stats) {
+
+    static const char* names[logger::S_COUNT] = { "file", "console", "binary" };
+
+    for(size_t i = 0; i < logger::S_COUNT; ++i) {
+
+        const logger::sink_stats& sink = stats.sinks[i];
+
+        if(!sink.records && !sink.dropped && !sink.enqueue.count) continue;
+
+        s.append(names[i]).append(": records ");
+        logger::AppendVar(s, sink.records);
+        s.append(" dropped ");
+        logger::AppendVar(s, sink.dropped);
+        s.append(" bytes ");
+        logger::AppendVar(s, sink.bytes);
+        s.append(" flushes ");
+        logger::AppendVar(s, sink.flushes);
+
+        const logger::latency_stats* latencies[2] = { &sink.enqueue, &sink.write };
+        const char*                  labels[2]    = { " enqueue ns p50/p99/p999/max ", " write ns p50/p99/p999/max " };
+
+        for(size_t j = 0; j < 2; ++j) {
+            s.append(labels[j]);
+            logger::AppendVar(s, latencies[j]->p50);
+            s += '/';
+            logger::AppendVar(s, latencies[j]->p99);
+            s += '/';
+            logger::AppendVar(s, latencies[j]->p999);
+            s += '/';
+            logger::AppendVar(s, latencies[j]->max);
+        }
+
+        s.append("; ");
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CountRecord
+
+void logger::CountRecord(logger::log_sink sink, bool written, size_t bytes) {
+
+    if(!logger::stats_enabled_.load(std::memory_order_relaxed)) return;
+
+    logger::sink_meter& meter = logger::sink_meters_[sink];
+
+    if(!written) {
+        meter.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    meter.records.fetch_add(1, std::memory_order_relaxed);
+    meter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CountDropped
+
+void logger::CountDropped(logger::log_sink sink, size_t n) {
+
+    if(!logger::stats_enabled_.load(std::memory_order_relaxed)) return;
+
+    logger::sink_meters_[sink].dropped.fetch_add(n, std::memory_order_relaxed);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CountFlush
+
+void logger::CountFlush(logger::log_sink sink) {
+
+    if(!logger::stats_enabled_.load(std::memory_order_relaxed)) return;
+
+    logger::sink_meters_[sink].flushes.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+#endif /* LOG_STATS_HPP */
@@ -0,0 +1,535 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_STYLE_HPP
+#define LOG_STYLE_HPP
+
+#include <string.h>                     // memcmp
+#include <cstddef>                      // size_t
+#include <string>                       // std::string
+#include <vector>                       // std::vector
+#include <atomic>                       // std::atomic
+#include <mutex>                        // std::mutex, std::lock_guard
+
+#if __cplusplus >= 201703L
+#include <string_view>                  // std::string_view
+#endif
+
+#include "log_console_modifiers.hpp"    // logger::kModifier
+
+namespace logger {
+
+    // @typedef style
+    //
+    //
+    // structure for holding modifiers that applied to elements with this style
+
+    typedef std::vector<kModifier> style;
+
+
+
+
+    // @typedef sgr_state
+    //
+    //
+    // attributes of the terminal packed into one integer:
+    // bits 0-7 - foreground color code, bits 8-15 - background color code (0 - default color),
+    // bits 16-24 - SGR_BOLD ... SGR_CROSSED
+    // 0 is the state after RESET
+
+    typedef unsigned sgr_state;
+
+    enum : unsigned {
+        SGR_BOLD        = 1u << 16,
+        SGR_FAINT       = 1u << 17,
+        SGR_ITALIC      = 1u << 18,
+        SGR_UNDERLINE   = 1u << 19,
+        SGR_SLOW_BLINK  = 1u << 20,
+        SGR_RAPID_BLINK = 1u << 21,
+        SGR_INVERSE     = 1u << 22,
+        SGR_CONCEAL     = 1u << 23,
+        SGR_CROSSED     = 1u << 24,
+        SGR_FG          = 0xffu,
+        SGR_BG          = 0xffu << 8
+    };
+
+
+
+
+    // @struct sgr_change
+    //
+    //
+    // @member reset - bool      : state is reset before the change
+    // @member set   - sgr_state : attributes and colors that are set
+    // @member clear - sgr_state : attributes and colors that are cleared before @set is applied
+    //
+    //
+    // modifiers of a style folded into one change of logger::sgr_state
+
+    struct sgr_change {
+        bool        reset;
+        sgr_state   set;
+        sgr_state   clear;
+    };
+
+
+
+
+    // @struct bound_style
+    //
+    //
+    // @member id       - unsigned           : number of the style, styles are numbered from 0 in order of binding
+    // @member name     - std::string        : name of the style
+    // @member change   - logger::sgr_change : what the style does to the state of the terminal
+    //
+    //
+    // style folded once when it is bound, never changes or moves afterwards,
+    // escape sequences are written by logger::AppendSgr from the state the style leads to
+
+    struct bound_style {
+        unsigned        id;
+        std::string     name;
+        sgr_change      change;
+    };
+
+
+
+
+    // @struct style_table
+    //
+    //
+    // @member styles - std::vector<const logger::bound_style*> : bound styles indexed by id
+    // @member slots  - std::vector<unsigned>                   : open addressing index by name hash,
+    //                                                            id + 1 of the style, 0 - empty slot
+    //
+    //
+    // immutable snapshot of bound styles, binding a style publishes a new snapshot
+
+    struct style_table {
+        std::vector<const bound_style*> styles;
+        std::vector<unsigned>           slots;
+    };
+
+
+
+
+    // @member style_table_
+    //
+    // latest snapshot, read without locks
+    // replaced snapshots are kept until exit as readers may still use them,
+    // styles are bound a few times per program so they take little memory
+
+    std::atomic<const style_table*> style_table_(nullptr);
+
+
+
+
+    // @member style_mutex_
+    //
+    // serializes binding of styles
+
+    std::mutex style_mutex_;
+
+
+
+
+    // @member retired_styles_
+    //
+    // every published snapshot and style, owned until exit
+
+    struct style_storage {
+        std::vector<const style_table*> tables;
+        std::vector<const bound_style*> styles;
+
+        ~style_storage() {
+            for(size_t i = 0; i < tables.size(); ++i) delete tables[i];
+            for(size_t i = 0; i < styles.size(); ++i) delete styles[i];
+        }
+    } retired_styles_;
+
+
+
+
+    // @function BindStyle(name, modifiers)
+    //
+    //
+    // @param name      - const std::string&    : name of style (should be unique)
+    // @param modifiers - const logger::style&  : modifiers that will be applied to that style
+    //
+    // @return bool
+    //
+    //
+    // render the escape sequence of @modifiers and publish it under @name
+    // return false if a style with such name is already bound
+
+    bool BindStyle(const std::string&, const style&);
+
+
+
+
+    // @function FindStyle(name, n)
+    //
+    //
+    // @param name - const char* : name of style, not null terminated
+    // @param n    - size_t      : length of @name
+    //
+    // @return const logger::bound_style*
+    //
+    //
+    // return bound style with such name or nullptr, never allocates or locks
+
+    const bound_style* FindStyle(const char*, size_t);
+
+#if __cplusplus >= 201703L
+    inline const bound_style* FindStyle(std::string_view name) { return FindStyle(name.data(), name.size()); }
+#endif
+
+
+
+
+    // @function FindStyle(id)
+    //
+    //
+    // @param id - unsigned : id of style
+    //
+    // @return const logger::bound_style*
+    //
+    //
+    // return bound style with such id or nullptr
+
+    const bound_style* FindStyle(unsigned);
+
+
+
+
+    // @function FoldModifiers(modifiers)
+    //
+    //
+    // @param modifiers - const logger::style& : modifiers in the order they are applied
+    //
+    // @return logger::sgr_change
+
+    sgr_change FoldModifiers(const style&);
+
+
+
+
+    // @function ApplyStyle(state, style)
+    //
+    //
+    // @param state - logger::sgr_state           : current state
+    // @param style - const logger::bound_style&  : style applied on top of @state
+    //
+    // @return logger::sgr_state
+
+    inline sgr_state ApplyStyle(sgr_state state, const bound_style& style) {
+        return ((style.change.reset ? 0 : state) & ~style.change.clear) | style.change.set;
+    }
+
+
+
+
+    // @function AppendSgr(s, from, to)
+    //
+    //
+    // @param s    - std::string&      : target string
+    // @param from - logger::sgr_state : state of the terminal
+    // @param to   - logger::sgr_state : wanted state
+    //
+    // @return void
+    //
+    //
+    // append one escape sequence with the fewest codes that turns @from into @to:
+    // codes of changed attributes only, or RESET followed by the whole @to if that is shorter
+    // nothing is appended if the states are equal
+
+    void AppendSgr(std::string&, sgr_state, sgr_state);
+
+
+
+
+    // @function StyleHash(name, n)
+    //
+    //
+    // @param name - const char* : name of style
+    // @param n    - size_t      : length of @name
+    //
+    // @return size_t
+
+    size_t StyleHash(const char*, size_t);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::StyleHash
+
+size_t logger::StyleHash(const char* name, size_t n) {
+
+    size_t hash = 14695981039346656037ULL & (size_t)-1;    // FNV-1a
+
+    for(size_t i = 0; i < n; ++i) {
+        hash = (hash ^ (unsigned char)name[i]) * (size_t)1099511628211ULL;
+    }
+
+    return hash;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::BindStyle
+
+bool logger::BindStyle(const std::string& name, const logger::style& modifiers) {
+
+    std::lock_guard<std::mutex> lock(logger::style_mutex_);
+
+    if(logger::FindStyle(name.data(), name.length())) return false;
+
+
+    logger::bound_style* style = new logger::bound_style;
+
+    style->name   = name;
+    style->change = logger::FoldModifiers(modifiers);
+
+    logger::retired_styles_.styles.push_back(style);
+
+
+    const logger::style_table* old   = logger::style_table_.load(std::memory_order_relaxed);
+    logger::style_table*       table = new logger::style_table;
+
+    if(old) table->styles = old->styles;
+
+    style->id = (unsigned)table->styles.size();
+    table->styles.push_back(style);
+
+
+    // index is at most half full
+    size_t capacity = 8;
+
+    while(capacity < table->styles.size() * 2) capacity *= 2;
+
+    table->slots.assign(capacity, 0);
+
+    for(size_t i = 0; i < table->styles.size(); ++i) {
+
+        const std::string& s    = table->styles[i]->name;
+        size_t             slot = logger::StyleHash(s.data(), s.length()) & (capacity - 1);
+
+        while(table->slots[slot]) slot = (slot + 1) & (capacity - 1);
+
+        table->slots[slot] = (unsigned)i + 1;
+    }
+
+    logger::retired_styles_.tables.push_back(table);
+    logger::style_table_.store(table, std::memory_order_release);
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FindStyle
+
+const logger::bound_style* logger::FindStyle(const char* name, size_t n) {
+
+    const logger::style_table* table = logger::style_table_.load(std::memory_order_acquire);
+
+    if(!table) return nullptr;
+
+    size_t mask = table->slots.size() - 1;
+
+    for(size_t slot = logger::StyleHash(name, n) & mask; table->slots[slot]; slot = (slot + 1) & mask) {
+
+        const logger::bound_style* style = table->styles[table->slots[slot] - 1];
+
+        if(style->name.length() == n && memcmp(style->name.data(), name, n) == 0) return style;
+    }
+
+    return nullptr;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FindStyle
+
+const logger::bound_style* logger::FindStyle(unsigned id) {
+
+    const logger::style_table* table = logger::style_table_.load(std::memory_order_acquire);
+
+    if(!table || id >= table->styles.size()) return nullptr;
+
+    return table->styles[id];
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FoldModifiers
+
+logger::sgr_change logger::FoldModifiers(const logger::style& modifiers) {
+
+    logger::sgr_change change = { false, 0, 0 };
+
+    for(size_t i = 0; i < modifiers.size(); ++i) {
+
+        unsigned  code = modifiers[i];
+        sgr_state on   = 0;     // attribute or color the modifier sets
+        sgr_state off  = 0;     // attributes or colors the modifier clears
+
+        switch(code) {
+            case logger::RESET:         change.reset = true; change.set = 0; change.clear = 0; continue;
+            case logger::BOLD:          on  = logger::SGR_BOLD;         break;
+            case logger::FAINT:         on  = logger::SGR_FAINT;        break;
+            case logger::ITALIC:        on  = logger::SGR_ITALIC;       break;
+            case logger::UNDERLINE:     on  = logger::SGR_UNDERLINE;    break;
+            case logger::SLOW_BLINK:    on  = logger::SGR_SLOW_BLINK;   break;
+            case logger::RAPID_BLINK:   on  = logger::SGR_RAPID_BLINK;  break;
+            case logger::INVERSE:       on  = logger::SGR_INVERSE;      break;
+            case logger::CONCEAL:       on  = logger::SGR_CONCEAL;      break;
+            case logger::CROSSED:       on  = logger::SGR_CROSSED;      break;
+            case logger::BOLD_OFF:      off = logger::SGR_BOLD;         break;
+            case logger::UNDERLINE_OFF: off = logger::SGR_UNDERLINE;    break;
+            case logger::BLINK_OFF:     off = logger::SGR_SLOW_BLINK | logger::SGR_RAPID_BLINK; break;
+            case logger::INVERSE_OFF:   off = logger::SGR_INVERSE;      break;
+            case logger::REVEAL:        off = logger::SGR_CONCEAL;      break;
+            case logger::CROSSED_OFF:   off = logger::SGR_CROSSED;      break;
+            case logger::FG_DEFAULT:    off = logger::SGR_FG;           break;
+            case logger::BG_DEFAULT:    off = logger::SGR_BG;           break;
+            default:
+                if((code >= 30 && code <= 37) || (code >= 90 && code <= 97)) {
+                    off = logger::SGR_FG;
+                    on  = code;
+                }
+                else if(code >= 40 && code <= 47) {
+                    off = logger::SGR_BG;
+                    on  = code << 8;
+                }
+                break;
+        }
+
+        change.set    = (change.set & ~off) | on;
+        change.clear |= off;
+    }
+
+    return change;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendSgr
+
+void logger::AppendSgr(std::string& s, logger::sgr_state from, logger::sgr_state to) {
+
+    if(from == to) return;
+
+    static const struct { sgr_state flag; unsigned char on, off; } attributes[] = {
+        { logger::SGR_ITALIC,    3, 23 },
+        { logger::SGR_UNDERLINE, 4, 24 },
+        { logger::SGR_INVERSE,   7, 27 },
+        { logger::SGR_CONCEAL,   8, 28 },
+        { logger::SGR_CROSSED,   9, 29 }
+    };
+
+    unsigned char changed[16];  // codes that change only what differs
+    unsigned char full[16];     // RESET and the whole @to
+    size_t        n = 0;
+    size_t        m = 0;
+
+    full[m++] = 0;
+
+
+    // 22 turns off both bold and faint, 25 both blinks
+    sgr_state   state  = from;
+    const struct { sgr_state flags; unsigned char off; } groups[] = {
+        { logger::SGR_BOLD | logger::SGR_FAINT, 22 },
+        { logger::SGR_SLOW_BLINK | logger::SGR_RAPID_BLINK, 25 }
+    };
+
+    for(size_t i = 0; i < 2; ++i) {
+        if(state & ~to & groups[i].flags) {
+            changed[n++] = groups[i].off;
+            state &= ~groups[i].flags;
+        }
+    }
+
+    const struct { sgr_state flag; unsigned char on; } grouped[] = {
+        { logger::SGR_BOLD, 1 }, { logger::SGR_FAINT, 2 }, { logger::SGR_SLOW_BLINK, 5 }, { logger::SGR_RAPID_BLINK, 6 }
+    };
+
+    for(size_t i = 0; i < 4; ++i) {
+        if(to & grouped[i].flag) {
+            if(!(state & grouped[i].flag)) changed[n++] = grouped[i].on;
+            full[m++] = grouped[i].on;
+        }
+    }
+
+    for(size_t i = 0; i < sizeof(attributes) / sizeof(attributes[0]); ++i) {
+
+        if((state ^ to) & attributes[i].flag) {
+            changed[n++] = to & attributes[i].flag ? attributes[i].on : attributes[i].off;
+        }
+
+        if(to & attributes[i].flag) full[m++] = attributes[i].on;
+    }
+
+    if((state ^ to) & logger::SGR_FG) changed[n++] = (unsigned char)(to & logger::SGR_FG ? to & logger::SGR_FG : 39);
+    if((state ^ to) & logger::SGR_BG) changed[n++] = (unsigned char)(to & logger::SGR_BG ? (to & logger::SGR_BG) >> 8 : 49);
+
+    if(to & logger::SGR_FG) full[m++] = (unsigned char)(to & logger::SGR_FG);
+    if(to & logger::SGR_BG) full[m++] = (unsigned char)((to & logger::SGR_BG) >> 8);
+
+
+    const unsigned char* codes = m < n ? full : changed;
+    size_t               count = m < n ? m : n;
+
+    s.append("\033[");
+
+    for(size_t i = 0; i < count; ++i) {
+
+        unsigned code = codes[i];
+
+        if(code >= 100) s += (char)('0' + code / 100);
+        if(code >= 10)  s += (char)('0' + code / 10 % 10);
+
+        s += (char)('0' + code % 10);
+        s += i + 1 < count ? ';' : 'm';
+    }
+
+}
+
+#endif /* LOG_STYLE_HPP */
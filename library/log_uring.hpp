@@ -0,0 +1,738 @@
+//MIT License
+//
+//Copyright (c) 2020 MrDanikus
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#ifndef LOG_URING_HPP
+#define LOG_URING_HPP
+
+#include <string.h>                 // memcpy, memset
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <deque>                    // std::deque
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <condition_variable>       // std::condition_variable
+#include <atomic>                   // std::atomic_thread_fence
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <errno.h>                  // errno, EINTR
+#include <fcntl.h>                  // open
+#include <unistd.h>                 // pwrite, close, syscall
+#include <sys/stat.h>               // fstat
+#define OS_UNIX
+#endif
+
+// io_uring is used through raw system calls, so no library has to be linked
+// LOGGER_NO_URING makes uring_file always use pwrite threads
+#if defined(__linux__) && defined(__has_include) && !defined(LOGGER_NO_URING)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>         // io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/mman.h>               // mmap, munmap
+#include <sys/syscall.h>            // __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register
+#include <sys/uio.h>                // iovec
+#define LOGGER_HAS_URING
+#endif
+#endif
+
+namespace logger {
+
+    // @class uring_file
+    //
+    //
+    // @method Open(path, buffers, buffer_size, threads)
+    //      @return bool
+    //
+    //      open or create @path for appending, writes go through @buffers buffers of
+    //      @buffer_size bytes, @threads threads call pwrite if io_uring is unavailable
+    //      return false if the file cannot be opened (always on Windows)
+    //
+    // @method IsOpen()
+    //      @return bool
+    //
+    // @method UsesUring()
+    //      @return bool
+    //
+    //      return true if writes are submitted through io_uring
+    //
+    // @method Append(data, n)
+    //      @return bool
+    //
+    //      copy @n bytes to the current buffer, a full buffer is handed off to be written
+    //      at its offset and a free one is taken from the pool
+    //
+    // @method Flush()
+    //      @return bool
+    //
+    //      hand off the current buffer and wait until every write is completed
+    //      return false if some write failed since the previous Flush
+    //
+    // @method Close()
+    //      @return void
+    //
+    //      flush and close the file
+    //
+    //
+    // log file written by io_uring: the buffers are registered once, a full buffer
+    // becomes a IORING_OP_WRITE_FIXED request, requests are submitted in batches and
+    // their completions return buffers to the pool
+    // when io_uring cannot be set up the same buffers are written by a pool of pwrite threads
+    // there must be a single writer at a time
+
+    class uring_file {
+    public:
+
+        uring_file();
+        ~uring_file();
+
+        uring_file(const uring_file&) = delete;
+        uring_file& operator=(const uring_file&) = delete;
+
+        bool    Open(const std::string&, size_t, size_t, size_t);
+        bool    IsOpen() const { return fd_ >= 0; }
+        bool    UsesUring() const { return ring_fd_ >= 0; }
+        bool    Append(const char*, size_t);
+        bool    Flush();
+        void    Close();
+
+    private:
+
+        // one buffer of the pool and the write it is used by
+        struct slot {
+            char*       data;
+            size_t      length;     // bytes to write
+            size_t      written;    // bytes written by completed requests
+            long long   offset;     // position of the buffer in the file
+        };
+
+        bool    Setup(size_t, size_t, size_t);
+        void    Teardown();
+        bool    SetupRing();
+        void    TeardownRing();
+        bool    Acquire();
+        void    Release(unsigned);
+        void    Submit(unsigned);
+        bool    Enter(unsigned, unsigned);
+        bool    Reap(bool);
+        void    Complete(unsigned, long);
+        void    RunWriter();
+
+        int                         fd_;
+        long long                   offset_;        // end of the file including buffers in flight
+
+        std::vector<char>           memory_;        // memory of every buffer
+        std::vector<slot>           slots_;
+        std::vector<unsigned>       free_;          // indices of free buffers
+        size_t                      buffer_size_;
+        size_t                      threads_count_;
+        int                         current_;       // buffer that is being filled, -1 if none
+        size_t                      inflight_;      // buffers handed off and not completed
+        bool                        failed_;
+
+        // io_uring
+        int                         ring_fd_;
+        void*                       sq_ptr_;
+        size_t                      sq_size_;
+        void*                       cq_ptr_;
+        size_t                      cq_size_;
+        void*                       sqes_ptr_;
+        size_t                      sqes_size_;
+        unsigned*                   sq_tail_;
+        unsigned*                   sq_mask_;
+        unsigned*                   sq_array_;
+        unsigned*                   cq_head_;
+        unsigned*                   cq_tail_;
+        unsigned*                   cq_mask_;
+        void*                       cqes_;
+        unsigned                    to_submit_;     // prepared and not submitted requests
+
+        // pwrite threads
+        std::vector<std::thread>    threads_;
+        std::mutex                  mutex_;
+        std::condition_variable     work_;          // wakes writer threads
+        std::condition_variable     done_;          // wakes Reap
+        std::deque<unsigned>        tasks_;         // buffers waiting for pwrite
+        std::vector<std::pair<unsigned, long> > completed_;  // buffer and result of pwrite
+        bool                        stop_;
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::uring_file
+
+logger::uring_file::uring_file() :
+    fd_(-1), offset_(0), buffer_size_(0), threads_count_(0), current_(-1), inflight_(0), failed_(false),
+    ring_fd_(-1), sq_ptr_(nullptr), sq_size_(0), cq_ptr_(nullptr), cq_size_(0), sqes_ptr_(nullptr), sqes_size_(0),
+    sq_tail_(nullptr), sq_mask_(nullptr), sq_array_(nullptr),
+    cq_head_(nullptr), cq_tail_(nullptr), cq_mask_(nullptr), cqes_(nullptr), to_submit_(0), stop_(false) {}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::~uring_file
+
+logger::uring_file::~uring_file() {
+
+    Close();
+    Teardown();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Open
+
+bool logger::uring_file::Open(const std::string& path, size_t buffers, size_t buffer_size, size_t threads) {
+
+    Close();
+
+#ifdef OS_UNIX
+    if(!Setup(buffers < 2 ? 2 : buffers, buffer_size < 4096 ? 4096 : buffer_size, threads < 1 ? 1 : threads)) return false;
+
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+
+    if(fd_ < 0) return false;
+
+    struct stat st;
+
+    if(fstat(fd_, &st) != 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    offset_ = (long long)st.st_size;
+    failed_ = false;
+
+    return true;
+#else
+    return false;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Setup
+
+bool logger::uring_file::Setup(size_t buffers, size_t buffer_size, size_t threads) {
+
+    if(slots_.size() == buffers && buffer_size_ == buffer_size && threads_count_ == threads) return true;
+
+    Teardown();
+
+    buffer_size_   = buffer_size;
+    threads_count_ = threads;
+
+    memory_.resize(buffers * buffer_size);
+    slots_.resize(buffers);
+
+    for(size_t i = 0; i < buffers; ++i) {
+        slots_[i].data = memory_.data() + i * buffer_size;
+        free_.push_back((unsigned)(buffers - 1 - i));
+    }
+
+    if(SetupRing()) return true;
+
+    // io_uring is not available, write buffers with pwrite threads
+    stop_ = false;
+
+    for(size_t i = 0; i < threads; ++i) {
+        threads_.push_back(std::thread(&uring_file::RunWriter, this));
+    }
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::SetupRing
+
+bool logger::uring_file::SetupRing() {
+
+#ifdef LOGGER_HAS_URING
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, (unsigned)slots_.size(), &params);
+
+    if(fd < 0) return false;
+
+    sq_size_   = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_   = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(cq_size_ > sq_size_) sq_size_ = cq_size_;
+        cq_size_ = 0;   // completion ring shares the mapping of the submission ring
+    }
+
+    sq_ptr_   = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cq_ptr_   = cq_size_ ? mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING) : sq_ptr_;
+    sqes_ptr_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    ring_fd_ = fd;
+
+    if(sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED || sqes_ptr_ == MAP_FAILED) {
+        TeardownRing();     // the buffer pool is kept for the pwrite threads
+        return false;
+    }
+
+    char* sq = (char*)sq_ptr_;
+    char* cq = (char*)cq_ptr_;
+
+    sq_tail_    = (unsigned*)(sq + params.sq_off.tail);
+    sq_mask_    = (unsigned*)(sq + params.sq_off.ring_mask);
+    sq_array_   = (unsigned*)(sq + params.sq_off.array);
+    cq_head_    = (unsigned*)(cq + params.cq_off.head);
+    cq_tail_    = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask_    = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes_       = cq + params.cq_off.cqes;
+
+
+    // buffers are pinned once instead of on every request
+    std::vector<struct iovec> iov(slots_.size());
+
+    for(size_t i = 0; i < slots_.size(); ++i) {
+        iov[i].iov_base = slots_[i].data;
+        iov[i].iov_len  = buffer_size_;
+    }
+
+    // fails if the buffers exceed RLIMIT_MEMLOCK
+    if(syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iov.data(), (unsigned)iov.size()) < 0) {
+        TeardownRing();     // the buffer pool is kept for the pwrite threads
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Teardown
+
+void logger::uring_file::Teardown() {
+
+    if(!threads_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_.notify_all();
+
+        for(size_t i = 0; i < threads_.size(); ++i) threads_[i].join();
+
+        threads_.clear();
+    }
+
+    TeardownRing();
+
+    memory_.clear();
+    slots_.clear();
+    free_.clear();
+    completed_.clear();
+    tasks_.clear();
+    current_       = -1;
+    buffer_size_   = 0;
+    threads_count_ = 0;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::TeardownRing
+
+void logger::uring_file::TeardownRing() {
+
+#ifdef LOGGER_HAS_URING
+    if(sqes_ptr_ && sqes_ptr_ != MAP_FAILED) munmap(sqes_ptr_, sqes_size_);
+    if(cq_size_ && cq_ptr_ && cq_ptr_ != MAP_FAILED) munmap(cq_ptr_, cq_size_);
+    if(sq_ptr_ && sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_size_);
+    if(ring_fd_ >= 0) close(ring_fd_);
+#endif
+
+    sq_ptr_ = cq_ptr_ = sqes_ptr_ = nullptr;
+    ring_fd_ = -1;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Append
+
+bool logger::uring_file::Append(const char* data, size_t n) {
+
+    while(n) {
+
+        if(current_ < 0 && !Acquire()) return false;
+
+        slot&  target = slots_[current_];
+        size_t part   = buffer_size_ - target.length;
+
+        if(part > n) part = n;
+
+        memcpy(target.data + target.length, data, part);
+
+        target.length += part;
+        data          += part;
+        n             -= part;
+
+        if(target.length == buffer_size_) {
+            Submit((unsigned)current_);
+            current_ = -1;
+        }
+    }
+
+    return !failed_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Acquire
+
+bool logger::uring_file::Acquire() {
+
+    Reap(false);
+
+    while(free_.empty()) {
+        // every buffer is in flight, make sure they are submitted and wait for one
+        if(!inflight_) return false;    // no buffers at all, nothing would ever return one
+        if(!Enter(to_submit_, 0) || !Reap(true)) return false;
+    }
+
+    current_ = (int)free_.back();
+    free_.pop_back();
+
+    slots_[current_].length  = 0;
+    slots_[current_].written = 0;
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Submit
+
+void logger::uring_file::Submit(unsigned index) {
+
+    slot& target = slots_[index];
+
+    if(target.written == 0) {   // not a retry of a short write
+        target.offset = offset_;
+        offset_      += (long long)target.length;
+        ++inflight_;
+    }
+
+#ifdef LOGGER_HAS_URING
+    if(ring_fd_ >= 0) {
+
+        unsigned tail = *sq_tail_;
+        unsigned i    = tail & *sq_mask_;
+
+        struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes_ptr_ + i;
+
+        memset(sqe, 0, sizeof(*sqe));
+
+        sqe->opcode    = IORING_OP_WRITE_FIXED;
+        sqe->fd        = fd_;
+        sqe->addr      = (unsigned long long)(target.data + target.written);
+        sqe->len       = (unsigned)(target.length - target.written);
+        sqe->off       = (unsigned long long)(target.offset + (long long)target.written);
+        sqe->buf_index = (unsigned short)index;
+        sqe->user_data = index;
+
+        sq_array_[i] = i;
+
+        std::atomic_thread_fence(std::memory_order_release);
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        // requests are submitted in batches of a half of the pool
+        if(++to_submit_ * 2 >= slots_.size()) Enter(to_submit_, 0);
+
+        return;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(index);
+    }
+    work_.notify_one();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Enter
+
+bool logger::uring_file::Enter(unsigned submit, unsigned wait) {
+
+#ifdef LOGGER_HAS_URING
+    if(ring_fd_ < 0) return true;
+
+    for(;;) {
+
+        long result = syscall(__NR_io_uring_enter, ring_fd_, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+        if(result >= 0) {
+            to_submit_ -= (unsigned)result < submit ? (unsigned)result : submit;
+            return true;
+        }
+
+        if(errno != EINTR) {
+            failed_ = true;
+            return false;
+        }
+    }
+#else
+    return true;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Reap
+
+bool logger::uring_file::Reap(bool wait) {
+
+#ifdef LOGGER_HAS_URING
+    if(ring_fd_ >= 0) {
+
+        for(;;) {
+
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+            if(head != tail) {
+
+                for(; head != tail; ++head) {
+
+                    struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes_ + (head & *cq_mask_);
+
+                    unsigned index  = (unsigned)cqe->user_data;
+                    long     result = (long)cqe->res;
+
+                    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);   // entry can be reused
+
+                    Complete(index, result);
+                }
+
+                return true;
+            }
+
+            if(!wait || inflight_ == 0) return true;
+
+            if(!Enter(to_submit_, 1)) return false;
+        }
+    }
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if(wait && inflight_ > 0) {
+        done_.wait(lock, [this]{ return !completed_.empty(); });
+    }
+
+    std::vector<std::pair<unsigned, long> > completed;
+
+    completed.swap(completed_);
+
+    lock.unlock();
+
+    for(size_t i = 0; i < completed.size(); ++i) {
+        Complete(completed[i].first, completed[i].second);
+    }
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Complete
+
+void logger::uring_file::Complete(unsigned index, long result) {
+
+    slot& target = slots_[index];
+
+    if(result < 0) {
+        failed_ = true;
+    } else {
+        target.written += (size_t)result;
+
+        if(result > 0 && target.written < target.length) {
+            Submit(index);  // short write, write the rest
+            return;
+        }
+
+        if(target.written < target.length) failed_ = true;
+    }
+
+    --inflight_;
+    Release(index);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Release
+
+void logger::uring_file::Release(unsigned index) {
+
+    free_.push_back(index);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::RunWriter
+
+void logger::uring_file::RunWriter() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for(;;) {
+
+        work_.wait(lock, [this]{ return stop_ || !tasks_.empty(); });
+
+        if(tasks_.empty()) return;
+
+        unsigned index = tasks_.front();
+        tasks_.pop_front();
+
+        slot& target = slots_[index];
+
+        lock.unlock();
+
+        long result;
+
+#ifdef OS_UNIX
+        do {
+            result = (long)pwrite(fd_, target.data + target.written, target.length - target.written, (off_t)(target.offset + (long long)target.written));
+        } while(result < 0 && errno == EINTR);
+#else
+        result = -1;
+#endif
+
+        lock.lock();
+
+        completed_.push_back(std::make_pair(index, result));
+        done_.notify_one();
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Flush
+
+bool logger::uring_file::Flush() {
+
+    if(current_ >= 0 && slots_[current_].length) {
+        Submit((unsigned)current_);
+        current_ = -1;
+    }
+
+    Enter(to_submit_, 0);
+
+    while(inflight_ > 0) {
+        if(!Reap(true)) break;
+    }
+
+    bool result = !failed_;
+
+    failed_ = false;
+
+    return result;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Close
+
+void logger::uring_file::Close() {
+
+    if(fd_ < 0) return;
+
+    Flush();
+
+    if(current_ >= 0) {
+        Release((unsigned)current_);
+        current_ = -1;
+    }
+
+#ifdef OS_UNIX
+    close(fd_);
+#endif
+
+    fd_ = -1;
+
+}
+
+#endif /* LOG_URING_HPP */
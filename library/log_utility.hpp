@@ -23,11 +23,15 @@
 #ifndef LOG_UTILITY_HPP
 #define LOG_UTILITY_HPP
 
+#include <stdio.h>          // snprintf
+#include <string.h>         // strlen, memcpy
 #include <cstddef>          // size_t
 #include <utility>          // std::move
 #include <string>           // std::string, std::to_string
-#include <queue>            // std::queue
-#include <sstream>          // std::stringstream
+#include <vector>           // std::vector
+#include <memory>           // std::unique_ptr
+#include <ostream>          // std::ostream
+#include <streambuf>        // std::streambuf
 
 #ifdef OS_WIN
 #include <windows.h>        //  DWORD, HANDLE, GetStdHandle, GetConsoleMode, SetConsoleMode
@@ -71,59 +75,183 @@ namespace logger {
     
     
     
-    // @function ProcessVars(queue)
+    // @struct var_buffer
     //
     //
-    // @param queue - std::queue<std::string>   : queue with processed variables
+    // @member data - std::string          : all variables converted to string one after another
+    // @member ends - std::vector<size_t>  : end of every variable in @data
     //
-    // @return void
+    // @method Clear()
+    //      @return void
     //
+    //      forget all variables but keep allocated memory
     //
-    // Does nothing
+    // @method Count()
+    //      @return size_t
+    //
+    //      number of variables
+    //
+    // @method Var(i) / Length(i)
+    //      @return const char* / size_t
+    //
+    //      text and length of variable @i
+    //
+    //
+    // variables of one log call, reused between calls so formatting does not allocate
+    
+    struct var_buffer {
+        
+        std::string         data;
+        std::vector<size_t> ends;
+        
+        void        Clear()                 { data.clear(); ends.clear(); }
+        size_t      Count()          const  { return ends.size(); }
+        const char* Var(size_t i)    const  { return data.data() + (i ? ends[i - 1] : 0); }
+        size_t      Length(size_t i) const  { return ends[i] - (i ? ends[i - 1] : 0); }
+        
+    };
+    
+    
+    
     
-    void ProcessVars(std::queue<std::string>*);
+    // @class var_stream
+    //
+    //
+    // @method Target(s)
+    //      @return std::ostream&
+    //
+    //      reset stream format and direct output to the end of string @s
+    //
+    //
+    // std::ostream that appends straight to a string,
+    // used for variables that have only operator<<
     
+    class var_stream : private std::streambuf {
+    public:
+        
+        var_stream() : stream_(this), target_(nullptr) {}
+        
+        std::ostream& Target(std::string*);
+        
+    private:
+        
+        int_type        overflow(int_type) override;
+        std::streamsize xsputn(const char*, std::streamsize) override;
+        
+        std::ostream    stream_;
+        std::string*    target_;
+        
+    };
     
     
     
     
     // template<T>
-    // @function ProcessVars(queue,var)
+    // @class thread_frame
+    //
+    //
+    // @method operator* / operator->
+    //      @return T& / T*
+    //
+    //      object owned by current thread for the lifetime of the frame
+    //
+    //
+    // gives every thread a reusable T, nested frames (e.g. a log call inside operator<<
+    // of a logged variable) get their own object so they never overwrite each other
+    
+    template <class T>
+    class thread_frame {
+    public:
+        
+        thread_frame();
+        ~thread_frame() { --Depth(); }
+        
+        thread_frame(const thread_frame&) = delete;
+        thread_frame& operator=(const thread_frame&) = delete;
+        
+        T& operator*()  const { return *value_; }
+        T* operator->() const { return value_; }
+        
+    private:
+        
+        static size_t&                          Depth();
+        static std::vector<std::unique_ptr<T> >& Pool();
+        
+        T* value_;
+        
+    };
+    
+    
+    
+    
+    // @function AppendVar(s, var)
     //
     //
-    // @param queue - std::queue<std::string>   : queue with processed variables
-    // @param var   - T                         : current processed value
+    // @param s   - std::string& : target string
+    // @param var - T            : variable to convert
     //
     // @return void
     //
     //
-    // create a stringstream and pass @var to it
-    // then push string to the @queue
+    // append @var to @s the same way operator<< of std::ostream would do it
+    // numbers, characters and strings are converted without std::ostream
+    
+    void AppendVar(std::string&, bool);
+    void AppendVar(std::string&, char);
+    void AppendVar(std::string&, signed char);
+    void AppendVar(std::string&, unsigned char);
+    void AppendVar(std::string&, short);
+    void AppendVar(std::string&, unsigned short);
+    void AppendVar(std::string&, int);
+    void AppendVar(std::string&, unsigned int);
+    void AppendVar(std::string&, long);
+    void AppendVar(std::string&, unsigned long);
+    void AppendVar(std::string&, long long);
+    void AppendVar(std::string&, unsigned long long);
+    void AppendVar(std::string&, float);
+    void AppendVar(std::string&, double);
+    void AppendVar(std::string&, long double);
+    void AppendVar(std::string&, const char*);
+    void AppendVar(std::string&, const std::string&);
     
     template <class T>
-    void ProcessVars(std::queue<std::string>*, const T&);
+    void AppendVar(std::string&, const T&);
+    
+    
+    
+    
+    // @function ProcessVars(buffer)
+    //
+    //
+    // @param buffer - logger::var_buffer*  : buffer with processed variables
+    //
+    // @return void
+    //
+    //
+    // Does nothing
+    
+    void ProcessVars(var_buffer*);
     
     
     
     
     
     // template<T>
-    // @function ProcessVars(queue,var,args)
+    // @function ProcessVars(buffer,var,args)
     //
     //
-    // @param queue - std::queue<std::string>   : queue with processed variables
-    // @param var   - T                         : current processed value
-    // @param args  - pack                      : variables
+    // @param buffer - logger::var_buffer*  : buffer with processed variables
+    // @param var    - T                    : current processed value
+    // @param args   - pack                 : variables
     //
     // @return void
     //
     //
-    // create a stringstream and pass @var to it
-    // then push string to the @queue
+    // append @var to the @buffer as a new variable
     // pass args recursively
     
     template <class T, class ...Args>
-    void ProcessVars(std::queue<std::string>*, const T&, const Args&...);
+    void ProcessVars(var_buffer*, const T&, const Args&...);
     
 }
 
@@ -145,9 +273,19 @@ std::string logger::StrToLen(std::string &&s, size_t len, char fill) {
 
 
 // @Implementation of
-//  logger::ProcessVars
+//  logger::var_stream::Target
 
-void logger::ProcessVars(std::queue<std::string>* queue) {
+std::ostream& logger::var_stream::Target(std::string* s) {
+    
+    target_ = s;
+    
+    stream_.clear();
+    stream_.flags(std::ios_base::dec | std::ios_base::skipws);
+    stream_.precision(6);
+    stream_.width(0);
+    stream_.fill(' ');
+    
+    return stream_;
     
 }
 
@@ -155,16 +293,225 @@ void logger::ProcessVars(std::queue<std::string>* queue) {
 
 
 // @Implementation of
-//  logger::ProcessVars
+//  logger::var_stream::overflow
+
+std::streambuf::int_type logger::var_stream::overflow(int_type c) {
+    
+    if(!traits_type::eq_int_type(c, traits_type::eof())) {
+        target_->push_back(traits_type::to_char_type(c));
+    }
+    
+    return traits_type::not_eof(c);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::var_stream::xsputn
+
+std::streamsize logger::var_stream::xsputn(const char* s, std::streamsize n) {
+    
+    target_->append(s, (size_t)n);
+    
+    return n;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::thread_frame::thread_frame
+
+template <class T>
+logger::thread_frame<T>::thread_frame() {
+    
+    size_t depth = Depth()++;
+    
+    std::vector<std::unique_ptr<T> >& pool = Pool();
+    
+    if(pool.size() <= depth) {
+        pool.emplace_back(new T());
+    }
+    
+    value_ = pool[depth].get();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::thread_frame::Depth
 
 template <class T>
-void logger::ProcessVars(std::queue<std::string>* queue, const T& var) {
+size_t& logger::thread_frame<T>::Depth() {
+    
+    static thread_local size_t depth = 0;
+    
+    return depth;
     
-    std::stringstream ss;
+}
+
+
+
+
+// @Implementation of
+//  logger::thread_frame::Pool
+
+template <class T>
+std::vector<std::unique_ptr<T> >& logger::thread_frame<T>::Pool() {
     
-    ss << var;
+    static thread_local std::vector<std::unique_ptr<T> > pool;
     
-    queue->push(ss.str()); // copy elision
+    return pool;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, unsigned long long var) {
+    
+    static const char digits[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    
+    char  buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p   = end;
+    
+    while(var >= 100) {
+        size_t i = (size_t)(var % 100) * 2;
+        var /= 100;
+        *--p = digits[i + 1];
+        *--p = digits[i];
+    }
+    
+    if(var >= 10) {
+        size_t i = (size_t)var * 2;
+        *--p = digits[i + 1];
+        *--p = digits[i];
+    } else {
+        *--p = (char)('0' + var);
+    }
+    
+    s.append(p, (size_t)(end - p));
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, long long var) {
+    
+    if(var < 0) {
+        s += '-';
+        logger::AppendVar(s, 0ULL - (unsigned long long)var);
+        return;
+    }
+    
+    logger::AppendVar(s, (unsigned long long)var);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, bool var)                { s += var ? '1' : '0'; }
+void logger::AppendVar(std::string& s, char var)                { s += var; }
+void logger::AppendVar(std::string& s, signed char var)         { s += (char)var; }
+void logger::AppendVar(std::string& s, unsigned char var)       { s += (char)var; }
+void logger::AppendVar(std::string& s, short var)               { logger::AppendVar(s, (long long)var); }
+void logger::AppendVar(std::string& s, unsigned short var)      { logger::AppendVar(s, (unsigned long long)var); }
+void logger::AppendVar(std::string& s, int var)                 { logger::AppendVar(s, (long long)var); }
+void logger::AppendVar(std::string& s, unsigned int var)        { logger::AppendVar(s, (unsigned long long)var); }
+void logger::AppendVar(std::string& s, long var)                { logger::AppendVar(s, (long long)var); }
+void logger::AppendVar(std::string& s, unsigned long var)       { logger::AppendVar(s, (unsigned long long)var); }
+void logger::AppendVar(std::string& s, const std::string& var)  { s += var; }
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, const char* var) {
+    
+    if(var) s.append(var, strlen(var)); // std::ostream puts nothing for null pointer
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, float var) {
+    
+    logger::AppendVar(s, (double)var);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, double var) {
+    
+    char buffer[32];
+    
+    int n = snprintf(buffer, sizeof(buffer), "%g", var);    // std::ostream default format
+    
+    s.append(buffer, n > 0 ? (size_t)n : 0);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, long double var) {
+    
+    char buffer[48];
+    
+    int n = snprintf(buffer, sizeof(buffer), "%Lg", var);   // std::ostream default format
+    
+    s.append(buffer, n > 0 ? (size_t)n : 0);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+template <class T>
+void logger::AppendVar(std::string& s, const T& var) {
+    
+    logger::thread_frame<logger::var_stream> stream;
+    
+    stream->Target(&s) << var;
     
 }
 
@@ -174,16 +521,24 @@ void logger::ProcessVars(std::queue<std::string>* queue, const T& var) {
 // @Implementation of
 //  logger::ProcessVars
 
-template <class T, class ...Args>
-void logger::ProcessVars(std::queue<std::string>* queue, const T& var, const Args&... args) {
+void logger::ProcessVars(logger::var_buffer* buffer) {
     
-    std::stringstream ss;
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessVars
+
+template <class T, class ...Args>
+void logger::ProcessVars(logger::var_buffer* buffer, const T& var, const Args&... args) {
     
-    ss << var;
+    logger::AppendVar(buffer->data, var);
     
-    queue->push(ss.str()); // copy elision
+    buffer->ends.push_back(buffer->data.length());
     
-    ProcessVars(queue,args...);
+    ProcessVars(buffer, args...);
     
 }
 
@@ -22,45 +22,24 @@
 
 // This is full log library in one file ready to use
 // Just include it
+// Generated from library/ by tools/amalgamate.cpp, do not edit
 
 #ifndef LOG_HPP
 #define LOG_HPP
 
-#if defined(_WIN32) | defined(_WIN64)
-#include <windows.h>                    //  DWORD, HANDLE, GetStdHandle, GetConsoleMode, SetConsoleMode, WIN32_FIND_DATA, HANDLE, CreateDirectory
-#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
-#define OS_WIN
-#else
-#include <sys/stat.h>                   // stat
-#include <unistd.h>                     // mkdir
-#define OS_UNIX
-#endif
 
-#include <string.h>                     // strrchr
-#include <time.h>                       // time, localtime
-#include <unordered_map>                // std::unordered_map
-#include <cstddef>                      // size_t
-#include <string>                       // std::string, std::to_string
-#include <vector>                       // std::vector
-#include <stack>                        // std::stack
-#include <queue>                        // std::queue
-#include <exception>                    // std::exception
-#include <utility>                      // std::move
-#include <iostream>                     // std::cout
-#include <sstream>                      // std::stringstream
-#include <fstream>                      // std::ofstream
 
-#define __FILENAME__ (strrchr("/" __FILE__, '/') + 1)
 
-namespace logger {
-    typedef enum : unsigned char {
-        T_WARNING,
-        T_DEBUG,
-        T_INFO,
-        T_ERROR,
-        T_CRITICAL
-    } log_message_type;
+// log_console_modifiers.hpp
+
+#ifndef LOG_CONSOLE_MODIFIERS_HPP
+#define LOG_CONSOLE_MODIFIERS_HPP
+
+#include <sstream>  // std::stringstream
+#include <vector>   // std::vector
 
+namespace logger {
+    
     typedef enum : unsigned char {
         RESET               =       0,
         BOLD                =       1,
@@ -105,914 +84,9966 @@ namespace logger {
         BG_WHITE            =      47,
         BG_DEFAULT          =      49
     } kModifier;
+    
+};
 
-    template < class CharT, class Traits >
-    std::basic_ostream<CharT, Traits>&
-    operator<<(std::basic_ostream<CharT, Traits>& os,
-               const logger::kModifier& x) {
-        os << "\033[" << static_cast<int>(x) << "m";
-        return os;
-    }
+template < class CharT, class Traits >
+std::basic_ostream<CharT, Traits>& operator<<( std::basic_ostream<CharT, Traits>& os, const logger::kModifier& x ) {
+    os << "\033[" << (int)x << "m";
+    return os;
+}
 
-    template < class CharT, class Traits >
-    std::basic_ostream<CharT, Traits>&
-    operator<<(std::basic_ostream<CharT, Traits>& os,
-               const std::vector<logger::kModifier>& x) {
-        if (x.size() == 0) return os;
-        size_t n = x.size();
-        os << "\033[";
-        for (size_t i = 0; i < n - 1; ++i) {
-            os << static_cast<int>(x[i]) << ';';
-        }
-        os << static_cast<int>(x.back()) << 'm';
-        return os;
+template < class CharT, class Traits >
+std::basic_ostream<CharT, Traits>& operator<<( std::basic_ostream<CharT, Traits>& os,const std::vector<logger::kModifier>& x ) {
+    if(x.size() == 0) return os;
+    
+    size_t n = x.size();
+    
+    os << "\033[";
+    
+    for(size_t i = 0; i < n - 1; ++i) {
+        os << (int)x[i] << ';';
     }
+    os << (int)x.back() << 'm';
+    
+    return os;
+}
+
+#endif /* LOG_CONSOLE_MODIFIERS_HPP */
+
+
+
+
+// log_style.hpp
+
+#ifndef LOG_STYLE_HPP
+#define LOG_STYLE_HPP
+
+#include <string.h>                     // memcmp
+#include <cstddef>                      // size_t
+#include <string>                       // std::string
+#include <vector>                       // std::vector
+#include <atomic>                       // std::atomic
+#include <mutex>                        // std::mutex, std::lock_guard
+
+#if __cplusplus >= 201703L
+#include <string_view>                  // std::string_view
+#endif
 
-    // @struct error
-    //
-    //
-    // @member message - std::string : information about the error
-    //
-    // @constructor error(const char*) : construct object from const C-string
-    // @constructor error(std::string) : construct object from std::string
-    //
-    //
-    // @method what()
-    //     @return const char*
-    //
-    //     return null terminating string containing information about the error
-    //
-    // @method push()
-    //      @return void
-    //
-    //      Pushes information to the error stack
-    //
-    //
-    // structure for holding errors that ConsoleLog throws
-    struct error : std::exception {
-        error() {}
-        explicit error(const char* s) : message_(s) {}
-        explicit error(std::string s) : message_(std::move(s)) {}
-        virtual const char* what() const noexcept override {
-            return message_.c_str();
-        }
-        void push(const char* path, const char* func, int line) {
-            error_stack_.push(
-                              std::string(path) + ':' +
-                              std::string(func) + ':' +
-                              std::to_string(line));
-        }
-        std::stack<std::string> error_stack_;
-        std::string             message_;
-    };
+
+namespace logger {
 
     // @typedef style
     //
     //
     // structure for holding modifiers that applied to elements with this style
+
     typedef std::vector<kModifier> style;
 
-    // @member binded_styles_
-    //
-    // hash table that contains correspondence between styles and it names
-    std::unordered_map<std::string, style> binded_styles;
 
-    // @member log_directory_
-    //
-    // string with path to logging directory
-    std::string log_directory_;
 
-    // @function BindConsoleStyle(s,...)
-    //
-    //
-    // @param s    - std::string : name of style (should be unique)
-    // @param ...  - modifiers that will be applied to that style
-    //
-    // @return bool
-    //
-    //
-    // set correspondence between style and it name
-    // and return true if everything fine and false otherwise
-    template <class ...Args>
-    bool BindConsoleStyle(std::string, Args...);
 
-    // @function BindLogDirectory
+    // @typedef sgr_state
     //
     //
-    // @param s - const char* : relative or full path to log directory
-    //
-    // @return void
-    //
-    //
-    // Set the logging directory to @s
-    void BindLogDirectory(const char*);
+    // attributes of the terminal packed into one integer:
+    // bits 0-7 - foreground color code, bits 8-15 - background color code (0 - default color),
+    // bits 16-24 - SGR_BOLD ... SGR_CROSSED
+    // 0 is the state after RESET
 
-#ifdef OS_WIN
-    // @function EnableWindowsAnsiEscapeSequence()
-    //
-    //
-    // @return void
-    //
-    // @throw logger::error
-    //
-    //
-    // enables ansi escape sequence on windows platform
-    // throws logger::error if there were errors
-    // with windows console
-    void EnableWindowsAnsiEscapeSequence();
-#endif
+    typedef unsigned sgr_state;
 
-    // @function StrToLen(a,b,c)
-    //
+    enum : unsigned {
+        SGR_BOLD        = 1u << 16,
+        SGR_FAINT       = 1u << 17,
+        SGR_ITALIC      = 1u << 18,
+        SGR_UNDERLINE   = 1u << 19,
+        SGR_SLOW_BLINK  = 1u << 20,
+        SGR_RAPID_BLINK = 1u << 21,
+        SGR_INVERSE     = 1u << 22,
+        SGR_CONCEAL     = 1u << 23,
+        SGR_CROSSED     = 1u << 24,
+        SGR_FG          = 0xffu,
+        SGR_BG          = 0xffu << 8
+    };
+
+
+
+
+    // @struct sgr_change
     //
-    // @param a - std::string&& : target string
-    // @param b - size_t        : target length
-    // @param c - char          : fill character
     //
-    // @return std::string
+    // @member reset - bool      : state is reset before the change
+    // @member set   - sgr_state : attributes and colors that are set
+    // @member clear - sgr_state : attributes and colors that are cleared before @set is applied
     //
     //
-    // move string @a
-    // and add (@b - Length(@a)) symbols that equals @c to the front
-    // if Length(@a) is at least @b, return @a without changes
-    std::string StrToLen(std::string&&, size_t, char);
+    // modifiers of a style folded into one change of logger::sgr_state
 
-    // @function ProcessVars(queue)
-    //
+    struct sgr_change {
+        bool        reset;
+        sgr_state   set;
+        sgr_state   clear;
+    };
+
+
+
+
+    // @struct bound_style
     //
-    // @param queue - std::queue<std::string>   : queue with processed variables
     //
-    // @return void
+    // @member id       - unsigned           : number of the style, styles are numbered from 0 in order of binding
+    // @member name     - std::string        : name of the style
+    // @member change   - logger::sgr_change : what the style does to the state of the terminal
     //
     //
-    // Does nothing
-    void ProcessVars(std::queue<std::string>*);
+    // style folded once when it is bound, never changes or moves afterwards,
+    // escape sequences are written by logger::AppendSgr from the state the style leads to
 
-    // template<T>
-    // @function ProcessVars(queue,var)
-    //
+    struct bound_style {
+        unsigned        id;
+        std::string     name;
+        sgr_change      change;
+    };
+
+
+
+
+    // @struct style_table
     //
-    // @param queue - std::queue<std::string>   : queue with processed variables
-    // @param var   - T                         : current processed value
     //
-    // @return void
+    // @member styles - std::vector<const logger::bound_style*> : bound styles indexed by id
+    // @member slots  - std::vector<unsigned>                   : open addressing index by name hash,
+    //                                                            id + 1 of the style, 0 - empty slot
     //
     //
-    // create a stringstream and pass @var to it
-    // then push string to the @queue
-    template <class T>
-    void ProcessVars(std::queue<std::string>*, const T&);
+    // immutable snapshot of bound styles, binding a style publishes a new snapshot
 
-    // template<T>
-    // @function ProcessVars(queue,var,args)
-    //
-    //
-    // @param queue - std::queue<std::string>   : queue with processed variables
-    // @param var   - T                         : current processed value
-    // @param args  - pack                      : variables
+    struct style_table {
+        std::vector<const bound_style*> styles;
+        std::vector<unsigned>           slots;
+    };
+
+
+
+
+    // @member style_table_
     //
-    // @return void
+    // latest snapshot, read without locks
+    // replaced snapshots are kept until exit as readers may still use them,
+    // styles are bound a few times per program so they take little memory
+
+    std::atomic<const style_table*> style_table_(nullptr);
+
+
+
+
+    // @member style_mutex_
     //
+    // serializes binding of styles
+
+    std::mutex style_mutex_;
+
+
+
+
+    // @member retired_styles_
     //
-    // create a stringstream and pass @var to it
-    // then push string to the @queue
-    // pass args recursively
-    template <class T, class ...Args>
-    void ProcessVars(std::queue<std::string>*, const T&, const Args&...);
+    // every published snapshot and style, owned until exit
 
-    // @function Trace(error, path, func, line)
+    struct style_storage {
+        std::vector<const style_table*> tables;
+        std::vector<const bound_style*> styles;
+
+        ~style_storage() {
+            for(size_t i = 0; i < tables.size(); ++i) delete tables[i];
+            for(size_t i = 0; i < styles.size(); ++i) delete styles[i];
+        }
+    } retired_styles_;
+
+
+
+
+    // @function BindStyle(name, modifiers)
     //
     //
-    // @param error - logger::error& : error to trace
-    // @param path  - const char*    : path to current file
-    // @param func  - const char*    : function name
-    // @param line  - int            : line number
+    // @param name      - const std::string&    : name of style (should be unique)
+    // @param modifiers - const logger::style&  : modifiers that will be applied to that style
     //
-    // @return logger::error&
+    // @return bool
     //
     //
-    // Push to error's stack information about current place
-    // and then return error
-    error& Trace(error&, const char*, const char*, int);
+    // render the escape sequence of @modifiers and publish it under @name
+    // return false if a style with such name is already bound
 
-    // @function Trace(error, path, func, line)
+    bool BindStyle(const std::string&, const style&);
+
+
+
+
+    // @function FindStyle(name, n)
     //
     //
-    // @param error - logger::error&& : error to trace
-    // @param path  - const char*    : path to current file
-    // @param func  - const char*    : function name
-    // @param line  - int            : line number
+    // @param name - const char* : name of style, not null terminated
+    // @param n    - size_t      : length of @name
     //
-    // @return logger::error
+    // @return const logger::bound_style*
     //
     //
-    // Creates new error
-    // push to error's stack information about current place
-    // and then return error
-    error Trace(error&&, const char*, const char*, int);
+    // return bound style with such name or nullptr, never allocates or locks
 
-    // @function ConsoleLog(default args, s, args)
-    //
+    const bound_style* FindStyle(const char*, size_t);
+
+#if __cplusplus >= 201703L
+    inline const bound_style* FindStyle(std::string_view name) { return FindStyle(name.data(), name.size()); }
+#endif
+
+
+
+
+    // @function FindStyle(id)
     //
-    // @param default args
-    // set of arguments that define macro information
-    // @param s    - std::string/const char*
-    // string that will be parsed
-    // @param args - pack
-    // variables that will be put instead of "%v" in target string
     //
-    // @return bool
+    // @param id - unsigned : id of style
     //
-    // @throw logger::error
+    // @return const logger::bound_style*
     //
     //
-    // parse string @s in accoring to defined rules
-    // and pass it to std::cout(console output).
-    // if some error occurs, throws logger::error with information about error
-    // return true if everything ok
-    // and false if there were errors with console output
-    template <class ...Args>
-    bool ConsoleLog(const char*,
-                    const char*,
-                    int,
-                    const char*,
-                    const std::string&,
-                    const Args&...);
+    // return bound style with such id or nullptr
 
-    // @function ConsoleLog(error)
+    const bound_style* FindStyle(unsigned);
+
+
+
+
+    // @function FoldModifiers(modifiers)
     //
     //
-    // @param error - const logger::error& : error
+    // @param modifiers - const logger::style& : modifiers in the order they are applied
     //
-    // @return bool
+    // @return logger::sgr_change
+
+    sgr_change FoldModifiers(const style&);
+
+
+
+
+    // @function ApplyStyle(state, style)
     //
-    // @throw logger::error
     //
+    // @param state - logger::sgr_state           : current state
+    // @param style - const logger::bound_style&  : style applied on top of @state
     //
-    // output error's stack to the console
-    // if some error occurs, throws logger::error with information about error
-    // return true if everything ok
-    // and false if there were errors with console output
-    bool ConsoleLog(const char*,
-                    const char*,
-                    int,
-                    const char*,
-                    error&);
+    // @return logger::sgr_state
 
-    // @function FileLog(default args, s, args)
-    //
+    inline sgr_state ApplyStyle(sgr_state state, const bound_style& style) {
+        return ((style.change.reset ? 0 : state) & ~style.change.clear) | style.change.set;
+    }
+
+
+
+
+    // @function AppendSgr(s, from, to)
     //
-    // @param default args
-    // set of arguments that define macro information
-    // @param TYPE - logger::log_message_type
-    // type of message
-    // @param args - pack
-    // variables that will be logged
     //
-    // @return bool
+    // @param s    - std::string&      : target string
+    // @param from - logger::sgr_state : state of the terminal
+    // @param to   - logger::sgr_state : wanted state
     //
-    // @throw logger::error
+    // @return void
     //
     //
-    // Put every arg in new line of log file
-    // if some error occurs, throws logger::error with information about error
-    // return true if everything ok
-    // and false if there were errors with console output
-    template <class ...Args>
-    bool FileLog(const char*,
-                 const char*,
-                 int,
-                 const char*,
-                 log_message_type,
-                 Args...);
+    // append one escape sequence with the fewest codes that turns @from into @to:
+    // codes of changed attributes only, or RESET followed by the whole @to if that is shorter
+    // nothing is appended if the states are equal
 
-    // @function FileLog(error)
-    //
-    //
-    // @param error - const logger::error& : error
-    //
-    // @return bool
+    void AppendSgr(std::string&, sgr_state, sgr_state);
+
+
+
+
+    // @function StyleHash(name, n)
     //
-    // @throw logger::error
     //
+    // @param name - const char* : name of style
+    // @param n    - size_t      : length of @name
     //
-    // output error's stack to the log file
-    // if some error occurs, throws logger::error with information about error
-    // return true if everything ok
-    // and false if there were errors with file output
-    bool FileLog(const char*, const char*, int, const char*, error&);
-}   // namespace logger
+    // @return size_t
+
+    size_t StyleHash(const char*, size_t);
 
-// @Implementation of
-//  logger::BindConsoleStyle
-template <class ...Args>
-bool logger::BindConsoleStyle(std::string s, Args... args) {
-    return binded_styles.emplace(std::make_pair(std::move(s),
-                                                style({args...}))).second;
 }
 
+
+
+
 // @Implementation of
-//  logger::BindLogFile
-void logger::BindLogDirectory(const char* s) {
-#ifdef OS_UNIX
-    struct stat st = {0};   // structure for holding stat
-    if (stat(s, &st) == -1) {
-        throw logger::error("path is invalid");
+//  logger::StyleHash
+
+size_t logger::StyleHash(const char* name, size_t n) {
+
+    size_t hash = 14695981039346656037ULL & (size_t)-1;    // FNV-1a
+
+    for(size_t i = 0; i < n; ++i) {
+        hash = (hash ^ (unsigned char)name[i]) * (size_t)1099511628211ULL;
+    }
+
+    return hash;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::BindStyle
+
+bool logger::BindStyle(const std::string& name, const logger::style& modifiers) {
+
+    std::lock_guard<std::mutex> lock(logger::style_mutex_);
+
+    if(logger::FindStyle(name.data(), name.length())) return false;
+
+
+    logger::bound_style* style = new logger::bound_style;
+
+    style->name   = name;
+    style->change = logger::FoldModifiers(modifiers);
+
+    logger::retired_styles_.styles.push_back(style);
+
+
+    const logger::style_table* old   = logger::style_table_.load(std::memory_order_relaxed);
+    logger::style_table*       table = new logger::style_table;
+
+    if(old) table->styles = old->styles;
+
+    style->id = (unsigned)table->styles.size();
+    table->styles.push_back(style);
+
+
+    // index is at most half full
+    size_t capacity = 8;
+
+    while(capacity < table->styles.size() * 2) capacity *= 2;
+
+    table->slots.assign(capacity, 0);
+
+    for(size_t i = 0; i < table->styles.size(); ++i) {
+
+        const std::string& s    = table->styles[i]->name;
+        size_t             slot = logger::StyleHash(s.data(), s.length()) & (capacity - 1);
+
+        while(table->slots[slot]) slot = (slot + 1) & (capacity - 1);
+
+        table->slots[slot] = (unsigned)i + 1;
+    }
+
+    logger::retired_styles_.tables.push_back(table);
+    logger::style_table_.store(table, std::memory_order_release);
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FindStyle
+
+const logger::bound_style* logger::FindStyle(const char* name, size_t n) {
+
+    const logger::style_table* table = logger::style_table_.load(std::memory_order_acquire);
+
+    if(!table) return nullptr;
+
+    size_t mask = table->slots.size() - 1;
+
+    for(size_t slot = logger::StyleHash(name, n) & mask; table->slots[slot]; slot = (slot + 1) & mask) {
+
+        const logger::bound_style* style = table->styles[table->slots[slot] - 1];
+
+        if(style->name.length() == n && memcmp(style->name.data(), name, n) == 0) return style;
+    }
+
+    return nullptr;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FindStyle
+
+const logger::bound_style* logger::FindStyle(unsigned id) {
+
+    const logger::style_table* table = logger::style_table_.load(std::memory_order_acquire);
+
+    if(!table || id >= table->styles.size()) return nullptr;
+
+    return table->styles[id];
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FoldModifiers
+
+logger::sgr_change logger::FoldModifiers(const logger::style& modifiers) {
+
+    logger::sgr_change change = { false, 0, 0 };
+
+    for(size_t i = 0; i < modifiers.size(); ++i) {
+
+        unsigned  code = modifiers[i];
+        sgr_state on   = 0;     // attribute or color the modifier sets
+        sgr_state off  = 0;     // attributes or colors the modifier clears
+
+        switch(code) {
+            case logger::RESET:         change.reset = true; change.set = 0; change.clear = 0; continue;
+            case logger::BOLD:          on  = logger::SGR_BOLD;         break;
+            case logger::FAINT:         on  = logger::SGR_FAINT;        break;
+            case logger::ITALIC:        on  = logger::SGR_ITALIC;       break;
+            case logger::UNDERLINE:     on  = logger::SGR_UNDERLINE;    break;
+            case logger::SLOW_BLINK:    on  = logger::SGR_SLOW_BLINK;   break;
+            case logger::RAPID_BLINK:   on  = logger::SGR_RAPID_BLINK;  break;
+            case logger::INVERSE:       on  = logger::SGR_INVERSE;      break;
+            case logger::CONCEAL:       on  = logger::SGR_CONCEAL;      break;
+            case logger::CROSSED:       on  = logger::SGR_CROSSED;      break;
+            case logger::BOLD_OFF:      off = logger::SGR_BOLD;         break;
+            case logger::UNDERLINE_OFF: off = logger::SGR_UNDERLINE;    break;
+            case logger::BLINK_OFF:     off = logger::SGR_SLOW_BLINK | logger::SGR_RAPID_BLINK; break;
+            case logger::INVERSE_OFF:   off = logger::SGR_INVERSE;      break;
+            case logger::REVEAL:        off = logger::SGR_CONCEAL;      break;
+            case logger::CROSSED_OFF:   off = logger::SGR_CROSSED;      break;
+            case logger::FG_DEFAULT:    off = logger::SGR_FG;           break;
+            case logger::BG_DEFAULT:    off = logger::SGR_BG;           break;
+            default:
+                if((code >= 30 && code <= 37) || (code >= 90 && code <= 97)) {
+                    off = logger::SGR_FG;
+                    on  = code;
+                }
+                else if(code >= 40 && code <= 47) {
+                    off = logger::SGR_BG;
+                    on  = code << 8;
+                }
+                break;
+        }
+
+        change.set    = (change.set & ~off) | on;
+        change.clear |= off;
+    }
+
+    return change;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendSgr
+
+void logger::AppendSgr(std::string& s, logger::sgr_state from, logger::sgr_state to) {
+
+    if(from == to) return;
+
+    static const struct { sgr_state flag; unsigned char on, off; } attributes[] = {
+        { logger::SGR_ITALIC,    3, 23 },
+        { logger::SGR_UNDERLINE, 4, 24 },
+        { logger::SGR_INVERSE,   7, 27 },
+        { logger::SGR_CONCEAL,   8, 28 },
+        { logger::SGR_CROSSED,   9, 29 }
+    };
+
+    unsigned char changed[16];  // codes that change only what differs
+    unsigned char full[16];     // RESET and the whole @to
+    size_t        n = 0;
+    size_t        m = 0;
+
+    full[m++] = 0;
+
+
+    // 22 turns off both bold and faint, 25 both blinks
+    sgr_state   state  = from;
+    const struct { sgr_state flags; unsigned char off; } groups[] = {
+        { logger::SGR_BOLD | logger::SGR_FAINT, 22 },
+        { logger::SGR_SLOW_BLINK | logger::SGR_RAPID_BLINK, 25 }
+    };
+
+    for(size_t i = 0; i < 2; ++i) {
+        if(state & ~to & groups[i].flags) {
+            changed[n++] = groups[i].off;
+            state &= ~groups[i].flags;
+        }
+    }
+
+    const struct { sgr_state flag; unsigned char on; } grouped[] = {
+        { logger::SGR_BOLD, 1 }, { logger::SGR_FAINT, 2 }, { logger::SGR_SLOW_BLINK, 5 }, { logger::SGR_RAPID_BLINK, 6 }
+    };
+
+    for(size_t i = 0; i < 4; ++i) {
+        if(to & grouped[i].flag) {
+            if(!(state & grouped[i].flag)) changed[n++] = grouped[i].on;
+            full[m++] = grouped[i].on;
+        }
+    }
+
+    for(size_t i = 0; i < sizeof(attributes) / sizeof(attributes[0]); ++i) {
+
+        if((state ^ to) & attributes[i].flag) {
+            changed[n++] = to & attributes[i].flag ? attributes[i].on : attributes[i].off;
+        }
+
+        if(to & attributes[i].flag) full[m++] = attributes[i].on;
+    }
+
+    if((state ^ to) & logger::SGR_FG) changed[n++] = (unsigned char)(to & logger::SGR_FG ? to & logger::SGR_FG : 39);
+    if((state ^ to) & logger::SGR_BG) changed[n++] = (unsigned char)(to & logger::SGR_BG ? (to & logger::SGR_BG) >> 8 : 49);
+
+    if(to & logger::SGR_FG) full[m++] = (unsigned char)(to & logger::SGR_FG);
+    if(to & logger::SGR_BG) full[m++] = (unsigned char)((to & logger::SGR_BG) >> 8);
+
+
+    const unsigned char* codes = m < n ? full : changed;
+    size_t               count = m < n ? m : n;
+
+    s.append("\033[");
+
+    for(size_t i = 0; i < count; ++i) {
+
+        unsigned code = codes[i];
+
+        if(code >= 100) s += (char)('0' + code / 100);
+        if(code >= 10)  s += (char)('0' + code / 10 % 10);
+
+        s += (char)('0' + code % 10);
+        s += i + 1 < count ? ';' : 'm';
     }
-#endif  // OS_UNIX
+
+}
+
+#endif /* LOG_STYLE_HPP */
+
+
+
+
+// log_error.hpp
+
+#ifndef LOG_ERROR_HPP
+#define LOG_ERROR_HPP
+
+#include <utility>          // std::move
+#include <exception>        // std::exception
+#include <string>           // std::string
+#include <stack>            // std::stack
+
+namespace logger {
+    
+    // @struct error
+    //
+    //
+    // @member message - std::string : string containing information about the error
+    //
+    // @constructor error(const char*) : construct object from const C-string
+    // @constructor error(std::string) : construct object from std::string
+    //
+    //
+    // @method what()
+    //     @return const char*
+    //
+    //     return null terminating string containing information about the error
+    //
+    // @method push()
+    //      @return void
+    //
+    //      Pushes information to the error stack
+    //
+    //
+    // structure for holding errors that ConsoleLog throws
+    
+    struct error : std::exception {
+        
+        error(){}
+        error(const char* s)    : message_(s) {}
+        error(std::string s)  : message_(std::move(s)) {}
+        
+        virtual const char* what() const noexcept override { return message_.c_str(); }
+        
+        void push(const char* path, const char* func, int line) {
+            error_stack_.push(std::string(path) + ':' + std::string(func) + ':' + std::to_string(line));
+        }
+        
+        std::stack<std::string> error_stack_;
+        std::string             message_;
+        
+    };
+    
+}
+
+#endif /* LOG_ERROR_HPP */
+
+
+
+
+// log_utility.hpp
+
+#ifndef LOG_UTILITY_HPP
+#define LOG_UTILITY_HPP
+
+#include <stdio.h>          // snprintf
+#include <string.h>         // strlen, memcpy
+#include <cstddef>          // size_t
+#include <utility>          // std::move
+#include <string>           // std::string, std::to_string
+#include <vector>           // std::vector
+#include <memory>           // std::unique_ptr
+#include <ostream>          // std::ostream
+#include <streambuf>        // std::streambuf
+
 #ifdef OS_WIN
-    WIN32_FIND_DATA data;
-    HANDLE hFile = FindFirstFile(s, &data);
-    if (hFile == INVALID_HANDLE_VALUE)  // directory doesn't exist
-        throw logger::error("path is invalid");
-#endif  // OS_WIN
-    logger::log_directory_ = s;
+#include <windows.h>        //  DWORD, HANDLE, GetStdHandle, GetConsoleMode, SetConsoleMode
+#endif
+
+namespace logger {
+    
+#ifdef OS_WIN
+    // @function EnableWindowsAnsiEscapeSequence()
+    //
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // enables ansi escape sequence on windows platform
+    // throws logger::error if there were errors
+    // with windows console
+    
+    void EnableWindowsAnsiEscapeSequence();
+#endif
+    
+    
+    
+    // @function StrToLen(a,b,c)
+    //
+    //
+    // @param a - std::string&& : target string
+    // @param b - size_t        : target length
+    // @param c - char          : fill character
+    //
+    // @return std::string
+    //
+    //
+    // move string @a and add (@b - Length(@a)) symbols that equals @c to the front
+    // if Length(@a) is at least @b, return @a without changes
+    
+    std::string StrToLen(std::string&&, size_t, char);
+    
+    
+    
+    
+    // @struct var_buffer
+    //
+    //
+    // @member data - std::string          : all variables converted to string one after another
+    // @member ends - std::vector<size_t>  : end of every variable in @data
+    //
+    // @method Clear()
+    //      @return void
+    //
+    //      forget all variables but keep allocated memory
+    //
+    // @method Count()
+    //      @return size_t
+    //
+    //      number of variables
+    //
+    // @method Var(i) / Length(i)
+    //      @return const char* / size_t
+    //
+    //      text and length of variable @i
+    //
+    //
+    // variables of one log call, reused between calls so formatting does not allocate
+    
+    struct var_buffer {
+        
+        std::string         data;
+        std::vector<size_t> ends;
+        
+        void        Clear()                 { data.clear(); ends.clear(); }
+        size_t      Count()          const  { return ends.size(); }
+        const char* Var(size_t i)    const  { return data.data() + (i ? ends[i - 1] : 0); }
+        size_t      Length(size_t i) const  { return ends[i] - (i ? ends[i - 1] : 0); }
+        
+    };
+    
+    
+    
+    
+    // @class var_stream
+    //
+    //
+    // @method Target(s)
+    //      @return std::ostream&
+    //
+    //      reset stream format and direct output to the end of string @s
+    //
+    //
+    // std::ostream that appends straight to a string,
+    // used for variables that have only operator<<
+    
+    class var_stream : private std::streambuf {
+    public:
+        
+        var_stream() : stream_(this), target_(nullptr) {}
+        
+        std::ostream& Target(std::string*);
+        
+    private:
+        
+        int_type        overflow(int_type) override;
+        std::streamsize xsputn(const char*, std::streamsize) override;
+        
+        std::ostream    stream_;
+        std::string*    target_;
+        
+    };
+    
+    
+    
+    
+    // template<T>
+    // @class thread_frame
+    //
+    //
+    // @method operator* / operator->
+    //      @return T& / T*
+    //
+    //      object owned by current thread for the lifetime of the frame
+    //
+    //
+    // gives every thread a reusable T, nested frames (e.g. a log call inside operator<<
+    // of a logged variable) get their own object so they never overwrite each other
+    
+    template <class T>
+    class thread_frame {
+    public:
+        
+        thread_frame();
+        ~thread_frame() { --Depth(); }
+        
+        thread_frame(const thread_frame&) = delete;
+        thread_frame& operator=(const thread_frame&) = delete;
+        
+        T& operator*()  const { return *value_; }
+        T* operator->() const { return value_; }
+        
+    private:
+        
+        static size_t&                          Depth();
+        static std::vector<std::unique_ptr<T> >& Pool();
+        
+        T* value_;
+        
+    };
+    
+    
+    
+    
+    // @function AppendVar(s, var)
+    //
+    //
+    // @param s   - std::string& : target string
+    // @param var - T            : variable to convert
+    //
+    // @return void
+    //
+    //
+    // append @var to @s the same way operator<< of std::ostream would do it
+    // numbers, characters and strings are converted without std::ostream
+    
+    void AppendVar(std::string&, bool);
+    void AppendVar(std::string&, char);
+    void AppendVar(std::string&, signed char);
+    void AppendVar(std::string&, unsigned char);
+    void AppendVar(std::string&, short);
+    void AppendVar(std::string&, unsigned short);
+    void AppendVar(std::string&, int);
+    void AppendVar(std::string&, unsigned int);
+    void AppendVar(std::string&, long);
+    void AppendVar(std::string&, unsigned long);
+    void AppendVar(std::string&, long long);
+    void AppendVar(std::string&, unsigned long long);
+    void AppendVar(std::string&, float);
+    void AppendVar(std::string&, double);
+    void AppendVar(std::string&, long double);
+    void AppendVar(std::string&, const char*);
+    void AppendVar(std::string&, const std::string&);
+    
+    template <class T>
+    void AppendVar(std::string&, const T&);
+    
+    
+    
+    
+    // @function ProcessVars(buffer)
+    //
+    //
+    // @param buffer - logger::var_buffer*  : buffer with processed variables
+    //
+    // @return void
+    //
+    //
+    // Does nothing
+    
+    void ProcessVars(var_buffer*);
+    
+    
+    
+    
+    
+    // template<T>
+    // @function ProcessVars(buffer,var,args)
+    //
+    //
+    // @param buffer - logger::var_buffer*  : buffer with processed variables
+    // @param var    - T                    : current processed value
+    // @param args   - pack                 : variables
+    //
+    // @return void
+    //
+    //
+    // append @var to the @buffer as a new variable
+    // pass args recursively
+    
+    template <class T, class ...Args>
+    void ProcessVars(var_buffer*, const T&, const Args&...);
+    
+}
+
+
+// @Implementation of
+//  logger::StrToLen
+
+std::string logger::StrToLen(std::string &&s, size_t len, char fill) {
+    
+    if(s.length() >= len) return std::move(s);
+    
+    s.insert(0,len - s.length(),fill);
+    
+    return std::move(s);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::var_stream::Target
+
+std::ostream& logger::var_stream::Target(std::string* s) {
+    
+    target_ = s;
+    
+    stream_.clear();
+    stream_.flags(std::ios_base::dec | std::ios_base::skipws);
+    stream_.precision(6);
+    stream_.width(0);
+    stream_.fill(' ');
+    
+    return stream_;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::var_stream::overflow
+
+std::streambuf::int_type logger::var_stream::overflow(int_type c) {
+    
+    if(!traits_type::eq_int_type(c, traits_type::eof())) {
+        target_->push_back(traits_type::to_char_type(c));
+    }
+    
+    return traits_type::not_eof(c);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::var_stream::xsputn
+
+std::streamsize logger::var_stream::xsputn(const char* s, std::streamsize n) {
+    
+    target_->append(s, (size_t)n);
+    
+    return n;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::thread_frame::thread_frame
+
+template <class T>
+logger::thread_frame<T>::thread_frame() {
+    
+    size_t depth = Depth()++;
+    
+    std::vector<std::unique_ptr<T> >& pool = Pool();
+    
+    if(pool.size() <= depth) {
+        pool.emplace_back(new T());
+    }
+    
+    value_ = pool[depth].get();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::thread_frame::Depth
+
+template <class T>
+size_t& logger::thread_frame<T>::Depth() {
+    
+    static thread_local size_t depth = 0;
+    
+    return depth;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::thread_frame::Pool
+
+template <class T>
+std::vector<std::unique_ptr<T> >& logger::thread_frame<T>::Pool() {
+    
+    static thread_local std::vector<std::unique_ptr<T> > pool;
+    
+    return pool;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, unsigned long long var) {
+    
+    static const char digits[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    
+    char  buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p   = end;
+    
+    while(var >= 100) {
+        size_t i = (size_t)(var % 100) * 2;
+        var /= 100;
+        *--p = digits[i + 1];
+        *--p = digits[i];
+    }
+    
+    if(var >= 10) {
+        size_t i = (size_t)var * 2;
+        *--p = digits[i + 1];
+        *--p = digits[i];
+    } else {
+        *--p = (char)('0' + var);
+    }
+    
+    s.append(p, (size_t)(end - p));
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, long long var) {
+    
+    if(var < 0) {
+        s += '-';
+        logger::AppendVar(s, 0ULL - (unsigned long long)var);
+        return;
+    }
+    
+    logger::AppendVar(s, (unsigned long long)var);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, bool var)                { s += var ? '1' : '0'; }
+void logger::AppendVar(std::string& s, char var)                { s += var; }
+void logger::AppendVar(std::string& s, signed char var)         { s += (char)var; }
+void logger::AppendVar(std::string& s, unsigned char var)       { s += (char)var; }
+void logger::AppendVar(std::string& s, short var)               { logger::AppendVar(s, (long long)var); }
+void logger::AppendVar(std::string& s, unsigned short var)      { logger::AppendVar(s, (unsigned long long)var); }
+void logger::AppendVar(std::string& s, int var)                 { logger::AppendVar(s, (long long)var); }
+void logger::AppendVar(std::string& s, unsigned int var)        { logger::AppendVar(s, (unsigned long long)var); }
+void logger::AppendVar(std::string& s, long var)                { logger::AppendVar(s, (long long)var); }
+void logger::AppendVar(std::string& s, unsigned long var)       { logger::AppendVar(s, (unsigned long long)var); }
+void logger::AppendVar(std::string& s, const std::string& var)  { s += var; }
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, const char* var) {
+    
+    if(var) s.append(var, strlen(var)); // std::ostream puts nothing for null pointer
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, float var) {
+    
+    logger::AppendVar(s, (double)var);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, double var) {
+    
+    char buffer[32];
+    
+    int n = snprintf(buffer, sizeof(buffer), "%g", var);    // std::ostream default format
+    
+    s.append(buffer, n > 0 ? (size_t)n : 0);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+void logger::AppendVar(std::string& s, long double var) {
+    
+    char buffer[48];
+    
+    int n = snprintf(buffer, sizeof(buffer), "%Lg", var);   // std::ostream default format
+    
+    s.append(buffer, n > 0 ? (size_t)n : 0);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendVar
+
+template <class T>
+void logger::AppendVar(std::string& s, const T& var) {
+    
+    logger::thread_frame<logger::var_stream> stream;
+    
+    stream->Target(&s) << var;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessVars
+
+void logger::ProcessVars(logger::var_buffer* buffer) {
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessVars
+
+template <class T, class ...Args>
+void logger::ProcessVars(logger::var_buffer* buffer, const T& var, const Args&... args) {
+    
+    logger::AppendVar(buffer->data, var);
+    
+    buffer->ends.push_back(buffer->data.length());
+    
+    ProcessVars(buffer, args...);
+    
+}
+
+
+
+
+#ifdef OS_WIN
+// @Implementation of
+//  logger::EnableWindowsAnsiEscapeSequence
+
+void logger::EnableWindowsAnsiEscapeSequence() {
+    
+    // Set output mode to handle virtual terminal sequences
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hOut == INVALID_HANDLE_VALUE)
+    {
+        throw logger::error("cannot enable ansi escape sequence");
+    }
+    
+    DWORD dwMode = 0;
+    if (!GetConsoleMode(hOut, &dwMode))
+    {
+        throw logger::error("cannot enable ansi escape sequence");
+    }
+    
+    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    if (!SetConsoleMode(hOut, dwMode))
+    {
+        throw logger::error("cannot enable ansi escape sequence");
+    }
+    
+}
+#endif
+
+#endif /* LOG_UTILITY_HPP */
+
+
+
+
+// log_format.hpp
+
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <type_traits>              // std::enable_if, std::is_array, std::is_convertible
+
+
+// relaxed constexpr functions (loops, several statements) are available since C++14
+#if __cplusplus >= 201402L
+#define LOGGER_CONSTEXPR constexpr
+#else
+#define LOGGER_CONSTEXPR
+#endif
+
+// string literals are parsed at compile time when consteval is available (C++20)
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+#define LOGGER_HAS_CONSTEVAL
+#endif
+
+// maximum number of commands in format string that is parsed at compile time
+// longer format strings are parsed when ConsoleLog is called
+#ifndef LOGGER_MAX_FORMAT_OPS
+#define LOGGER_MAX_FORMAT_OPS 32
+#endif
+
+namespace logger {
+
+    typedef enum : unsigned char {
+        F_TEXT,             // text without commands or "%%"
+        F_YEAR4,            // %yyyy
+        F_YEAR2,            // %yy
+        F_MONTH,            // %mm
+        F_DAY,              // %dd
+        F_HOUR,             // %h
+        F_MINUTE,           // %m
+        F_SECOND,           // %s
+        F_MILLISECOND,      // %ms
+        F_MICROSECOND,      // %us
+        F_VAR,              // %v
+        F_FILE,             // %FILE
+        F_FUNC,             // %FUNC
+        F_LINE,             // %LINE
+        F_PATH,             // %PATH
+        F_STYLE,            // %.ClassName(
+        F_STYLE_END         // %)
+    } format_command;
+
+
+
+
+    // @struct format_op
+    //
+    //
+    // @member command - logger::format_command : what to put
+    // @member begin   - size_t                 : start of text or class name in format string,
+    //                                            index of variable for F_VAR
+    // @member length  - size_t                 : length of text or class name
+    //
+    //
+    // one instruction of parsed format string
+
+    struct format_op {
+        format_command  command;
+        size_t          begin;
+        size_t          length;
+    };
+
+
+
+
+    // @function ParseFormatOp(s, n, i, op, var)
+    //
+    //
+    // @param s   - const char*         : format string
+    // @param n   - size_t              : length of format string
+    // @param i   - size_t              : position of the instruction to parse, less than @n
+    // @param op  - logger::format_op&  : parsed instruction
+    // @param var - size_t              : number of "%v" parsed before @i
+    //
+    // @return size_t
+    //
+    // @throw logger::error
+    //
+    //
+    // parse one instruction that starts at @i in accoring to ConsoleLog rules
+    // and return position of the next one
+    // usable in constant expressions since C++14
+
+    LOGGER_CONSTEXPR size_t ParseFormatOp(const char*, size_t, size_t, format_op&, size_t);
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+    // template<Args>
+    // @struct format_string
+    //
+    //
+    // @constructor format_string(s) : parse string literal @s at compile time
+    //
+    // @member str       - const char*       : format string
+    // @member length    - size_t            : length of format string
+    // @member ops       - logger::format_op : parsed instructions
+    // @member count     - size_t            : number of instructions, 0 if @dynamic
+    // @member dynamic   - bool              : string has more than LOGGER_MAX_FORMAT_OPS
+    //                                         instructions and is parsed at runtime
+    //
+    //
+    // format string literal parsed at compile time
+    // wrong commands and mismatch between the number of "%v" and
+    // the number of arguments are compile errors
+
+    template <class ...Args>
+    struct format_string {
+
+        template <size_t N>
+        consteval format_string(const char (&s)[N]) : str(s), length(N - 1), ops(), count(0), dynamic(false) {
+
+            for(size_t i = 0; i < LOGGER_MAX_FORMAT_OPS; ++i) {
+                ops[i] = format_op{F_TEXT, 0, 0};
+            }
+
+            size_t vars = 0;
+
+            for(size_t i = 0; i < length; ) {
+
+                format_op op = {F_TEXT, 0, 0};
+
+                i = ParseFormatOp(str, length, i, op, vars);
+
+                if(op.command == F_VAR) ++vars;
+
+                if(count == LOGGER_MAX_FORMAT_OPS) dynamic = true;
+                else ops[count++] = op;
+            }
+
+            if(vars != sizeof...(Args)) {
+                throw "ConsoleLog : number of %v doesn't match number of arguments";
+            }
+
+            if(dynamic) count = 0;
+        }
+
+        const char* str;
+        size_t      length;
+        format_op   ops[LOGGER_MAX_FORMAT_OPS];
+        size_t      count;
+        bool        dynamic;
+
+    };
+#endif
+
+
+
+
+    // template<S>
+    // @struct is_runtime_format
+    //
+    //
+    // @member value - bool : @S is a format string that is parsed when ConsoleLog is called
+    //
+    //
+    // string literals are parsed at compile time when it is supported,
+    // ConsoleLog passes other character arrays as const char*
+
+    template <class S>
+    struct is_runtime_format {
+#ifdef LOGGER_HAS_CONSTEVAL
+        static const bool value = std::is_convertible<const S&, std::string>::value && !std::is_array<S>::value;
+#else
+        static const bool value = std::is_convertible<const S&, std::string>::value;
+#endif
+    };
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+    // @function IsStringLiteral(spelling)
+    //
+    //
+    // @param spelling - const char* : argument of a macro turned into a string by #
+    //
+    // @return bool
+    //
+    //
+    // return true if the argument is written as a string literal (or several of them),
+    // only such arguments are constant expressions that format_string can parse,
+    // arrays filled at runtime are parsed when ConsoleLog is called
+
+    constexpr bool IsStringLiteral(const char* spelling) {
+
+        size_t n = 0;
+
+        while(spelling[n]) ++n;
+
+        return n >= 2 && spelling[0] == '"' && spelling[n - 1] == '"';
+    }
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ParseFormatOp
+
+LOGGER_CONSTEXPR size_t logger::ParseFormatOp(const char* s, size_t n, size_t i, logger::format_op& op, size_t var) {
+
+    if(s[i] != '%') {  // text until the next command
+
+        size_t j = i;
+        while(j < n && s[j] != '%') ++j;
+
+        op.command = logger::F_TEXT;
+        op.begin   = i;
+        op.length  = j - i;
+
+        return j;
+    }
+
+    if(i + 1 == n) {
+        throw logger::error("parse error : empty command");
+    }
+
+    op.begin  = 0;
+    op.length = 0;
+
+    if(s[i + 1] == 'y') {         // %yyyy / %yy
+        if(i + 2 < n && s[i + 2] == 'y') {
+            if(i + 4 < n && s[i + 3] == 'y' && s[i + 4] == 'y') {
+                op.command = logger::F_YEAR4;
+                return i + 5;
+            }
+            op.command = logger::F_YEAR2;
+            return i + 3;
+        }
+        throw logger::error("no such command : \"%y\"");
+    }
+
+    if(s[i + 1] == 'm') {         // %mm / %ms / %m
+        if(i + 2 < n && s[i + 2] == 'm') {
+            op.command = logger::F_MONTH;
+            return i + 3;
+        }
+        if(i + 2 < n && s[i + 2] == 's') {
+            op.command = logger::F_MILLISECOND;
+            return i + 3;
+        }
+        op.command = logger::F_MINUTE;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 's') {         // %s
+        op.command = logger::F_SECOND;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 'u') {         // %us
+        if(i + 2 < n && s[i + 2] == 's') {
+            op.command = logger::F_MICROSECOND;
+            return i + 3;
+        }
+        throw logger::error("no such command : \"%u\"");
+    }
+
+    if(s[i + 1] == 'h') {         // %h
+        op.command = logger::F_HOUR;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 'd') {         // %dd
+        if(i + 2 < n && s[i + 2] == 'd') {
+            op.command = logger::F_DAY;
+            return i + 3;
+        }
+        throw logger::error("no such command : \"%d\"");
+    }
+
+    if(s[i + 1] == 'v') {         // %v
+        op.command = logger::F_VAR;
+        op.begin   = var;
+        return i + 2;
+    }
+
+    if(s[i + 1] == 'F') {         // %FILE / %FUNC
+        if(i + 4 < n && s[i + 2] == 'I' && s[i + 3] == 'L' && s[i + 4] == 'E') {
+            op.command = logger::F_FILE;
+            return i + 5;
+        }
+        if(i + 4 < n && s[i + 2] == 'U' && s[i + 3] == 'N' && s[i + 4] == 'C') {
+            op.command = logger::F_FUNC;
+            return i + 5;
+        }
+        throw logger::error("parse error");
+    }
+
+    if(s[i + 1] == 'P') {         // %PATH
+        if(i + 4 < n && s[i + 2] == 'A' && s[i + 3] == 'T' && s[i + 4] == 'H') {
+            op.command = logger::F_PATH;
+            return i + 5;
+        }
+        throw logger::error("parse error");
+    }
+
+    if(s[i + 1] == 'L') {         // %LINE
+        if(i + 4 < n && s[i + 2] == 'I' && s[i + 3] == 'N' && s[i + 4] == 'E') {
+            op.command = logger::F_LINE;
+            return i + 5;
+        }
+        throw logger::error("parse error");
+    }
+
+    if(s[i + 1] == '.') {         // %.ClassName(
+
+        size_t j = i + 2;
+        while(j < n && s[j] != '(') ++j;
+
+        if(j == n) {
+            throw logger::error("parse error");
+        }
+
+        op.command = logger::F_STYLE;
+        op.begin   = i + 2;
+        op.length  = j - (i + 2);
+
+        return j + 1;
+    }
+
+    if(s[i + 1] == ')') {         // %)
+        op.command = logger::F_STYLE_END;
+        return i + 2;
+    }
+
+    if(s[i + 1] == '%') {         // %%
+        op.command = logger::F_TEXT;
+        op.begin   = i + 1;
+        op.length  = 1;
+        return i + 2;
+    }
+
+    throw logger::error("parse error : empty command");
+
+}
+
+#endif /* LOG_FORMAT_HPP */
+
+
+
+
+// log_clock.hpp
+
+#ifndef LOG_CLOCK_HPP
+#define LOG_CLOCK_HPP
+
+#include <string.h>                 // memcpy
+#include <time.h>                   // time_t, clock_gettime, localtime_r
+#include <cstddef>                  // size_t
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::system_clock
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#define OS_UNIX
+#endif
+
+// LOGGER_COARSE_CLOCK makes logger::Now read the coarse clock of the kernel:
+// it is cheaper but has a resolution of a few milliseconds
+#if defined(__linux__) && defined(LOGGER_COARSE_CLOCK)
+#define LOGGER_CLOCK_ID CLOCK_REALTIME_COARSE
+#elif defined(OS_UNIX)
+#define LOGGER_CLOCK_ID CLOCK_REALTIME
+#endif
+
+namespace logger {
+
+    // @struct log_time
+    //
+    //
+    // @member seconds     - time_t : seconds since the epoch
+    // @member nanoseconds - long   : fractional part of the second
+    //
+    //
+    // point of time of a log record
+
+    struct log_time {
+        time_t  seconds;
+        long    nanoseconds;
+    };
+
+
+
+
+    // @function Now()
+    //
+    //
+    // @return logger::log_time
+    //
+    //
+    // current wall clock time, read without a system call where the platform allows it
+
+    log_time Now();
+
+
+
+
+    // @function LocalTime(time, result)
+    //
+    //
+    // @param time   - time_t     : time to convert
+    // @param result - struct tm* : converted local time
+    //
+    // @return void
+    //
+    //
+    // thread safe version of localtime
+
+    void LocalTime(time_t, struct tm*);
+
+
+
+
+    // @function UtcOffset(time)
+    //
+    //
+    // @param time - time_t : point of time
+    //
+    // @return long
+    //
+    //
+    // difference in seconds between local time and UTC at @time
+    // the offset is computed once per quarter of an hour and shared by every thread
+
+    long UtcOffset(time_t);
+
+
+
+
+    // @function DateTime(time, text)
+    //
+    //
+    // @param time - time_t : point of time
+    // @param text - char*  : buffer for at least 20 characters
+    //
+    // @return void
+    //
+    //
+    // write local time @time in format "YYYY-MM-DD HH:MM:SS" with terminating null to @text
+    // the string of the current second is rendered once and reused by every thread
+
+    void DateTime(time_t, char*);
+
+
+
+
+    // @function CivilDateTime(local, text)
+    //
+    //
+    // @param local - long long : seconds since the epoch shifted by the UTC offset
+    // @param text  - char*     : buffer for at least 20 characters
+    //
+    // @return void
+    //
+    //
+    // write @local in format "YYYY-MM-DD HH:MM:SS" with terminating null to @text
+
+    void CivilDateTime(long long, char*);
+
+
+
+
+    // @function FractionDigits(nanoseconds, digits, text)
+    //
+    //
+    // @param nanoseconds - long   : fractional part of the second
+    // @param digits      - int    : number of digits to write, 3 for milliseconds, 6 for microseconds
+    // @param text        - char*  : buffer for @digits characters
+    //
+    // @return void
+    //
+    //
+    // write first @digits digits of the fractional part of the second
+
+    void FractionDigits(long, int, char*);
+
+
+
+
+    // @struct date_time_slot
+    //
+    //
+    // @member sequence - std::atomic<unsigned>            : odd while the slot is being written
+    // @member second   - std::atomic<long long>           : second that @text belongs to
+    // @member text     - std::atomic<unsigned long long>  : rendered "YYYY-MM-DD HH:MM:SS"
+    //
+    //
+    // rendered date and time of the latest second protected by a sequence lock,
+    // readers never wait and writers never block each other
+
+    struct date_time_slot {
+        std::atomic<unsigned>           sequence;
+        std::atomic<long long>          second;
+        std::atomic<unsigned long long> text[3];
+    };
+
+
+
+
+    // @member date_time_slot_
+    //
+    // date and time shared by every thread
+
+    date_time_slot date_time_slot_;
+
+
+
+
+    // @member utc_offset_
+    //
+    // cached UTC offset packed with the quarter of an hour it was computed for
+
+    std::atomic<long long> utc_offset_(-1);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::Now
+
+logger::log_time logger::Now() {
+
+    logger::log_time result;
+
+#ifdef LOGGER_CLOCK_ID
+    struct timespec ts;
+
+    clock_gettime(LOGGER_CLOCK_ID, &ts);
+
+    result.seconds     = ts.tv_sec;
+    result.nanoseconds = ts.tv_nsec;
+#else
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    result.seconds     = (time_t)(ns / 1000000000);
+    result.nanoseconds = (long)(ns % 1000000000);
+#endif
+
+    return result;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::LocalTime
+
+void logger::LocalTime(time_t time, struct tm* result) {
+
+#ifdef OS_UNIX
+    localtime_r(&time, result);
+#endif // OS_UNIX
+
+#ifdef OS_WIN
+    localtime_s(result, &time);
+#endif // OS_WIN
+
+}
+
+
+
+
+// @Implementation of
+//  logger::UtcOffset
+
+long logger::UtcOffset(time_t time) {
+
+    long long quarter = (long long)time / 900;  // DST changes on a quarter of an hour boundary
+    long long cached  = logger::utc_offset_.load(std::memory_order_relaxed);
+
+    if(cached >= 0 && (cached >> 20) == quarter) {
+        return (long)(cached & 0xFFFFF) - 65536;
+    }
+
+    struct tm local;
+
+    logger::LocalTime(time, &local);
+
+
+    // days from 1970-01-01 to the local date
+    long long y   = local.tm_year + 1900 - (local.tm_mon < 2);
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yoe = y - era * 400;
+    long long m   = local.tm_mon + 1;
+    long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + local.tm_mday - 1;
+    long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long day = era * 146097 + doe - 719468;
+
+    long offset = (long)(day * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec - (long long)time);
+
+    if(quarter >= 0) {
+        logger::utc_offset_.store((quarter << 20) | (offset + 65536), std::memory_order_relaxed);
+    }
+
+    return offset;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CivilDateTime
+
+void logger::CivilDateTime(long long local, char* text) {
+
+    long long z     = (local >= 0 ? local : local - 86399) / 86400;
+    long long secs  = local - z * 86400;
+
+    z += 719468;
+
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    long long doe = z - era * 146097;
+    long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long long mp  = (5 * doy + 2) / 153;
+    long long day = doy - (153 * mp + 2) / 5 + 1;
+    long long mon = mp < 10 ? mp + 3 : mp - 9;
+    long long yr  = yoe + era * 400 + (mon <= 2);
+
+    int hour = (int)(secs / 3600), min = (int)(secs / 60 % 60), sec = (int)(secs % 60);
+
+    char buffer[20] = {
+        (char)('0' + yr / 1000 % 10), (char)('0' + yr / 100 % 10), (char)('0' + yr / 10 % 10), (char)('0' + yr % 10), '-',
+        (char)('0' + mon / 10),       (char)('0' + mon % 10),       '-',
+        (char)('0' + day / 10),       (char)('0' + day % 10),       ' ',
+        (char)('0' + hour / 10),      (char)('0' + hour % 10),      ':',
+        (char)('0' + min / 10),       (char)('0' + min % 10),       ':',
+        (char)('0' + sec / 10),       (char)('0' + sec % 10),       '\0'
+    };
+
+    memcpy(text, buffer, 20);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::DateTime
+
+void logger::DateTime(time_t time, char* text) {
+
+    logger::date_time_slot& slot = logger::date_time_slot_;
+
+    unsigned long long words[3];
+
+    unsigned sequence = slot.sequence.load(std::memory_order_acquire);
+
+    if(!(sequence & 1) && slot.second.load(std::memory_order_relaxed) == (long long)time) {
+
+        words[0] = slot.text[0].load(std::memory_order_relaxed);
+        words[1] = slot.text[1].load(std::memory_order_relaxed);
+        words[2] = slot.text[2].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(slot.sequence.load(std::memory_order_relaxed) == sequence && words[0] != 0) {
+            memcpy(text, words, 20);
+            return;
+        }
+    }
+
+
+    // render date and time of a new second
+    char buffer[24] = {0};
+
+    logger::CivilDateTime((long long)time + logger::UtcOffset(time), buffer);
+
+    memcpy(text, buffer, 20);
+
+
+    // publish it for other threads unless somebody else is writing right now
+    if(!(sequence & 1) && slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy(words, buffer, sizeof(words));
+
+        slot.second.store((long long)time, std::memory_order_relaxed);
+        slot.text[0].store(words[0], std::memory_order_relaxed);
+        slot.text[1].store(words[1], std::memory_order_relaxed);
+        slot.text[2].store(words[2], std::memory_order_relaxed);
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::FractionDigits
+
+void logger::FractionDigits(long nanoseconds, int digits, char* text) {
+
+    for(int i = 9; i > digits; --i) nanoseconds /= 10;
+
+    for(int i = digits - 1; i >= 0; --i) {
+        text[i] = (char)('0' + nanoseconds % 10);
+        nanoseconds /= 10;
+    }
+
+}
+
+#endif /* LOG_CLOCK_HPP */
+
+
+
+
+// log_message_types.hpp
+
+#ifndef LOG_MESSAGE_TYPES_HPP
+#define LOG_MESSAGE_TYPES_HPP
+
+namespace logger {
+    
+    typedef enum : unsigned char {
+        T_WARNING,
+        T_DEBUG,
+        T_INFO,
+        T_ERROR,
+        T_CRITICAL
+    } log_message_type;
+    
+    
+    
+    
+    // @function MessageTypeName(type)
+    //
+    //
+    // @param type - logger::log_message_type : type of message
+    //
+    // @return const char*
+    //
+    //
+    // label of @type that is written to the log file
+    
+    const char* MessageTypeName(log_message_type);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::MessageTypeName
+
+const char* logger::MessageTypeName(logger::log_message_type type) {
+    
+    switch (type) {
+        case logger::T_INFO:
+            return "INFO";
+        case logger::T_DEBUG:
+            return "DEBUG";
+        case logger::T_ERROR:
+            return "ERROR";
+        case logger::T_WARNING:
+            return "WARNING";
+        case logger::T_CRITICAL:
+            return "CRITICAL";
+        default:
+            return "INFO";
+    }
+    
+}
+
+#endif /* LOG_MESSAGE_TYPES_HPP */
+
+
+
+
+// log_async.hpp
+
+#ifndef LOG_ASYNC_HPP
+#define LOG_ASYNC_HPP
+
+#include <cstddef>                  // size_t
+#include <vector>                   // std::vector
+#include <memory>                   // std::shared_ptr, std::make_shared
+#include <atomic>                   // std::atomic
+#include <thread>                   // std::thread, std::this_thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <condition_variable>       // std::condition_variable
+#include <chrono>                   // std::chrono::milliseconds, std::chrono::steady_clock
+
+namespace logger {
+
+    // template<T>
+    // @class spsc_ring
+    //
+    //
+    // @constructor spsc_ring(capacity) : capacity is rounded up to the power of two
+    //
+    //
+    // @method Full()
+    //      @return bool
+    //
+    //      return true if there is no free cell, producer only
+    //
+    // @method Push(value, sequence)
+    //      @return void
+    //
+    //      copy @value and its @sequence number into the ring, the ring must not be full
+    //      producer only
+    //
+    // @method Front(sequence)
+    //      @return T*
+    //
+    //      return the oldest value and put its sequence number to @sequence,
+    //      nullptr if the ring is empty, consumer only
+    //
+    // @method Pop()
+    //      @return void
+    //
+    //      release the value returned by Front, consumer only
+    //
+    //
+    // bounded lock-free single-producer single-consumer ring
+    // each side keeps a cached copy of the other side's position so the shared
+    // positions are read only when the cached one says the ring is full or empty
+    // values are copy-assigned so cells keep the memory they own
+    // and the ring does not allocate once it is warmed up
+
+    template <class T>
+    class spsc_ring {
+    public:
+
+        explicit spsc_ring(size_t);
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        bool    Full();
+        void    Push(const T&, size_t);
+        T*      Front(size_t&);
+        void    Pop();
+
+    private:
+
+        struct cell {
+            size_t  sequence;
+            T       data;
+        };
+
+        std::vector<cell>   cells_;
+        size_t              mask_;
+
+        char                pad0_[64];
+        std::atomic<size_t> tail_;          // written by the producer
+        size_t              head_cache_;    // producer's copy of @head_
+        char                pad1_[64];
+        std::atomic<size_t> head_;          // written by the consumer
+        size_t              tail_cache_;    // consumer's copy of @tail_
+        char                pad2_[64];
+
+    };
+
+
+
+
+    // template<T>
+    // @class async_worker
+    //
+    //
+    // @constructor async_worker(capacity, handler, flusher)
+    //      @param capacity - size_t        : maximum number of records waiting to be written per thread
+    //      @param handler  - bool(*)(T&)   : writes one record, may throw logger::error
+    //      @param flusher  - bool(*)()     : flushes everything written so far, also called every second while idle
+    //
+    //
+    // @method Push(record)
+    //      @return void
+    //
+    //      enqueue copy of @record, waits while the ring of the calling thread is full
+    //
+    // @method Flush()
+    //      @return bool
+    //
+    //      block until every record pushed before the call is handled and flushed
+    //      return false if some record failed since the previous Flush
+    //
+    //
+    // every producer thread gets its own ring on the first Push, so producers never
+    // touch each other's memory; records are numbered by one global counter and
+    // the background thread merges the rings and handles records in that order
+    // destructor drains the rings, flushes and joins the thread
+
+    template <class T>
+    class async_worker {
+    public:
+
+        typedef bool (*handler)(T&);
+        typedef bool (*flusher)();
+
+        async_worker(size_t, handler, flusher);
+        ~async_worker();
+
+        async_worker(const async_worker&) = delete;
+        async_worker& operator=(const async_worker&) = delete;
+
+        void Push(const T&);
+        bool Flush();
+
+    private:
+
+        // ring of one producer thread, kept until the thread exits and the ring is drained
+        struct stage {
+            explicit stage(size_t capacity) : ring(capacity), closed(false) {}
+
+            spsc_ring<T>        ring;
+            std::atomic<bool>   closed;
+        };
+
+        // ring of the calling thread, closes it when the thread exits
+        struct producer {
+            producer() : owner(0) {}
+            ~producer() { if(target) target->closed.store(true, std::memory_order_release); }
+
+            size_t                  owner;      // id of the worker @target belongs to
+            std::shared_ptr<stage>  target;
+        };
+
+        static producer&    Producer();
+        static size_t       NextId();
+
+        void                Run();
+        void                Collect(std::vector<std::shared_ptr<stage> >&);
+
+        size_t                  id_;
+        size_t                  capacity_;
+        handler                 handler_;
+        flusher                 flusher_;
+
+        std::vector<std::shared_ptr<stage> > stages_;   // guarded by @mutex_
+        std::atomic<bool>       stages_changed_;
+
+        char                    pad0_[64];
+        std::atomic<size_t>     sequence_;      // sequence number of the next record
+        char                    pad1_[64];
+        std::atomic<size_t>     processed_;     // records handled by the worker
+        std::atomic<size_t>     flush_ticket_;  // records that have to be flushed
+        std::atomic<size_t>     flushed_;       // records that are flushed
+        std::atomic<bool>       failed_;
+        std::atomic<bool>       stop_;
+
+        std::mutex              mutex_;
+        std::condition_variable wake_;          // wakes the worker
+        std::condition_variable done_;          // wakes Flush callers
+
+        std::thread             thread_;
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::spsc_ring
+
+template <class T>
+logger::spsc_ring<T>::spsc_ring(size_t capacity) : tail_(0), head_cache_(0), head_(0), tail_cache_(0) {
+
+    size_t size = 2;
+    while(size < capacity) size <<= 1;
+
+    cells_ = std::vector<cell>(size);
+    mask_  = size - 1;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Full
+
+template <class T>
+bool logger::spsc_ring<T>::Full() {
+
+    size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if(tail - head_cache_ <= mask_) return false;
+
+    head_cache_ = head_.load(std::memory_order_acquire);
+
+    return tail - head_cache_ > mask_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Push
+
+template <class T>
+void logger::spsc_ring<T>::Push(const T& value, size_t sequence) {
+
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    cell&  target = cells_[tail & mask_];
+
+    target.data     = value;
+    target.sequence = sequence;
+
+    tail_.store(tail + 1, std::memory_order_release);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Front
+
+template <class T>
+T* logger::spsc_ring<T>::Front(size_t& sequence) {
+
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    if(head == tail_cache_) {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if(head == tail_cache_) return nullptr;
+    }
+
+    cell& target = cells_[head & mask_];
+
+    sequence = target.sequence;
+
+    return &target.data;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::spsc_ring::Pop
+
+template <class T>
+void logger::spsc_ring<T>::Pop() {
+
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::async_worker
+
+template <class T>
+logger::async_worker<T>::async_worker(size_t capacity, handler h, flusher f) :
+    id_(NextId()), capacity_(capacity), handler_(h), flusher_(f), stages_changed_(false),
+    sequence_(0), processed_(0), flush_ticket_(0), flushed_(0), failed_(false), stop_(false) {
+
+    thread_ = std::thread(&async_worker<T>::Run, this);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::~async_worker
+
+template <class T>
+logger::async_worker<T>::~async_worker() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    wake_.notify_one();
+
+    thread_.join();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Producer
+
+template <class T>
+typename logger::async_worker<T>::producer& logger::async_worker<T>::Producer() {
+
+    static thread_local producer p;
+
+    return p;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::NextId
+
+template <class T>
+size_t logger::async_worker<T>::NextId() {
+
+    static std::atomic<size_t> id(0);
+
+    return ++id;    // 0 is never used, so a fresh producer belongs to no worker
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Push
+
+template <class T>
+void logger::async_worker<T>::Push(const T& record) {
+
+    producer& p = Producer();
+
+    if(p.owner != id_) {
+        // first record of this thread
+        if(p.target) p.target->closed.store(true, std::memory_order_release);
+
+        p.target = std::make_shared<stage>(capacity_);
+        p.owner  = id_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stages_.push_back(p.target);
+        stages_changed_.store(true, std::memory_order_release);
+    }
+
+    spsc_ring<T>& ring = p.target->ring;
+
+    while(ring.Full()) {
+        // ring is full, let the worker catch up
+        wake_.notify_one();
+        std::this_thread::yield();
+    }
+
+    // numbered only when the record can be published at once,
+    // so the worker never waits for a record stuck behind a full ring
+    ring.Push(record, sequence_.fetch_add(1, std::memory_order_relaxed));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Flush
+
+template <class T>
+bool logger::async_worker<T>::Flush() {
+
+    size_t ticket = sequence_.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if(flush_ticket_.load() < ticket) flush_ticket_.store(ticket);
+
+    wake_.notify_one();
+    done_.wait(lock, [this, ticket]{ return flushed_.load() >= ticket; });
+
+    return !failed_.exchange(false);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Collect
+
+template <class T>
+void logger::async_worker<T>::Collect(std::vector<std::shared_ptr<stage> >& stages) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t sequence;
+    size_t kept = 0;
+
+    for(size_t i = 0; i < stages_.size(); ++i) {
+        // rings of finished threads are dropped once they are drained
+        if(stages_[i]->closed.load(std::memory_order_acquire) && !stages_[i]->ring.Front(sequence)) continue;
+
+        stages_[kept++] = stages_[i];
+    }
+
+    stages_.resize(kept);
+    stages_changed_.store(false, std::memory_order_relaxed);
+
+    stages = stages_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::async_worker::Run
+
+template <class T>
+void logger::async_worker<T>::Run() {
+
+    std::vector<std::shared_ptr<stage> > stages;   // snapshot of @stages_
+    size_t next = 0;                                // sequence number of the next record to handle
+
+    std::chrono::steady_clock::time_point flushed_at = std::chrono::steady_clock::now();
+
+    for(;;) {
+
+        bool stop    = stop_.load();   // read before draining so nothing pushed earlier is lost
+        bool written = false;
+        bool missing = false;          // next record is numbered but not published yet
+
+        if(stages_changed_.load(std::memory_order_acquire)) Collect(stages);
+
+        for(;;) {
+
+            // the ring whose oldest record has the smallest number
+            spsc_ring<T>* best          = nullptr;
+            size_t        best_sequence = 0;
+
+            for(size_t i = 0; i < stages.size(); ++i) {
+                size_t sequence;
+                if(stages[i]->ring.Front(sequence) && (!best || sequence < best_sequence)) {
+                    best          = &stages[i]->ring;
+                    best_sequence = sequence;
+                }
+            }
+
+            if(!best) break;
+
+            if(best_sequence != next) {
+                missing = true;
+                break;
+            }
+
+            // consecutive records of one thread are handled without scanning again
+            size_t sequence;
+            T*     record;
+
+            while((record = best->Front(sequence)) && sequence == next) {
+                try {
+                    if(!handler_(*record)) failed_.store(true);
+                } catch(...) {
+                    failed_.store(true);
+                }
+                best->Pop();
+                ++next;
+                written = true;
+            }
+
+            processed_.store(next, std::memory_order_release);
+        }
+
+        if(missing || (stop && next < sequence_.load())) {
+            // some producer numbered a record but did not publish it yet,
+            // or it is in a ring that is not in the snapshot
+            if(stages_changed_.load(std::memory_order_acquire)) Collect(stages);
+            std::this_thread::yield();
+            continue;
+        }
+
+        size_t processed       = next;
+        bool   flush_requested = flush_ticket_.load() > flushed_.load();
+
+        if(flush_requested && processed < flush_ticket_.load() && !stop) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if(written || flush_requested || stop || now - flushed_at >= std::chrono::seconds(1)) {
+            // rings are empty - flush the whole batch at once,
+            // when idle the sink still gets to write what it held back
+            if(!flusher_()) failed_.store(true);
+            flushed_at = now;
+        }
+
+        if(flush_requested || stop) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushed_.store(processed);
+            done_.notify_all();
+        }
+
+        if(stop) return;
+
+        if(!written) Collect(stages);   // idle, forget rings of finished threads
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(1), [this]{
+            return stop_.load() || flush_ticket_.load() > flushed_.load();
+        });
+    }
+
+}
+
+#endif /* LOG_ASYNC_HPP */
+
+
+
+
+// log_limit.hpp
+
+#ifndef LOG_LIMIT_HPP
+#define LOG_LIMIT_HPP
+
+#include <stdlib.h>                 // atexit
+#include <cstddef>                  // size_t
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::steady_clock
+
+
+// state of one call site, created when the call site is reached for the first time
+#define LOGGER_LIMITER(TYPE, ARG) [&]() -> TYPE& { static TYPE limiter(ARG); return limiter; }()
+
+namespace logger {
+    
+    // @struct limiter_site
+    //
+    //
+    // @member report   - bool(*)(const limiter_site&, size_t, bool) : logs "suppressed N records" for the call site
+    // @member path     - const char*                           : file of the call site
+    // @member filename - const char*                           : name of the file of the call site
+    // @member line     - int                                   : line of the call site
+    // @member func     - const char*                           : function of the call site
+    // @member type     - logger::log_message_type              : type of the first suppressed record
+    //
+    //
+    // where and how suppressed records of a rate limited call site are reported
+    
+    struct limiter_site {
+        bool                (*report)(const limiter_site&, size_t, bool);
+        const char*         path;
+        const char*         filename;
+        int                 line;
+        const char*         func;
+        log_message_type    type;
+    };
+    
+    
+    
+    
+    // @class rate_limiter
+    //
+    //
+    // @constructor rate_limiter(per_second) : pass at most @per_second records per second
+    //
+    //
+    // @method Pass()
+    //      @return size_t
+    //
+    //      0 if the record has to be suppressed, otherwise 1 + number of records
+    //      suppressed since the previous passed one
+    //
+    // @method Watch(site)
+    //      @return void
+    //
+    //      remember @site and add the limiter to rate_limiters_ when it suppresses a record
+    //      for the first time, so logger::ReportSuppressed finds it
+    //
+    // @method Report(now)
+    //      @return bool
+    //
+    //      report records suppressed since the previous passed one, if there are any,
+    //      @now - written right away as logger::ReportSuppressed does it
+    //
+    //
+    // token bucket of one call site that holds a second worth of records
+    // the bucket is kept as the time it becomes empty (generic cell rate algorithm),
+    // so it is checked and updated with a single atomic
+    
+    class rate_limiter {
+    public:
+        
+        explicit rate_limiter(double);
+        
+        size_t Pass();
+        
+        void Watch(const limiter_site&);
+        
+        bool Report(bool);
+        
+        rate_limiter*               next;           // next watched limiter in rate_limiters_
+        
+    private:
+        
+        long long                   interval_;      // nanoseconds per record
+        long long                   tolerance_;     // nanoseconds the bucket may run ahead of the clock
+        std::atomic<long long>      empty_at_;      // time when the bucket is empty
+        std::atomic<size_t>         suppressed_;
+        std::atomic<bool>           watched_;
+        limiter_site                site_;          // set once before the limiter is added to rate_limiters_
+        
+    };
+    
+    
+    
+    
+    // @member rate_limiters_
+    //
+    // rate limiters that have suppressed records, newest first, never removed
+    
+    std::atomic<rate_limiter*> rate_limiters_(nullptr);
+    
+    
+    
+    
+    // @function ReportSuppressed(now)
+    //
+    //
+    // @param now - bool : write the lines right away without buffers of the calling thread,
+    //                     which are already destroyed when the program exits
+    //
+    // @return bool
+    //
+    //
+    // log "suppressed N records" for every call site with records suppressed since its last passed one,
+    // called by logger::Flush and when the program exits, so counts are not lost when a call site goes quiet
+    // return false if some line could not be written
+    
+    bool ReportSuppressed(bool now = false);
+    
+    
+    
+    
+    // @class sample_limiter
+    //
+    //
+    // @constructor sample_limiter(k) : pass one record of every @k
+    //
+    //
+    // @method Pass()
+    //      @return size_t
+    //
+    //      0 if the record has to be suppressed, 1 otherwise
+    //
+    //
+    // sampling state of one call site, the first record is always passed
+    // passed records stand for the @k - 1 suppressed ones, so no summary is reported
+    
+    class sample_limiter {
+    public:
+        
+        explicit sample_limiter(size_t k) : k_(k ? k : 1), count_(0) {}
+        
+        size_t Pass() { return count_.fetch_add(1, std::memory_order_relaxed) % k_ == 0 ? 1 : 0; }
+        
+    private:
+        
+        size_t                      k_;
+        std::atomic<size_t>         count_;
+        
+    };
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::rate_limiter
+
+logger::rate_limiter::rate_limiter(double per_second) : next(nullptr), empty_at_(0), suppressed_(0), watched_(false), site_() {
+    
+    if(per_second <= 0) per_second = 1e-9;
+    
+    interval_  = (long long)(1e9 / per_second);
+    tolerance_ = per_second > 1 ? 1000000000LL - interval_ : 0;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::Pass
+
+size_t logger::rate_limiter::Pass() {
+    
+    long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+    
+    long long empty_at = empty_at_.load(std::memory_order_relaxed);
+    
+    for(;;) {
+        
+        long long start = empty_at > now ? empty_at : now;
+        
+        if(start - now > tolerance_) {  // no token left
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        
+        if(empty_at_.compare_exchange_weak(empty_at, start + interval_, std::memory_order_relaxed)) break;
+    }
+    
+    return 1 + suppressed_.exchange(0, std::memory_order_relaxed);
+    
+}
+
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::Watch
+
+void logger::rate_limiter::Watch(const logger::limiter_site& site) {
+    
+    if(watched_.load(std::memory_order_relaxed) || watched_.exchange(true)) return;
+    
+    static const int registered = atexit([]{
+        try { logger::ReportSuppressed(true); } catch(...) {}   // nothing can be reported at exit
+    });
+    
+    (void)registered;
+    
+    site_ = site;
+    next  = logger::rate_limiters_.load(std::memory_order_relaxed);
+    
+    while(!logger::rate_limiters_.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::rate_limiter::Report
+
+bool logger::rate_limiter::Report(bool now) {
+    
+    size_t suppressed = suppressed_.exchange(0, std::memory_order_relaxed);   // the next passed record does not count them again
+    
+    return !suppressed || site_.report(site_, suppressed, now);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ReportSuppressed
+
+bool logger::ReportSuppressed(bool now) {
+    
+    bool result = true;
+    
+    for(logger::rate_limiter* limiter = logger::rate_limiters_.load(std::memory_order_acquire); limiter; limiter = limiter->next) {
+        
+        if(!limiter->Report(now)) result = false;
+    }
+    
+    return result;
+    
+}
+
+#endif /* LOG_LIMIT_HPP */
+
+
+
+
+// log_flusher.hpp
+
+#ifndef LOG_FLUSHER_HPP
+#define LOG_FLUSHER_HPP
+
+#include <stdlib.h>                 // atexit
+#include <cstddef>                  // size_t
+#include <time.h>                   // time_t
+#include <memory>                   // std::unique_ptr
+#include <atomic>                   // std::atomic
+
+
+// maximum number of sinks that are flushed by logger::Flush
+#define LOGGER_MAX_SINKS 8
+
+namespace logger {
+    
+    // @struct log_record
+    //
+    //
+    // @member write    - bool(*)(log_record&)      : sink that writes the record
+    // @member time     - time_t                    : time when the record was made
+    // @member type     - logger::log_message_type  : type of message
+    // @member filename - const char*               : file where the record was made
+    // @member line     - int                       : line where the record was made
+    // @member func     - const char*               : function where the record was made
+    // @member is_error - bool                      : record holds logger::error
+    // @member is_json  - bool                      : @values is one variable with the JSON fields of the record
+    // @member values   - logger::var_buffer        : variables converted to string
+    //                                                (message and error stack if @is_error,
+    //                                                rendered line for the console)
+    //
+    //
+    // everything that is needed to write one log call to its sink
+    
+    struct log_record {
+        bool                    (*write)(log_record&);
+        time_t                  time;
+        log_message_type        type;
+        const char*             filename;
+        int                     line;
+        const char*             func;
+        bool                    is_error;
+        bool                    is_json;
+        var_buffer              values;
+    };
+    
+    
+    
+    
+    // @member log_worker_
+    //
+    // central flusher that drains the rings of all producer threads in the order
+    // records were made, empty while every sink is synchronous
+    
+    std::unique_ptr<async_worker<log_record> > log_worker_;
+    
+    
+    
+    
+    // @member sink_flushers_
+    //
+    // flush functions of the sinks that were written at least once
+    
+    std::atomic<bool (*)()> sink_flushers_[LOGGER_MAX_SINKS];
+    
+    
+    
+    
+    // @function StartLogWorker(capacity)
+    //
+    //
+    // @param capacity - size_t : maximum number of records waiting to be written per thread
+    //
+    // @return void
+    //
+    //
+    // start the central flusher if it is not running yet
+    // pending records are written when the program exits
+    
+    void StartLogWorker(size_t);
+    
+    
+    
+    
+    // @function StopLogWorker()
+    //
+    //
+    // @return void
+    //
+    //
+    // write pending records and stop the central flusher
+    
+    void StopLogWorker();
+    
+    
+    
+    
+    // @function AddSinkFlusher(flusher)
+    //
+    //
+    // @param flusher - bool(*)() : function that flushes a sink
+    //
+    // @return bool
+    //
+    //
+    // make logger::Flush flush one more sink, adding the same function twice does nothing
+    
+    bool AddSinkFlusher(bool (*)());
+    
+    
+    
+    
+    // @function FlushSinks()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush every sink added with AddSinkFlusher
+    // return true if everything ok and false if some sink failed
+    
+    bool FlushSinks();
+    
+    
+    
+    
+    // @function WriteLogRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record to write
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // pass @record to its sink
+    
+    bool WriteLogRecord(log_record&);
+    
+    
+    
+    
+    // @function Flush()
+    //
+    //
+    // @return bool
+    //
+    //
+    // report records suppressed by rate limited call sites and
+    // wait until every record logged before the call is written to its sink
+    // return true if everything ok and false if some record was not written
+    
+    bool Flush();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::StartLogWorker
+
+void logger::StartLogWorker(size_t capacity) {
+    
+    if(logger::log_worker_) return;
+    
+    logger::log_worker_.reset(new logger::async_worker<logger::log_record>(capacity, &logger::WriteLogRecord, &logger::FlushSinks));
+    
+    // registered after every sink is constructed, so it runs before they are destroyed
+    atexit(&logger::StopLogWorker);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::StopLogWorker
+
+void logger::StopLogWorker() {
+    
+    logger::log_worker_.reset();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AddSinkFlusher
+
+bool logger::AddSinkFlusher(bool (*flusher)()) {
+    
+    for(size_t i = 0; i < LOGGER_MAX_SINKS; ++i) {
+        
+        bool (*expected)() = nullptr;
+        
+        if(logger::sink_flushers_[i].compare_exchange_strong(expected, flusher) || expected == flusher) {
+            return true;
+        }
+    }
+    
+    return false;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushSinks
+
+bool logger::FlushSinks() {
+    
+    bool result = true;
+    
+    for(size_t i = 0; i < LOGGER_MAX_SINKS; ++i) {
+        
+        bool (*flusher)() = logger::sink_flushers_[i].load();
+        
+        if(!flusher) break;
+        
+        if(!flusher()) result = false;
+    }
+    
+    return result;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteLogRecord
+
+bool logger::WriteLogRecord(logger::log_record& record) {
+    
+    return record.write(record);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Flush
+
+bool logger::Flush() {
+    
+    bool reported = logger::ReportSuppressed();
+    
+    if(logger::log_worker_) {
+        return logger::log_worker_->Flush() && reported;
+    }
+    
+    return logger::FlushSinks() && reported;
+    
+}
+
+#endif /* LOG_FLUSHER_HPP */
+
+
+
+
+// log_level.hpp
+
+#ifndef LOG_LEVEL_HPP
+#define LOG_LEVEL_HPP
+
+#include <atomic>                   // std::atomic
+#include <mutex>                    // std::mutex, std::lock_guard
+#include <type_traits>              // std::decay
+#include <utility>                  // std::forward
+
+
+// least severe message type that is compiled in, e.g. -DLOGGER_MIN_LEVEL=T_INFO
+// log calls of less severe types are removed together with their arguments:
+// by their type alone for logger::error, by the constant folded check for a constant message type
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL T_DEBUG
+#endif
+
+// first argument of a log macro, works with a single argument too
+#define LOGGER_EXPAND(x) x
+#define LOGGER_FIRST_ARG_(first, ...) first
+#define LOGGER_FIRST_ARG(...) LOGGER_EXPAND(LOGGER_FIRST_ARG_(__VA_ARGS__, 0))
+
+// arguments of a log macro after the first one, each with a leading comma, nothing for a single argument
+// works with up to 64 arguments
+#define LOGGER_CONCAT_(a, b) a##b
+#define LOGGER_CONCAT(a, b) LOGGER_CONCAT_(a, b)
+#define LOGGER_ARG_65(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,_17,_18,_19,_20,_21,_22,_23,_24,_25,_26,_27,_28,_29,_30,_31,_32,_33,_34,_35,_36,_37,_38,_39,_40,_41,_42,_43,_44,_45,_46,_47,_48,_49,_50,_51,_52,_53,_54,_55,_56,_57,_58,_59,_60,_61,_62,_63,_64, N, ...) N
+#define LOGGER_HAS_REST(...) LOGGER_EXPAND(LOGGER_ARG_65(__VA_ARGS__, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 0, 0))
+#define LOGGER_REST_0(first)
+#define LOGGER_REST_1(first, ...) , __VA_ARGS__
+#define LOGGER_REST_ARGS(...) LOGGER_EXPAND(LOGGER_CONCAT(LOGGER_REST_, LOGGER_HAS_REST(__VA_ARGS__))(__VA_ARGS__))
+
+// log call of a macro: the first argument is evaluated once and checked by logger::Gate,
+// PASS and CALL are made only if it passes, with the first argument bound to logger_first_
+// and the function of the call site in logger_func_
+#define LOGGER_GATE(SINK, PASS, CALL, ...) logger::Gate(SINK, LOGGER_FIRST_ARG(__VA_ARGS__), __func__, \
+    [&](decltype((LOGGER_FIRST_ARG(__VA_ARGS__))) logger_first_, const char* logger_func_) -> bool { \
+        return PASS && CALL(__FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_ LOGGER_REST_ARGS(__VA_ARGS__)); })
+
+namespace logger {
+    
+    typedef enum : unsigned char {
+        S_FILE,             // FileLog
+        S_CONSOLE,          // ConsoleLog
+        S_BINARY,           // BinaryLog
+        S_COUNT
+    } log_sink;
+    
+    
+    
+    
+    // @function Severity(type)
+    //
+    //
+    // @param type - logger::log_message_type : type of message
+    //
+    // @return int
+    //
+    //
+    // rank of @type from the least severe T_DEBUG (0) to the most severe T_CRITICAL (4),
+    // order of log_message_type values is kept for compatibility and is not the severity
+    
+    constexpr int Severity(log_message_type);
+    
+    
+    
+    
+    // @member min_level_
+    //
+    // LOGGER_MIN_LEVEL, may be given with or without "logger::"
+    
+    constexpr log_message_type min_level_ = LOGGER_MIN_LEVEL;
+    
+    
+    
+    
+    // @function CompiledIn(x)
+    //
+    //
+    // @param x - first argument of a log macro
+    //
+    // @return bool
+    //
+    //
+    // false if a log call is below LOGGER_MIN_LEVEL: @x is its message type,
+    // logger::error is logged as T_ERROR, calls without a type as T_INFO
+    
+    constexpr bool CompiledIn(log_message_type);
+    constexpr bool CompiledIn(const error&);
+    
+    template <class T>
+    constexpr bool CompiledIn(const T&);
+    
+    
+    
+    
+    // template<T>
+    // @struct compiled_in
+    //
+    //
+    // @member value - bool : a log call whose first argument has type @T may be compiled in
+    //
+    //
+    // the part of CompiledIn that depends only on the type of the first argument,
+    // false removes the call at compile time without looking at the argument
+    
+    template <class T>
+    struct compiled_in;
+    
+    
+    
+    
+    // @function TypeOf(x)
+    //
+    //
+    // @param x - first argument of a log macro
+    //
+    // @return logger::log_message_type
+    //
+    //
+    // message type of a log call: @x itself, T_ERROR for logger::error, T_INFO otherwise
+    
+    log_message_type TypeOf(log_message_type);
+    log_message_type TypeOf(const error&);
+    
+    template <class T>
+    log_message_type TypeOf(const T&);
+    
+    
+    
+    
+    // @member log_levels_
+    //
+    // runtime levels: global level, then level of every sink, guarded by log_levels_mutex_
+    
+    log_message_type log_levels_[S_COUNT + 1] = {T_DEBUG, T_DEBUG, T_DEBUG, T_DEBUG};
+    
+    
+    
+    
+    // @member log_levels_mutex_
+    //
+    // serializes SetLogLevel and SetSinkLevel
+    
+    std::mutex log_levels_mutex_;
+    
+    
+    
+    
+    // @member enabled_levels_
+    //
+    // 8 bits per sink, bit Severity(type) is set if @type passes both the global
+    // and the sink level, so a log call checks both with one relaxed load
+    
+    std::atomic<unsigned> enabled_levels_(0x1F1F1F);
+    
+    
+    
+    
+    // @function SetLogLevel(type)
+    //
+    //
+    // @param type - logger::log_message_type : least severe type that is logged
+    //
+    // @return void
+    //
+    //
+    // change the global runtime level, it applies to every sink together with its own level
+    
+    void SetLogLevel(log_message_type);
+    
+    
+    
+    
+    // @function SetSinkLevel(sink, type)
+    //
+    //
+    // @param sink - logger::log_sink          : sink to configure
+    // @param type - logger::log_message_type  : least severe type that is logged to @sink
+    //
+    // @return void
+    //
+    //
+    // change the runtime level of one sink
+    
+    void SetSinkLevel(log_sink, log_message_type);
+    
+    
+    
+    
+    // @function Enabled(sink, x)
+    //
+    //
+    // @param sink - logger::log_sink : sink of the log call
+    // @param x    - first argument of a log macro
+    //
+    // @return bool
+    //
+    //
+    // false if a log call is below LOGGER_MIN_LEVEL or filtered out at runtime
+    // checked by the log macros before any argument is evaluated
+    
+    bool Enabled(log_sink, log_message_type);
+    bool Enabled(log_sink, const error&);
+    
+    template <class T>
+    bool Enabled(log_sink, const T&);
+    
+    
+    
+    
+    // @function Gate(sink, first, func, call)
+    //
+    //
+    // @param sink  - logger::log_sink : sink of the log call
+    // @param first - T&&              : first argument of a log macro, evaluated once by the macro
+    // @param func  - const char*      : function of the call site
+    // @param call  - F                : bool(first, func), evaluates the other arguments and logs
+    //
+    // @return bool
+    //
+    //
+    // false without calling @call if the log call is not compiled in or filtered out at runtime,
+    // the result of @call otherwise
+    
+    template <class T, class F>
+    bool Gate(log_sink, T&&, const char*, F);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Severity
+
+constexpr int logger::Severity(logger::log_message_type type) {
+    
+    return type == logger::T_DEBUG   ? 0 :
+           type == logger::T_INFO    ? 1 :
+           type == logger::T_WARNING ? 2 :
+           type == logger::T_ERROR   ? 3 : 4;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CompiledIn
+
+constexpr bool logger::CompiledIn(logger::log_message_type type) {
+    
+    return logger::Severity(type) >= logger::Severity(logger::min_level_);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CompiledIn
+
+constexpr bool logger::CompiledIn(const logger::error&) {
+    
+    return logger::CompiledIn(logger::T_ERROR);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CompiledIn
+
+template <class T>
+constexpr bool logger::CompiledIn(const T&) {
+    
+    return logger::CompiledIn(logger::T_INFO);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::compiled_in
+
+template <class T>
+struct logger::compiled_in {
+    static constexpr bool value = logger::CompiledIn(logger::T_INFO);
+};
+
+template <>
+struct logger::compiled_in<logger::log_message_type> {
+    static constexpr bool value = true;     // checked by value
+};
+
+template <>
+struct logger::compiled_in<logger::error> {
+    static constexpr bool value = logger::CompiledIn(logger::T_ERROR);
+};
+
+
+
+
+
+// @Implementation of
+//  logger::TypeOf
+
+logger::log_message_type logger::TypeOf(logger::log_message_type type) {
+    
+    return type;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::TypeOf
+
+logger::log_message_type logger::TypeOf(const logger::error&) {
+    
+    return logger::T_ERROR;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::TypeOf
+
+template <class T>
+logger::log_message_type logger::TypeOf(const T&) {
+    
+    return logger::T_INFO;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::SetLogLevel
+
+void logger::SetLogLevel(logger::log_message_type type) {
+    
+    logger::SetSinkLevel(logger::S_COUNT, type);    // slot S_COUNT holds the global level
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::SetSinkLevel
+
+void logger::SetSinkLevel(logger::log_sink sink, logger::log_message_type type) {
+    
+    std::lock_guard<std::mutex> lock(logger::log_levels_mutex_);
+    
+    logger::log_levels_[sink] = type;
+    
+    int      global  = logger::Severity(logger::log_levels_[logger::S_COUNT]);
+    unsigned enabled = 0;
+    
+    for(int i = 0; i < logger::S_COUNT; ++i) {
+        
+        int level = logger::Severity(logger::log_levels_[i]);
+        
+        if(level < global) level = global;
+        
+        enabled |= (0x1Fu >> level << level) << (i * 8);  // bits level..4
+    }
+    
+    logger::enabled_levels_.store(enabled, std::memory_order_relaxed);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Enabled
+
+bool logger::Enabled(logger::log_sink sink, logger::log_message_type type) {
+    
+    return logger::CompiledIn(type) &&
+           (logger::enabled_levels_.load(std::memory_order_relaxed) >> (sink * 8 + logger::Severity(type)) & 1);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Enabled
+
+bool logger::Enabled(logger::log_sink sink, const logger::error&) {
+    
+    return logger::Enabled(sink, logger::T_ERROR);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Enabled
+
+template <class T>
+bool logger::Enabled(logger::log_sink sink, const T&) {
+    
+    return logger::Enabled(sink, logger::T_INFO);   // the same type TypeOf gives the call
+    
+}
+
+
+
+
+
+// @Implementation of
+//  logger::Gate
+
+template <class T, class F>
+bool logger::Gate(logger::log_sink sink, T&& first, const char* func, F call) {
+    
+    if(!logger::compiled_in<typename std::decay<T>::type>::value) return false;     // by the type, a constant
+    
+    if(!logger::CompiledIn(first)) return false;    // folded when the message type is a constant
+    
+    return logger::Enabled(sink, first) && call(std::forward<T>(first), func);
+    
+}
+
+#endif /* LOG_LEVEL_HPP */
+
+
+
+
+// log_stats.hpp
+
+#ifndef LOG_STATS_HPP
+#define LOG_STATS_HPP
+
+#include <time.h>                   // time_t
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::steady_clock
+
+
+namespace logger {
+
+    // @class latency_histogram
+    //
+    //
+    // @method Add(ns)
+    //      @return void
+    //
+    //      count one call that took @ns nanoseconds
+    //
+    // @method Percentile(p)
+    //      @return unsigned long long
+    //
+    //      upper bound of the bucket that holds @p percent of counted calls, p is from 0 to 100
+    //
+    // @method Count()
+    //      @return unsigned long long
+    //
+    // @method Max()
+    //      @return unsigned long long
+    //
+    //
+    // HDR style histogram of nanoseconds: 8 linear buckets for every power of two,
+    // so values are kept with at most 1/8 relative error in 4 KB
+    // Add is a relaxed atomic increment, any thread may call it
+
+    class latency_histogram {
+    public:
+
+        void                Add(unsigned long long);
+        unsigned long long  Percentile(double) const;
+        unsigned long long  Count() const;
+        unsigned long long  Max() const { return max_.load(std::memory_order_relaxed); }
+
+    private:
+
+        static size_t               Index(unsigned long long);
+        static unsigned long long   Upper(size_t);
+
+        std::atomic<unsigned long long> counts_[64 * 8];
+        std::atomic<unsigned long long> max_;
+
+    };
+
+
+
+
+    // @struct sink_meter
+    //
+    //
+    // @member records - std::atomic<unsigned long long> : records written
+    // @member dropped - std::atomic<unsigned long long> : records suppressed or not written because of errors
+    // @member bytes   - std::atomic<unsigned long long> : bytes written
+    // @member flushes - std::atomic<unsigned long long> : number of flushes
+    // @member enqueue - logger::latency_histogram      : time spent in log calls by the caller
+    // @member write   - logger::latency_histogram      : time spent writing a record to the sink
+    //
+    //
+    // self instrumentation of one sink
+
+    struct sink_meter {
+        std::atomic<unsigned long long> records;
+        std::atomic<unsigned long long> dropped;
+        std::atomic<unsigned long long> bytes;
+        std::atomic<unsigned long long> flushes;
+        latency_histogram               enqueue;
+        latency_histogram               write;
+    };
+
+
+
+
+    // @struct latency_stats
+    //
+    //
+    // @member count - unsigned long long : number of measured calls
+    // @member p50   - unsigned long long : median in nanoseconds
+    // @member p99   - unsigned long long : 99th percentile in nanoseconds
+    // @member p999  - unsigned long long : 99.9th percentile in nanoseconds
+    // @member max   - unsigned long long : longest call in nanoseconds
+
+    struct latency_stats {
+        unsigned long long  count;
+        unsigned long long  p50;
+        unsigned long long  p99;
+        unsigned long long  p999;
+        unsigned long long  max;
+    };
+
+
+
+
+    // @struct sink_stats
+    //
+    //
+    // snapshot of logger::sink_meter
+
+    struct sink_stats {
+        unsigned long long  records;
+        unsigned long long  dropped;
+        unsigned long long  bytes;
+        unsigned long long  flushes;
+        latency_stats       enqueue;
+        latency_stats       write;
+    };
+
+
+
+
+    // @struct log_stats
+    //
+    //
+    // @member sinks - logger::sink_stats[] : statistics of every sink indexed by logger::log_sink
+
+    struct log_stats {
+        sink_stats          sinks[S_COUNT];
+    };
+
+
+
+
+    // @member stats_enabled_
+    //
+    // sinks measure themselves, otherwise every measurement costs a relaxed load
+
+    std::atomic<bool> stats_enabled_(false);
+
+
+
+
+    // @member stats_period_
+    //
+    // seconds between stats records in the log file, 0 - never
+
+    std::atomic<long long> stats_period_(0);
+
+
+
+
+    // @member sink_meters_
+    //
+    // counters and histograms of every sink
+
+    sink_meter sink_meters_[S_COUNT];
+
+
+
+
+    // @function EnableStats(period)
+    //
+    //
+    // @param period - time_t : seconds between stats records written to the log file, 0 - never
+    //
+    // @return void
+    //
+    //
+    // make sinks count records, bytes and flushes and measure latency of log calls and writes
+
+    void EnableStats(time_t period = 0);
+
+
+
+
+    // @function GetStats()
+    //
+    //
+    // @return logger::log_stats
+    //
+    //
+    // snapshot of counters and latency percentiles of every sink since EnableStats was called
+
+    log_stats GetStats();
+
+
+
+
+    // @function AppendStats(s, stats)
+    //
+    //
+    // @param s     - std::string&              : target string
+    // @param stats - const logger::log_stats&  : statistics
+    //
+    // @return void
+    //
+    //
+    // append one line description of @stats to @s
+
+    void AppendStats(std::string&, const log_stats&);
+
+
+
+
+    // @function CountRecord(sink, written, bytes)
+    //
+    //
+    // @param sink    - logger::log_sink : sink
+    // @param written - bool             : false if the record was not written
+    // @param bytes   - size_t           : number of written bytes
+    //
+    // @return void
+
+    void CountRecord(log_sink, bool, size_t);
+
+
+
+
+    // @function CountDropped(sink, n)
+    //
+    //
+    // @param sink - logger::log_sink : sink
+    // @param n    - size_t           : number of suppressed records
+    //
+    // @return void
+
+    void CountDropped(log_sink, size_t);
+
+
+
+
+    // @function CountFlush(sink)
+    //
+    //
+    // @param sink - logger::log_sink : sink
+    //
+    // @return void
+
+    void CountFlush(log_sink);
+
+
+
+
+    // @class stats_timer
+    //
+    //
+    // measures time between its construction and destruction into @histogram
+    // reads the clock only when stats are enabled
+
+    class stats_timer {
+    public:
+
+        explicit stats_timer(latency_histogram& histogram) : histogram_(histogram),
+            enabled_(logger::stats_enabled_.load(std::memory_order_relaxed)) {
+            if(enabled_) start_ = std::chrono::steady_clock::now();
+        }
+
+        ~stats_timer() {
+            if(enabled_) {
+                histogram_.Add((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start_).count());
+            }
+        }
+
+        stats_timer(const stats_timer&) = delete;
+        stats_timer& operator=(const stats_timer&) = delete;
+
+    private:
+
+        latency_histogram&                      histogram_;
+        bool                                    enabled_;
+        std::chrono::steady_clock::time_point   start_;
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Index
+
+size_t logger::latency_histogram::Index(unsigned long long ns) {
+
+    if(ns < 8) return (size_t)ns;
+
+    int msb = 63;
+
+    while(!(ns >> msb)) --msb;
+
+    return (size_t)(msb - 2) * 8 + (size_t)((ns >> (msb - 3)) & 7);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Upper
+
+unsigned long long logger::latency_histogram::Upper(size_t i) {
+
+    if(i < 8) return i;
+
+    size_t msb = i / 8 + 2;
+
+    return ((8ULL + i % 8 + 1) << (msb - 3)) - 1;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Add
+
+void logger::latency_histogram::Add(unsigned long long ns) {
+
+    counts_[Index(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    unsigned long long max = max_.load(std::memory_order_relaxed);
+
+    while(ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Count
+
+unsigned long long logger::latency_histogram::Count() const {
+
+    unsigned long long total = 0;
+
+    for(size_t i = 0; i < 64 * 8; ++i) total += counts_[i].load(std::memory_order_relaxed);
+
+    return total;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::latency_histogram::Percentile
+
+unsigned long long logger::latency_histogram::Percentile(double p) const {
+
+    unsigned long long rank  = (unsigned long long)(p / 100 * (double)Count());
+    unsigned long long total = 0;
+    unsigned long long max   = Max();
+
+    for(size_t i = 0; i < 64 * 8; ++i) {
+
+        total += counts_[i].load(std::memory_order_relaxed);
+
+        if(total > rank) return Upper(i) < max ? Upper(i) : max;
+    }
+
+    return max;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableStats
+
+void logger::EnableStats(time_t period) {
+
+    logger::stats_period_.store((long long)period, std::memory_order_relaxed);
+    logger::stats_enabled_.store(true, std::memory_order_relaxed);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::GetStats
+
+logger::log_stats logger::GetStats() {
+
+    logger::log_stats result;
+
+    for(size_t i = 0; i < logger::S_COUNT; ++i) {
+
+        logger::sink_meter& meter = logger::sink_meters_[i];
+        logger::sink_stats& stats = result.sinks[i];
+
+        stats.records = meter.records.load(std::memory_order_relaxed);
+        stats.dropped = meter.dropped.load(std::memory_order_relaxed);
+        stats.bytes   = meter.bytes.load(std::memory_order_relaxed);
+        stats.flushes = meter.flushes.load(std::memory_order_relaxed);
+
+        logger::latency_histogram* histograms[2] = { &meter.enqueue, &meter.write };
+        logger::latency_stats*     latencies[2]  = { &stats.enqueue, &stats.write };
+
+        for(size_t j = 0; j < 2; ++j) {
+            latencies[j]->count = histograms[j]->Count();
+            latencies[j]->p50   = histograms[j]->Percentile(50);
+            latencies[j]->p99   = histograms[j]->Percentile(99);
+            latencies[j]->p999  = histograms[j]->Percentile(99.9);
+            latencies[j]->max   = histograms[j]->Max();
+        }
+    }
+
+    return result;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendStats
+
+void logger::AppendStats(std::string& s, const logger::log_stats& stats) {
+
+    static const char* names[logger::S_COUNT] = { "file", "console", "binary" };
+
+    for(size_t i = 0; i < logger::S_COUNT; ++i) {
+
+        const logger::sink_stats& sink = stats.sinks[i];
+
+        if(!sink.records && !sink.dropped && !sink.enqueue.count) continue;
+
+        s.append(names[i]).append(": records ");
+        logger::AppendVar(s, sink.records);
+        s.append(" dropped ");
+        logger::AppendVar(s, sink.dropped);
+        s.append(" bytes ");
+        logger::AppendVar(s, sink.bytes);
+        s.append(" flushes ");
+        logger::AppendVar(s, sink.flushes);
+
+        const logger::latency_stats* latencies[2] = { &sink.enqueue, &sink.write };
+        const char*                  labels[2]    = { " enqueue ns p50/p99/p999/max ", " write ns p50/p99/p999/max " };
+
+        for(size_t j = 0; j < 2; ++j) {
+            s.append(labels[j]);
+            logger::AppendVar(s, latencies[j]->p50);
+            s += '/';
+            logger::AppendVar(s, latencies[j]->p99);
+            s += '/';
+            logger::AppendVar(s, latencies[j]->p999);
+            s += '/';
+            logger::AppendVar(s, latencies[j]->max);
+        }
+
+        s.append("; ");
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CountRecord
+
+void logger::CountRecord(logger::log_sink sink, bool written, size_t bytes) {
+
+    if(!logger::stats_enabled_.load(std::memory_order_relaxed)) return;
+
+    logger::sink_meter& meter = logger::sink_meters_[sink];
+
+    if(!written) {
+        meter.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    meter.records.fetch_add(1, std::memory_order_relaxed);
+    meter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CountDropped
+
+void logger::CountDropped(logger::log_sink sink, size_t n) {
+
+    if(!logger::stats_enabled_.load(std::memory_order_relaxed)) return;
+
+    logger::sink_meters_[sink].dropped.fetch_add(n, std::memory_order_relaxed);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CountFlush
+
+void logger::CountFlush(logger::log_sink sink) {
+
+    if(!logger::stats_enabled_.load(std::memory_order_relaxed)) return;
+
+    logger::sink_meters_[sink].flushes.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+#endif /* LOG_STATS_HPP */
+
+
+
+
+// log_console.hpp
+
+#ifndef LOG_CONSOLE_HPP
+#define LOG_CONSOLE_HPP
+
+#include <string.h>			            // strrchr, strlen
+#include <cstddef>                      // size_t
+#include <utility>                      // std::move
+#include <memory>                       // std::shared_ptr, std::make_shared
+#include <string>                       // std::string, std::to_string
+#include <vector>                       // std::vector
+#include <iostream>                     // std::cout
+#include <sstream>                      // std::stringstream
+#include <unordered_map>                // std::unordered_map
+#include <type_traits>                  // std::enable_if, std::type_identity_t
+#include <mutex>                        // std::mutex, std::lock_guard, std::unique_lock
+#include <thread>                       // std::thread
+#include <chrono>                       // std::chrono::milliseconds
+#include <condition_variable>           // std::condition_variable
+#include <atomic>                       // std::atomic
+
+#if defined(_WIN32) | defined(_WIN64)
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#define OS_WIN
+#include <io.h>                         // _write, _isatty
+#else
+#define OS_UNIX
+#include <errno.h>                      // errno, EINTR
+#include <unistd.h>                     // write, isatty
+#include <sys/uio.h>                    // writev
+#endif
+
+
+#define __FILENAME__ (strrchr("/" __FILE__, '/') + 1)
+
+// maximum number of compiled target strings kept by every thread
+#ifndef LOGGER_FORMAT_CACHE_SIZE
+#define LOGGER_FORMAT_CACHE_SIZE 256
+#endif
+
+namespace logger {
+    
+    // @member async_console_log_
+    //
+    // ConsoleLog only passes rendered lines to the central flusher
+    
+    bool async_console_log_ = false;
+    
+    
+    
+    
+    // @enum console_colors
+    //
+    //
+    // whether ConsoleLog writes escape sequences of styles
+    
+    typedef enum : unsigned char {
+        CC_AUTO,            // only if the console sink writes to a terminal
+        CC_ALWAYS,          // always
+        CC_NEVER            // never, styles are skipped
+    } console_colors;
+    
+    
+    
+    
+    // @function IsTerminal(fd)
+    //
+    //
+    // @param fd - int : file descriptor
+    //
+    // @return bool
+    //
+    //
+    // return true if @fd is a terminal and not a file or a pipe
+    
+    bool IsTerminal(int);
+    
+    
+    
+    
+    // @member console_colors_
+    //
+    // mode set by logger::SetConsoleColors
+    
+    console_colors console_colors_ = CC_AUTO;
+    
+    
+    
+    
+    // @member console_plain_
+    //
+    // ConsoleLog writes no escape sequences, stdout is checked once at startup
+    
+    std::atomic<bool> console_plain_(!IsTerminal(1));
+    
+    
+    
+    
+    // @function SetConsoleColors(colors)
+    //
+    //
+    // @param colors - logger::console_colors : new mode
+    //
+    // @return void
+    //
+    //
+    // override detection of the terminal, CC_AUTO checks the file descriptor of the console sink again
+    
+    void SetConsoleColors(console_colors);
+    
+    
+    
+    
+    // @enum console_flush
+    //
+    //
+    // when lines buffered by the direct console sink are written to the file descriptor
+    
+    typedef enum : unsigned char {
+        CF_LINE,            // every line right away
+        CF_BYTES,           // when the buffer holds at least the given number of bytes
+        CF_PERIODIC         // every given number of milliseconds or when the buffer is full
+    } console_flush;
+    
+    
+    
+    
+    // @struct console_sink
+    //
+    //
+    // @member fd       - int                     : file descriptor lines are written to, -1 - std::cout is used
+    // @member policy   - logger::console_flush   : when the buffer is written
+    // @member bytes    - size_t                  : size the buffer is written at
+    // @member interval - unsigned                : milliseconds between writes in CF_PERIODIC mode
+    // @member buffer   - std::string             : lines that are not written yet
+    // @member mutex    - std::mutex              : guards the buffer
+    // @member thread   - std::thread             : writes the buffer in CF_PERIODIC mode
+    // @member wake     - std::condition_variable : stops the thread
+    // @member stop     - bool                    : thread should exit
+    //
+    //
+    // console output that bypasses iostream: lines are appended to one buffer and written
+    // with write(2), the pending buffer and the new line together with writev(2)
+    // T_ERROR and T_CRITICAL lines are always written right away
+    
+    struct console_sink {
+        int                     fd;
+        console_flush           policy;
+        size_t                  bytes;
+        unsigned                interval;
+        std::string             buffer;
+        std::mutex              mutex;
+        std::thread             thread;
+        std::condition_variable wake;
+        bool                    stop;
+        
+        console_sink() : fd(-1), policy(CF_LINE), bytes(0), interval(0), stop(false) {}
+        ~console_sink();
+    };
+    
+    
+    
+    
+    // @member console_sink_
+    //
+    // console sink shared by every ConsoleLog call
+    
+    console_sink console_sink_;
+    
+    
+    
+    
+    
+    // @function BindConsoleStyle(s,...)
+    //
+    //
+    // @param s    - std::string : name of style (should be unique)
+    // @param ...  - modifiers that will be applied to that style
+    //
+    // @return bool
+    //
+    //
+    // set correspondence between style and it name and return true if everything fine and false otherwise
+    
+    template <class ...Args>
+    bool BindConsoleStyle(std::string, Args...);
+    
+    
+    
+    
+    // @function Trace(error, path, func, line)
+    //
+    //
+    // @param error - logger::error& : error to trace
+    // @param path  - const char*    : path to current file
+    // @param func  - const char*    : function name
+    // @param line  - int            : line number
+    //
+    // @return logger::error&
+    //
+    //
+    // Push to error's stack information about current place
+    // and then return error
+    
+    error& Trace(error&, const char*, const char*, int);
+    
+    
+    
+    
+    // @function Trace(error, path, func, line)
+    //
+    //
+    // @param error - logger::error&& : error to trace
+    // @param path  - const char*    : path to current file
+    // @param func  - const char*    : function name
+    // @param line  - int            : line number
+    //
+    // @return logger::error
+    //
+    //
+    // Creates new error
+    // push to error's stack information about current place
+    // and then return error
+    
+    error Trace(error&&, const char*, const char*, int);
+    
+    
+    
+    
+    // @function EnableAsyncConsoleLog(capacity)
+    //
+    //
+    // @param capacity - size_t : maximum number of lines waiting to be written per thread
+    //
+    // @return void
+    //
+    //
+    // switch ConsoleLog to asynchronous mode: calls render the line and pass it through
+    // the ring of the calling thread to the central flusher, so lines of different threads
+    // never interleave and keep the order they were logged in with FileLog records
+    // errors of the background thread are reported by logger::Flush
+    
+    void EnableAsyncConsoleLog(size_t capacity = 1024);
+    
+    
+    
+    
+    // @function EnableDirectConsoleLog(fd, policy, bytes, interval)
+    //
+    //
+    // @param fd       - int                   : file descriptor to write to, 1 - stdout, 2 - stderr
+    // @param policy   - logger::console_flush : when buffered lines are written
+    // @param bytes    - size_t                : size of the buffer that is written in CF_BYTES and CF_PERIODIC modes
+    // @param interval - unsigned              : milliseconds between writes in CF_PERIODIC mode
+    //
+    // @return void
+    //
+    //
+    // make ConsoleLog write to @fd directly instead of std::cout, see logger::console_sink
+    // output does not depend on std::ios::sync_with_stdio, std::cout is flushed before the switch
+    
+    void EnableDirectConsoleLog(int fd = 1, console_flush policy = CF_LINE, size_t bytes = 64 * 1024, unsigned interval = 100);
+    
+    
+    
+    
+    // @function WriteConsole(text, type)
+    //
+    //
+    // @param text - const std::string&        : rendered output
+    // @param type - logger::log_message_type  : type of the output
+    //
+    // @return bool
+    //
+    //
+    // pass @text to the console sink or to the central flusher in asynchronous mode
+    // return true if everything ok and false if there were errors with console output
+    
+    bool WriteConsole(const std::string&, log_message_type);
+    
+    
+    
+    
+    // @function WriteConsoleText(data, n, type)
+    //
+    //
+    // @param data - const char*              : rendered output
+    // @param n    - size_t                   : length of @data
+    // @param type - logger::log_message_type : type of the output
+    //
+    // @return bool
+    //
+    //
+    // write @data to std::cout or to the buffer of the direct console sink
+    
+    bool WriteConsoleText(const char*, size_t, log_message_type);
+    
+    
+    
+    
+    // @function WriteConsoleFd(fd, first, first_n, second, second_n)
+    //
+    //
+    // @param fd       - int         : file descriptor
+    // @param first    - const char* : data written first
+    // @param first_n  - size_t      : length of @first
+    // @param second   - const char* : data written after @first
+    // @param second_n - size_t      : length of @second
+    //
+    // @return bool
+    //
+    //
+    // write both pieces with one system call when possible, retry partial and interrupted writes
+    
+    bool WriteConsoleFd(int, const char*, size_t, const char*, size_t);
+    
+    
+    
+    
+    // @function WriteConsoleRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record with rendered line
+    //
+    // @return bool
+    //
+    //
+    // write line rendered by ConsoleLog to the console sink
+    
+    bool WriteConsoleRecord(log_record&);
+    
+    
+    
+    
+    // @function FlushConsoleSink()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush std::cout or write the buffer of the direct console sink
+    
+    bool FlushConsoleSink();
+    
+    
+    
+    
+    // @struct format_program
+    //
+    //
+    // @member format - std::string                      : copy of target string
+    // @member ops    - std::vector<logger::format_op>   : parsed target string
+    // @member styles - std::vector<const logger::bound_style*>: style of every F_STYLE instruction,
+    //                                                           nullptr for other instructions
+    // @member plain  - bool                             : compiled for output without escape sequences,
+    //                                                     style instructions are left out
+    //
+    //
+    // target string compiled once and executed by every ConsoleLog call with the same string
+    
+    struct format_program {
+        std::string                     format;
+        std::vector<format_op>          ops;
+        std::vector<const bound_style*> styles;
+        bool                            plain;
+    };
+    
+    
+    
+    
+    // @function CompileFormat(s, n, program)
+    //
+    //
+    // @param s       - const char*              : target string
+    // @param n       - size_t                   : length of target string
+    // @param program - logger::format_program&  : compiled target string
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // parse target string and resolve its styles, leave style instructions out if logger::console_plain_ is set
+    
+    void CompileFormat(const char*, size_t, format_program&);
+    
+    
+    
+    
+    // @function CachedFormat(s)
+    //
+    //
+    // @param s - const std::string&/const char* : target string
+    //
+    // @return std::shared_ptr<const logger::format_program>
+    //
+    // @throw logger::error
+    //
+    //
+    // return compiled target string from the cache of current thread,
+    // compile it if this thread meets it for the first time
+    // cache is cleared when it holds LOGGER_FORMAT_CACHE_SIZE strings,
+    // the caller keeps the program alive while ConsoleLog called by operator<< of its arguments changes the cache
+    
+    std::shared_ptr<const format_program> CachedFormat(const char*, size_t);
+    std::shared_ptr<const format_program> CachedFormat(const std::string&);
+    std::shared_ptr<const format_program> CachedFormat(const char*);
+    
+    
+    
+    
+    // @function RenderFormat(default args, type, s, ops, styles, count, args)
+    //
+    //
+    // @param default args                                  : set of arguments that define macro information
+    // @param type          - logger::log_message_type      : type of message
+    // @param s             - const char*                   : target string
+    // @param ops           - const logger::format_op*      : parsed target string
+    // @param styles        - const logger::bound_style* const* : resolved styles of @ops, or nullptr
+    //                                                            to find styles by name
+    // @param count         - size_t                        : number of parsed instructions
+    // @param args          - pack                          : variables that will be put instead of "%v"
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // execute parsed target string and pass result to logger::WriteConsole.
+    // return true if everything ok and false if there were errors with console output
+    
+    template <class ...Args>
+    bool RenderFormat(const char*, const char*, int, const char*, log_message_type, const char*, const format_op*, const bound_style* const*, size_t, const Args&...);
+    
+    
+    
+    
+    // @function ConsoleLog(default args, s, args)
+    //
+    //
+    // @param default args                            : set of arguments that define macro information
+    // @param s             - std::string/const char* : target string - string that will be parsed
+    // @param args          - pack                    : variables that will be put instead of "%v" in target string
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // parse string @s in accoring to defined rules and pass it to std::cout(console output).
+    // if some error occurs, throws logger::error with information about error
+    // return true if everything ok and false if there were errors with console output
+    
+    template <class S, class ...Args>
+    typename std::enable_if<is_runtime_format<S>::value, bool>::type
+    ConsoleLog(const char*, const char*, int, const char*, const S&, const Args&...);
+    
+    
+    
+    
+#ifdef LOGGER_HAS_CONSTEVAL
+    // @function ConsoleLog(default args, s, args)
+    //
+    //
+    // @param default args                                      : set of arguments that define macro information
+    // @param s             - logger::format_string<Args...>    : string literal parsed at compile time
+    // @param args          - pack                              : variables that will be put instead of "%v" in target string
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // same as ConsoleLog for runtime strings but string literal is parsed at compile time,
+    // wrong commands and wrong number of arguments are compile errors
+    
+    template <class ...Args>
+    bool ConsoleLog(const char*, const char*, int, const char*, format_string<std::type_identity_t<Args>...>, const Args&...);
+#endif
+    
+    
+    
+    
+    // @function ConsoleLog(default args, type, s, args)
+    //
+    //
+    // @param default args                            : set of arguments that define macro information
+    // @param type          - logger::log_message_type: type of message, calls below LOGGER_MIN_LEVEL are removed
+    // @param s             - std::string/const char* : target string - string that will be parsed
+    // @param args          - pack                    : variables that will be put instead of "%v" in target string
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // same as ConsoleLog without a type, T_ERROR and T_CRITICAL lines are written right away
+    // by the direct console sink, lines without a type are T_INFO
+    
+    template <class S, class ...Args>
+    typename std::enable_if<is_runtime_format<S>::value, bool>::type
+    ConsoleLog(const char*, const char*, int, const char*, log_message_type, const S&, const Args&...);
+    
+#ifdef LOGGER_HAS_CONSTEVAL
+    template <class ...Args>
+    bool ConsoleLog(const char*, const char*, int, const char*, log_message_type, format_string<std::type_identity_t<Args>...>, const Args&...);
+#endif
+    
+    
+    
+    
+    // @function ConsoleLogPass(limiter, default args, first)
+    //
+    //
+    // @param limiter       - logger::rate_limiter& : limiter of the call site
+    // @param default args                          : set of arguments that define macro information
+    // @param first                                 : first argument of the log call
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // return false if the record is suppressed, when the record passes after suppressed ones
+    // put a line with the number of suppressed records first
+    // a call site that suppressed records is watched, so logger::Flush and the exit report the rest
+    
+    template <class T>
+    bool ConsoleLogPass(rate_limiter&, const char*, const char*, int, const char*, const T&);
+    
+    
+    
+    
+    // @function ConsoleLogSuppressed(site, suppressed, now)
+    //
+    //
+    // @param site       - const logger::limiter_site& : call site
+    // @param suppressed - size_t                      : number of suppressed records
+    // @param now        - bool                        : write the line on this thread without thread local
+    //                                                   buffers and format cache, so it works when the program exits
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // put a line with the number of suppressed records of @site to the console
+    
+    bool ConsoleLogSuppressed(const limiter_site&, size_t, bool);
+    
+    
+    
+    
+    // @function ConsoleLog(error)
+    //
+    //
+    // @param error - const logger::error& : error
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // output error's stack to the console
+    // if some error occurs, throws logger::error with information about error
+    // return true if everything ok and false if there were errors with console output
+    
+    bool ConsoleLog(const char*, const char*, int, const char*, error&);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::BindConsoleStyle
+
+template <class ...Args>
+bool logger::BindConsoleStyle(std::string s, Args... args) {
+    
+    return logger::BindStyle(s, logger::style({args...}));
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Trace
+
+logger::error& logger::Trace(logger::error& error, const char* path, const char* func, int line) {
+    
+    error.push(path, func, line);
+    
+    return error;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::Trace
+
+logger::error logger::Trace(logger::error&& error, const char* path, const char* func, int line) {
+
+    error.push(path, func, line);
+    
+    return error;
+}
+
+
+
+
+// @Implementation of
+//  logger::CompileFormat
+
+void logger::CompileFormat(const char* s, size_t n, logger::format_program& program) {
+    
+    program.format.assign(s, n);
+    program.ops.clear();
+    program.styles.clear();
+    program.plain = logger::console_plain_.load(std::memory_order_relaxed);
+    
+    for(size_t i = 0, vars = 0; i < n; ) {
+        
+        logger::format_op           op    = {logger::F_TEXT, 0, 0};
+        const logger::bound_style*  style = nullptr;
+        
+        i = logger::ParseFormatOp(s, n, i, op, vars);
+        
+        if(op.command == logger::F_VAR) ++vars;
+        
+        if(op.command == logger::F_STYLE) {
+            style = logger::FindStyle(s + op.begin, op.length);
+            
+            if(!style) throw logger::error("parse error : unknown style");
+        }
+        
+        if(program.plain && (op.command == logger::F_STYLE || op.command == logger::F_STYLE_END)) continue;
+        
+        program.ops.push_back(op);
+        program.styles.push_back(style);
+    }
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CachedFormat
+
+std::shared_ptr<const logger::format_program> logger::CachedFormat(const char* s, size_t n) {
+    
+    static thread_local std::unordered_map<size_t, std::shared_ptr<const logger::format_program> > cache;   // hash of target string -> program
+    
+    size_t hash = 14695981039346656037ULL & (size_t)-1;    // FNV-1a
+    
+    for(size_t i = 0; i < n; ++i) {
+        hash = (hash ^ (unsigned char)s[i]) * (size_t)1099511628211ULL;
+    }
+    
+    std::unordered_map<size_t, std::shared_ptr<const logger::format_program> >::iterator it = cache.find(hash);
+    
+    if(it != cache.end() && it->second->format.compare(0, std::string::npos, s, n) == 0 &&
+       it->second->plain == logger::console_plain_.load(std::memory_order_relaxed)) {
+        return it->second;
+    }
+    
+    std::shared_ptr<logger::format_program> program = std::make_shared<logger::format_program>();
+    
+    logger::CompileFormat(s, n, *program);  // throws before the cache is changed
+    
+    if(cache.size() >= LOGGER_FORMAT_CACHE_SIZE) {
+        cache.clear();      // programs being rendered are freed by their callers
+    }
+    
+    cache[hash] = program;
+    
+    return program;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CachedFormat
+
+std::shared_ptr<const logger::format_program> logger::CachedFormat(const std::string& s) {
+    
+    return logger::CachedFormat(s.c_str(), s.length());
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::CachedFormat
+
+std::shared_ptr<const logger::format_program> logger::CachedFormat(const char* s) {
+    
+    return logger::CachedFormat(s, strlen(s));
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableAsyncConsoleLog
+
+void logger::EnableAsyncConsoleLog(size_t capacity) {
+    
+    logger::StartLogWorker(capacity);
+    
+    logger::async_console_log_ = true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::IsTerminal
+
+bool logger::IsTerminal(int fd) {
+    
+#ifdef OS_WIN
+    return _isatty(fd) != 0;
+#else
+    return isatty(fd) != 0;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::SetConsoleColors
+
+void logger::SetConsoleColors(logger::console_colors colors) {
+    
+    logger::console_colors_ = colors;
+    
+    if(colors == logger::CC_AUTO) {
+        logger::console_plain_.store(!logger::IsTerminal(logger::console_sink_.fd < 0 ? 1 : logger::console_sink_.fd));
+        return;
+    }
+    
+    logger::console_plain_.store(colors == logger::CC_NEVER);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableDirectConsoleLog
+
+void logger::EnableDirectConsoleLog(int fd, logger::console_flush policy, size_t bytes, unsigned interval) {
+    
+    logger::AddSinkFlusher(&logger::FlushConsoleSink);  // logger::Flush writes the buffer
+    
+    std::cout.flush();
+    
+    {
+        std::lock_guard<std::mutex> lock(logger::console_sink_.mutex);
+        
+        logger::console_sink_.fd       = fd;
+        logger::console_sink_.policy   = policy;
+        logger::console_sink_.bytes    = bytes;
+        logger::console_sink_.interval = interval ? interval : 1;
+        
+        logger::console_sink_.buffer.reserve(bytes);
+        
+        if(logger::console_colors_ == logger::CC_AUTO) {
+            logger::console_plain_.store(!logger::IsTerminal(fd));
+        }
+        
+        if(policy == logger::CF_PERIODIC && !logger::console_sink_.thread.joinable()) {
+            
+            logger::console_sink_.thread = std::thread([]{
+                
+                logger::console_sink& sink = logger::console_sink_;
+                
+                std::unique_lock<std::mutex> lock(sink.mutex);
+                
+                while(!sink.wake.wait_for(lock, std::chrono::milliseconds(sink.interval), [&sink]{ return sink.stop; })) {
+                    
+                    if(sink.buffer.empty()) continue;
+                    
+                    logger::WriteConsoleFd(sink.fd, sink.buffer.data(), sink.buffer.length(), nullptr, 0);
+                    sink.buffer.clear();
+                }
+            });
+        }
+    }
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::console_sink::~console_sink
+
+logger::console_sink::~console_sink() {
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    
+    wake.notify_one();
+    
+    if(thread.joinable()) thread.join();
+    
+    if(fd >= 0 && !buffer.empty()) {
+        logger::WriteConsoleFd(fd, buffer.data(), buffer.length(), nullptr, 0);
+    }
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsole
+
+bool logger::WriteConsole(const std::string& text, logger::log_message_type type) {
+    
+    if(logger::async_console_log_ && logger::log_worker_) {     // written right away once the central flusher stopped at exit
+        
+        logger::thread_frame<logger::log_record> record;  // reused by every call of this thread
+        
+        record->write    = &logger::WriteConsoleRecord;
+        record->type     = type;
+        record->is_error = false;
+        
+        record->values.Clear();
+        
+        ProcessVars(&record->values, text);
+        
+        logger::log_worker_->Push(*record);
+        
+        return true;
+    }
+    
+    return logger::WriteConsoleText(text.data(), text.length(), type);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsoleRecord
+
+bool logger::WriteConsoleRecord(logger::log_record& record) {
+    
+    static const bool flushed = logger::AddSinkFlusher(&logger::FlushConsoleSink);   // logger::Flush flushes the console
+    
+    (void)flushed;
+    
+    return logger::WriteConsoleText(record.values.Var(0), record.values.Length(0), record.type);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsoleText
+
+bool logger::WriteConsoleText(const char* data, size_t n, logger::log_message_type type) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_CONSOLE].write);
+    
+    logger::console_sink& sink = logger::console_sink_;
+    
+    bool written = true;
+    
+    if(sink.fd < 0) {
+        
+        written = std::cout.write(data, (std::streamsize)n).good();
+    }
+    else {
+        
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        
+        bool urgent = type == logger::T_ERROR || type == logger::T_CRITICAL;
+        bool full   = sink.buffer.length() + n >= sink.bytes;
+        
+        if(sink.policy != logger::CF_LINE && !urgent && !full) {
+            sink.buffer.append(data, n);
+        }
+        else {
+            written = logger::WriteConsoleFd(sink.fd, sink.buffer.data(), sink.buffer.length(), data, n);    // no copy of the line
+            sink.buffer.clear();
+        }
+    }
+    
+    logger::CountRecord(logger::S_CONSOLE, written, n);
+    
+    return written;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteConsoleFd
+
+bool logger::WriteConsoleFd(int fd, const char* first, size_t first_n, const char* second, size_t second_n) {
+    
+#ifdef OS_UNIX
+    struct iovec parts[2] = { {(void*)first, first_n}, {(void*)second, second_n} };
+    struct iovec* part    = first_n ? parts : parts + 1;
+    int           count   = (int)(parts + 2 - part);
+    
+    while(count && part->iov_len + (count > 1 ? part[1].iov_len : 0)) {
+        
+        ssize_t n = count > 1 ? writev(fd, part, count) : write(fd, part->iov_base, part->iov_len);
+        
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        
+        // skip written data, a partial write continues where it stopped
+        while(count && (size_t)n >= part->iov_len) {
+            n -= (ssize_t)part->iov_len;
+            ++part;
+            --count;
+        }
+        
+        if(count) {
+            part->iov_base  = (char*)part->iov_base + n;
+            part->iov_len  -= (size_t)n;
+        }
+    }
+    
+    return true;
+#else
+    const char* parts[2]   = { first, second };
+    size_t      lengths[2] = { first_n, second_n };
+    
+    for(int i = 0; i < 2; ++i) {
+        
+        while(lengths[i]) {
+            
+            int n = _write(fd, parts[i], (unsigned)lengths[i]);
+            
+            if(n <= 0) return false;
+            
+            parts[i]   += n;
+            lengths[i] -= (size_t)n;
+        }
+    }
+    
+    return true;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushConsoleSink
+
+bool logger::FlushConsoleSink() {
+    
+    logger::CountFlush(logger::S_CONSOLE);
+    
+    logger::console_sink& sink = logger::console_sink_;
+    
+    if(sink.fd < 0) return std::cout.flush().good();
+    
+    std::lock_guard<std::mutex> lock(sink.mutex);
+    
+    bool written = logger::WriteConsoleFd(sink.fd, sink.buffer.data(), sink.buffer.length(), nullptr, 0);
+    
+    sink.buffer.clear();
+    
+    return written;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::RenderFormat
+
+template <class ...Args>
+bool logger::RenderFormat(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, const char* s, const logger::format_op* ops, const logger::bound_style* const* styles, size_t count, const Args&... args) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_CONSOLE].enqueue);
+    
+    bool plain = logger::console_plain_.load(std::memory_order_relaxed);   // no escape sequences
+    
+#ifdef OS_WIN
+    static bool escape_sequence_enabled = false;
+    if(!escape_sequence_enabled && !plain) {
+        logger::EnableWindowsAnsiEscapeSequence();
+        escape_sequence_enabled = true;
+    }
+#endif
+    
+    
+    logger::log_time            now       = logger::Now();          // current time
+    char                        date_time[20];                      // "YYYY-MM-DD HH:MM:SS"
+    char                        fraction[6];                        // digits of fractional part of second
+    
+    logger::DateTime(now.seconds, date_time);
+    
+    
+    logger::thread_frame<logger::var_buffer>             vars;     // variables converted to string
+    logger::thread_frame<std::vector<logger::sgr_state>> states;   // state of every opened style
+    logger::sgr_state                                    emitted = 0;  // state of the terminal
+    
+    
+    states->assign(1, 0);   // line starts and ends in the default state
+    
+    vars->Clear();
+    
+    ProcessVars(&*vars, args...);    // convert vars to string and append them to the buffer
+    
+    
+    logger::thread_frame<std::string> line;     // output, keeps its capacity between calls
+    std::string&                      out = *line;
+    
+    out.clear();
+    
+    
+    for(size_t i = 0; i < count; ++i) {
+        
+        const logger::format_op& op = ops[i];
+        
+        // styles only change the wanted state, the difference is written before the next text
+        // so adjacent style commands produce one escape sequence
+        if(op.command != logger::F_STYLE && op.command != logger::F_STYLE_END && emitted != states->back()) {
+            logger::AppendSgr(out, emitted, states->back());
+            emitted = states->back();
+        }
+        
+        switch(op.command) {
+            case logger::F_TEXT:
+                out.append(s + op.begin, op.length);
+                break;
+            case logger::F_YEAR4:
+                out.append(date_time, 4);
+                break;
+            case logger::F_YEAR2:
+                out.append(date_time + 2, 2);
+                break;
+            case logger::F_MONTH:
+                out.append(date_time + 5, 2);
+                break;
+            case logger::F_DAY:
+                out.append(date_time + 8, 2);
+                break;
+            case logger::F_HOUR:
+                out.append(date_time + 11, 2);
+                break;
+            case logger::F_MINUTE:
+                out.append(date_time + 14, 2);
+                break;
+            case logger::F_SECOND:
+                out.append(date_time + 17, 2);
+                break;
+            case logger::F_MILLISECOND:
+                logger::FractionDigits(now.nanoseconds, 3, fraction);
+                out.append(fraction, 3);
+                break;
+            case logger::F_MICROSECOND:
+                logger::FractionDigits(now.nanoseconds, 6, fraction);
+                out.append(fraction, 6);
+                break;
+            case logger::F_VAR:
+                if(op.begin >= vars->Count()) {
+                    throw logger::error("parse error : not enough arguments for \"%v\"");
+                }
+                out.append(vars->Var(op.begin), vars->Length(op.begin));
+                break;
+            case logger::F_FILE:
+                out.append(FILENAME);
+                break;
+            case logger::F_FUNC:
+                out.append(FUNC);
+                break;
+            case logger::F_LINE:
+                logger::AppendVar(out, LINE);
+                break;
+            case logger::F_PATH:
+                out.append(PATH);
+                break;
+            case logger::F_STYLE:
+            {
+                if(plain) break;    // only in strings parsed at compile time
+                
+                // style resolved by CompileFormat or found by name without copying it
+                const logger::bound_style* style = styles ? styles[i] : logger::FindStyle(s + op.begin, op.length);
+                
+                if(!style) throw logger::error("parse error : unknown style");
+                
+                states->push_back(logger::ApplyStyle(states->back(), *style));
+                break;
+            }
+            case logger::F_STYLE_END:
+                if(plain) break;
+                
+                if(states->size() < 2){
+                    throw logger::error("parse error: modifier stack is empty");
+                }
+                
+                states->pop_back();
+                break;
+        }
+    }
+    
+    // disable modifiers that are still on and move to next line
+    logger::AppendSgr(out, emitted, 0);
+    out += '\n';
+    
+    
+    return logger::WriteConsole(out, TYPE);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class S, class ...Args>
+typename std::enable_if<logger::is_runtime_format<S>::value, bool>::type
+logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const S& format, const Args&... args) {
+    
+    return logger::ConsoleLog(PATH, FILENAME, LINE, FUNC, logger::T_INFO, format, args...);
+    
+}
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class ...Args>
+bool logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::format_string<std::type_identity_t<Args>...> format, const Args&... args) {
+    
+    return logger::ConsoleLog<Args...>(PATH, FILENAME, LINE, FUNC, logger::T_INFO, format, args...);
+    
+}
+#endif
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class S, class ...Args>
+typename std::enable_if<logger::is_runtime_format<S>::value, bool>::type
+logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, const S& format, const Args&... args) {
+    
+    std::shared_ptr<const logger::format_program> program = logger::CachedFormat(format);   // parsed target string, alive until rendered
+    
+    return logger::RenderFormat(PATH, FILENAME, LINE, FUNC, TYPE, program->format.c_str(), program->ops.data(), program->styles.data(), program->ops.size(), args...);
+    
+}
+
+
+
+
+#ifdef LOGGER_HAS_CONSTEVAL
+// @Implementation of
+//  logger::ConsoleLog
+
+template <class ...Args>
+bool logger::ConsoleLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, logger::format_string<std::type_identity_t<Args>...> format, const Args&... args) {
+    
+    if(format.dynamic) { // too many commands to be stored in format_string
+        
+        std::shared_ptr<const logger::format_program> program = logger::CachedFormat(format.str, format.length);
+        
+        return logger::RenderFormat(PATH, FILENAME, LINE, FUNC, TYPE, program->format.c_str(), program->ops.data(), program->styles.data(), program->ops.size(), args...);
+    }
+    
+    return logger::RenderFormat(PATH, FILENAME, LINE, FUNC, TYPE, format.str, format.ops, (const logger::bound_style* const*)nullptr, format.count, args...);
+    
+}
+#endif
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLog
+
+bool logger::ConsoleLog(const char*, const char*, int, const char*, logger::error& error) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_CONSOLE].enqueue);
+    
+    if(logger::console_plain_.load(std::memory_order_relaxed)) {
+        
+        std::string text = "[ERROR] error message : \"";
+        
+        text.append(error.what()).append("\" error stack :\n");
+        
+        while(!error.error_stack_.empty()) {
+            text.append(1, '\t').append(error.error_stack_.top()) += '\n';
+            error.error_stack_.pop();
+        }
+        
+        return logger::WriteConsole(text, logger::T_ERROR);
+    }
+    
+#ifdef OS_WIN
+    static bool escape_sequence_enabled = false;
+    if(!escape_sequence_enabled) {
+        logger::EnableWindowsAnsiEscapeSequence();
+        escape_sequence_enabled = true;
+    }
+#endif
+    
+    std::stringstream result_ss;    // stringstream containing output
+    
+    result_ss << logger::FG_WHITE << logger::BG_RED << "[ERROR]" << logger::RESET << " error message : \"" << logger::FG_RED << error.what() << logger::RESET <<  "\" error stack :\n" ;
+    while(!error.error_stack_.empty()) {
+        result_ss << '\t' << logger::UNDERLINE <<  error.error_stack_.top() << logger::UNDERLINE_OFF << "\n";
+        error.error_stack_.pop();
+    }
+    
+    return logger::WriteConsole(result_ss.str(), logger::T_ERROR);
+    
+};
+
+// @Implementation of
+//  logger::ConsoleLogPass
+
+template <class T>
+bool logger::ConsoleLogPass(logger::rate_limiter& limiter, const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const T& first) {
+    
+    size_t passed = limiter.Pass();
+    
+    if(passed == 0) {
+        logger::CountDropped(logger::S_CONSOLE, 1);
+        limiter.Watch(logger::limiter_site{ &logger::ConsoleLogSuppressed, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) });
+        return false;
+    }
+    
+    if(passed > 1) {
+        logger::ConsoleLogSuppressed(logger::limiter_site{ nullptr, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) }, passed - 1, false);
+    }
+    
+    return true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::ConsoleLogSuppressed
+
+bool logger::ConsoleLogSuppressed(const logger::limiter_site& site, size_t suppressed, bool now) {
+    
+    if(now) {
+        
+        std::string text = "suppressed ";
+        
+        logger::AppendVar(text, suppressed);
+        text += " records\n";
+        
+        if(logger::log_worker_) logger::log_worker_->Flush();   // records queued before stay ahead of the line
+        
+        return logger::WriteConsoleText(text.data(), text.length(), site.type);
+    }
+    
+    const char* format = "suppressed %v records";   // parsed once and cached
+    
+    return logger::ConsoleLog(site.path, site.filename, site.line, site.func, site.type, format, suppressed);
+    
+}
+
+// LOGGER_GATE for ConsoleLog, with compile time parsing a first argument written as a string literal
+// is passed on as it is written, so it stays a constant expression (it has no side effects to repeat),
+// other character arrays are passed as const char* and parsed at runtime
+#ifdef LOGGER_HAS_CONSTEVAL
+#define LOGGER_STRINGIFY_(x) #x
+#define LOGGER_STRINGIFY(x) LOGGER_STRINGIFY_(x)
+#define LOGGER_CONSOLE_GATE(PASS, ...) logger::Gate(logger::S_CONSOLE, LOGGER_FIRST_ARG(__VA_ARGS__), __func__, \
+    [&](auto&& logger_first_, const char* logger_func_) -> bool { \
+        if constexpr(logger::IsStringLiteral(LOGGER_STRINGIFY(LOGGER_FIRST_ARG(__VA_ARGS__)))) { \
+            return PASS && (logger::ConsoleLog)(__FILE__,__FILENAME__,__LINE__,logger_func_, __VA_ARGS__); \
+        } \
+        else if constexpr(std::is_array<std::remove_reference_t<decltype(logger_first_)> >::value) { \
+            return PASS && (logger::ConsoleLog)(__FILE__,__FILENAME__,__LINE__,logger_func_, \
+                                                static_cast<const char*>(logger_first_) LOGGER_REST_ARGS(__VA_ARGS__)); \
+        } \
+        else { \
+            return PASS && (logger::ConsoleLog)(__FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_ LOGGER_REST_ARGS(__VA_ARGS__)); \
+        } })
+#else
+#define LOGGER_CONSOLE_GATE(PASS, ...) LOGGER_GATE(logger::S_CONSOLE, PASS, (logger::ConsoleLog), __VA_ARGS__)
+#endif
+
+// Macro that pass to the logger::ConsoleLog additional info about place where it has been called
+// the first argument is evaluated once, calls below LOGGER_MIN_LEVEL or the runtime level
+// do nothing and do not evaluate the other arguments
+#define ConsoleLog(...) LOGGER_CONSOLE_GATE(true, __VA_ARGS__)
+
+// ConsoleLog that prints at most RATE lines per second from this call site,
+// arguments of suppressed calls except the first one are not evaluated
+#define ConsoleLogRate(RATE, ...) LOGGER_CONSOLE_GATE( \
+    logger::ConsoleLogPass(LOGGER_LIMITER(logger::rate_limiter, RATE), __FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_), \
+    __VA_ARGS__)
+
+// ConsoleLog that prints one of every K lines from this call site
+#define ConsoleLogSample(K, ...) LOGGER_CONSOLE_GATE(LOGGER_LIMITER(logger::sample_limiter, K).Pass(), __VA_ARGS__)
+
+// Macro that pass to the logger::Trace additional info about place where it has been called
+#define Trace(x) logger::Trace(x,__FILE__,__func__,__LINE__)
+
+// DEBUG ONLY mode
+#ifdef DEBUG_ONLY
+    #if defined(DEBUG) | defined(_DEBUG)
+        #define ConsoleLog(...) NULL
+        #define ConsoleLogRate(...) NULL
+        #define ConsoleLogSample(...) NULL
+    #endif
+#endif
+
+#endif /* LOG_CONSOLE_HPP */
+
+
+
+
+// log_path.hpp
+
+#ifndef LOG_PATH_HPP
+#define LOG_PATH_HPP
+
+#include <time.h>                   // time_t, mktime
+#include <cstddef>                  // size_t
+#include <utility>                  // std::move
+#include <string>                   // std::string
+#include <unordered_set>            // std::unordered_set
+
+#if defined(_WIN32) | defined(_WIN64)
+#include <windows.h>                // CreateDirectory
+#include <sys/stat.h>               // stat
+#define OS_WIN
+#else
+#include <sys/stat.h>               // stat, mkdir
+#include <unistd.h>                 // mkdir
+#define OS_UNIX
+#endif
+
+
+namespace logger {
+
+    // @function MakeDirectory(path)
+    //
+    //
+    // @param path - const std::string& : directory to create
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // create directory @path if it does not exist
+
+    void MakeDirectory(const std::string&);
+
+
+
+
+    // @class log_path
+    //
+    //
+    // @method Reset(directory, extension)
+    //      @return void
+    //
+    //      change the logging directory to @directory and extension of log files to @extension
+    //      and forget everything resolved before
+    //
+    // @method Expired(time)
+    //      @return bool
+    //
+    //      return true if a record made at @time does not belong to the resolved file
+    //
+    // @method Resolve(time)
+    //      @return const std::string&
+    //      @throw  logger::error
+    //
+    //      create directories logs/{year}/{month} for the day of @time
+    //      and return path to the latest existing segment of the log file of that day,
+    //      a segment compressed to {path}.gz counts as existing but is never continued
+    //
+    // @method NextSegment()
+    //      @return const std::string&
+    //
+    //      return path to the next segment of the resolved day: ddmmyyyy.N{extension}
+    //
+    //
+    // resolves log file path once per day: the local day boundaries are computed
+    // when the path is resolved so the hot path only compares the record time
+    // against them, directories that are known to exist are never checked again
+    // the first segment of a day is ddmmyyyy{extension}, the next are ddmmyyyy.1{extension}, ...
+
+    class log_path {
+    public:
+
+        log_path() : segment_(0), begin_(0), end_(0) {}
+
+        void                Reset(std::string, const char* = ".log");
+        bool                Expired(time_t t) const { return t >= end_ || t < begin_; }
+        const std::string&  Resolve(time_t);
+        const std::string&  NextSegment();
+        const std::string&  Path() const { return path_; }
+        const std::string&  Directory() const { return directory_; }
+
+    private:
+
+        void                EnsureDirectory(const std::string&);
+        void                BuildPath();
+
+        std::string                     directory_;     // logging directory with "logs" appended
+        std::string                     extension_;     // extension of log files
+        std::string                     path_;          // resolved log file
+        std::string                     day_;           // resolved log file without segment and extension
+        size_t                          segment_;       // segment of the resolved log file
+        time_t                          begin_;         // local midnight of the resolved day
+        time_t                          end_;           // next local midnight
+        std::unordered_set<std::string> created_;       // directories known to exist
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::MakeDirectory
+
+void logger::MakeDirectory(const std::string& path) {
+
+#ifdef OS_UNIX
+    struct stat st = {0};   // structure for holding stat
+
+    if (stat(path.c_str(), &st) == -1) {
+        if(mkdir(path.c_str(), 0700)) {
+            throw logger::error("cannot create directory");
+        }
+    }
+#endif // OS_UNIX
+
+#ifdef OS_WIN
+	if (CreateDirectory(path.c_str(), NULL))
+	{
+		// Directory created
+	}
+	else if (ERROR_ALREADY_EXISTS == GetLastError())
+	{
+		// Directory already exists
+	}
+	else
+	{
+		throw logger::error("cannot create directory");
+	}
+#endif // OS_WIN
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::Reset
+
+void logger::log_path::Reset(std::string directory, const char* extension) {
+
+    directory_ = std::move(directory) + "logs";
+    extension_ = extension;
+    path_.clear();
+    day_.clear();
+    segment_ = 0;
+    created_.clear();
+    begin_ = end_ = 0;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::EnsureDirectory
+
+void logger::log_path::EnsureDirectory(const std::string& path) {
+
+    if(created_.count(path)) return;
+
+    logger::MakeDirectory(path);
+
+    created_.insert(path);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::Resolve
+
+const std::string& logger::log_path::Resolve(time_t time) {
+
+    static const char* month[] = {
+        "january",
+        "february",
+        "march",
+        "april",
+        "may",
+        "june",
+        "july",
+        "august",
+        "september",
+        "october",
+        "november",
+        "december"
+    };
+
+    struct tm cur_time;
+
+    logger::LocalTime(time, &cur_time);
+
+
+    // day boundaries, mktime takes care of month/year overflow and DST
+    struct tm midnight = cur_time;
+
+    midnight.tm_hour  = 0;
+    midnight.tm_min   = 0;
+    midnight.tm_sec   = 0;
+    midnight.tm_isdst = -1;
+    begin_ = mktime(&midnight);
+
+    midnight = cur_time;
+    midnight.tm_mday += 1;
+    midnight.tm_hour  = 0;
+    midnight.tm_min   = 0;
+    midnight.tm_sec   = 0;
+    midnight.tm_isdst = -1;
+    end_ = mktime(&midnight);
+
+
+    int  year = cur_time.tm_year + 1900;
+    char digits[4];
+
+    digits[0] = (char)('0' + year / 1000 % 10);
+    digits[1] = (char)('0' + year / 100 % 10);
+    digits[2] = (char)('0' + year / 10 % 10);
+    digits[3] = (char)('0' + year % 10);
+
+    path_.assign(directory_);
+    EnsureDirectory(path_);
+
+    path_ += '/';
+    path_.append(digits, 4);
+    EnsureDirectory(path_);
+
+    path_ += '/';
+    path_ += month[cur_time.tm_mon];
+    EnsureDirectory(path_);
+
+
+    path_ += '/';
+    path_ += (char)('0' + cur_time.tm_mday / 10);
+    path_ += (char)('0' + cur_time.tm_mday % 10);
+    path_ += (char)('0' + (cur_time.tm_mon + 1) / 10);
+    path_ += (char)('0' + (cur_time.tm_mon + 1) % 10);
+    path_.append(digits, 4);
+
+    day_.swap(path_);
+
+
+    // continue the latest segment written before
+    struct stat st;
+
+    for(segment_ = 1; ; ++segment_) {
+
+        BuildPath();
+
+        if(stat(path_.c_str(), &st) != 0 && stat((path_ + ".gz").c_str(), &st) != 0) break;
+    }
+
+    --segment_;
+    BuildPath();
+
+    if(stat(path_.c_str(), &st) != 0 && stat((path_ + ".gz").c_str(), &st) == 0) {
+        NextSegment();  // compressed by an earlier run, its number is taken
+    }
+
+    return path_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::NextSegment
+
+const std::string& logger::log_path::NextSegment() {
+
+    ++segment_;
+    BuildPath();
+
+    return path_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_path::BuildPath
+
+void logger::log_path::BuildPath() {
+
+    path_.assign(day_);
+
+    if(segment_) {
+        path_ += '.';
+        path_ += std::to_string(segment_);
+    }
+
+    path_ += extension_;
+
+}
+
+#endif /* LOG_PATH_HPP */
+
+
+
+
+// log_mmap.hpp
+
+#ifndef LOG_MMAP_HPP
+#define LOG_MMAP_HPP
+
+#include <string.h>                 // memcpy
+#include <errno.h>                  // errno, EINTR, EOPNOTSUPP, ENOSYS
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <atomic>                   // std::atomic
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <fcntl.h>                  // open, fallocate
+#include <unistd.h>                 // ftruncate, close, sysconf
+#include <sys/mman.h>               // mmap, munmap, msync
+#include <sys/stat.h>               // fstat
+#define OS_UNIX
+#endif
+
+namespace logger {
+    
+    // @class mapped_file
+    //
+    //
+    // @method Open(path, extent, checkpoint)
+    //      @return bool
+    //
+    //      open or create @path, preallocate it by @extent bytes and map it to memory
+    //      msync written data every @checkpoint bytes, never if @checkpoint is 0
+    //      return false if the file cannot be mapped (always on Windows)
+    //
+    // @method IsOpen()
+    //      @return bool
+    //
+    // @method Size()
+    //      @return size_t
+    //
+    //      written length of the file
+    //
+    // @method Append(data, n)
+    //      @return bool
+    //
+    //      copy @n bytes to the end of the file, grow the file by another extent if needed
+    //
+    // @method Sync()
+    //      @return bool
+    //
+    //      msync data written since the previous checkpoint and wait for it
+    //
+    // @method Close()
+    //      @return void
+    //
+    //      unmap the file and truncate it to the written length
+    //
+    //
+    // log file that is written with memcpy: the file is preallocated in large extents,
+    // so appending costs no system call until the extent is used up
+    // written length is kept in an atomic, so it can be read by other threads,
+    // but there must be a single writer at a time
+    // a file that was not closed (e.g. after a crash) ends with zeros that are
+    // cut off by the next Open
+    
+    class mapped_file {
+    public:
+        
+        mapped_file() : fd_(-1), data_(nullptr), capacity_(0), extent_(0), checkpoint_(0), synced_(0), tail_(0) {}
+        ~mapped_file() { Close(); }
+        
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        
+        bool    Open(const std::string&, size_t, size_t);
+        bool    IsOpen() const { return data_ != nullptr; }
+        size_t  Size() const { return tail_.load(std::memory_order_relaxed); }
+        bool    Append(const char*, size_t);
+        bool    Sync();
+        void    Close();
+        
+    private:
+        
+        bool    Map(size_t);
+        
+        int                 fd_;
+        char*               data_;          // mapped file
+        size_t              capacity_;      // mapped and preallocated length
+        size_t              extent_;        // preallocation step
+        size_t              checkpoint_;    // bytes between msync calls, 0 - never
+        size_t              synced_;        // bytes written before the last msync
+        std::atomic<size_t> tail_;          // written length
+        
+    };
+    
+}
+
+
+
+
+#ifdef OS_UNIX
+// @Implementation of
+//  logger::mapped_file::Map
+
+bool logger::mapped_file::Map(size_t capacity) {
+    
+#ifdef __linux__
+    int allocated;
+    
+    while((allocated = fallocate(fd_, 0, 0, (off_t)capacity)) != 0 && errno == EINTR) {}
+    
+    if(allocated != 0) {
+        // a sparse file only if the file system cannot preallocate, a page without
+        // a disk block behind it would raise SIGBUS on the first write (ENOSPC)
+        if(errno != EOPNOTSUPP && errno != ENOSYS) return false;
+        if(ftruncate(fd_, (off_t)capacity) != 0) return false;
+    }
+#else
+    if(ftruncate(fd_, (off_t)capacity) != 0) return false;
+#endif
+    
+    if(data_) {     // the old mapping stays usable until the file is extended
+        munmap(data_, capacity_);
+        data_ = nullptr;
+    }
+    
+    void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    
+    if(data == MAP_FAILED) return false;
+    
+    data_     = (char*)data;
+    capacity_ = capacity;
+    
+    return true;
+    
+}
+#endif // OS_UNIX
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Open
+
+bool logger::mapped_file::Open(const std::string& path, size_t extent, size_t checkpoint) {
+    
+    Close();
+    
+#ifdef OS_UNIX
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    
+    if(fd_ < 0) return false;
+    
+    struct stat st;
+    
+    if(fstat(fd_, &st) != 0) {
+        Close();
+        return false;
+    }
+    
+    size_t length = (size_t)st.st_size;
+    size_t page   = (size_t)sysconf(_SC_PAGESIZE);
+    
+    extent_     = (extent + page - 1) / page * page;
+    checkpoint_ = checkpoint;
+    
+    if(!Map((length / extent_ + 1) * extent_)) {
+        Close();
+        return false;
+    }
+    
+    // drop preallocated zeros left by a file that was not closed
+    while(length && data_[length - 1] == '\0') --length;
+    
+    tail_.store(length, std::memory_order_release);
+    synced_ = length;
+    
+    return true;
+#else
+    return false;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Append
+
+bool logger::mapped_file::Append(const char* data, size_t n) {
+    
+#ifdef OS_UNIX
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    
+    if(tail + n > capacity_ || !data_) {    // no mapping if mmap failed while growing
+        
+        size_t capacity = capacity_;
+        while(tail + n > capacity) capacity += extent_;
+        
+        if(!Map(capacity)) return false;
+    }
+    
+    memcpy(data_ + tail, data, n);
+    
+    tail_.store(tail + n, std::memory_order_release);
+    
+    if(checkpoint_ && tail + n - synced_ >= checkpoint_) {
+        return Sync();
+    }
+    
+    return true;
+#else
+    return false;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Sync
+
+bool logger::mapped_file::Sync() {
+    
+#ifdef OS_UNIX
+    if(!data_) return true;
+    
+    size_t tail  = tail_.load(std::memory_order_acquire);
+    size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = synced_ / page * page;   // msync needs page aligned address
+    
+    if(tail == synced_) return true;
+    
+    synced_ = tail;
+    
+    return msync(data_ + begin, tail - begin, MS_SYNC) == 0;
+#else
+    return true;
+#endif
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::mapped_file::Close
+
+void logger::mapped_file::Close() {
+    
+#ifdef OS_UNIX
+    if(data_) {
+        if(checkpoint_) Sync();
+        
+        munmap(data_, capacity_);
+        data_ = nullptr;
+    }
+    
+    if(fd_ >= 0) {
+        // file was never mapped when capacity is 0, its length is unknown
+        if(capacity_ && ftruncate(fd_, (off_t)tail_.load(std::memory_order_acquire)) != 0) {
+            // file keeps trailing zeros, they are cut off by the next Open
+        }
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+    
+    capacity_ = 0;
+    tail_.store(0, std::memory_order_relaxed);
+    
+}
+
+#endif /* LOG_MMAP_HPP */
+
+
+
+
+// log_uring.hpp
+
+#ifndef LOG_URING_HPP
+#define LOG_URING_HPP
+
+#include <string.h>                 // memcpy, memset
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <deque>                    // std::deque
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <condition_variable>       // std::condition_variable
+#include <atomic>                   // std::atomic_thread_fence
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <errno.h>                  // errno, EINTR
+#include <fcntl.h>                  // open
+#include <unistd.h>                 // pwrite, close, syscall
+#include <sys/stat.h>               // fstat
+#define OS_UNIX
+#endif
+
+// io_uring is used through raw system calls, so no library has to be linked
+// LOGGER_NO_URING makes uring_file always use pwrite threads
+#if defined(__linux__) && defined(__has_include) && !defined(LOGGER_NO_URING)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>         // io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/mman.h>               // mmap, munmap
+#include <sys/syscall.h>            // __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register
+#include <sys/uio.h>                // iovec
+#define LOGGER_HAS_URING
+#endif
+#endif
+
+namespace logger {
+
+    // @class uring_file
+    //
+    //
+    // @method Open(path, buffers, buffer_size, threads)
+    //      @return bool
+    //
+    //      open or create @path for appending, writes go through @buffers buffers of
+    //      @buffer_size bytes, @threads threads call pwrite if io_uring is unavailable
+    //      return false if the file cannot be opened (always on Windows)
+    //
+    // @method IsOpen()
+    //      @return bool
+    //
+    // @method UsesUring()
+    //      @return bool
+    //
+    //      return true if writes are submitted through io_uring
+    //
+    // @method Append(data, n)
+    //      @return bool
+    //
+    //      copy @n bytes to the current buffer, a full buffer is handed off to be written
+    //      at its offset and a free one is taken from the pool
+    //
+    // @method Flush()
+    //      @return bool
+    //
+    //      hand off the current buffer and wait until every write is completed
+    //      return false if some write failed since the previous Flush
+    //
+    // @method Close()
+    //      @return void
+    //
+    //      flush and close the file
+    //
+    //
+    // log file written by io_uring: the buffers are registered once, a full buffer
+    // becomes a IORING_OP_WRITE_FIXED request, requests are submitted in batches and
+    // their completions return buffers to the pool
+    // when io_uring cannot be set up the same buffers are written by a pool of pwrite threads
+    // there must be a single writer at a time
+
+    class uring_file {
+    public:
+
+        uring_file();
+        ~uring_file();
+
+        uring_file(const uring_file&) = delete;
+        uring_file& operator=(const uring_file&) = delete;
+
+        bool    Open(const std::string&, size_t, size_t, size_t);
+        bool    IsOpen() const { return fd_ >= 0; }
+        bool    UsesUring() const { return ring_fd_ >= 0; }
+        bool    Append(const char*, size_t);
+        bool    Flush();
+        void    Close();
+
+    private:
+
+        // one buffer of the pool and the write it is used by
+        struct slot {
+            char*       data;
+            size_t      length;     // bytes to write
+            size_t      written;    // bytes written by completed requests
+            long long   offset;     // position of the buffer in the file
+        };
+
+        bool    Setup(size_t, size_t, size_t);
+        void    Teardown();
+        bool    SetupRing();
+        void    TeardownRing();
+        bool    Acquire();
+        void    Release(unsigned);
+        void    Submit(unsigned);
+        bool    Enter(unsigned, unsigned);
+        bool    Reap(bool);
+        void    Complete(unsigned, long);
+        void    RunWriter();
+
+        int                         fd_;
+        long long                   offset_;        // end of the file including buffers in flight
+
+        std::vector<char>           memory_;        // memory of every buffer
+        std::vector<slot>           slots_;
+        std::vector<unsigned>       free_;          // indices of free buffers
+        size_t                      buffer_size_;
+        size_t                      threads_count_;
+        int                         current_;       // buffer that is being filled, -1 if none
+        size_t                      inflight_;      // buffers handed off and not completed
+        bool                        failed_;
+
+        // io_uring
+        int                         ring_fd_;
+        void*                       sq_ptr_;
+        size_t                      sq_size_;
+        void*                       cq_ptr_;
+        size_t                      cq_size_;
+        void*                       sqes_ptr_;
+        size_t                      sqes_size_;
+        unsigned*                   sq_tail_;
+        unsigned*                   sq_mask_;
+        unsigned*                   sq_array_;
+        unsigned*                   cq_head_;
+        unsigned*                   cq_tail_;
+        unsigned*                   cq_mask_;
+        void*                       cqes_;
+        unsigned                    to_submit_;     // prepared and not submitted requests
+
+        // pwrite threads
+        std::vector<std::thread>    threads_;
+        std::mutex                  mutex_;
+        std::condition_variable     work_;          // wakes writer threads
+        std::condition_variable     done_;          // wakes Reap
+        std::deque<unsigned>        tasks_;         // buffers waiting for pwrite
+        std::vector<std::pair<unsigned, long> > completed_;  // buffer and result of pwrite
+        bool                        stop_;
+
+    };
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::uring_file
+
+logger::uring_file::uring_file() :
+    fd_(-1), offset_(0), buffer_size_(0), threads_count_(0), current_(-1), inflight_(0), failed_(false),
+    ring_fd_(-1), sq_ptr_(nullptr), sq_size_(0), cq_ptr_(nullptr), cq_size_(0), sqes_ptr_(nullptr), sqes_size_(0),
+    sq_tail_(nullptr), sq_mask_(nullptr), sq_array_(nullptr),
+    cq_head_(nullptr), cq_tail_(nullptr), cq_mask_(nullptr), cqes_(nullptr), to_submit_(0), stop_(false) {}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::~uring_file
+
+logger::uring_file::~uring_file() {
+
+    Close();
+    Teardown();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Open
+
+bool logger::uring_file::Open(const std::string& path, size_t buffers, size_t buffer_size, size_t threads) {
+
+    Close();
+
+#ifdef OS_UNIX
+    if(!Setup(buffers < 2 ? 2 : buffers, buffer_size < 4096 ? 4096 : buffer_size, threads < 1 ? 1 : threads)) return false;
+
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+
+    if(fd_ < 0) return false;
+
+    struct stat st;
+
+    if(fstat(fd_, &st) != 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    offset_ = (long long)st.st_size;
+    failed_ = false;
+
+    return true;
+#else
+    return false;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Setup
+
+bool logger::uring_file::Setup(size_t buffers, size_t buffer_size, size_t threads) {
+
+    if(slots_.size() == buffers && buffer_size_ == buffer_size && threads_count_ == threads) return true;
+
+    Teardown();
+
+    buffer_size_   = buffer_size;
+    threads_count_ = threads;
+
+    memory_.resize(buffers * buffer_size);
+    slots_.resize(buffers);
+
+    for(size_t i = 0; i < buffers; ++i) {
+        slots_[i].data = memory_.data() + i * buffer_size;
+        free_.push_back((unsigned)(buffers - 1 - i));
+    }
+
+    if(SetupRing()) return true;
+
+    // io_uring is not available, write buffers with pwrite threads
+    stop_ = false;
+
+    for(size_t i = 0; i < threads; ++i) {
+        threads_.push_back(std::thread(&uring_file::RunWriter, this));
+    }
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::SetupRing
+
+bool logger::uring_file::SetupRing() {
+
+#ifdef LOGGER_HAS_URING
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, (unsigned)slots_.size(), &params);
+
+    if(fd < 0) return false;
+
+    sq_size_   = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_   = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(cq_size_ > sq_size_) sq_size_ = cq_size_;
+        cq_size_ = 0;   // completion ring shares the mapping of the submission ring
+    }
+
+    sq_ptr_   = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cq_ptr_   = cq_size_ ? mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING) : sq_ptr_;
+    sqes_ptr_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    ring_fd_ = fd;
+
+    if(sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED || sqes_ptr_ == MAP_FAILED) {
+        TeardownRing();     // the buffer pool is kept for the pwrite threads
+        return false;
+    }
+
+    char* sq = (char*)sq_ptr_;
+    char* cq = (char*)cq_ptr_;
+
+    sq_tail_    = (unsigned*)(sq + params.sq_off.tail);
+    sq_mask_    = (unsigned*)(sq + params.sq_off.ring_mask);
+    sq_array_   = (unsigned*)(sq + params.sq_off.array);
+    cq_head_    = (unsigned*)(cq + params.cq_off.head);
+    cq_tail_    = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask_    = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes_       = cq + params.cq_off.cqes;
+
+
+    // buffers are pinned once instead of on every request
+    std::vector<struct iovec> iov(slots_.size());
+
+    for(size_t i = 0; i < slots_.size(); ++i) {
+        iov[i].iov_base = slots_[i].data;
+        iov[i].iov_len  = buffer_size_;
+    }
+
+    // fails if the buffers exceed RLIMIT_MEMLOCK
+    if(syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iov.data(), (unsigned)iov.size()) < 0) {
+        TeardownRing();     // the buffer pool is kept for the pwrite threads
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Teardown
+
+void logger::uring_file::Teardown() {
+
+    if(!threads_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_.notify_all();
+
+        for(size_t i = 0; i < threads_.size(); ++i) threads_[i].join();
+
+        threads_.clear();
+    }
+
+    TeardownRing();
+
+    memory_.clear();
+    slots_.clear();
+    free_.clear();
+    completed_.clear();
+    tasks_.clear();
+    current_       = -1;
+    buffer_size_   = 0;
+    threads_count_ = 0;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::TeardownRing
+
+void logger::uring_file::TeardownRing() {
+
+#ifdef LOGGER_HAS_URING
+    if(sqes_ptr_ && sqes_ptr_ != MAP_FAILED) munmap(sqes_ptr_, sqes_size_);
+    if(cq_size_ && cq_ptr_ && cq_ptr_ != MAP_FAILED) munmap(cq_ptr_, cq_size_);
+    if(sq_ptr_ && sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_size_);
+    if(ring_fd_ >= 0) close(ring_fd_);
+#endif
+
+    sq_ptr_ = cq_ptr_ = sqes_ptr_ = nullptr;
+    ring_fd_ = -1;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Append
+
+bool logger::uring_file::Append(const char* data, size_t n) {
+
+    while(n) {
+
+        if(current_ < 0 && !Acquire()) return false;
+
+        slot&  target = slots_[current_];
+        size_t part   = buffer_size_ - target.length;
+
+        if(part > n) part = n;
+
+        memcpy(target.data + target.length, data, part);
+
+        target.length += part;
+        data          += part;
+        n             -= part;
+
+        if(target.length == buffer_size_) {
+            Submit((unsigned)current_);
+            current_ = -1;
+        }
+    }
+
+    return !failed_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Acquire
+
+bool logger::uring_file::Acquire() {
+
+    Reap(false);
+
+    while(free_.empty()) {
+        // every buffer is in flight, make sure they are submitted and wait for one
+        if(!inflight_) return false;    // no buffers at all, nothing would ever return one
+        if(!Enter(to_submit_, 0) || !Reap(true)) return false;
+    }
+
+    current_ = (int)free_.back();
+    free_.pop_back();
+
+    slots_[current_].length  = 0;
+    slots_[current_].written = 0;
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Submit
+
+void logger::uring_file::Submit(unsigned index) {
+
+    slot& target = slots_[index];
+
+    if(target.written == 0) {   // not a retry of a short write
+        target.offset = offset_;
+        offset_      += (long long)target.length;
+        ++inflight_;
+    }
+
+#ifdef LOGGER_HAS_URING
+    if(ring_fd_ >= 0) {
+
+        unsigned tail = *sq_tail_;
+        unsigned i    = tail & *sq_mask_;
+
+        struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes_ptr_ + i;
+
+        memset(sqe, 0, sizeof(*sqe));
+
+        sqe->opcode    = IORING_OP_WRITE_FIXED;
+        sqe->fd        = fd_;
+        sqe->addr      = (unsigned long long)(target.data + target.written);
+        sqe->len       = (unsigned)(target.length - target.written);
+        sqe->off       = (unsigned long long)(target.offset + (long long)target.written);
+        sqe->buf_index = (unsigned short)index;
+        sqe->user_data = index;
+
+        sq_array_[i] = i;
+
+        std::atomic_thread_fence(std::memory_order_release);
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        // requests are submitted in batches of a half of the pool
+        if(++to_submit_ * 2 >= slots_.size()) Enter(to_submit_, 0);
+
+        return;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(index);
+    }
+    work_.notify_one();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Enter
+
+bool logger::uring_file::Enter(unsigned submit, unsigned wait) {
+
+#ifdef LOGGER_HAS_URING
+    if(ring_fd_ < 0) return true;
+
+    for(;;) {
+
+        long result = syscall(__NR_io_uring_enter, ring_fd_, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+        if(result >= 0) {
+            to_submit_ -= (unsigned)result < submit ? (unsigned)result : submit;
+            return true;
+        }
+
+        if(errno != EINTR) {
+            failed_ = true;
+            return false;
+        }
+    }
+#else
+    return true;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Reap
+
+bool logger::uring_file::Reap(bool wait) {
+
+#ifdef LOGGER_HAS_URING
+    if(ring_fd_ >= 0) {
+
+        for(;;) {
+
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+            if(head != tail) {
+
+                for(; head != tail; ++head) {
+
+                    struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes_ + (head & *cq_mask_);
+
+                    unsigned index  = (unsigned)cqe->user_data;
+                    long     result = (long)cqe->res;
+
+                    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);   // entry can be reused
+
+                    Complete(index, result);
+                }
+
+                return true;
+            }
+
+            if(!wait || inflight_ == 0) return true;
+
+            if(!Enter(to_submit_, 1)) return false;
+        }
+    }
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if(wait && inflight_ > 0) {
+        done_.wait(lock, [this]{ return !completed_.empty(); });
+    }
+
+    std::vector<std::pair<unsigned, long> > completed;
+
+    completed.swap(completed_);
+
+    lock.unlock();
+
+    for(size_t i = 0; i < completed.size(); ++i) {
+        Complete(completed[i].first, completed[i].second);
+    }
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Complete
+
+void logger::uring_file::Complete(unsigned index, long result) {
+
+    slot& target = slots_[index];
+
+    if(result < 0) {
+        failed_ = true;
+    } else {
+        target.written += (size_t)result;
+
+        if(result > 0 && target.written < target.length) {
+            Submit(index);  // short write, write the rest
+            return;
+        }
+
+        if(target.written < target.length) failed_ = true;
+    }
+
+    --inflight_;
+    Release(index);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Release
+
+void logger::uring_file::Release(unsigned index) {
+
+    free_.push_back(index);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::RunWriter
+
+void logger::uring_file::RunWriter() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for(;;) {
+
+        work_.wait(lock, [this]{ return stop_ || !tasks_.empty(); });
+
+        if(tasks_.empty()) return;
+
+        unsigned index = tasks_.front();
+        tasks_.pop_front();
+
+        slot& target = slots_[index];
+
+        lock.unlock();
+
+        long result;
+
+#ifdef OS_UNIX
+        do {
+            result = (long)pwrite(fd_, target.data + target.written, target.length - target.written, (off_t)(target.offset + (long long)target.written));
+        } while(result < 0 && errno == EINTR);
+#else
+        result = -1;
+#endif
+
+        lock.lock();
+
+        completed_.push_back(std::make_pair(index, result));
+        done_.notify_one();
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Flush
+
+bool logger::uring_file::Flush() {
+
+    if(current_ >= 0 && slots_[current_].length) {
+        Submit((unsigned)current_);
+        current_ = -1;
+    }
+
+    Enter(to_submit_, 0);
+
+    while(inflight_ > 0) {
+        if(!Reap(true)) break;
+    }
+
+    bool result = !failed_;
+
+    failed_ = false;
+
+    return result;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::uring_file::Close
+
+void logger::uring_file::Close() {
+
+    if(fd_ < 0) return;
+
+    Flush();
+
+    if(current_ >= 0) {
+        Release((unsigned)current_);
+        current_ = -1;
+    }
+
+#ifdef OS_UNIX
+    close(fd_);
+#endif
+
+    fd_ = -1;
+
+}
+
+#endif /* LOG_URING_HPP */
+
+
+
+
+// log_retention.hpp
+
+#ifndef LOG_RETENTION_HPP
+#define LOG_RETENTION_HPP
+
+#include <time.h>                   // time_t, time
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <map>                      // std::map
+#include <set>                      // std::set
+#include <algorithm>                // std::sort
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <condition_variable>       // std::condition_variable
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <dirent.h>                 // opendir, readdir, closedir
+#include <sys/stat.h>               // stat
+#include <unistd.h>                 // unlink, rmdir
+#define OS_UNIX
+#endif
+
+
+namespace logger {
+
+    // @struct log_entry
+    //
+    //
+    // @member path    - std::string        : path to the file
+    // @member kind    - std::string        : extension of the file, e.g. ".log" or ".bin"
+    // @member day     - long               : day of the file as yyyymmdd
+    // @member segment - size_t             : number of the segment of the day
+    // @member size    - unsigned long long : size of the file
+    //
+    //
+    // log file found in logs/{year}/{month}
+
+    struct log_entry {
+        std::string         path;
+        std::string         kind;
+        long                day;
+        size_t              segment;
+        unsigned long long  size;
+
+        bool operator<(const log_entry& other) const {
+            return day != other.day ? day < other.day : segment < other.segment;
+        }
+    };
+
+
+
+
+    // @function ParseLogName(name, entry)
+    //
+    //
+    // @param name  - const char*        : file name "ddmmyyyy.ext" or "ddmmyyyy.N.ext"
+    // @param entry - logger::log_entry* : day, segment and kind of the file
+    //
+    // @return bool
+    //
+    //
+    // return false if @name is not a name of a log file
+
+    bool ParseLogName(const char*, log_entry*);
+
+
+
+
+    // @function ListLogFiles(directory, entries, directories)
+    //
+    //
+    // @param directory   - const std::string&          : logs directory
+    // @param entries     - std::vector<log_entry>*      : log files of logs/{year}/{month} sorted from the oldest
+    // @param directories - std::vector<std::string>*   : month directories followed by year directories
+    //
+    // @return void
+    //
+    //
+    // find every log file in @directory, does nothing on Windows
+
+    void ListLogFiles(const std::string&, std::vector<log_entry>*, std::vector<std::string>*);
+
+
+
+
+    // @function DayOf(time)
+    //
+    //
+    // @param time - time_t : point of time
+    //
+    // @return long
+    //
+    //
+    // local day of @time as yyyymmdd
+
+    long DayOf(time_t);
+
+
+
+
+    // @class log_retention
+    //
+    //
+    // @method Start(max_bytes, max_days)
+    //      @return void
+    //
+    //      start the background thread that keeps at most @max_bytes bytes
+    //      and at most @max_days days of log files, 0 - no limit
+    //      has no effect on Windows
+    //
+    // @method Request(directory, current)
+    //      @return void
+    //
+    //      ask the background thread to enforce limits in @directory,
+    //      @current is the file being written, it is never deleted
+    //      never waits for the files to be deleted
+    //
+    //
+    // deletes the oldest files of logs/{year}/{month} and directories left empty by that,
+    // the latest segment of every kind of today's files is kept as it may be opened by a sink,
+    // directories that were empty before are kept as a sink may be about to open a file there
+
+    class log_retention {
+    public:
+
+        log_retention() : max_bytes_(0), max_days_(0), requested_(false), stop_(false) {}
+        ~log_retention();
+
+        log_retention(const log_retention&) = delete;
+        log_retention& operator=(const log_retention&) = delete;
+
+        void    Start(unsigned long long, unsigned);
+        void    Request(const std::string&, const std::string&);
+
+    private:
+
+        void    Run();
+        void    Enforce(const std::string&, const std::string&, unsigned long long, unsigned);
+
+        std::thread             thread_;
+        std::mutex              mutex_;
+        std::condition_variable wake_;
+        unsigned long long      max_bytes_;
+        unsigned                max_days_;
+        std::string             directory_;     // logs directory of the latest request
+        std::string             current_;       // file being written
+        bool                    requested_;
+        bool                    stop_;
+
+    };
+
+
+
+
+    // @member log_retention_
+    //
+    // retention of files written by FileLog
+
+    log_retention log_retention_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ParseLogName
+
+bool logger::ParseLogName(const char* name, logger::log_entry* entry) {
+
+    long digits[8];
+
+    for(int i = 0; i < 8; ++i) {
+        if(name[i] < '0' || name[i] > '9') return false;
+        digits[i] = name[i] - '0';
+    }
+
+    if(name[8] != '.') return false;
+
+    entry->day = (digits[4] * 1000 + digits[5] * 100 + digits[6] * 10 + digits[7]) * 10000 +
+                 (digits[2] * 10 + digits[3]) * 100 + digits[0] * 10 + digits[1];
+
+    entry->segment = 0;
+
+    const char* rest = name + 8;
+    const char* p    = rest + 1;
+
+    while(*p >= '0' && *p <= '9') {
+        entry->segment = entry->segment * 10 + (size_t)(*p - '0');
+        ++p;
+    }
+
+    if(p != rest + 1 && *p == '.') {
+        rest = p;               // "ddmmyyyy.N.ext"
+    }
+    else {
+        entry->segment = 0;     // "ddmmyyyy.ext"
+    }
+
+    entry->kind = rest;
+
+    return true;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ListLogFiles
+
+void logger::ListLogFiles(const std::string& directory, std::vector<logger::log_entry>* entries, std::vector<std::string>* directories) {
+
+#ifdef OS_UNIX
+    std::vector<std::string> years;
+
+    DIR* root = opendir(directory.c_str());
+
+    if(!root) return;
+
+    for(struct dirent* year = readdir(root); year; year = readdir(root)) {
+
+        if(year->d_name[0] == '.') continue;
+
+        std::string year_path = directory + '/' + year->d_name;
+        DIR*        months    = opendir(year_path.c_str());
+
+        if(!months) continue;
+
+        for(struct dirent* month = readdir(months); month; month = readdir(months)) {
+
+            if(month->d_name[0] == '.') continue;
+
+            std::string month_path = year_path + '/' + month->d_name;
+            DIR*        files      = opendir(month_path.c_str());
+
+            if(!files) continue;
+
+            for(struct dirent* file = readdir(files); file; file = readdir(files)) {
+
+                logger::log_entry entry;
+                struct stat       st;
+
+                if(!logger::ParseLogName(file->d_name, &entry)) continue;
+
+                entry.path = month_path + '/' + file->d_name;
+
+                if(stat(entry.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+                entry.size = (unsigned long long)st.st_size;
+                entries->push_back(entry);
+            }
+
+            closedir(files);
+            directories->push_back(month_path);
+        }
+
+        closedir(months);
+        years.push_back(year_path);
+    }
+
+    closedir(root);
+
+    directories->insert(directories->end(), years.begin(), years.end());
+
+    std::sort(entries->begin(), entries->end());
+#else
+    (void)directory;
+    (void)entries;
+    (void)directories;
+#endif // OS_UNIX
+
+}
+
+
+
+
+// @Implementation of
+//  logger::DayOf
+
+long logger::DayOf(time_t time) {
+
+    struct tm local;
+
+    logger::LocalTime(time, &local);
+
+    return (local.tm_year + 1900L) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::~log_retention
+
+logger::log_retention::~log_retention() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_one();
+
+    if(thread_.joinable()) thread_.join();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Start
+
+void logger::log_retention::Start(unsigned long long max_bytes, unsigned max_days) {
+
+#ifdef OS_UNIX
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    max_bytes_ = max_bytes;
+    max_days_  = max_days;
+
+    if(!thread_.joinable()) {
+        thread_ = std::thread(&log_retention::Run, this);
+    }
+#endif // OS_UNIX
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Request
+
+void logger::log_retention::Request(const std::string& directory, const std::string& current) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(!thread_.joinable()) return;
+
+        directory_ = directory;
+        current_   = current;
+        requested_ = true;
+    }
+
+    wake_.notify_one();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Run
+
+void logger::log_retention::Run() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for(;;) {
+
+        wake_.wait(lock, [this]{ return requested_ || stop_; });
+
+        if(stop_) return;
+
+        requested_ = false;
+
+        std::string directory = directory_;
+        std::string current   = current_;
+
+        unsigned long long max_bytes = max_bytes_;
+        unsigned           max_days  = max_days_;
+
+        lock.unlock();
+
+        Enforce(directory, current, max_bytes, max_days);
+
+        lock.lock();
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_retention::Enforce
+
+void logger::log_retention::Enforce(const std::string& directory, const std::string& current, unsigned long long max_bytes, unsigned max_days) {
+
+#ifdef OS_UNIX
+    std::vector<logger::log_entry>  entries;
+    std::vector<std::string>        directories;
+
+    logger::ListLogFiles(directory, &entries, &directories);
+
+
+    // files that can be opened by a sink right now
+    time_t now    = time(nullptr);
+    long   today  = logger::DayOf(now);
+    long   oldest = 0;
+
+    if(max_days) {
+        oldest = logger::DayOf(now - (time_t)max_days * 86400);
+    }
+
+    std::map<std::string, size_t> latest;   // kind -> latest segment of today
+    std::set<std::string>         emptied;  // directories files were deleted from
+    unsigned long long            total = 0;
+
+    for(size_t i = 0; i < entries.size(); ++i) {
+
+        total += entries[i].size;
+
+        if(entries[i].day == today) latest[entries[i].kind] = entries[i].segment;
+    }
+
+
+    for(size_t i = 0; i < entries.size(); ++i) {
+
+        const logger::log_entry& entry = entries[i];
+
+        bool expired  = max_days && entry.day <= oldest;
+        bool overflow = max_bytes && total > max_bytes;
+
+        if(!expired && !overflow) break;    // entries are sorted from the oldest
+
+        if(entry.path == current) continue;
+        if(entry.day >= today && latest[entry.kind] == entry.segment) continue;
+
+        if(unlink(entry.path.c_str()) == 0) {
+            total -= entry.size;
+            emptied.insert(entry.path.substr(0, entry.path.rfind('/')));
+        }
+    }
+
+
+    for(size_t i = 0; i < directories.size(); ++i) {     // months come before their years
+
+        const std::string& path = directories[i];
+
+        if(!emptied.count(path)) continue;
+        if(current.compare(0, path.length() + 1, path + '/') == 0) continue;  // holds the file being written
+
+        if(rmdir(path.c_str()) == 0) {      // fails unless the directory is empty
+            emptied.insert(path.substr(0, path.rfind('/')));
+        }
+    }
+#else
+    (void)directory;
+    (void)current;
+    (void)max_bytes;
+    (void)max_days;
+#endif // OS_UNIX
+
+}
+
+#endif /* LOG_RETENTION_HPP */
+
+
+
+
+// log_compress.hpp
+
+#ifndef LOG_COMPRESS_HPP
+#define LOG_COMPRESS_HPP
+
+#include <stdio.h>                  // FILE, fopen, fread, fwrite, rename, remove
+#include <string.h>                 // memcpy, memmove, memset
+#include <time.h>                   // clock_gettime
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <deque>                    // std::deque
+#include <atomic>                   // std::atomic
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <chrono>                   // std::chrono::nanoseconds
+#include <condition_variable>       // std::condition_variable
+
+#if defined(_WIN32) | defined(_WIN64)
+#define OS_WIN
+#else
+#include <unistd.h>                 // fsync, unlink, link, access
+#define OS_UNIX
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>           // setpriority
+#include <sys/syscall.h>            // SYS_gettid
+#endif
+
+#ifdef LOGGER_ZLIB
+#include <zlib.h>                   // deflate, crc32
+#endif
+
+
+namespace logger {
+
+    // @function CompressLogFile(path, level, budget, stop)
+    //
+    //
+    // @param path   - const std::string&       : closed log file
+    // @param level  - int                      : zlib compression level
+    // @param budget - double                   : share of one CPU the compression may use, 1 - no limit
+    // @param stop   - const std::atomic<bool>* : checked between blocks, compression is abandoned if it is set
+    //
+    // @return bool
+    //
+    //
+    // replace @path with @path.gz in BGZF format: a sequence of independent gzip members
+    // of at most 64 KB each followed by an empty member, so every block can be found by
+    // walking the headers and decompressed on its own, and the whole file by gzip -d or zcat
+    // blocks end at a line boundary when a line fits into one block
+    // an existing @path.gz is never replaced, @path is left as it is then
+    // return false if the file is not compressed, always without LOGGER_ZLIB
+
+    bool CompressLogFile(const std::string&, int, double, const std::atomic<bool>*);
+
+
+
+
+    // @class log_compressor
+    //
+    //
+    // @method Start(directory, level, budget)
+    //      @return void
+    //
+    //      start the background thread and compress log files left in @directory
+    //      except the latest segment of today
+    //      has no effect without LOGGER_ZLIB or on Windows
+    //
+    // @method Request(path)
+    //      @return void
+    //
+    //      compress closed log file @path, never waits for the compression
+    //
+    //
+    // compresses closed log files on a background thread with the lowest priority
+    // that sleeps as long as needed to keep its CPU usage within the budget
+
+    class log_compressor {
+    public:
+
+        log_compressor() : level_(6), budget_(1), stop_(false) {}
+        ~log_compressor();
+
+        log_compressor(const log_compressor&) = delete;
+        log_compressor& operator=(const log_compressor&) = delete;
+
+        void    Start(const std::string&, int, double);
+        void    Request(const std::string&);
+
+    private:
+
+        void    Run();
+
+        std::thread             thread_;
+        std::mutex              mutex_;
+        std::condition_variable wake_;
+        std::deque<std::string> paths_;     // files waiting for compression
+        std::string             directory_; // logs directory to look for left files in, empty - none
+        int                     level_;
+        double                  budget_;
+        std::atomic<bool>       stop_;
+
+    };
+
+
+
+
+    // @member log_compressor_
+    //
+    // compression of files closed by FileLog
+
+    log_compressor log_compressor_;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::CompressLogFile
+
+bool logger::CompressLogFile(const std::string& path, int level, double budget, const std::atomic<bool>* stop) {
+
+#if defined(LOGGER_ZLIB) && defined(OS_UNIX)
+    static const unsigned char eof_block[28] = {
+        0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+
+    const size_t block_size = 0xff00;   // input of one block, its output always fits into 64 KB
+
+    std::string target = path + ".gz";
+    std::string temp   = target + ".tmp";
+
+    if(access(target.c_str(), F_OK) == 0) return false;    // written by an earlier run for another file of the same name
+
+    FILE* in = fopen(path.c_str(), "rb");
+
+    if(!in) return false;
+
+    FILE* out = fopen(temp.c_str(), "wb");
+
+    if(!out) {
+        fclose(in);
+        return false;
+    }
+
+
+    z_stream stream;
+
+    memset(&stream, 0, sizeof(stream));
+
+    if(deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fclose(in);
+        fclose(out);
+        remove(temp.c_str());
+        return false;
+    }
+
+    std::vector<unsigned char> input(block_size);
+    std::vector<unsigned char> output(18 + deflateBound(&stream, block_size) + 8);
+
+    size_t filled = 0;
+    bool   eof    = false;
+    bool   ok     = true;
+
+    while(ok && !*stop) {
+
+        struct timespec started;
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &started);
+
+
+        if(!eof) {
+            filled += fread(input.data() + filled, 1, block_size - filled, in);
+            eof     = filled < block_size;
+        }
+
+        if(!filled) break;
+
+
+        // cut the block after the last complete line
+        size_t length = filled;
+
+        if(!eof) {
+            size_t line_end = filled;
+
+            while(line_end > 0 && input[line_end - 1] != '\n') --line_end;
+
+            if(line_end) length = line_end;
+        }
+
+
+        deflateReset(&stream);
+
+        stream.next_in   = input.data();
+        stream.avail_in  = (uInt)length;
+        stream.next_out  = output.data() + 18;
+        stream.avail_out = (uInt)(output.size() - 26);
+
+        if(deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+            ok = false;
+            break;
+        }
+
+        size_t          total = 18 + stream.total_out + 8;
+        unsigned        crc   = (unsigned)crc32(0, input.data(), (uInt)length);
+        unsigned char*  h     = output.data();
+
+        const unsigned char header[16] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0 };
+
+        memcpy(h, header, 16);
+        h[16] = (unsigned char)((total - 1) & 0xff);
+        h[17] = (unsigned char)((total - 1) >> 8);
+
+        unsigned char* t = h + 18 + stream.total_out;
+
+        for(int i = 0; i < 4; ++i) {
+            t[i]     = (unsigned char)(crc >> (8 * i));
+            t[4 + i] = (unsigned char)(length >> (8 * i));
+        }
+
+        ok = fwrite(h, 1, total, out) == total;
+
+
+        memmove(input.data(), input.data() + length, filled - length);
+        filled -= length;
+
+
+        // sleep for the time the budget leaves to other threads
+        struct timespec finished;
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &finished);
+
+        if(budget > 0 && budget < 1) {
+
+            long long spent = (long long)(finished.tv_sec - started.tv_sec) * 1000000000 + (finished.tv_nsec - started.tv_nsec);
+
+            std::this_thread::sleep_for(std::chrono::nanoseconds((long long)(spent * (1 / budget - 1))));
+        }
+    }
+
+    deflateEnd(&stream);
+    fclose(in);
+
+    ok = ok && !*stop && filled == 0 && fwrite(eof_block, 1, sizeof(eof_block), out) == sizeof(eof_block);
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    ok = fclose(out) == 0 && ok;
+
+    // link fails if the target appeared meanwhile, rename would replace it
+    if(!ok || link(temp.c_str(), target.c_str()) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+
+    unlink(temp.c_str());
+    unlink(path.c_str());
+
+    return true;
+#else
+    (void)path;
+    (void)level;
+    (void)budget;
+    (void)stop;
+
+    return false;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::~log_compressor
+
+logger::log_compressor::~log_compressor() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_one();
+
+    if(thread_.joinable()) thread_.join();   // a file being compressed is left for the next start
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::Start
+
+void logger::log_compressor::Start(const std::string& directory, int level, double budget) {
+
+#if defined(LOGGER_ZLIB) && defined(OS_UNIX)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        level_     = level;
+        budget_    = budget;
+        directory_ = directory;
+
+        if(!thread_.joinable()) {
+            thread_ = std::thread(&log_compressor::Run, this);
+        }
+    }
+
+    wake_.notify_one();
+#else
+    (void)directory;
+    (void)level;
+    (void)budget;
+#endif
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::Request
+
+void logger::log_compressor::Request(const std::string& path) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(!thread_.joinable()) return;
+
+        paths_.push_back(path);
+    }
+
+    wake_.notify_one();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::log_compressor::Run
+
+void logger::log_compressor::Run() {
+
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);   // the lowest priority for this thread only
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for(;;) {
+
+        wake_.wait(lock, [this]{ return stop_ || !paths_.empty() || !directory_.empty(); });
+
+        if(stop_) return;
+
+
+        // files closed before the start
+        if(!directory_.empty()) {
+
+            std::string directory;
+
+            directory.swap(directory_);
+
+            lock.unlock();
+
+            std::vector<logger::log_entry>  entries;
+            std::vector<std::string>        directories;
+
+            logger::ListLogFiles(directory, &entries, &directories);
+
+            long   today  = logger::DayOf(time(nullptr));
+            size_t latest = 0;
+
+            for(size_t i = 0; i < entries.size(); ++i) {
+                if(entries[i].day == today && entries[i].kind == ".log") latest = entries[i].segment;
+            }
+
+            lock.lock();
+
+            for(size_t i = 0; i < entries.size(); ++i) {
+
+                if(entries[i].kind != ".log") continue;
+                if(entries[i].day >= today && entries[i].segment >= latest) continue;
+
+                paths_.push_back(entries[i].path);
+            }
+
+            continue;
+        }
+
+
+        std::string path   = paths_.front();
+        int         level  = level_;
+        double      budget = budget_;
+
+        paths_.pop_front();
+
+        lock.unlock();
+
+        logger::CompressLogFile(path, level, budget, &stop_);
+
+        lock.lock();
+    }
+
+}
+
+#endif /* LOG_COMPRESS_HPP */
+
+
+
+
+// log_json.hpp
+
+#ifndef LOG_JSON_HPP
+#define LOG_JSON_HPP
+
+#include <stdio.h>                  // snprintf
+#include <stdlib.h>                 // strtod
+#include <string.h>                 // strlen
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <ostream>                  // std::ostream
+
+// strings are scanned 16 bytes at a time where SSE2 is available
+#if !defined(LOGGER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>              // _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8
+#define LOGGER_SSE2
+#endif
+
+
+namespace logger {
+
+    // template<T>
+    // @struct key_value
+    //
+    //
+    // @member key   - const char* : name of the field
+    // @member value - const T&    : value of the field
+    //
+    //
+    // named field of a structured log call, see logger::kv
+
+    template <class T>
+    struct key_value {
+        const char*     key;
+        const T&        value;
+    };
+
+
+
+
+    // template<T>
+    // @function kv(key, value)
+    //
+    //
+    // @param key   - const char* : name of the field
+    // @param value - const T&    : value of the field
+    //
+    // @return logger::key_value<T>
+    //
+    //
+    // field that is written as "key":value by the JSON-lines file sink and as key=value elsewhere
+    // the value is referenced, not copied, so kv is used only as an argument of a log call
+
+    template <class T>
+    key_value<T> kv(const char* key, const T& value) { return key_value<T>{ key, value }; }
+
+
+
+
+    // template<T>
+    // @function operator<<(os, field)
+    //
+    //
+    // @param os    - std::ostream&                 : target stream
+    // @param field - const logger::key_value<T>&   : field
+    //
+    // @return std::ostream&
+    //
+    //
+    // put key=value, so fields are written by every sink
+
+    template <class T>
+    std::ostream& operator<<(std::ostream&, const key_value<T>&);
+
+
+
+
+    // @function AppendJsonString(s, data, n)
+    //
+    //
+    // @param s    - std::string& : target string
+    // @param data - const char*  : UTF-8 text
+    // @param n    - size_t       : length of @data
+    //
+    // @return void
+    //
+    //
+    // append @data as a quoted JSON string, runs without '"', '\' and control characters
+    // are found 16 bytes at a time with SSE2 and copied at once
+
+    void AppendJsonString(std::string&, const char*, size_t);
+
+
+
+
+    // @function AppendJson(s, var)
+    //
+    //
+    // @param s   - std::string& : target string
+    // @param var - T            : value
+    //
+    // @return void
+    //
+    //
+    // append @var as a JSON value: numbers and booleans as they are, NaN and infinities as null,
+    // everything else as a string converted like logger::AppendVar does it
+
+    void AppendJson(std::string&, bool);
+    void AppendJson(std::string&, short);
+    void AppendJson(std::string&, unsigned short);
+    void AppendJson(std::string&, int);
+    void AppendJson(std::string&, unsigned int);
+    void AppendJson(std::string&, long);
+    void AppendJson(std::string&, unsigned long);
+    void AppendJson(std::string&, long long);
+    void AppendJson(std::string&, unsigned long long);
+    void AppendJson(std::string&, float);
+    void AppendJson(std::string&, double);
+    void AppendJson(std::string&, long double);
+    void AppendJson(std::string&, const char*);
+    void AppendJson(std::string&, const std::string&);
+
+    template <class T>
+    void AppendJson(std::string&, const T&);
+
+
+
+
+    // @function ProcessJson(message, fields, args)
+    //
+    //
+    // @param message - std::string& : values without a key separated by spaces
+    // @param fields  - std::string& : ,"key":value for every logger::key_value
+    // @param args    - pack         : arguments of a log call
+    //
+    // @return void
+
+    void ProcessJson(std::string&, std::string&);
+
+    template <class T, class ...Args>
+    void ProcessJson(std::string&, std::string&, const T&, const Args&...);
+
+    template <class T, class ...Args>
+    void ProcessJson(std::string&, std::string&, const key_value<T>&, const Args&...);
+
+
+
+
+    // @function ProcessJsonVars(buffer, args)
+    //
+    //
+    // @param buffer - logger::var_buffer* : buffer the fields are appended to as one variable
+    // @param args   - pack                : arguments of a log call
+    //
+    // @return void
+    //
+    //
+    // append "msg":"..." followed by ,"key":value of every logger::key_value of @args
+
+    template <class ...Args>
+    void ProcessJsonVars(var_buffer*, const Args&...);
+
+
+
+
+    // @function AppendJsonHead(s, date_time, type, filename, line, func)
+    //
+    //
+    // @param s         - std::string&             : target string
+    // @param date_time - const char*              : "YYYY-MM-DD HH:MM:SS"
+    // @param type      - logger::log_message_type : type of message
+    // @param filename  - const char*              : file where the record was made
+    // @param line      - int                      : line where the record was made
+    // @param func      - const char*              : function where the record was made
+    //
+    // @return void
+    //
+    //
+    // open a JSON-lines record: {"time":..,"level":..,"file":..,"line":..,"func":..,
+    // fields of the record and "}\n" are appended by the caller
+
+    void AppendJsonHead(std::string&, const char*, log_message_type, const char*, int, const char*);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::operator<<
+
+template <class T>
+std::ostream& logger::operator<<(std::ostream& os, const logger::key_value<T>& field) {
+
+    return os << field.key << '=' << field.value;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJsonString
+
+void logger::AppendJsonString(std::string& s, const char* data, size_t n) {
+
+    static const char hex[] = "0123456789abcdef";
+
+    s += '"';
+
+    size_t start = 0;   // first byte that is not appended yet
+
+    for(size_t i = 0; i < n; ) {
+
+#ifdef LOGGER_SSE2
+        if(i + 16 <= n) {
+
+            __m128i bytes   = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));   // <= 0x1f
+            __m128i quote   = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+            __m128i slash   = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(control, _mm_or_si128(quote, slash)));
+
+            if(!mask) {
+                i += 16;
+                continue;
+            }
+
+#if defined(__GNUC__) || defined(__clang__)
+            i += (size_t)__builtin_ctz(mask);
+#else
+            while(!(mask & 1)) {
+                mask >>= 1;
+                ++i;
+            }
+#endif
+        }
+#endif
+
+        unsigned char c = (unsigned char)data[i];
+
+        if(c >= 0x20 && c != '"' && c != '\\') {
+            ++i;
+            continue;
+        }
+
+        s.append(data + start, i - start);
+
+        switch(c) {
+            case '"':   s.append("\\\"");   break;
+            case '\\':  s.append("\\\\");   break;
+            case '\n':  s.append("\\n");    break;
+            case '\r':  s.append("\\r");    break;
+            case '\t':  s.append("\\t");    break;
+            case '\b':  s.append("\\b");    break;
+            case '\f':  s.append("\\f");    break;
+            default:
+                s.append("\\u00");
+                s += hex[c >> 4];
+                s += hex[c & 15];
+                break;
+        }
+
+        start = ++i;
+    }
+
+    s.append(data + start, n - start);
+    s += '"';
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+void logger::AppendJson(std::string& s, bool var)                   { s.append(var ? "true" : "false"); }
+void logger::AppendJson(std::string& s, short var)                  { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned short var)         { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, int var)                    { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned int var)           { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, long var)                   { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned long var)          { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, long long var)              { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, unsigned long long var)     { logger::AppendVar(s, var); }
+void logger::AppendJson(std::string& s, float var)                  { logger::AppendJson(s, (double)var); }
+void logger::AppendJson(std::string& s, long double var)            { logger::AppendJson(s, (double)var); }
+void logger::AppendJson(std::string& s, const std::string& var)     { logger::AppendJsonString(s, var.data(), var.length()); }
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+void logger::AppendJson(std::string& s, double var) {
+
+    if(var != var || var - var != 0) {     // NaN or infinity
+        s.append("null");
+        return;
+    }
+
+    char buffer[32];
+
+    int n = snprintf(buffer, sizeof(buffer), "%.15g", var);
+
+    if(strtod(buffer, nullptr) != var) {
+        n = snprintf(buffer, sizeof(buffer), "%.17g", var);    // the shortest precision that round-trips
+    }
+
+    s.append(buffer, n > 0 ? (size_t)n : 0);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+void logger::AppendJson(std::string& s, const char* var) {
+
+    if(!var) {
+        s.append("null");
+        return;
+    }
+
+    logger::AppendJsonString(s, var, strlen(var));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJson
+
+template <class T>
+void logger::AppendJson(std::string& s, const T& var) {
+
+    logger::thread_frame<std::string> text;     // converted value, escaped as a whole
+
+    text->clear();
+
+    logger::AppendVar(*text, var);
+    logger::AppendJsonString(s, text->data(), text->length());
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessJson
+
+void logger::ProcessJson(std::string&, std::string&) {}
+
+
+
+
+// @Implementation of
+//  logger::ProcessJson
+
+template <class T, class ...Args>
+void logger::ProcessJson(std::string& message, std::string& fields, const T& var, const Args&... args) {
+
+    if(!message.empty()) message += ' ';
+
+    logger::AppendVar(message, var);
+
+    logger::ProcessJson(message, fields, args...);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::ProcessJson
+
+template <class T, class ...Args>
+void logger::ProcessJson(std::string& message, std::string& fields, const logger::key_value<T>& field, const Args&... args) {
+
+    fields += ',';
+    logger::AppendJsonString(fields, field.key, strlen(field.key));
+    fields += ':';
+    logger::AppendJson(fields, field.value);
+
+    logger::ProcessJson(message, fields, args...);
+
+}
+
+
+
+
+
+// @Implementation of
+//  logger::ProcessJsonVars
+
+template <class ...Args>
+void logger::ProcessJsonVars(logger::var_buffer* buffer, const Args&... args) {
+
+    logger::thread_frame<std::string> message;  // values without a key
+    logger::thread_frame<std::string> fields;   // ,"key":value
+
+    message->clear();
+    fields->clear();
+
+    logger::ProcessJson(*message, *fields, args...);
+
+    buffer->data.append("\"msg\":");
+    logger::AppendJsonString(buffer->data, message->data(), message->length());
+    buffer->data.append(*fields);
+
+    buffer->ends.push_back(buffer->data.length());
+
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendJsonHead
+
+void logger::AppendJsonHead(std::string& s, const char* date_time, logger::log_message_type type, const char* filename, int line, const char* func) {
+
+    s.append("{\"time\":");
+    logger::AppendJsonString(s, date_time, 19);
+    s.append(",\"level\":");
+    logger::AppendJson(s, logger::MessageTypeName(type));
+    s.append(",\"file\":");
+    logger::AppendJson(s, filename);
+    s.append(",\"line\":");
+    logger::AppendVar(s, line);
+    s.append(",\"func\":");
+    logger::AppendJson(s, func);
+    s += ',';
+
+}
+
+#endif /* LOG_JSON_HPP */
+
+
+
+
+// log_file.hpp
+
+#ifndef LOG_FILE_HPP
+#define LOG_FILE_HPP
+
+#include <string.h>                 // strrchr
+#include <stdlib.h>                 // atexit
+#include <cstddef>                  // size_t
+#include <time.h>                   // time_t
+#include <string>                   // std::string, std::to_string
+#include <mutex>                    // std::mutex, std::recursive_mutex, std::lock_guard
+#include <atomic>                   // std::atomic
+#include <fstream>                  // std::ofstream
+
+#if defined(_WIN32) | defined(_WIN64)
+#include <windows.h>                // WIN32_FIND_DATA, HANDLE
+#include <sys/stat.h>               // stat
+#define OS_WIN
+#else
+#include <sys/stat.h>               // stat
+#define OS_UNIX
+#endif
+
+
+#define __FILENAME__ (strrchr("/" __FILE__, '/') + 1)
+
+namespace logger {
+    
+    // @member log_directory_
+    //
+    // string with path to logging directory
+    
+    std::string log_directory_;
+    
+    
+    
+    
+    // @member log_directory_mutex_
+    //
+    // guards log_directory_ when it is read by the background writer
+    
+    std::mutex log_directory_mutex_;
+    
+    
+    
+    
+    // @member log_directory_generation_
+    //
+    // incremented every time the logging directory is changed
+    
+    std::atomic<size_t> log_directory_generation_(1);
+    
+    
+    
+    
+    // @struct file_sink
+    //
+    //
+    // @member stream     - std::ofstream       : currently opened log file
+    // @member mapped     - logger::mapped_file : currently opened log file in mapped mode
+    // @member uring      - logger::uring_file  : currently opened log file in io_uring mode
+    // @member path       - logger::log_path    : resolved path and day boundaries of the opened file
+    // @member generation - size_t              : log_directory_generation_ the file was opened for
+    // @member text       - std::string         : rendered record, reused by every write
+    // @member extent     - size_t              : preallocation step of mapped mode, 0 - std::ofstream is used
+    // @member checkpoint - size_t              : bytes between msync calls in mapped mode, 0 - never
+    // @member buffers    - size_t              : number of buffers in io_uring mode, 0 - mode is disabled
+    // @member buffer_size- size_t              : size of one buffer in io_uring mode
+    // @member threads    - size_t              : pwrite threads used when io_uring is unavailable
+    // @member segment_size    - size_t         : size a segment of the day is limited to, 0 - no limit
+    // @member written         - size_t         : size of the opened segment
+    // @member opened          - std::string    : path to the opened log file
+    // @member repeat_interval - time_t         : longest time repeats are held back, 0 - repeats are written
+    // @member repeat_hash     - size_t         : hash of the last written record, 0 - none
+    // @member repeats         - size_t         : number of held back repeats of the last written record
+    // @member repeat_since    - time_t         : time of the first held back repeat
+    // @member repeated        - log_record     : time of the last held back repeat and place of the last record
+    // @member stats_due       - time_t         : time of the next stats record, 0 - not scheduled yet
+    // @member mutex           - std::recursive_mutex : serializes writes and flushes of synchronous FileLog calls
+    //                                                  of several threads, the central flusher and logger::Flush
+    //
+    //
+    // log file that stays opened between FileLog calls until the day changes
+    
+    struct file_sink {
+        std::ofstream   stream;
+        mapped_file     mapped;
+        uring_file      uring;
+        log_path        path;
+        size_t          generation;
+        std::string     text;
+        size_t          extent;
+        size_t          checkpoint;
+        size_t          buffers;
+        size_t          buffer_size;
+        size_t          threads;
+        size_t          segment_size;
+        size_t          written;
+        std::string     opened;
+        time_t          repeat_interval;
+        size_t          repeat_hash;
+        size_t          repeats;
+        time_t          repeat_since;
+        log_record      repeated;
+        time_t          stats_due;
+        std::recursive_mutex mutex;
+    };
+    
+    
+    
+    
+    // @member log_file_
+    //
+    // file sink shared by every FileLog call
+    
+    file_sink log_file_;
+    
+    
+    
+    
+    // @member async_file_log_
+    //
+    // FileLog only passes records to the central flusher
+    
+    bool async_file_log_ = false;
+    
+    
+    
+    
+    // @member json_file_log_
+    //
+    // FileLog writes JSON lines instead of text
+    
+    bool json_file_log_ = false;
+    
+    
+    
+    
+    // @function BindLogDirectory
+    //
+    //
+    // @param s - const char* : null terminated string, relative or full path to log directory
+    //
+    // @return void
+    //
+    //
+    // Set the logging directory to @s
+    
+    void BindLogDirectory(const char*);
+    
+    
+    
+    
+    // @function EnableAsyncFileLog(capacity)
+    //
+    //
+    // @param capacity - size_t : maximum number of records waiting to be written per thread
+    //
+    // @return void
+    //
+    //
+    // switch FileLog to asynchronous mode: calls only capture the record into
+    // the ring of the calling thread and the central flusher writes it to the log file
+    // errors of the background thread are reported by logger::Flush
+    // pending records are written when the program exits
+    
+    void EnableAsyncFileLog(size_t capacity = 1024);
+    
+    
+    
+    
+    // @function EnableMappedFileLog(extent, checkpoint)
+    //
+    //
+    // @param extent     - size_t : number of bytes the log file is preallocated by
+    // @param checkpoint - size_t : msync written data every @checkpoint bytes, 0 - never
+    //
+    // @return void
+    //
+    //
+    // write log files through a shared memory mapping instead of std::ofstream:
+    // appending a record is a memcpy until the preallocated extent is used up
+    // files are truncated to their real length at rollover and when the program exits
+    // has no effect on Windows, should be called before the first FileLog call
+    
+    void EnableMappedFileLog(size_t extent = 16 << 20, size_t checkpoint = 0);
+    
+    
+    
+    
+    // @function EnableUringFileLog(buffers, buffer_size, threads)
+    //
+    //
+    // @param buffers     - size_t : number of buffers records are collected in
+    // @param buffer_size - size_t : size of one buffer
+    // @param threads     - size_t : number of pwrite threads used when io_uring is unavailable
+    //
+    // @return void
+    //
+    //
+    // write log files through io_uring instead of std::ofstream: rendered records are
+    // copied to a buffer and a full buffer is submitted without waiting for the write,
+    // so records reach the file when their buffer is full or on logger::Flush
+    // falls back to a pool of @threads threads calling pwrite if io_uring cannot be set up
+    // has no effect on Windows, should be called before the first FileLog call
+    
+    void EnableUringFileLog(size_t buffers = 16, size_t buffer_size = 64 << 10, size_t threads = 2);
+    
+    
+    
+    
+    // @function EnableSegmentFileLog(segment_size)
+    //
+    //
+    // @param segment_size - size_t : size a log file is limited to
+    //
+    // @return void
+    //
+    //
+    // split log files of a day into segments ddmmyyyy.log, ddmmyyyy.1.log, ddmmyyyy.2.log, ...
+    // a record is never split between segments, the next segment is opened when
+    // the record does not fit into the current one
+    
+    void EnableSegmentFileLog(size_t segment_size);
+    
+    
+    
+    
+    // @function EnableLogRetention(max_bytes, max_days)
+    //
+    //
+    // @param max_bytes - unsigned long long : total size of log files to keep, 0 - no limit
+    // @param max_days  - unsigned           : number of days to keep log files for, 0 - no limit
+    //
+    // @return void
+    //
+    //
+    // delete the oldest files of the logging directory every time a log file is opened
+    // files are deleted by a background thread, FileLog never waits for it
+    // has no effect on Windows
+    
+    void EnableLogRetention(unsigned long long max_bytes, unsigned max_days = 0);
+    
+    
+    
+    
+    // @function EnableLogCompression(budget, level)
+    //
+    //
+    // @param budget - double : share of one CPU the compression may use, 1 - no limit
+    // @param level  - int    : zlib compression level from 1 to 9
+    //
+    // @return void
+    //
+    //
+    // compress every log file closed by FileLog and files left by previous runs to ddmmyyyy.log.gz
+    // on a background thread with the lowest priority, FileLog never waits for it
+    // compressed files are BGZF: blocks of 64 KB that can be decompressed independently
+    // needs LOGGER_ZLIB defined and zlib linked, has no effect otherwise and on Windows
+    
+    void EnableLogCompression(double budget = 0.25, int level = 6);
+    
+    
+    
+    
+    // @function EnableJsonFileLog()
+    //
+    //
+    // @return void
+    //
+    //
+    // make FileLog write one JSON object per line:
+    // {"time":..,"level":..,"file":..,"line":..,"func":..,"msg":..,"key":value,...}
+    // values without a key are joined by spaces into "msg", every logger::kv becomes a typed field,
+    // errors put their stack into "stack", should be called before the first FileLog call
+    
+    void EnableJsonFileLog();
+    
+    
+    
+    
+    // @function EnableRepeatFileLog(interval)
+    //
+    //
+    // @param interval - time_t : longest time in seconds repeats are held back
+    //
+    // @return void
+    //
+    //
+    // make FileLog hold back records that repeat the previous one: same place, type and values
+    // instead of them a single line "last message repeated N times" is written when
+    // a different record comes, the day changes, @interval seconds pass or the program exits,
+    // after a burst of repeats the line is written by FlushFileSink once it is due
+    
+    void EnableRepeatFileLog(time_t interval = 30);
+    
+    
+    
+    
+    // @function FlushRepeatFileLog()
+    //
+    //
+    // @return bool
+    //
+    //
+    // write the line about held back repeats now and flush the log file
+    
+    bool FlushRepeatFileLog();
+    
+    
+    
+    
+    // @function WriteRepeatRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : unused, makes the function a log_record writer
+    //
+    // @return bool
+    //
+    //
+    // append the line about held back repeats of the last written record to the log file
+    
+    bool WriteRepeatRecord(log_record&);
+    
+    
+    
+    
+    // @function WriteStatsRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record that made the stats due, gives the time
+    //
+    // @return bool
+    //
+    //
+    // append the line with logger::GetStats of every sink to the log file, see logger::EnableStats
+    
+    bool WriteStatsRecord(log_record&);
+    
+    
+    
+    
+    // @function RecordHash(record)
+    //
+    //
+    // @param record - const logger::log_record& : record
+    //
+    // @return size_t
+    //
+    //
+    // FNV-1a hash of place, type and values of @record, never 0
+    
+    size_t RecordHash(const log_record&);
+    
+    
+    
+    
+    // @function WriteFileRecord(record)
+    //
+    //
+    // @param record - logger::log_record& : record to write
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // create log directories and append @record to the log file
+    // return true if everything ok and false if there were errors with file output
+    
+    bool WriteFileRecord(log_record&);
+    
+    
+    
+    
+    // @function WriteFileRecordNow(record)
+    //
+    //
+    // @param record - logger::log_record& : record to write
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // write @record in synchronous mode: std::ofstream is flushed after every record,
+    // io_uring buffers are left to be submitted when they are full
+    
+    bool WriteFileRecordNow(log_record&);
+    
+    
+    
+    
+    // @function OpenLogFile(time)
+    //
+    //
+    // @param time - time_t : time of the record
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // create directories logs/{year}/{month} and open the log file of the day of @time
+    
+    void OpenLogFile(time_t);
+    
+    
+    
+    
+    // @function RotateLogFile()
+    //
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // close the opened log file and open the next segment of the same day
+    
+    void RotateLogFile();
+    
+    
+    
+    
+    // @function OpenLogPath(path)
+    //
+    //
+    // @param path - const std::string& : path to the log file
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // close the opened log file and open @path with the enabled backend
+    
+    void OpenLogPath(const std::string&);
+    
+    
+    
+    
+    // @function AppendLogFile(data, n)
+    //
+    //
+    // @param data - const char* : rendered records
+    // @param n    - size_t      : length of @data
+    //
+    // @return bool
+    //
+    //
+    // append @data to the opened log file
+    
+    bool AppendLogFile(const char*, size_t);
+    
+    
+    
+    
+    // @function FlushFileSink()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush data written by WriteFileRecord, first write the line about held back repeats
+    // if @interval of EnableRepeatFileLog passed or the day changed since they began
+    
+    bool FlushFileSink();
+    
+    
+    
+    
+    // @function FileLog(default args, s, args)
+    //
+    //
+    // @param default args                              : set of arguments that define macro information
+    // @param TYPE          - logger::log_message_type  : type of message
+    // @param args          - pack                      : variables that will be logged
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // Put every arg in new line of log file
+    // synchronous calls of several threads are serialized, lines of one call are never split
+    // if some error occurs, throws logger::error with information about error
+    // return true if everything ok and false if there were errors with console output
+    
+    template <class ...Args>
+    bool FileLog(const char*, const char*, int, const char*, log_message_type, const Args&...);
+    
+    
+    
+    
+    // @function FileLogPass(limiter, default args, first)
+    //
+    //
+    // @param limiter       - logger::rate_limiter& : limiter of the call site
+    // @param default args                          : set of arguments that define macro information
+    // @param first                                 : first argument of the log call
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // return false if the record is suppressed, when the record passes after suppressed ones
+    // put a line with the number of suppressed records first
+    // a call site that suppressed records is watched, so logger::Flush and the exit report the rest
+    
+    template <class T>
+    bool FileLogPass(rate_limiter&, const char*, const char*, int, const char*, const T&);
+    
+    
+    
+    
+    // @function FileLogSuppressed(site, suppressed, now)
+    //
+    //
+    // @param site       - const logger::limiter_site& : call site
+    // @param suppressed - size_t                      : number of suppressed records
+    // @param now        - bool                        : write the line on this thread even in asynchronous mode
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // put a line with the number of suppressed records of @site to the log file,
+    // thread local buffers are not used, so it works when the program exits
+    
+    bool FileLogSuppressed(const limiter_site&, size_t, bool);
+    
+    
+    
+    
+    // @function FileLog(error)
+    //
+    //
+    // @param error - const logger::error& : error
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // output error's stack to the log file
+    // if some error occurs, throws logger::error with information about error
+    // return true if everything ok and false if there were errors with file output
+    
+    bool FileLog(const char*, const char*, int, const char*, error&);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::BindLogFile
+
+void logger::BindLogDirectory(const char* s) {
+    
+#ifdef OS_UNIX
+    struct stat st = {0};   // structure for holding stat
+
+    if (stat(s, &st) == -1) {
+        throw logger::error("path is invalid");
+    }
+#endif // OS_UNIX
+
+#ifdef OS_WIN
+	WIN32_FIND_DATA data;
+	HANDLE hFile = FindFirstFile(s, &data);
+
+	if (hFile == INVALID_HANDLE_VALUE) // directory doesn't exist
+		throw logger::error("path is invalid");
+#endif // OS_WIN
+
+    std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+    
+    logger::log_directory_ = s;
+    
+    logger::log_directory_generation_.fetch_add(1); // reopen the log file on the next write
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableAsyncFileLog
+
+void logger::EnableAsyncFileLog(size_t capacity) {
+    
+    logger::StartLogWorker(capacity);
+    
+    logger::async_file_log_ = true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableMappedFileLog
+
+void logger::EnableMappedFileLog(size_t extent, size_t checkpoint) {
+    
+    logger::log_file_.extent     = extent;
+    logger::log_file_.checkpoint = checkpoint;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableUringFileLog
+
+void logger::EnableUringFileLog(size_t buffers, size_t buffer_size, size_t threads) {
+    
+    logger::log_file_.buffers     = buffers;
+    logger::log_file_.buffer_size = buffer_size;
+    logger::log_file_.threads     = threads;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableSegmentFileLog
+
+void logger::EnableSegmentFileLog(size_t segment_size) {
+    
+    logger::log_file_.segment_size = segment_size;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableLogRetention
+
+void logger::EnableLogRetention(unsigned long long max_bytes, unsigned max_days) {
+    
+    logger::log_retention_.Start(max_bytes, max_days);
+    
+    std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+    
+    logger::log_retention_.Request(logger::log_directory_ + "logs", std::string());
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableLogCompression
+
+void logger::EnableLogCompression(double budget, int level) {
+    
+    std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+    
+    logger::log_compressor_.Start(logger::log_directory_ + "logs", level, budget);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableJsonFileLog
+
+void logger::EnableJsonFileLog() {
+    
+    logger::json_file_log_ = true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::EnableRepeatFileLog
+
+void logger::EnableRepeatFileLog(time_t interval) {
+    
+    static const int registered = atexit([]{ logger::FlushRepeatFileLog(); });   // runs before log_file_ is destroyed
+    
+    (void)registered;
+    
+    logger::log_file_.repeat_interval = interval;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushRepeatFileLog
+
+bool logger::FlushRepeatFileLog() {
+    
+    if(logger::async_file_log_ && logger::log_worker_) {
+        
+        logger::log_record record = logger::log_record();   // written by the background thread in order
+        
+        record.write = &logger::WriteRepeatRecord;
+        
+        logger::log_worker_->Push(record);
+        
+        return logger::log_worker_->Flush();
+    }
+    
+    return logger::WriteRepeatRecord(logger::log_file_.repeated) && logger::FlushFileSink();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::RecordHash
+
+size_t logger::RecordHash(const logger::log_record& record) {
+    
+    size_t hash = 14695981039346656037ULL & (size_t)-1;    // FNV-1a
+    size_t head[4] = { (size_t)record.filename, (size_t)record.line, (size_t)record.func, (size_t)record.type };
+    
+    const unsigned char* bytes = (const unsigned char*)head;
+    
+    for(size_t i = 0; i < sizeof(head); ++i) {
+        hash = (hash ^ bytes[i]) * (size_t)1099511628211ULL;
+    }
+    
+    for(size_t i = 0; i < record.values.Count(); ++i) {
+        
+        const char* var = record.values.Var(i);
+        size_t      n   = record.values.Length(i);
+        
+        for(size_t j = 0; j < n; ++j) {
+            hash = (hash ^ (unsigned char)var[j]) * (size_t)1099511628211ULL;
+        }
+        
+        hash = (hash ^ 0xFF) * (size_t)1099511628211ULL;    // separates values
+    }
+    
+    return hash ? hash : 1;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteRepeatRecord
+
+bool logger::WriteRepeatRecord(logger::log_record&) {
+    
+    logger::file_sink& sink = logger::log_file_;
+    
+    std::lock_guard<std::recursive_mutex> lock(sink.mutex);
+    
+    if(!sink.repeats) return true;
+    
+    char date_time[20];
+    
+    logger::DateTime(sink.repeated.time, date_time);
+    
+    
+    std::string& text = sink.text;
+    
+    text.clear();
+    
+    if(logger::json_file_log_) {
+        
+        logger::AppendJsonHead(text, date_time, sink.repeated.type, sink.repeated.filename, sink.repeated.line, sink.repeated.func);
+        text.append("\"msg\":\"last message repeated ");
+        logger::AppendVar(text, sink.repeats);
+        text.append(" times\",\"repeats\":");
+        logger::AppendVar(text, sink.repeats);
+        text.append("}\n");
+    }
+    else {
+        
+        text.append(date_time, 19) += ' ';
+        text.append(1, '[').append(logger::MessageTypeName(sink.repeated.type)).append("] ");
+        text.append(sink.repeated.filename) += ':';
+        logger::AppendVar(text, sink.repeated.line);
+        text.append(1, ' ').append(sink.repeated.func).append(" -> last message repeated ");
+        logger::AppendVar(text, sink.repeats);
+        text.append(" times\n");
+    }
+    
+    sink.repeats = 0;
+    
+    return logger::AppendLogFile(text.data(), text.length());
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::AppendLogFile
+
+bool logger::AppendLogFile(const char* data, size_t n) {
+    
+    logger::file_sink& sink = logger::log_file_;
+    
+    if(sink.segment_size && sink.written && sink.written + n > sink.segment_size) {
+        logger::RotateLogFile();
+    }
+    
+    sink.written += n;
+    
+    if(logger::log_file_.mapped.IsOpen()) {
+        return logger::log_file_.mapped.Append(data, n);
+    }
+    
+    if(logger::log_file_.uring.IsOpen()) {
+        return logger::log_file_.uring.Append(data, n);
+    }
+    
+    return logger::log_file_.stream.write(data, (std::streamsize)n).good();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FlushFileSink
+
+bool logger::FlushFileSink() {
+    
+    logger::file_sink& sink = logger::log_file_;
+    
+    std::lock_guard<std::recursive_mutex> lock(sink.mutex);
+    
+    bool written = true;
+    
+    if(sink.repeats) {  // repeats followed by silence, no record comes to write the line
+        
+        time_t now = logger::Now().seconds;
+        
+        if(now - sink.repeat_since >= sink.repeat_interval || sink.path.Expired(now)) {
+            written = logger::WriteRepeatRecord(sink.repeated);
+        }
+    }
+    
+    logger::CountFlush(logger::S_FILE);
+    
+    if(sink.mapped.IsOpen()) {
+        // written data is in the page cache already, msync only if checkpoints are enabled
+        return (!sink.checkpoint || sink.mapped.Sync()) && written;
+    }
+    
+    if(sink.uring.IsOpen()) {
+        return sink.uring.Flush() && written;
+    }
+    
+    if(!sink.stream.is_open()) return written;
+    
+    return sink.stream.flush().good() && written;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::OpenLogFile
+
+void logger::OpenLogFile(time_t time) {
+    
+    static const bool flushed = logger::AddSinkFlusher(&logger::FlushFileSink);   // logger::Flush flushes the log file
+    
+    (void)flushed;
+    
+    if(logger::log_file_.generation != logger::log_directory_generation_.load()) {
+        
+        std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+        
+        logger::log_file_.path.Reset(logger::log_directory_);
+        logger::log_file_.generation = logger::log_directory_generation_.load();
+    }
+    
+    
+    logger::OpenLogPath(logger::log_file_.path.Resolve(time));
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::RotateLogFile
+
+void logger::RotateLogFile() {
+    
+    logger::OpenLogPath(logger::log_file_.path.NextSegment());
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::OpenLogPath
+
+void logger::OpenLogPath(const std::string& path) {
+    
+    if(logger::log_file_.stream.is_open()) {
+        logger::log_file_.stream.close();
+    }
+    
+    logger::log_file_.mapped.Close();   // truncated to the written length
+    logger::log_file_.uring.Close();    // waits for buffers in flight
+    
+    if(!logger::log_file_.opened.empty() && logger::log_file_.opened != path) {
+        logger::log_compressor_.Request(logger::log_file_.opened);
+    }
+    
+    logger::log_file_.opened = path;
+    
+    
+    struct stat st;
+    
+    logger::log_file_.written = stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+    
+    if(logger::log_file_.extent && logger::log_file_.mapped.Open(path, logger::log_file_.extent, logger::log_file_.checkpoint)) {
+        logger::log_file_.written = logger::log_file_.mapped.Size();    // without the preallocated tail
+    }
+    else if(!logger::log_file_.buffers || !logger::log_file_.uring.Open(path, logger::log_file_.buffers, logger::log_file_.buffer_size, logger::log_file_.threads)) {
+        
+        logger::log_file_.stream.clear();
+        logger::log_file_.stream.open(path, std::ios::app);
+        
+        if(!logger::log_file_.stream.is_open()) {
+            logger::log_file_.generation = 0;   // check directories again next time
+            logger::log_file_.opened.clear();
+            throw logger::error("cannot open file");
+        }
+    }
+    
+    // only once the file exists, its directory must not look empty to the retention thread
+    logger::log_retention_.Request(logger::log_file_.path.Directory(), path);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteFileRecord
+
+bool logger::WriteFileRecord(logger::log_record& record) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_FILE].write);
+    
+    logger::file_sink& sink = logger::log_file_;
+    
+    std::lock_guard<std::recursive_mutex> lock(sink.mutex);    // synchronous FileLog may be called by several threads
+    
+    bool written = true;
+    
+    if(sink.repeat_interval) {
+        
+        size_t hash = record.is_error ? 0 : logger::RecordHash(record);
+        
+        if(hash && hash == sink.repeat_hash && !sink.path.Expired(record.time)) {
+            
+            if(!sink.repeats) sink.repeat_since = record.time;
+            
+            sink.repeated.time = record.time;
+            
+            ++sink.repeats;
+            
+            if(record.time - sink.repeat_since < sink.repeat_interval) {
+                logger::CountDropped(logger::S_FILE, 1);
+                return true;
+            }
+            
+            return logger::WriteRepeatRecord(record);
+        }
+        
+        written = logger::WriteRepeatRecord(record);   // the previous record is not repeated anymore
+        
+        sink.repeat_hash       = hash;
+        sink.repeated.type     = record.type;
+        sink.repeated.filename = record.filename;
+        sink.repeated.line     = record.line;
+        sink.repeated.func     = record.func;
+    }
+    
+    
+    char                        date_time[20];                      // "YYYY-MM-DD HH:MM:SS"
+    
+    logger::DateTime(record.time, date_time);
+    
+    
+    bool opened = logger::log_file_.mapped.IsOpen() || logger::log_file_.uring.IsOpen() ||
+                  (logger::log_file_.stream.is_open() && logger::log_file_.stream.good());
+    
+    if(logger::log_file_.path.Expired(record.time) || !opened ||
+       logger::log_file_.generation != logger::log_directory_generation_.load(std::memory_order_relaxed)) {
+        logger::OpenLogFile(record.time);
+    }
+    
+    
+    const char*  log_type = logger::MessageTypeName(record.type);
+    std::string& text     = logger::log_file_.text;    // keeps its capacity between records
+    
+    text.clear();
+    
+    
+    if(record.is_json) {    // one variable with every field after the head
+        
+        logger::AppendJsonHead(text, date_time, record.type, record.filename, record.line, record.func);
+        text.append(record.values.Var(0), record.values.Length(0)).append("}\n");
+    }
+    else for(size_t i = 0; i < record.values.Count(); ++i) {
+        
+        if(record.is_error && i > 0) {  // error stack
+            
+            text += '\t';
+            text.append(record.values.Var(i), record.values.Length(i)) += '\n';
+            continue;
+        }
+        
+        text.append(date_time, 19) += ' ';    // date and time
+        
+        text.append(1, '[').append(log_type).append("] ");  // message type
+        
+        text.append(record.filename) += ':';  // info
+        logger::AppendVar(text, record.line);
+        text.append(1, ' ').append(record.func).append(" -> ");
+        
+        
+        if(record.is_error) {   // error message
+            
+            text += '\"';
+            text.append(record.values.Var(0), record.values.Length(0)).append("\" error stack : \n");
+            continue;
+        }
+        
+        text.append(record.values.Var(i), record.values.Length(i)) += '\n';
+    }
+    
+    
+    written = logger::AppendLogFile(text.data(), text.length()) && written;
+    
+    logger::CountRecord(logger::S_FILE, written, text.length());
+    
+    
+    long long period = logger::stats_period_.load(std::memory_order_relaxed);
+    
+    if(period && record.time >= sink.stats_due) {
+        
+        if(sink.stats_due) written = logger::WriteStatsRecord(record) && written;
+        
+        sink.stats_due = record.time + (time_t)period;
+    }
+    
+    return written;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteStatsRecord
+
+bool logger::WriteStatsRecord(logger::log_record& record) {
+    
+    std::lock_guard<std::recursive_mutex> lock(logger::log_file_.mutex);
+    
+    char date_time[20];
+    
+    logger::DateTime(record.time, date_time);
+    
+    
+    std::string& text = logger::log_file_.text;
+    
+    text.clear();
+    
+    if(logger::json_file_log_) {
+        
+        std::string stats;      // not thread_frame, a stats line may be due when the program exits
+        
+        logger::AppendStats(stats, logger::GetStats());
+        
+        logger::AppendJsonHead(text, date_time, logger::T_INFO, "logger", 0, "stats");
+        text.append("\"msg\":");
+        logger::AppendJsonString(text, stats.data(), stats.length());
+        text.append("}\n");
+    }
+    else {
+        
+        text.append(date_time, 19).append(" [").append(logger::MessageTypeName(logger::T_INFO)).append("] logger:0 stats -> ");
+        logger::AppendStats(text, logger::GetStats());
+        text += '\n';
+    }
+    
+    return logger::AppendLogFile(text.data(), text.length());
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::WriteFileRecordNow
+
+bool logger::WriteFileRecordNow(logger::log_record& record) {
+    
+    std::lock_guard<std::recursive_mutex> lock(logger::log_file_.mutex);    // the record and its flush are not interleaved with other threads
+    
+    if(!logger::WriteFileRecord(record)) return false;
+    
+    if(logger::log_file_.uring.IsOpen()) return true;   // flushing would wait for the write
+    
+    return logger::FlushFileSink();
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FileLog
+
+template <class ...Args>
+bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::log_message_type TYPE, const Args&... args) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_FILE].enqueue);
+    
+    logger::thread_frame<logger::log_record> record;  // reused by every call of this thread
+    
+    record->write    = &logger::WriteFileRecord;
+    record->time     = logger::Now().seconds;
+    record->type     = TYPE;
+    record->filename = FILENAME;
+    record->line     = LINE;
+    record->func     = FUNC;
+    record->is_error = false;
+    record->is_json  = logger::json_file_log_;
+    
+    record->values.Clear();
+    
+    if(record->is_json) {
+        logger::ProcessJsonVars(&record->values, args...);
+    }
+    else {
+        ProcessVars(&record->values, args...);    // convert vars to string and append them to the buffer
+    }
+    
+    
+    if(logger::async_file_log_ && logger::log_worker_) {     // written right away once the central flusher stopped at exit
+        logger::log_worker_->Push(*record);
+        return true;
+    }
+    
+    return logger::WriteFileRecordNow(*record);
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FileLog
+
+bool logger::FileLog(const char* PATH, const char* FILENAME, int LINE, const char* FUNC, logger::error& error) {
+    
+    logger::stats_timer timer(logger::sink_meters_[logger::S_FILE].enqueue);
+    
+    logger::thread_frame<logger::log_record> record;  // reused by every call of this thread
+    
+    record->write    = &logger::WriteFileRecord;
+    record->time     = logger::Now().seconds;
+    record->type     = logger::T_ERROR;
+    record->filename = FILENAME;
+    record->line     = LINE;
+    record->func     = FUNC;
+    record->is_error = true;
+    record->is_json  = logger::json_file_log_;
+    
+    record->values.Clear();
+    
+    if(record->is_json) {
+        
+        std::string& data = record->values.data;
+        
+        data.append("\"msg\":");
+        logger::AppendJson(data, error.what());
+        data.append(",\"stack\":[");
+        
+        for(bool first = true; !error.error_stack_.empty(); first = false) {
+            
+            if(!first) data += ',';
+            
+            logger::AppendJson(data, error.error_stack_.top());
+            
+            error.error_stack_.pop();
+        }
+        
+        data += ']';
+        
+        record->values.ends.push_back(data.length());
+    }
+    else {
+        
+        ProcessVars(&record->values, error.what());
+        
+        while(!error.error_stack_.empty()) {
+            
+            ProcessVars(&record->values, error.error_stack_.top());
+            
+            error.error_stack_.pop();
+        }
+    }
+    
+    
+    if(logger::async_file_log_ && logger::log_worker_) {
+        logger::log_worker_->Push(*record);
+        return true;
+    }
+    
+    return logger::WriteFileRecordNow(*record);
+    
+}
+
+// @Implementation of
+//  logger::FileLogPass
+
+template <class T>
+bool logger::FileLogPass(logger::rate_limiter& limiter, const char* PATH, const char* FILENAME, int LINE, const char* FUNC, const T& first) {
+    
+    size_t passed = limiter.Pass();
+    
+    if(passed == 0) {
+        logger::CountDropped(logger::S_FILE, 1);
+        limiter.Watch(logger::limiter_site{ &logger::FileLogSuppressed, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) });
+        return false;
+    }
+    
+    if(passed > 1) {
+        logger::FileLogSuppressed(logger::limiter_site{ nullptr, PATH, FILENAME, LINE, FUNC, logger::TypeOf(first) }, passed - 1, false);
+    }
+    
+    return true;
+    
+}
+
+
+
+
+// @Implementation of
+//  logger::FileLogSuppressed
+
+bool logger::FileLogSuppressed(const logger::limiter_site& site, size_t suppressed, bool now) {
+    
+    std::string message = "suppressed ";
+    
+    logger::AppendVar(message, suppressed);
+    message += " records";
+    
+    
+    logger::log_record record = logger::log_record();
+    
+    record.write    = &logger::WriteFileRecord;
+    record.time     = logger::Now().seconds;
+    record.type     = site.type;
+    record.filename = site.filename;
+    record.line     = site.line;
+    record.func     = site.func;
+    record.is_json  = logger::json_file_log_;
+    
+    if(record.is_json) {
+        record.values.data.append("\"msg\":");
+        logger::AppendJsonString(record.values.data, message.data(), message.length());
+        record.values.ends.push_back(record.values.data.length());
+    }
+    else {
+        ProcessVars(&record.values, message);
+    }
+    
+    
+    if(!now && logger::async_file_log_ && logger::log_worker_) {
+        logger::log_worker_->Push(record);
+        return true;
+    }
+    
+    if(logger::log_worker_) logger::log_worker_->Flush();   // records queued before stay ahead of the line
+    
+    return logger::WriteFileRecordNow(record);
+    
+}
+
+// Macro that pass to the logger::FileLog additional info about place where it has been called
+// the first argument is evaluated once, calls below LOGGER_MIN_LEVEL or the runtime level
+// do nothing and do not evaluate the other arguments
+#define FileLog(...) LOGGER_GATE(logger::S_FILE, true, (logger::FileLog), __VA_ARGS__)
+
+// FileLog that writes at most RATE records per second from this call site,
+// arguments of suppressed calls except the first one are not evaluated
+#define FileLogRate(RATE, ...) LOGGER_GATE(logger::S_FILE, \
+    logger::FileLogPass(LOGGER_LIMITER(logger::rate_limiter, RATE), __FILE__,__FILENAME__,__LINE__,logger_func_, logger_first_), \
+    (logger::FileLog), __VA_ARGS__)
+
+// FileLog that writes one of every K records from this call site
+#define FileLogSample(K, ...) LOGGER_GATE(logger::S_FILE, LOGGER_LIMITER(logger::sample_limiter, K).Pass(), (logger::FileLog), __VA_ARGS__)
+
+// DEBUG ONLY mode
+#ifdef DEBUG_ONLY
+    #if defined(DEBUG) | defined(_DEBUG)
+        #define FileLog(...) NULL
+        #define FileLogRate(...) NULL
+        #define FileLogSample(...) NULL
+    #endif
+#endif
+
+#endif /* LOG_FILE_HPP */
+
+
+
+
+// log_binary.hpp
+
+#ifndef LOG_BINARY_HPP
+#define LOG_BINARY_HPP
+
+#include <string.h>                 // memcpy, strlen
+#include <stdio.h>                  // snprintf
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+#include <istream>                  // std::istream
+#include <ostream>                  // std::ostream
+#include <fstream>                  // std::ofstream
+#include <mutex>                    // std::mutex, std::lock_guard
+
+
+// Binary log file
+//
+// "CPPLOGB1" followed by entries, numbers are stored in the byte order of the machine
+//
+// 'S' call site   : u32 id, u32 line, u16 length, file name, u16 length, function name
+// 'R' record      : u32 site id, u8 log_message_type, i64 local time, u8 number of variables, variables
+//
+// variable        : 'i' i64 | 'u' u64 | 'd' f64 | 'c' char | 'b' u8 | 's' u32 length, text
+
+#define LOGGER_BINARY_MAGIC "CPPLOGB1"
+
+namespace logger {
+
+    // @class binary_sink
+    //
+    //
+    // @method Register(filename, line, func)
+    //      @return unsigned
+    //
+    //      remember a call site and return its id
+    //
+    // @method Write(data, n, time)
+    //      @return bool
+    //      @throw  logger::error
+    //
+    //      append encoded record to the binary log file of the day of @time
+    //
+    // @method Flush()
+    //      @return bool
+    //
+    //      flush written records to the file
+    //
+    //
+    // binary log files logs/{year}/{month}/ddmmyyyy.bin
+    // every file starts with the definitions of all known call sites so it can be decoded alone
+
+    class binary_sink {
+    public:
+
+        binary_sink() : generation_(0) {}
+        ~binary_sink() { Flush(); }
+
+        unsigned    Register(const char*, int, const char*);
+        bool        Write(const char*, size_t, time_t);
+        bool        Flush();
+
+    private:
+
+        void        Open(time_t);
+        void        WriteSite(unsigned);
+
+        struct site {
+            std::string filename;
+            int         line;
+            std::string func;
+        };
+
+        std::mutex          mutex_;
+        std::vector<site>   sites_;
+        std::ofstream       stream_;
+        log_path            path_;
+        size_t              generation_;
+        std::vector<char>   buffer_;        // buffer of @stream_
+
+    };
+
+
+
+
+    // @member binary_sink_
+    //
+    // binary log file shared by every BinaryLog call
+
+    binary_sink binary_sink_;
+
+
+
+
+    // @function EncodeVar(s, var)
+    //
+    //
+    // @param s   - std::string& : encoded record
+    // @param var - T            : variable to encode
+    //
+    // @return void
+    //
+    //
+    // append tagged raw bytes of @var to @s, numbers, characters and strings are stored as is
+    // other types are converted to string now because they may not outlive the call
+
+    void EncodeVar(std::string&, bool);
+    void EncodeVar(std::string&, char);
+    void EncodeVar(std::string&, signed char);
+    void EncodeVar(std::string&, unsigned char);
+    void EncodeVar(std::string&, short);
+    void EncodeVar(std::string&, unsigned short);
+    void EncodeVar(std::string&, int);
+    void EncodeVar(std::string&, unsigned int);
+    void EncodeVar(std::string&, long);
+    void EncodeVar(std::string&, unsigned long);
+    void EncodeVar(std::string&, long long);
+    void EncodeVar(std::string&, unsigned long long);
+    void EncodeVar(std::string&, float);
+    void EncodeVar(std::string&, double);
+    void EncodeVar(std::string&, const char*);
+    void EncodeVar(std::string&, const std::string&);
+
+    template <class T>
+    void EncodeVar(std::string&, const T&);
+
+
+
+
+    // @function EncodeVars(s, args)
+    //
+    //
+    // @param s    - std::string& : encoded record
+    // @param args - pack         : variables to encode
+    //
+    // @return void
+    //
+    //
+    // encode every variable of @args
+
+    void EncodeVars(std::string&);
+
+    template <class T, class ...Args>
+    void EncodeVars(std::string&, const T&, const Args&...);
+
+
+
+
+    // @function BinaryLog(site, TYPE, args)
+    //
+    //
+    // @param site - unsigned                   : call site id returned by binary_sink::Register
+    // @param TYPE - logger::log_message_type   : type of message
+    // @param args - pack                       : variables that will be logged
+    //
+    // @return bool
+    //
+    // @throw logger::error
+    //
+    //
+    // store call site id, time and raw variables in the binary log file,
+    // all text formatting is done by DecodeBinaryLog later
+    // return true if everything ok and false if there were errors with file output
+
+    template <class ...Args>
+    bool BinaryLog(unsigned, log_message_type, const Args&...);
+
+
+
+
+    // @function FlushBinaryLog()
+    //
+    //
+    // @return bool
+    //
+    //
+    // flush the binary log file
+
+    bool FlushBinaryLog();
+
+
+
+
+    // @function DecodeBinaryLog(in, out)
+    //
+    //
+    // @param in  - std::istream& : binary log file
+    // @param out - std::ostream& : text output
+    //
+    // @return void
+    //
+    // @throw logger::error
+    //
+    //
+    // convert binary log to the same text FileLog writes
+
+    void DecodeBinaryLog(std::istream&, std::ostream&);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Register
+
+unsigned logger::binary_sink::Register(const char* filename, int line, const char* func) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    site s;
+
+    s.filename = filename;
+    s.line     = line;
+    s.func     = func;
+
+    sites_.push_back(s);
+
+    unsigned id = (unsigned)(sites_.size() - 1);
+
+    if(stream_.is_open()) WriteSite(id);
+
+    return id;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::WriteSite
+
+void logger::binary_sink::WriteSite(unsigned id) {
+
+    const site& s = sites_[id];
+
+    unsigned        line      = (unsigned)s.line;
+    unsigned short  file_len  = (unsigned short)s.filename.length();
+    unsigned short  func_len  = (unsigned short)s.func.length();
+
+    stream_.put('S');
+    stream_.write((const char*)&id, sizeof(id));
+    stream_.write((const char*)&line, sizeof(line));
+    stream_.write((const char*)&file_len, sizeof(file_len));
+    stream_.write(s.filename.data(), file_len);
+    stream_.write((const char*)&func_len, sizeof(func_len));
+    stream_.write(s.func.data(), func_len);
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Open
+
+void logger::binary_sink::Open(time_t time) {
+
+    if(generation_ != logger::log_directory_generation_.load()) {
+
+        std::lock_guard<std::mutex> lock(logger::log_directory_mutex_);
+
+        path_.Reset(logger::log_directory_, ".bin");
+        generation_ = logger::log_directory_generation_.load();
+    }
+
+    if(stream_.is_open()) {
+        stream_.close();
+    }
+
+    if(buffer_.empty()) {
+        buffer_.resize(1 << 16);
+    }
+
+    stream_.clear();
+    stream_.rdbuf()->pubsetbuf(buffer_.data(), (std::streamsize)buffer_.size());
+    stream_.open(path_.Resolve(time), std::ios::app | std::ios::binary);
+
+    if(!stream_.is_open()) {
+        generation_ = 0;   // check directories again next time
+        throw logger::error("cannot open file");
+    }
+
+    if(stream_.tellp() == 0) {
+        stream_.write(LOGGER_BINARY_MAGIC, 8);
+    }
+
+    for(unsigned id = 0; id < sites_.size(); ++id) {
+        WriteSite(id);  // file may be decoded without the previous ones
+    }
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Write
+
+bool logger::binary_sink::Write(const char* data, size_t n, time_t time) {
+
+    logger::stats_timer timer(logger::sink_meters_[logger::S_BINARY].write);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(path_.Expired(time) || !stream_.good() || !stream_.is_open() ||
+       generation_ != logger::log_directory_generation_.load(std::memory_order_relaxed)) {
+        Open(time);
+    }
+
+    stream_.write(data, (std::streamsize)n);
+
+    bool written = stream_.good();
+
+    logger::CountRecord(logger::S_BINARY, written, n);
+
+    return written;
+
+}
+
+
+
+
+// @Implementation of
+//  logger::binary_sink::Flush
+
+bool logger::binary_sink::Flush() {
+
+    logger::CountFlush(logger::S_BINARY);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(!stream_.is_open()) return true;
+
+    return stream_.flush().good();
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, long long var) {
+
+    s += 'i';
+    s.append((const char*)&var, sizeof(var));
+
+}
+
+
+
+
+// @Implementation of
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, unsigned long long var) {
+
+    s += 'u';
+    s.append((const char*)&var, sizeof(var));
+
 }
 
+
+
+
 // @Implementation of
-//  logger::StrToLen
-std::string logger::StrToLen(std::string &&s, size_t len, char fill) {
-    if (s.length() >= len) return std::move(s);
-    s.insert(0, len - s.length(), fill);
-    return std::move(s);
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, double var) {
+
+    s += 'd';
+    s.append((const char*)&var, sizeof(var));
+
 }
 
+
+
+
 // @Implementation of
-//  logger::ProcessVars
-void logger::ProcessVars(std::queue<std::string>* queue) {}
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, bool var)                { s += 'b'; s += (char)var; }
+void logger::EncodeVar(std::string& s, char var)                { s += 'c'; s += var; }
+void logger::EncodeVar(std::string& s, signed char var)         { s += 'c'; s += (char)var; }
+void logger::EncodeVar(std::string& s, unsigned char var)       { s += 'c'; s += (char)var; }
+void logger::EncodeVar(std::string& s, short var)               { logger::EncodeVar(s, (long long)var); }
+void logger::EncodeVar(std::string& s, unsigned short var)      { logger::EncodeVar(s, (unsigned long long)var); }
+void logger::EncodeVar(std::string& s, int var)                 { logger::EncodeVar(s, (long long)var); }
+void logger::EncodeVar(std::string& s, unsigned int var)        { logger::EncodeVar(s, (unsigned long long)var); }
+void logger::EncodeVar(std::string& s, long var)                { logger::EncodeVar(s, (long long)var); }
+void logger::EncodeVar(std::string& s, unsigned long var)       { logger::EncodeVar(s, (unsigned long long)var); }
+void logger::EncodeVar(std::string& s, float var)               { logger::EncodeVar(s, (double)var); }
+
+
+
 
 // @Implementation of
-//  logger::ProcessVars
-template <class T>
-void logger::ProcessVars(std::queue<std::string>* queue, const T& var) {
-    std::stringstream ss;
-    ss << var;
-    queue->push(ss.str());  // copy elision
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, const char* var) {
+
+    unsigned length = var ? (unsigned)strlen(var) : 0;
+
+    s += 's';
+    s.append((const char*)&length, sizeof(length));
+    s.append(var ? var : "", length);
+
 }
 
+
+
+
 // @Implementation of
-//  logger::ProcessVars
-template <class T, class ...Args>
-void logger::ProcessVars(std::queue<std::string>* queue,
-                         const T& var,
-                         const Args&... args) {
-    std::stringstream ss;
-    ss << var;
-    queue->push(ss.str());  // copy elision
-    ProcessVars(queue, args...);
+//  logger::EncodeVar
+
+void logger::EncodeVar(std::string& s, const std::string& var) {
+
+    unsigned length = (unsigned)var.length();
+
+    s += 's';
+    s.append((const char*)&length, sizeof(length));
+    s.append(var);
+
 }
 
-#ifdef OS_WIN
+
+
+
 // @Implementation of
-//  logger::EnableWindowsAnsiEscapeSequence
-void logger::EnableWindowsAnsiEscapeSequence() {
-    // Set output mode to handle virtual terminal sequences
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (hOut == INVALID_HANDLE_VALUE) {
-        throw logger::error("cannot enable ansi escape sequence");
-    }
-    DWORD dwMode = 0;
-    if (!GetConsoleMode(hOut, &dwMode)) {
-        throw logger::error("cannot enable ansi escape sequence");
-    }
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    if (!SetConsoleMode(hOut, dwMode)) {
-        throw logger::error("cannot enable ansi escape sequence");
-    }
+//  logger::EncodeVar
+
+template <class T>
+void logger::EncodeVar(std::string& s, const T& var) {
+
+    unsigned length = 0;
+
+    s += 's';
+
+    size_t position = s.length();
+
+    s.append((const char*)&length, sizeof(length));
+
+    logger::AppendVar(s, var);  // format in place, then patch the length
+
+    length = (unsigned)(s.length() - position - sizeof(length));
+
+    memcpy(&s[position], &length, sizeof(length));
+
 }
-#endif  // OS_WIN
+
+
+
 
 // @Implementation of
-//  logger::Trace
-logger::error& logger::Trace(logger::error& error,
-                             const char* path,
-                             const char* func,
-                             int line) {
-    error.push(path, func, line);
-    return error;
+//  logger::EncodeVars
+
+void logger::EncodeVars(std::string& s) {
+
 }
 
+
+
+
 // @Implementation of
-//  logger::Trace
-logger::error logger::Trace(logger::error&& error,
-                            const char* path,
-                            const char* func,
-                            int line) {
-    error.push(path, func, line);
-    return std::move(error);
+//  logger::EncodeVars
+
+template <class T, class ...Args>
+void logger::EncodeVars(std::string& s, const T& var, const Args&... args) {
+
+    logger::EncodeVar(s, var);
+
+    EncodeVars(s, args...);
+
 }
 
+
+
+
 // @Implementation of
-//  logger::ConsoleLog
+//  logger::BinaryLog
+
 template <class ...Args>
-bool logger::ConsoleLog(const char* PATH,
-                        const char* FILENAME,
-                        int LINE,
-                        const char* FUNC,
-                        const std::string& s,
-                        const Args&... args) {
-#ifdef OS_WIN
-    static bool escape_sequence_enabled = false;
-    if (!escape_sequence_enabled) {
-        EnableWindowsAnsiEscapeSequence();
-        escape_sequence_enabled = true;
-    }
-#endif  // OS_WIN
-    // static time object
-    static time_t the_time  = time(NULL);
-    // default style is no-style
-    static logger::style default_style({logger::RESET});
-    // current time object
-    struct tm *cur_time = new tm;
-    localtime_r(&the_time, cur_time);
-    // length of string
-    size_t n = s.length();
-    // start pos of last substring without commands
-    size_t prev_it = 0;
-    // queue with variable converted to string
-    std::queue<std::string> queue;
-    // stack with active modifiers
-    std::stack<logger::style*>  modifier_stack;
-    modifier_stack.push(&default_style);
-    // convert vars to string and push them to the queue
-    ProcessVars(&queue, args...);
-    // stringstream containing output
-    std::stringstream result_ss;
-    for (size_t i = 0; i < n; ++i) {
-        if (s[i] == '%') {
-            // command
-            if (i + 1 == n) {
-                throw logger::error("parse error : empty command");
-            }
-            if (i != prev_it) {
-                result_ss.write(
-                                const_cast<char*>(s.c_str() + prev_it),
-                                sizeof(char) * (i - prev_it));
-            }
-            if (s[i + 1] == 'y') {
-                if (i + 2 != n && s[i + 2] == 'y') {
-                    if (i + 4 != n && s[i + 3] == s[i + 4] && s[i + 3] == 'y') {
-                        // %yyyy
-                        result_ss
-                            << std::to_string(cur_time->tm_year + 1900);
-                        i += 4;
-                    } else {
-                        // %yy
-                        result_ss
-                            << StrToLen(std::to_string(cur_time->tm_year % 100), 2, '0');
-                        i += 2;
-                    }
-                } else {
-                    throw logger::error("no such command : \"%y\"");
-                }
-            } else if (s[i + 1] == 'm') {
-                if (i + 2 != n && s[i + 2] == 'm') {
-                    // %mm
-                    result_ss
-                        << StrToLen(std::to_string(cur_time->tm_mon + 1), 2, '0');
-                    i += 2;
-                } else {
-                    // %m
-                    result_ss
-                        << StrToLen(std::to_string(cur_time->tm_min), 2, '0');
-                    i += 1;
-                }
-            } else if (s[i + 1] == 's') {
-                // %s
-                result_ss
-                    << StrToLen(std::to_string(cur_time->tm_sec), 2, '0');
-                i += 1;
-            } else if (s[i + 1] == 'h') {
-                // %h
-                result_ss
-                    << StrToLen(std::to_string(cur_time->tm_hour), 2, '0');
-                i += 1;
-            } else if (s[i + 1] == 'd') {
-                // %dd
-                if (i + 2 != n && s[i + 2] == 'd') {
-                    result_ss
-                        << StrToLen(std::to_string(cur_time->tm_mday), 2, '0');
-                    i += 2;
-                } else {
-                    throw logger::error("no such command : \"%d\"");
-                }
-            } else if (s[i + 1] == 'v') {
-                // %v
-                result_ss << queue.front();
-                queue.pop();
-                i += 1;
-            } else if (s[i + 1] == 'F') {
-                // %FILE %FUNC
-                if (i + 4 != n &&
-                    s[i + 2] == 'I' &&
-                    s[i + 3] == 'L' &&
-                    s[i + 4] == 'E') {
-                    result_ss << FILENAME;
-                    i += 4;
-                } else if (i + 4 != n &&
-                           s[i + 2] == 'U' &&
-                           s[i + 3] == 'N' &&
-                           s[i + 4] == 'C') {
-                    result_ss << FUNC;
-                    i += 4;
-                } else {
-                    throw logger::error("parse error");
-                }
-            } else if (s[i + 1] == 'P') {
-                // %PATH
-                if (i + 4 != n &&
-                    s[i + 2] == 'A' &&
-                    s[i + 3] == 'T' &&
-                    s[i + 4] == 'H') {
-                    result_ss << PATH;
-                    i += 4;
-                } else {
-                    throw logger::error("parse error");
-                }
-            } else if (s[i + 1] == 'L') {
-                // %LINE
-                if (i + 4 != n &&
-                    s[i + 2] == 'I' &&
-                    s[i + 3] == 'N' &&
-                    s[i + 4] == 'E') {
-                    result_ss << LINE;
-                    i += 4;
-                } else {
-                    throw logger::error("parse error");
-                }
-            } else if (s[i + 1] == '.') {
-                // %.
-                size_t class_name_begin = i+2,       // start pos of class name
-                class_name_end = std::string::npos;  // end pos of class name
-                for (size_t j = i + 2; j < n; ++j) {
-                    if (s[j] == '(') {
-                        class_name_end = j;
-                        break;
-                    }
-                }
-                if (class_name_end == std::string::npos) {
-                    throw logger::error("parse error");
-                }
-                try {
-                    // try to find style with such name
-                    logger::style &style =
-                    logger::binded_styles.at(s.substr(class_name_begin,
-                                                      class_name_end - class_name_begin));
-                    // update last active modifier
-                    modifier_stack.push(&style);
-                    // apply modifier
-                    result_ss << style;
-                } catch(std::out_of_range e) {
-                    throw logger::error(e.what());
-                }
-                i = class_name_end;
-            } else if (s[i + 1] == ')') {
-                // %)
-                if (modifier_stack.size() < 2) {
-                    throw logger::error("parse error: modifier stack is empty");
-                }
-                modifier_stack.pop();
-                result_ss << logger::RESET;
-                result_ss << *modifier_stack.top();
-                i += 1;
-            } else if (s[i + 1] == '%') {
-                // %%
-                result_ss << '%';
-                i += 1;
-            } else {
-                // nothing
-                throw logger::error("parse error : empty command");
-            }
-            // update non-command sequence
-            prev_it = i + 1;
-        }
-    }
-    if (n != prev_it) {
-        result_ss.write(const_cast<char*>(s.c_str() + prev_it),
-                        sizeof(char) * (n - prev_it));
-    }
-    // output stringstream, disable all modifiers and move to next line
-    std::cout << std::move(result_ss.str()) << logger::RESET << '\n';
-    return std::cout.good();
+bool logger::BinaryLog(unsigned site, logger::log_message_type TYPE, const Args&... args) {
+
+    static_assert(sizeof...(Args) < 256, "BinaryLog : too many variables");
+
+    logger::stats_timer timer(logger::sink_meters_[logger::S_BINARY].enqueue);
+
+    logger::thread_frame<std::string> record;   // reused by every call of this thread
+
+    time_t          time  = logger::Now().seconds;
+    long long       local = (long long)time + logger::UtcOffset(time);
+    unsigned char   type  = (unsigned char)TYPE;
+    unsigned char   count = (unsigned char)sizeof...(Args);
+
+    record->clear();
+    *record += 'R';
+    record->append((const char*)&site, sizeof(site));
+    *record += (char)type;
+    record->append((const char*)&local, sizeof(local));
+    *record += (char)count;
+
+    EncodeVars(*record, args...);
+
+    return logger::binary_sink_.Write(record->data(), record->length(), time);
+
 }
 
+
+
+
 // @Implementation of
-//  logger::ConsoleLog
-bool logger::ConsoleLog(const char*,
-                        const char*,
-                        int,
-                        const char*,
-                        logger::error& error) {
-#ifdef OS_WIN
-    static bool escape_sequence_enabled = false;
-    if (!escape_sequence_enabled) {
-        EnableWindowsAnsiEscapeSequence();
-        escape_sequence_enabled = true;
-    }
-#endif  // OS_WIN
-    std::cout
-        << logger::FG_WHITE
-        << logger::BG_RED
-        << "[ERROR]"
-        << logger::RESET
-        << " error message : \""
-        << logger::FG_RED
-        << error.what()
-        << logger::RESET
-        <<  "\" error stack :\n";
-    while (!error.error_stack_.empty()) {
-        std::cout
-            << '\t'
-            << logger::UNDERLINE
-            <<  error.error_stack_.top()
-            << logger::UNDERLINE_OFF
-            << "\n";
-        error.error_stack_.pop();
-    }
-    return std::cout.good();
-};
+//  logger::FlushBinaryLog
+
+bool logger::FlushBinaryLog() {
+
+    return logger::binary_sink_.Flush();
+
+}
+
+
+
 
 // @Implementation of
-//  logger::FileLog
-template <class ...Args>
-bool logger::FileLog(const char* PATH,
-                     const char* FILENAME,
-                     int LINE,
-                     const char* FUNC,
-                     logger::log_message_type TYPE,
-                     Args... args) {
-    static const char* month[] = {
-        "january",
-        "february",
-        "march",
-        "april",
-        "may",
-        "june",
-        "july",
-        "august",
-        "september",
-        "october",
-        "november",
-        "december"
+//  logger::DecodeBinaryLog
+
+void logger::DecodeBinaryLog(std::istream& in, std::ostream& out) {
+
+    struct site {
+        std::string filename;
+        unsigned    line;
+        std::string func;
     };
-    // static time object
-    static time_t the_time  = time(NULL);
-    // current time object
-    struct tm *cur_time = new tm;
-    localtime_r(&the_time, cur_time);
-    // structure for holding stat
-    struct stat st = {0};
-    std::string directory = logger::log_directory_ + "logs";
-    std::string year_directory = directory +
-                                 '/' +
-                                 std::to_string(cur_time->tm_year + 1900);
-    std::string month_directory = year_directory +
-                                  '/' +
-                                  month[cur_time->tm_mon];
-    std::string filename = month_directory +
-                           '/' +
-                           StrToLen(std::to_string(cur_time->tm_mday), 2, '0') +
-                           StrToLen(std::to_string(cur_time->tm_mon + 1), 2, '0') +
-                           std::to_string(cur_time->tm_year + 1900) +
-                           ".log";
-    // queue with variable converted to string
-    std::queue<std::string> queue;
-#ifdef OS_UNIX
-    int res;
-    if (stat(directory.c_str(), &st) == -1) {
-        res = mkdir(directory.c_str(), 0700);
-        if (res) {
-            throw logger::error("cannot create directory");
-        }
-    }
-    if (stat(year_directory.c_str(), &st) == -1) {
-        res = mkdir(year_directory.c_str(), 0700);
-        if (res) {
-            throw logger::error("cannot create directory");
-        }
+
+    std::vector<site>   sites;
+    std::string         value;
+    char                magic[8];
+
+    if(!in.read(magic, 8) || memcmp(magic, LOGGER_BINARY_MAGIC, 8) != 0) {
+        throw logger::error("not a binary log file");
     }
-    if (stat(month_directory.c_str(), &st) == -1) {
-        res = mkdir(month_directory.c_str(), 0700);
-        if (res) {
-            throw logger::error("cannot create directory");
+
+    char kind;
+
+    while(in.get(kind)) {
+
+        if(kind == 'S') {
+
+            unsigned        id, line;
+            unsigned short  length;
+            site            s;
+
+            in.read((char*)&id, sizeof(id));
+            in.read((char*)&line, sizeof(line));
+
+            in.read((char*)&length, sizeof(length));
+            s.filename.resize(length);
+            if(length) in.read(&s.filename[0], length);
+
+            in.read((char*)&length, sizeof(length));
+            s.func.resize(length);
+            if(length) in.read(&s.func[0], length);
+
+            s.line = line;
+
+            if(!in) break;
+
+            if(sites.size() <= id) sites.resize(id + 1);
+            sites[id] = s;
+
+            continue;
         }
-    }
-#endif  // OS_UNIX
-#ifdef OS_WIN
-    if (CreateDirectory(directory.c_str(), NULL)) {
-        // Directory created
-    } else if (ERROR_ALREADY_EXISTS == GetLastError()) {
-        // Directory already exists
-    } else {
-        throw logger::error("cannot create directory");
-    }
-    if (CreateDirectory(year_directory.c_str(), NULL)) {
-        // Directory created
-    } else if (ERROR_ALREADY_EXISTS == GetLastError()) {
-        // Directory already exists
-    } else {
-        throw logger::error("cannot create directory");
-    }
-    if (CreateDirectory(month_directory.c_str(), NULL)) {
-        // Directory created
-    } else if (ERROR_ALREADY_EXISTS == GetLastError()) {
-        // Directory already exists
-    } else {
-        throw logger::error("cannot create directory");
-    }
-#endif  // OS_WIN
-    std::ofstream file_out(filename, std::ios::app);
-    if (!file_out.is_open()) {
-        throw logger::error("cannot open file");
-    }
-    std::string log_type;
-    switch (TYPE) {
-        case logger::T_INFO:
-            log_type = "INFO";
-            break;
-        case logger::T_DEBUG:
-            log_type = "DEBUG";
-            break;
-        case logger::T_ERROR:
-            log_type = "ERROR";
-            break;
-        case logger::T_WARNING:
-            log_type = "WARNING";
-            break;
-        case logger::T_CRITICAL:
-            log_type = "CRITICAL";
-            break;
-        default:
-            log_type = "INFO";
-            break;
-    }
-    // convert vars to string and push them to the queue
-    ProcessVars(&queue, args...);
-    while (!queue.empty()) {
-        std::string cur = queue.front();
-           // date
-        file_out
-            << std::to_string(cur_time->tm_year + 1900)
-            << '-'
-            << StrToLen(std::to_string(cur_time->tm_mon + 1), 2, '0')
-            << '-'
-            << StrToLen(std::to_string(cur_time->tm_mday), 2, '0')
-            << ' ';
-        // time
-        file_out
-            << StrToLen(std::to_string(cur_time->tm_hour), 2, '0')
-            << ':'
-            << StrToLen(std::to_string(cur_time->tm_min), 2, '0')
-            << ':'
-            << StrToLen(std::to_string(cur_time->tm_sec), 2, '0')
-            << ' ';
-        // message type
-        file_out << '[' << log_type << "] ";
-        // info
-        file_out << FILENAME << ':' << LINE << ' ' << FUNC << " -> ";
-        // error
-        file_out << cur << '\n';
-        queue.pop();
-    }
-    return file_out.good();
-}
 
-// @Implementation of
-//  logger::FileLog
-bool logger::FileLog(const char* PATH,
-                     const char* FILENAME,
-                     int LINE,
-                     const char* FUNC,
-                     logger::error& error) {
-    static const char* month[] = {
-        "january",
-        "february",
-        "march",
-        "april",
-        "may",
-        "june",
-        "july",
-        "august",
-        "september",
-        "october",
-        "november",
-        "december"
-    };
-    // static time object
-    static time_t the_time  = time(NULL);
-    // current time object
-    struct tm *cur_time = new tm;
-    localtime_r(&the_time, cur_time);
-    // structure for holding stat
-    struct stat st = {0};
-    std::string directory = logger::log_directory_ + "logs";
-    std::string year_directory = directory +
-                                 '/' +
-                                 std::to_string(cur_time->tm_year + 1900);
-    std::string month_directory = year_directory +
-                                  '/' +
-                                  month[cur_time->tm_mon];
-    std::string filename = month_directory +
-                           '/' +
-                           StrToLen(std::to_string(cur_time->tm_mday), 2, '0') +
-                           StrToLen(std::to_string(cur_time->tm_mon + 1), 2, '0') +
-                           std::to_string(cur_time->tm_year + 1900) +
-                           ".log";
-#ifdef OS_UNIX
-    int res;
-    if (stat(directory.c_str(), &st) == -1) {
-        res = mkdir(directory.c_str(), 0700);
-        if (res) {
-            throw logger::error("cannot create directory");
+        if(kind != 'R') {
+            throw logger::error("broken binary log file");
         }
-    }
-    if (stat(year_directory.c_str(), &st) == -1) {
-        res = mkdir(year_directory.c_str(), 0700);
-        if (res) {
-            throw logger::error("cannot create directory");
+
+
+        unsigned        id;
+        unsigned char   type, count;
+        long long       local;
+        char            date_time[20];
+
+        in.read((char*)&id, sizeof(id));
+        type = (unsigned char)in.get();
+        in.read((char*)&local, sizeof(local));
+        count = (unsigned char)in.get();
+
+        if(!in || id >= sites.size()) {
+            throw logger::error("broken binary log file");
         }
-    }
-    if (stat(month_directory.c_str(), &st) == -1) {
-        res = mkdir(month_directory.c_str(), 0700);
-        if (res) {
-            throw logger::error("cannot create directory");
+
+        logger::CivilDateTime(local, date_time);
+
+        const site& s        = sites[id];
+        const char* log_type = logger::MessageTypeName((logger::log_message_type)type);
+
+        for(unsigned i = 0; i < count; ++i) {
+
+            char tag = (char)in.get();
+
+            value.clear();
+
+            if(tag == 'i') {
+                long long var;
+                in.read((char*)&var, sizeof(var));
+                logger::AppendVar(value, var);
+            } else if(tag == 'u') {
+                unsigned long long var;
+                in.read((char*)&var, sizeof(var));
+                logger::AppendVar(value, var);
+            } else if(tag == 'd') {
+                double var;
+                in.read((char*)&var, sizeof(var));
+                logger::AppendVar(value, var);
+            } else if(tag == 'c') {
+                value += (char)in.get();
+            } else if(tag == 'b') {
+                logger::AppendVar(value, in.get() != 0);
+            } else if(tag == 's') {
+                unsigned length;
+                in.read((char*)&length, sizeof(length));
+                value.resize(length);
+                if(length) in.read(&value[0], length);
+            } else {
+                throw logger::error("broken binary log file");
+            }
+
+            if(!in) {
+                throw logger::error("broken binary log file");
+            }
+
+            out.write(date_time, 19) << ' '; // date and time
+
+            out << '[' << log_type << "] "; // message type
+
+            out << s.filename << ':' << s.line << ' ' << s.func << " -> "; // info
+
+            out << value << '\n';
         }
     }
-#endif  // OS_UNIX
-#ifdef OS_WIN
-    if (CreateDirectory(directory.c_str(), NULL)) {
-        // Directory created
-    } else if (ERROR_ALREADY_EXISTS == GetLastError()) {
-        // Directory already exists
-    } else {
-        throw logger::error("cannot create directory");
-    }
-    if (CreateDirectory(year_directory.c_str(), NULL)) {
-        // Directory created
-    } else if (ERROR_ALREADY_EXISTS == GetLastError()) {
-        // Directory already exists
-    } else {
-        throw logger::error("cannot create directory");
-    }
-    if (CreateDirectory(month_directory.c_str(), NULL)) {
-        // Directory created
-    } else if (ERROR_ALREADY_EXISTS == GetLastError()) {
-        // Directory already exists
-    } else {
-        throw logger::error("cannot create directory");
-    }
-#endif  // OS_WIN
-    std::ofstream file_out(filename, std::ios::app);
-    if (!file_out.is_open()) {
-        throw logger::error("cannot open file");
-    }
-    std::string log_type = "ERROR";
-    // date
-    file_out
-        << std::to_string(cur_time->tm_year + 1900)
-        << '-'
-        << StrToLen(std::to_string(cur_time->tm_mon + 1), 2, '0')
-        << '-'
-        << StrToLen(std::to_string(cur_time->tm_mday), 2, '0')
-        << ' ';
-    // time
-    file_out
-        << StrToLen(std::to_string(cur_time->tm_hour), 2, '0')
-        << ':'
-        << StrToLen(std::to_string(cur_time->tm_min), 2, '0')
-        << ':'
-        << StrToLen(std::to_string(cur_time->tm_sec), 2, '0')
-        << ' ';
-    // message type
-    file_out << '[' << log_type << "] ";
-    // info
-    file_out << FILENAME << ':' << LINE << ' ' << FUNC << " -> ";
-    // error stack
-    file_out << '\"' <<  error.what() << "\" error stack : \n";
-    while (!error.error_stack_.empty()) {
-        file_out << '\t' << error.error_stack_.top() << '\n';
-        error.error_stack_.pop();
-    }
-    return file_out.good();
-}
-
-// Macro that pass to the logger::ConsoleLog
-// additional info about place where it has been called
-#define ConsoleLog(...) logger::ConsoleLog(__FILE__, __FILENAME__, __LINE__, __func__, __VA_ARGS__)
 
-// Macro that pass to the logger::Trace
-// additional info about place where it has been called
-#define Trace(x) logger::Trace(x, __FILE__, __func__, __LINE__)
+}
 
-// Macro that pass to the logger::FileLog
-// additional info about place where it has been called
-#define FileLog(...) logger::FileLog(__FILE__, __FILENAME__, __LINE__, __func__ , __VA_ARGS__)
+// Macro that registers the call site once and passes its id to the logger::BinaryLog
+// TYPE is evaluated once, calls below LOGGER_MIN_LEVEL or the runtime level do nothing
+// and do not evaluate the other arguments
+#define BinaryLog(TYPE, ...) logger::Gate(logger::S_BINARY, TYPE, __func__, \
+    [&](decltype((TYPE)) logger_first_, const char* logger_func_) -> bool { \
+        static const unsigned site = logger::binary_sink_.Register(__FILENAME__, __LINE__, logger_func_); \
+        return logger::BinaryLog(site, logger_first_, __VA_ARGS__); })
 
 // DEBUG ONLY mode
 #ifdef DEBUG_ONLY
-#if defined(DEBUG) | defined(_DEBUG)
-#define ConsoleLog(...) NULL
-#define FileLog(...) NULL
-#endif  // defined(DEBUG) | defined(_DEBUG)
-#endif  // DEBUG_ONLY
+    #if defined(DEBUG) | defined(_DEBUG)
+        #define BinaryLog(...) NULL
+    #endif
+#endif
+
+#endif /* LOG_BINARY_HPP */
+
 #endif  // LOG_HPP
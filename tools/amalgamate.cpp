@@ -0,0 +1,117 @@
+// Joins the headers of library/ into one file, the release/log.hpp users include
+//
+// usage: amalgamate [library directory] [output]      (library release/log.hpp by default)
+//
+// every header is written after the headers it includes, starting from the ones users include,
+// license comments of the headers and #include "..." lines are left out, header guards are kept
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+
+static const char* roots[] = { "log_console.hpp", "log_file.hpp", "log_binary.hpp" };
+
+static const char* head =
+    "// MIT License\n"
+    "//\n"
+    "// Copyright (c) 2020 MrDanikus\n"
+    "//\n"
+    "// Permission is hereby granted, free of charge, to any person obtaining a copy\n"
+    "// of this software and associated documentation files (the \"Software\"), to deal\n"
+    "// in the Software without restriction, including without limitation the rights\n"
+    "// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell\n"
+    "// copies of the Software, and to permit persons to whom the Software is\n"
+    "// furnished to do so, subject to the following conditions:\n"
+    "//\n"
+    "// The above copyright notice and this permission notice shall be included in all\n"
+    "// copies or substantial portions of the Software.\n"
+    "//\n"
+    "// THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR\n"
+    "// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,\n"
+    "// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE\n"
+    "// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER\n"
+    "// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,\n"
+    "// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE\n"
+    "// SOFTWARE.\n"
+    "\n"
+    "// This is full log library in one file ready to use\n"
+    "// Just include it\n"
+    "// Generated from library/ by tools/amalgamate.cpp, do not edit\n"
+    "\n"
+    "#ifndef LOG_HPP\n"
+    "#define LOG_HPP\n";
+
+// append @name and the headers it includes to @out, every header once
+static bool Append(const std::string& directory, const std::string& name, std::set<std::string>& visited, std::string& out) {
+
+    if(!visited.insert(name).second) return true;
+
+    std::ifstream in((directory + "/" + name).c_str(), std::ios::binary);   // keeps CRLF of Windows blocks
+
+    if(!in.is_open()) {
+        std::cerr << directory << "/" << name << " : cannot open file" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    std::string              line;
+
+    while(std::getline(in, line)) lines.push_back(line);
+
+
+    // headers it includes go first
+    for(size_t i = 0; i < lines.size(); ++i) {
+
+        if(lines[i].compare(0, 10, "#include \"") != 0) continue;
+
+        size_t end = lines[i].find('"', 10);
+
+        if(end == std::string::npos || !Append(directory, lines[i].substr(10, end - 10), visited, out)) return false;
+    }
+
+
+    size_t first = 0;
+
+    while(first < lines.size() && lines[first].compare(0, 2, "//") == 0) ++first;     // license
+    while(first < lines.size() && (lines[first].empty() || lines[first] == "\r")) ++first;
+
+    out += "\n\n\n\n// " + name + "\n\n";
+
+    for(size_t i = first; i < lines.size(); ++i) {
+
+        if(lines[i].compare(0, 10, "#include \"") == 0) continue;
+
+        out += lines[i];
+        out += '\n';
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    std::string directory = argc > 1 ? argv[1] : "library";
+    std::string output    = argc > 2 ? argv[2] : "release/log.hpp";
+
+    std::set<std::string> visited;
+    std::string           out = head;
+
+    for(size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); ++i) {
+        if(!Append(directory, roots[i], visited, out)) return 1;
+    }
+
+    out += "\n#endif  // LOG_HPP\n";
+
+
+    std::ofstream file(output.c_str(), std::ios::binary);
+
+    if(!file.is_open() || !file.write(out.data(), (std::streamsize)out.length())) {
+        std::cerr << output << " : cannot write file" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
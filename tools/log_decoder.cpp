@@ -0,0 +1,37 @@
+// Converts binary log files written by BinaryLog to the text FileLog writes
+//
+// usage: log_decoder file.bin [file.bin ...] > file.log
+
+#include <iostream>
+#include <fstream>
+#include "../library/log_binary.hpp"
+
+int main(int argc, char** argv) {
+    
+    if(argc < 2) {
+        std::cerr << "usage: " << argv[0] << " file.bin [file.bin ...]" << std::endl;
+        return 1;
+    }
+    
+    int result = 0;
+    
+    for(int i = 1; i < argc; ++i) {
+        
+        std::ifstream in(argv[i], std::ios::binary);
+        
+        if(!in.is_open()) {
+            std::cerr << argv[i] << " : cannot open file" << std::endl;
+            result = 1;
+            continue;
+        }
+        
+        try {
+            logger::DecodeBinaryLog(in, std::cout);
+        } catch (logger::error& e) {
+            std::cerr << argv[i] << " : " << e.what() << std::endl;
+            result = 1;
+        }
+    }
+    
+    return result;
+}